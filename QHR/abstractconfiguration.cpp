@@ -4,6 +4,8 @@
  */
 
 #include "abstractconfiguration.h"
+#include "abstractcredentialprovider.h"
+#include "job.h"
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonParseError>
@@ -33,4 +35,29 @@ QString AbstractConfiguration::userAgent() const
     return QStringLiteral("Libqhr %1").arg(QStringLiteral(QHR_VERSION));
 }
 
+QUrl AbstractConfiguration::baseUrl() const
+{
+    return QUrl(QStringLiteral("https://robot-ws.your-server.de"));
+}
+
+bool AbstractConfiguration::isHttp2Allowed() const
+{
+    return false;
+}
+
+bool AbstractConfiguration::isPipeliningAllowed() const
+{
+    return false;
+}
+
+AbstractCredentialProvider *AbstractConfiguration::credentialProvider() const
+{
+    return nullptr;
+}
+
+ResponseCache *AbstractConfiguration::responseCache() const
+{
+    return QHR::responseCache();
+}
+
 #include "moc_abstractconfiguration.cpp"
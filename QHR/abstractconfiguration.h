@@ -16,6 +16,9 @@ class QJsonObject;
 
 namespace QHR {
 
+class AbstractCredentialProvider;
+class ResponseCache;
+
 /*!
  * \brief Stores configuratoin for API requests.
  *
@@ -89,6 +92,58 @@ public:
      */
     Q_INVOKABLE virtual QString userAgent() const;
 
+    /*!
+     * \brief Returns the base URL of the API.
+     *
+     * All request paths will be appended to this URL. Reimplement this to use a different
+     * host, port or scheme, for example to run against a local test server. The default
+     * implementation returns "https://robot-ws.your-server.de".
+     */
+    Q_INVOKABLE virtual QUrl baseUrl() const;
+
+    /*!
+     * \brief Returns \c true if requests are allowed to use HTTP/2.
+     *
+     * If HTTP/2 is allowed, all concurrent jobs will share a single multiplexed connection
+     * to the API host instead of using up to six connections and queuing the remaining
+     * requests. If the server does not support HTTP/2, HTTP/1.1 will be used. Requires
+     * Qt 5.8 or newer. The default implementation returns \c false.
+     *
+     * \sa isPipeliningAllowed()
+     */
+    Q_INVOKABLE virtual bool isHttp2Allowed() const;
+
+    /*!
+     * \brief Returns \c true if \c GET requests are allowed to use HTTP/1.1 pipelining.
+     *
+     * Pipelining will only be used for \c GET requests if HTTP/2 is not used. If a
+     * pipelined request fails with a protocol error, pipelining will be disabled for
+     * that host and the request will be sent again. The default implementation
+     * returns \c false.
+     *
+     * \sa isHttp2Allowed()
+     */
+    Q_INVOKABLE virtual bool isPipeliningAllowed() const;
+
+    /*!
+     * \brief Returns a provider for asynchronously fetched credentials.
+     *
+     * If this returns a valid provider, it will be used instead of username() and
+     * password(). The configuration does not take ownership of the provider.
+     * The default implementation returns \c nullptr.
+     */
+    Q_INVOKABLE virtual QHR::AbstractCredentialProvider *credentialProvider() const;
+
+    /*!
+     * \brief Returns the response cache used for requests with this configuration.
+     *
+     * Reimplement this to use a different cache for this configuration, for example one
+     * that stores responses on disk via ResponseCache::setDirectory(). The default
+     * implementation returns QHR::responseCache(). Return \c nullptr to disable caching.
+     * The configuration does not take ownership of the cache.
+     */
+    virtual ResponseCache *responseCache() const;
+
 private:
     Q_DISABLE_COPY(AbstractConfiguration)
 };
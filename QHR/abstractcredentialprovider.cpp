@@ -0,0 +1,99 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "abstractcredentialprovider_p.h"
+#include "logging.h"
+
+using namespace QHR;
+
+AbstractCredentialProvider::AbstractCredentialProvider(QObject *parent)
+    : QObject(parent), cd_ptr(new AbstractCredentialProviderPrivate)
+{
+    connect(this, &AbstractCredentialProvider::credentialsChanged, this, &AbstractCredentialProvider::invalidate);
+}
+
+AbstractCredentialProvider::~AbstractCredentialProvider() = default;
+
+bool AbstractCredentialProvider::isReady() const
+{
+    Q_D(const AbstractCredentialProvider);
+    QReadLocker locker(&d->lock);
+    return d->ready;
+}
+
+QString AbstractCredentialProvider::username() const
+{
+    Q_D(const AbstractCredentialProvider);
+    QReadLocker locker(&d->lock);
+    return d->username;
+}
+
+QByteArray AbstractCredentialProvider::authorizationHeader() const
+{
+    Q_D(const AbstractCredentialProvider);
+    QReadLocker locker(&d->lock);
+    return d->authHeader;
+}
+
+void AbstractCredentialProvider::requestCredentials()
+{
+    Q_D(AbstractCredentialProvider);
+    // decided under the same lock that marks the fetch, invalidate() might run in between otherwise
+    bool ready = false;
+    {
+        QWriteLocker locker(&d->lock);
+        ready = d->ready;
+        if (!ready) {
+            if (d->fetching) {
+                return;
+            }
+            d->fetching = true;
+        }
+    }
+
+    if (ready) {
+        Q_EMIT credentialsReady();
+    } else {
+        qCDebug(qhrCore) << "Fetching credentials via" << this;
+        fetchCredentials();
+    }
+}
+
+void AbstractCredentialProvider::invalidate()
+{
+    Q_D(AbstractCredentialProvider);
+    qCDebug(qhrCore) << "Invalidating cached credentials of" << this;
+    QWriteLocker locker(&d->lock);
+    d->ready = false;
+    d->username.clear();
+    d->authHeader.clear();
+}
+
+void AbstractCredentialProvider::setCredentials(const QString &username, const QString &password)
+{
+    Q_D(AbstractCredentialProvider);
+    {
+        QWriteLocker locker(&d->lock);
+        d->username = username;
+        const QString auth = username + QLatin1Char(':') + password;
+        d->authHeader = QByteArrayLiteral("Basic ") + auth.toUtf8().toBase64();
+        d->ready = true;
+        d->fetching = false;
+    }
+    Q_EMIT credentialsReady();
+}
+
+void AbstractCredentialProvider::setCredentialsError(const QString &errorString)
+{
+    Q_D(AbstractCredentialProvider);
+    {
+        QWriteLocker locker(&d->lock);
+        d->fetching = false;
+    }
+    qCWarning(qhrCore) << "Failed to fetch credentials:" << errorString;
+    Q_EMIT credentialsFailed(errorString);
+}
+
+#include "moc_abstractcredentialprovider.cpp"
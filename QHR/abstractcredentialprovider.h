@@ -0,0 +1,129 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_ABSTRACTCREDENTIALPROVIDER_H
+#define QHR_ABSTRACTCREDENTIALPROVIDER_H
+
+#include <QObject>
+#include "qhr_global.h"
+#include <memory>
+
+namespace QHR {
+
+class AbstractCredentialProviderPrivate;
+
+/*!
+ * \brief Provides credentials for API requests asynchronously.
+ *
+ * Reimplement fetchCredentials() to get the username and password, for example from a
+ * secret store, and call setCredentials() or setCredentialsError() when done. The
+ * credentials are fetched only once and the encoded \c Authorization header is cached
+ * until invalidate() is called or credentialsChanged() is emitted.
+ *
+ * Jobs will not block while the credentials are fetched, they will wait for
+ * credentialsReady() and will then continue to send their requests. All jobs that
+ * are started while a fetch is running will share that fetch.
+ *
+ * Return the provider from AbstractConfiguration::credentialProvider() to use it. It will
+ * then be used instead of AbstractConfiguration::username() and AbstractConfiguration::password().
+ * The cached values can be read from any thread.
+ *
+ * \headerfile "" <QHR/AbstractCredentialProvider>
+ */
+class QHR_LIBRARY AbstractCredentialProvider : public QObject
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief Constructs a new %AbstractCredentialProvider object with the given \a parent.
+     */
+    explicit AbstractCredentialProvider(QObject *parent = nullptr);
+
+    /*!
+     * \brief Destroys the %AbstractCredentialProvider object.
+     */
+    ~AbstractCredentialProvider() override;
+
+    /*!
+     * \brief Returns \c true if the credentials have been fetched and are cached.
+     */
+    bool isReady() const;
+
+    /*!
+     * \brief Returns the cached username or a null string if not ready.
+     */
+    QString username() const;
+
+    /*!
+     * \brief Returns the cached value for the \c Authorization header or an empty byte array if not ready.
+     */
+    QByteArray authorizationHeader() const;
+
+public Q_SLOTS:
+    /*!
+     * \brief Requests the credentials.
+     *
+     * If the credentials are already cached, credentialsReady() will be emitted immediately.
+     * Otherwise fetchCredentials() will be called if no fetch is already running.
+     */
+    void requestCredentials();
+
+    /*!
+     * \brief Removes the cached credentials.
+     *
+     * The next job will fetch the credentials again. This is also called if the API
+     * rejects the credentials.
+     */
+    void invalidate();
+
+Q_SIGNALS:
+    /*!
+     * \brief Emit this if the stored credentials have been changed.
+     *
+     * This invalidates the cached credentials.
+     */
+    void credentialsChanged();
+
+    /*!
+     * \brief Emitted when the credentials have been fetched.
+     */
+    void credentialsReady();
+
+    /*!
+     * \brief Emitted when fetching the credentials failed with \a errorString.
+     */
+    void credentialsFailed(const QString &errorString);
+
+protected:
+    /*!
+     * \brief Starts fetching the credentials.
+     *
+     * Reimplement this to start fetching the credentials asynchronously. When done, call
+     * setCredentials() or setCredentialsError(). It is fine to call them from within this
+     * function if the credentials are available immediately.
+     */
+    virtual void fetchCredentials() = 0;
+
+    /*!
+     * \brief Sets the fetched \a username and \a password.
+     *
+     * The password will not be stored, only the encoded \c Authorization header.
+     */
+    void setCredentials(const QString &username, const QString &password);
+
+    /*!
+     * \brief Finishes the running fetch with \a errorString.
+     */
+    void setCredentialsError(const QString &errorString);
+
+private:
+    const std::unique_ptr<AbstractCredentialProviderPrivate> cd_ptr;
+    Q_DECLARE_PRIVATE_D(cd_ptr, AbstractCredentialProvider)
+    Q_DISABLE_COPY(AbstractCredentialProvider)
+};
+
+}
+
+#endif // QHR_ABSTRACTCREDENTIALPROVIDER_H
@@ -0,0 +1,28 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_ABSTRACTCREDENTIALPROVIDER_P_H
+#define QHR_ABSTRACTCREDENTIALPROVIDER_P_H
+
+#include "abstractcredentialprovider.h"
+#include <QReadWriteLock>
+#include <QByteArray>
+#include <QString>
+
+namespace QHR {
+
+class AbstractCredentialProviderPrivate
+{
+public:
+    mutable QReadWriteLock lock;
+    QString username;
+    QByteArray authHeader;
+    bool ready = false;
+    bool fetching = false;
+};
+
+}
+
+#endif // QHR_ABSTRACTCREDENTIALPROVIDER_P_H
@@ -0,0 +1,465 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "addressindex_p.h"
+#include "logging.h"
+#include <QtAlgorithms>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <algorithm>
+#include <cstring>
+
+using namespace QHR;
+
+namespace {
+
+inline uint charCode(QChar c) { return c.unicode(); }
+
+inline uint charCode(char c) { return static_cast<uchar>(c); }
+
+inline int hexValue(uint c)
+{
+    if (c - '0' < 10u) {
+        return static_cast<int>(c - '0');
+    }
+    const uint lower = c | 0x20;
+    if (lower - 'a' < 6u) {
+        return static_cast<int>(lower - 'a' + 10);
+    }
+    return -1;
+}
+
+template<typename Char>
+bool parseIpv4(const Char *s, const Char *end, quint32 *out)
+{
+    quint32 result = 0;
+    for (int part = 0; part < 4; ++part) {
+        if (part > 0) {
+            if (s == end || charCode(*s) != '.') {
+                return false;
+            }
+            ++s;
+        }
+        uint value = 0;
+        int digits = 0;
+        while (s != end && digits < 4) {
+            const uint digit = charCode(*s) - '0';
+            if (digit > 9) {
+                break;
+            }
+            value = value * 10 + digit;
+            ++digits;
+            ++s;
+        }
+        if (digits == 0 || digits > 3 || value > 255) {
+            return false;
+        }
+        result = (result << 8) | value;
+    }
+
+    if (s != end) {
+        return false;
+    }
+
+    *out = result;
+    return true;
+}
+
+template<typename Char>
+bool parseIpv6(const Char *s, const Char *end, quint16 (&groups)[8])
+{
+    int count = 0;
+    int compressed = -1;
+
+    if (s != end && charCode(*s) == ':') {
+        if (end - s < 2 || charCode(s[1]) != ':') {
+            return false;
+        }
+        s += 2;
+        compressed = 0;
+    }
+
+    while (s != end) {
+        if (count >= 8) {
+            return false;
+        }
+
+        const Char *groupStart = s;
+        uint value = 0;
+        int digits = 0;
+        while (s != end) {
+            const int h = hexValue(charCode(*s));
+            if (h < 0) {
+                break;
+            }
+            if (++digits > 4) {
+                return false;
+            }
+            value = (value << 4) | static_cast<uint>(h);
+            ++s;
+        }
+
+        // embedded IPv4 address in the last 32 bits
+        if (s != end && charCode(*s) == '.') {
+            quint32 ipv4;
+            if (count > 6 || !parseIpv4(groupStart, end, &ipv4)) {
+                return false;
+            }
+            groups[count++] = static_cast<quint16>(ipv4 >> 16);
+            groups[count++] = static_cast<quint16>(ipv4 & 0xffff);
+            s = end;
+            break;
+        }
+
+        if (digits == 0) {
+            return false;
+        }
+        groups[count++] = static_cast<quint16>(value);
+
+        if (s == end) {
+            break;
+        }
+        if (charCode(*s) != ':') {
+            return false;
+        }
+        ++s;
+        if (s != end && charCode(*s) == ':') {
+            if (compressed >= 0) {
+                return false;
+            }
+            compressed = count;
+            ++s;
+        } else if (s == end) {
+            return false;
+        }
+    }
+
+    if (compressed >= 0) {
+        if (count > 7) {
+            return false;
+        }
+        // move the groups after :: to the end and fill the gap with zeros
+        const int tail = count - compressed;
+        for (int i = 0; i < tail; ++i) {
+            groups[7 - i] = groups[count - 1 - i];
+        }
+        for (int i = compressed; i < 8 - tail; ++i) {
+            groups[i] = 0;
+        }
+    } else if (count != 8) {
+        return false;
+    }
+
+    return true;
+}
+
+template<typename Char>
+bool parseAddress(const Char *s, int size, AddressIndex::Address *address)
+{
+    const Char *end = s + size;
+
+    bool hasColon = false;
+    for (const Char *p = s; p != end; ++p) {
+        if (charCode(*p) == ':') {
+            hasColon = true;
+            break;
+        }
+    }
+
+    if (!hasColon) {
+        quint32 ipv4;
+        if (!parseIpv4(s, end, &ipv4)) {
+            return false;
+        }
+        address->hi = static_cast<quint64>(ipv4) << 32;
+        address->lo = 0;
+        address->ipv6 = false;
+        return true;
+    }
+
+    quint16 g[8];
+    if (!parseIpv6(s, end, g)) {
+        return false;
+    }
+
+    if (g[0] == 0 && g[1] == 0 && g[2] == 0 && g[3] == 0 && g[4] == 0 && g[5] == 0xffff) {
+        // IPv4 mapped address
+        address->hi = (static_cast<quint64>(g[6]) << 48) | (static_cast<quint64>(g[7]) << 32);
+        address->lo = 0;
+        address->ipv6 = false;
+        return true;
+    }
+
+    address->hi = (static_cast<quint64>(g[0]) << 48) | (static_cast<quint64>(g[1]) << 32) | (static_cast<quint64>(g[2]) << 16) | g[3];
+    address->lo = (static_cast<quint64>(g[4]) << 48) | (static_cast<quint64>(g[5]) << 32) | (static_cast<quint64>(g[6]) << 16) | g[7];
+    address->ipv6 = true;
+    return true;
+}
+
+inline quint64 maskWord(quint64 word, int bits)
+{
+    if (bits <= 0) {
+        return 0;
+    }
+    return bits >= 64 ? word : word & (~Q_UINT64_C(0) << (64 - bits));
+}
+
+inline void maskKey(quint64 &hi, quint64 &lo, int length)
+{
+    lo = maskWord(lo, length - 64);
+    hi = maskWord(hi, length);
+}
+
+inline int bitAt(quint64 hi, quint64 lo, int position)
+{
+    return static_cast<int>(position < 64 ? (hi >> (63 - position)) & 1 : (lo >> (127 - position)) & 1);
+}
+
+inline int commonLength(quint64 hi1, quint64 lo1, quint64 hi2, quint64 lo2)
+{
+    quint64 x = hi1 ^ hi2;
+    if (x) {
+        return static_cast<int>(qCountLeadingZeroBits(x));
+    }
+    x = lo1 ^ lo2;
+    return x ? 64 + static_cast<int>(qCountLeadingZeroBits(x)) : 128;
+}
+
+}
+
+int AddressTrie::addNode(quint64 hi, quint64 lo, int length, int value)
+{
+    Node node;
+    node.hi = hi;
+    node.lo = lo;
+    node.length = static_cast<quint8>(length);
+    node.value = value;
+    nodes.push_back(node);
+    return static_cast<int>(nodes.size() - 1);
+}
+
+void AddressTrie::insert(quint64 hi, quint64 lo, int length, int value)
+{
+    maskKey(hi, lo, length);
+
+    // addNode() might reallocate, so links are always resolved by index
+    int parent = -1;
+    int slot = 0;
+    auto link = [this](int p, int s) -> int& {
+        return p < 0 ? root : nodes[static_cast<size_t>(p)].child[s];
+    };
+
+    int index = root;
+    while (index >= 0) {
+        const Node node = nodes[static_cast<size_t>(index)];
+        const int common = std::min(commonLength(node.hi, node.lo, hi, lo), std::min<int>(node.length, length));
+
+        if (common == node.length) {
+            if (common == length) {
+                nodes[static_cast<size_t>(index)].value = value;
+                return;
+            }
+            parent = index;
+            slot = bitAt(hi, lo, node.length);
+            index = node.child[slot];
+            continue;
+        }
+
+        // the new prefix diverges inside the compressed path of node
+        quint64 splitHi = hi;
+        quint64 splitLo = lo;
+        maskKey(splitHi, splitLo, common);
+        const int split = addNode(splitHi, splitLo, common, common == length ? value : -1);
+        nodes[static_cast<size_t>(split)].child[bitAt(node.hi, node.lo, common)] = index;
+        if (common != length) {
+            const int leaf = addNode(hi, lo, length, value);
+            nodes[static_cast<size_t>(split)].child[bitAt(hi, lo, common)] = leaf;
+        }
+        link(parent, slot) = split;
+        return;
+    }
+
+    const int leaf = addNode(hi, lo, length, value);
+    link(parent, slot) = leaf;
+}
+
+int AddressTrie::lookup(quint64 hi, quint64 lo) const
+{
+    int best = -1;
+    int index = root;
+    while (index >= 0) {
+        const Node &node = nodes[static_cast<size_t>(index)];
+        if (commonLength(node.hi, node.lo, hi, lo) < node.length) {
+            break;
+        }
+        if (node.value >= 0) {
+            best = node.value;
+        }
+        if (node.length >= 128) {
+            break;
+        }
+        index = node.child[bitAt(hi, lo, node.length)];
+    }
+    return best;
+}
+
+void AddressIndexData::insert(const AddressIndex::Address &address, int prefixLength, const AddressMatch &match)
+{
+    entries.push_back(match);
+    AddressMatch &entry = entries.last();
+    entry.prefixLength = qBound(0, prefixLength, address.ipv6 ? 128 : 32);
+    AddressTrie &trie = address.ipv6 ? ipv6 : ipv4;
+    trie.insert(address.hi, address.lo, entry.prefixLength, entries.size() - 1);
+}
+
+AddressMatch AddressIndexData::lookup(const AddressIndex::Address &address) const
+{
+    const int index = address.ipv6 ? ipv6.lookup(address.hi, address.lo) : ipv4.lookup(address.hi, address.lo);
+    return index >= 0 ? entries.at(index) : AddressMatch();
+}
+
+AddressIndexPrivate::AddressIndexPrivate(AddressIndex *q)
+    : q_ptr(q)
+{
+
+}
+
+AddressIndexPrivate::~AddressIndexPrivate() = default;
+
+std::shared_ptr<const AddressIndexData> AddressIndexPrivate::current() const
+{
+    QReadLocker locker(&lock);
+    return data;
+}
+
+AddressIndex::Snapshot::Snapshot() = default;
+
+AddressMatch AddressIndex::Snapshot::lookup(const Address &address) const
+{
+    return d ? d->lookup(address) : AddressMatch();
+}
+
+AddressMatch AddressIndex::Snapshot::lookup(const QString &address) const
+{
+    Address a;
+    return AddressIndex::parse(address, &a) ? lookup(a) : AddressMatch();
+}
+
+AddressMatch AddressIndex::Snapshot::lookup(QLatin1String address) const
+{
+    Address a;
+    return AddressIndex::parse(address, &a) ? lookup(a) : AddressMatch();
+}
+
+int AddressIndex::Snapshot::size() const
+{
+    return d ? d->entries.size() : 0;
+}
+
+quint64 AddressIndex::Snapshot::generation() const
+{
+    return d ? d->generation : 0;
+}
+
+AddressIndex::AddressIndex()
+    : d_ptr(new AddressIndexPrivate(this))
+{
+
+}
+
+AddressIndex::~AddressIndex() = default;
+
+void AddressIndex::rebuild(const QVector<IpAddress> &ips, const QVector<Subnet> &subnets)
+{
+    Q_D(AddressIndex);
+
+    // built without holding the lock, readers continue to use the current index
+    auto data = std::make_shared<AddressIndexData>();
+    data->entries.reserve(ips.size() + subnets.size());
+
+    Address address;
+
+    for (const Subnet &subnet : subnets) {
+        if (Q_UNLIKELY(!parse(subnet.ip(), &address))) {
+            qCWarning(qhrCore) << "Skipping subnet with invalid address" << subnet.ip() << "in address index.";
+            continue;
+        }
+        AddressMatch match;
+        match.subnet = subnet;
+        match.serverNumber = subnet.serverNumber();
+        match.failover = subnet.isFailover();
+        data->insert(address, subnet.mask(), match);
+    }
+
+    // inserted last, so single addresses replace subnets with the same prefix
+    for (const IpAddress &ip : ips) {
+        if (Q_UNLIKELY(!parse(ip.ip(), &address))) {
+            qCWarning(qhrCore) << "Skipping invalid IP address" << ip.ip() << "in address index.";
+            continue;
+        }
+        AddressMatch match;
+        match.ip = ip;
+        match.serverNumber = ip.serverNumber();
+        data->insert(address, address.ipv6 ? 128 : 32, match);
+    }
+
+    QWriteLocker locker(&d->lock);
+    data->generation = d->generation.load(std::memory_order_relaxed) + 1;
+    d->data = std::move(data);
+    d->generation.store(d->data->generation, std::memory_order_release);
+
+    qCDebug(qhrCore) << "Rebuilt address index with" << d->data->entries.size() << "entries, generation" << d->data->generation;
+}
+
+void AddressIndex::rebuild(const QJsonArray &ips, const QJsonArray &subnets)
+{
+    rebuild(IpAddress::listFromJson(ips), Subnet::listFromJson(subnets));
+}
+
+AddressIndex::Snapshot AddressIndex::snapshot() const
+{
+    Q_D(const AddressIndex);
+    Snapshot snapshot;
+    snapshot.d = d->current();
+    return snapshot;
+}
+
+AddressMatch AddressIndex::lookup(const Address &address) const
+{
+    return snapshot().lookup(address);
+}
+
+AddressMatch AddressIndex::lookup(const QString &address) const
+{
+    return snapshot().lookup(address);
+}
+
+AddressMatch AddressIndex::lookup(QLatin1String address) const
+{
+    return snapshot().lookup(address);
+}
+
+int AddressIndex::size() const
+{
+    return snapshot().size();
+}
+
+quint64 AddressIndex::generation() const
+{
+    Q_D(const AddressIndex);
+    return d->generation.load(std::memory_order_acquire);
+}
+
+bool AddressIndex::parse(const QString &str, Address *address)
+{
+    Q_ASSERT(address);
+    return parseAddress(str.constData(), str.size(), address);
+}
+
+bool AddressIndex::parse(QLatin1String str, Address *address)
+{
+    Q_ASSERT(address);
+    return parseAddress(str.data(), str.size(), address);
+}
@@ -0,0 +1,198 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_ADDRESSINDEX_H
+#define QHR_ADDRESSINDEX_H
+
+#include <QString>
+#include <QVector>
+#include <QJsonArray>
+#include "qhr_global.h"
+#include "ipaddress.h"
+#include "subnet.h"
+#include <memory>
+
+namespace QHR {
+
+class AddressIndexPrivate;
+class AddressIndexData;
+
+/*!
+ * \brief Result of a lookup in the AddressIndex.
+ *
+ * \headerfile "" <QHR/AddressIndex>
+ */
+struct AddressMatch
+{
+    IpAddress ip;           /**< The matching single IP address, null if a subnet matched. */
+    Subnet subnet;          /**< The matching subnet, null if a single IP address matched. */
+    int serverNumber = 0;   /**< Number of the server the address belongs to. */
+    int prefixLength = -1;  /**< Length of the matching prefix, \c -1 if nothing matched. */
+    bool failover = false;  /**< \c true if the matching subnet is a failover subnet. */
+
+    bool isValid() const { return prefixLength >= 0; }
+};
+
+/*!
+ * \brief Maps IPv4 and IPv6 addresses to the owning server via longest-prefix match.
+ *
+ * The index is built from the single IP addresses returned by \c /ip and from the subnets
+ * returned by \c /subnet. It consists of two path compressed binary radix tries, one for
+ * IPv4 and one for IPv6, stored in contiguous arrays. A lookup walks at most one node per
+ * distinct prefix length on the path and returns the most specific entry containing the
+ * address. IPv4 mapped IPv6 addresses are looked up in the IPv4 trie.
+ *
+ * Address strings are parsed by parse() directly from the string data without allocating,
+ * so lookups never create a QHostAddress.
+ *
+ * rebuild() builds a complete new index aside and then swaps it in, readers running at the
+ * same time continue to use the previous index. lookup() can be called from any thread.
+ * Readers with very high lookup rates can fetch a Snapshot once and use it without any
+ * locking, refreshing it when generation() changes.
+ *
+ * \headerfile "" <QHR/AddressIndex>
+ */
+class QHR_LIBRARY AddressIndex
+{
+public:
+    /*!
+     * \brief Binary representation of an IPv4 or IPv6 address.
+     *
+     * IPv4 addresses are stored in the most significant 32 bits of \a hi.
+     */
+    struct Address
+    {
+        quint64 hi = 0;
+        quint64 lo = 0;
+        bool ipv6 = false;
+    };
+
+    /*!
+     * \brief Immutable state of the index at a point in time.
+     *
+     * Snapshots are cheap to copy and can be used from multiple threads at the same time.
+     */
+    class QHR_LIBRARY Snapshot
+    {
+    public:
+        /*!
+         * \brief Constructs an empty snapshot.
+         */
+        Snapshot();
+
+        /*!
+         * \brief Returns the longest prefix match for \a address.
+         */
+        AddressMatch lookup(const Address &address) const;
+
+        /*!
+         * \brief Parses \a address and returns the longest prefix match.
+         *
+         * Returns an invalid match if \a address can not be parsed.
+         */
+        AddressMatch lookup(const QString &address) const;
+
+        /*!
+         * \brief Parses \a address and returns the longest prefix match.
+         *
+         * Returns an invalid match if \a address can not be parsed.
+         */
+        AddressMatch lookup(QLatin1String address) const;
+
+        /*!
+         * \brief Returns the number of entries.
+         */
+        int size() const;
+
+        /*!
+         * \brief Returns the generation of the index this snapshot has been taken from.
+         */
+        quint64 generation() const;
+
+    private:
+        friend class AddressIndex;
+        std::shared_ptr<const AddressIndexData> d;
+    };
+
+    /*!
+     * \brief Constructs an empty %AddressIndex.
+     */
+    AddressIndex();
+
+    /*!
+     * \brief Destroys the %AddressIndex.
+     */
+    ~AddressIndex();
+
+    /*!
+     * \brief Builds a new index from \a ips and \a subnets and swaps it in.
+     *
+     * Single IP addresses take precedence over subnets with the same prefix.
+     * Entries whose address can not be parsed are skipped.
+     */
+    void rebuild(const QVector<IpAddress> &ips, const QVector<Subnet> &subnets);
+
+    /*!
+     * \brief Builds a new index from the JSON data returned by \c /ip and \c /subnet and swaps it in.
+     */
+    void rebuild(const QJsonArray &ips, const QJsonArray &subnets);
+
+    /*!
+     * \brief Returns the current state of the index.
+     */
+    Snapshot snapshot() const;
+
+    /*!
+     * \brief Returns the longest prefix match for \a address in the current index.
+     */
+    AddressMatch lookup(const Address &address) const;
+
+    /*!
+     * \brief Parses \a address and returns the longest prefix match in the current index.
+     */
+    AddressMatch lookup(const QString &address) const;
+
+    /*!
+     * \brief Parses \a address and returns the longest prefix match in the current index.
+     */
+    AddressMatch lookup(QLatin1String address) const;
+
+    /*!
+     * \brief Returns the number of entries in the current index.
+     */
+    int size() const;
+
+    /*!
+     * \brief Returns the number of rebuilds, can be used to refresh snapshots.
+     */
+    quint64 generation() const;
+
+    /*!
+     * \brief Parses the IPv4 or IPv6 address in \a str into \a address.
+     *
+     * Returns \c false if \a str does not contain a valid address. Scoped IPv6 addresses are not supported.
+     */
+    static bool parse(const QString &str, Address *address);
+
+    /*!
+     * \brief Parses the IPv4 or IPv6 address in \a str into \a address.
+     *
+     * Returns \c false if \a str does not contain a valid address. Scoped IPv6 addresses are not supported.
+     */
+    static bool parse(QLatin1String str, Address *address);
+
+protected:
+    const std::unique_ptr<AddressIndexPrivate> d_ptr;
+
+private:
+    Q_DECLARE_PRIVATE_D(d_ptr, AddressIndex)
+    Q_DISABLE_COPY(AddressIndex)
+};
+
+}
+
+Q_DECLARE_METATYPE(QHR::AddressMatch)
+
+#endif // QHR_ADDRESSINDEX_H
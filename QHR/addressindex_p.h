@@ -0,0 +1,79 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_ADDRESSINDEX_P_H
+#define QHR_ADDRESSINDEX_P_H
+
+#include "addressindex.h"
+#include <QReadWriteLock>
+#include <atomic>
+#include <vector>
+
+namespace QHR {
+
+/*
+ * Path compressed binary trie over 128 bit keys. Nodes are stored in a
+ * single vector and refer to their children by index, every node covers the
+ * first length bits of its key. Nodes are only added while building, lookups
+ * only read, so a built trie can be shared between threads.
+ */
+class AddressTrie
+{
+public:
+    struct Node {
+        quint64 hi = 0;
+        quint64 lo = 0;
+        int child[2] = {-1, -1};
+        int value = -1;
+        quint8 length = 0;
+    };
+
+    void insert(quint64 hi, quint64 lo, int length, int value);
+
+    int lookup(quint64 hi, quint64 lo) const;
+
+    std::vector<Node> nodes;
+    int root = -1;
+
+private:
+    int addNode(quint64 hi, quint64 lo, int length, int value);
+};
+
+class AddressIndexData
+{
+public:
+    void insert(const AddressIndex::Address &address, int prefixLength, const AddressMatch &match);
+
+    AddressMatch lookup(const AddressIndex::Address &address) const;
+
+    AddressTrie ipv4;
+    AddressTrie ipv6;
+    QVector<AddressMatch> entries;
+    quint64 generation = 0;
+};
+
+class AddressIndexPrivate
+{
+public:
+    explicit AddressIndexPrivate(AddressIndex *q);
+    ~AddressIndexPrivate();
+
+    std::shared_ptr<const AddressIndexData> current() const;
+
+    mutable QReadWriteLock lock;
+    std::shared_ptr<const AddressIndexData> data;
+    std::atomic<quint64> generation{0};
+
+protected:
+    AddressIndex *q_ptr = nullptr;
+
+private:
+    Q_DISABLE_COPY(AddressIndexPrivate)
+    Q_DECLARE_PUBLIC(AddressIndex)
+};
+
+}
+
+#endif // QHR_ADDRESSINDEX_P_H
@@ -0,0 +1,284 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "client_p.h"
+#include <QCoreApplication>
+
+using namespace QHR;
+
+JobError::JobError() = default;
+
+JobError::JobError(int code, const QString &errorString, const QString &apiErrorCode)
+    : m_errorString(errorString), m_apiErrorCode(apiErrorCode), m_what(errorString.toUtf8()), m_code(code)
+{
+
+}
+
+JobError::~JobError() = default;
+
+int JobError::code() const
+{
+    return m_code;
+}
+
+QString JobError::errorString() const
+{
+    return m_errorString;
+}
+
+QString JobError::apiErrorCode() const
+{
+    return m_apiErrorCode;
+}
+
+const char *JobError::what() const noexcept
+{
+    return m_what.constData();
+}
+
+void JobError::raise() const
+{
+    throw *this;
+}
+
+JobError *JobError::clone() const
+{
+    return new JobError(*this);
+}
+
+ClientRequestQueue::ClientRequestQueue()
+    : m_head(&m_stub), m_tail(&m_stub)
+{
+
+}
+
+void ClientRequestQueue::push(ClientRequest *request)
+{
+    request->next.store(nullptr, std::memory_order_relaxed);
+    ClientRequest *prev = m_head.exchange(request, std::memory_order_acq_rel);
+    prev->next.store(request, std::memory_order_release);
+}
+
+ClientRequest *ClientRequestQueue::pop()
+{
+    ClientRequest *tail = m_tail;
+    ClientRequest *next = tail->next.load(std::memory_order_acquire);
+
+    if (tail == &m_stub) {
+        if (!next) {
+            return nullptr;
+        }
+        m_tail = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next) {
+        m_tail = next;
+        return tail;
+    }
+
+    if (tail != m_head.load(std::memory_order_acquire)) {
+        // a producer has exchanged the head but not yet linked it
+        return nullptr;
+    }
+
+    push(&m_stub);
+
+    next = tail->next.load(std::memory_order_acquire);
+    if (next) {
+        m_tail = next;
+        return tail;
+    }
+
+    return nullptr;
+}
+
+ClientWorker::ClientWorker(ClientPrivate *d)
+    : QObject(nullptr), d(d)
+{
+
+}
+
+bool ClientWorker::event(QEvent *event)
+{
+    if (event->type() == ClientPrivate::wakeUpEventType()) {
+        d->processQueue();
+        return true;
+    }
+
+    if (event->type() == ClientPrivate::shutdownEventType()) {
+        d->shutdown();
+        return true;
+    }
+
+    return QObject::event(event);
+}
+
+ClientPrivate::ClientPrivate(Client *q)
+    : q_ptr(q)
+{
+
+}
+
+ClientPrivate::~ClientPrivate() = default;
+
+QEvent::Type ClientPrivate::wakeUpEventType()
+{
+    static const auto type = static_cast<QEvent::Type>(QEvent::registerEventType());
+    return type;
+}
+
+QEvent::Type ClientPrivate::shutdownEventType()
+{
+    static const auto type = static_cast<QEvent::Type>(QEvent::registerEventType());
+    return type;
+}
+
+JobError ClientPrivate::shutdownError()
+{
+    //: Error message
+    //% "The client has been shut down before the request has been finished."
+    return JobError(BJob::KilledJobError, qtTrId("libqhr-error-client-shut-down"));
+}
+
+void ClientPrivate::processQueue()
+{
+    // reset before draining, producers pushing after this point will post a new event
+    wakeUpPending.store(false);
+
+    while (ClientRequest *request = queue.pop()) {
+        if (Q_UNLIKELY(stopping.load(std::memory_order_acquire))) {
+            request->fail(shutdownError());
+            delete request;
+        } else {
+            startRequest(request);
+        }
+    }
+}
+
+void ClientPrivate::startRequest(ClientRequest *request)
+{
+    Job *job = request->create();
+    if (Q_UNLIKELY(!job)) {
+        qCWarning(qhrCore) << "Job factory submitted to" << q_ptr << "returned no job";
+        //: Error message
+        //% "The submitted job factory did not create a job."
+        request->fail(JobError(BJob::UserDefinedError, qtTrId("libqhr-error-client-invalid-job")));
+        delete request;
+        return;
+    }
+
+    if (!job->configuration()) {
+        AbstractConfiguration *config = configuration.load(std::memory_order_acquire);
+        if (config) {
+            job->setConfiguration(config);
+        }
+    }
+
+    runningRequests.insert(job, request);
+
+    QObject::connect(job, &BJob::result, worker, [this, job](){
+        ClientRequest *r = runningRequests.take(job);
+        if (!r) {
+            return;
+        }
+        if (job->error() == BJob::NoError) {
+            r->deliver(job);
+        } else {
+            r->fail(JobError(job->error(), job->errorString(), job->apiErrorCode()));
+        }
+        delete r;
+    });
+
+    job->start();
+}
+
+void ClientPrivate::shutdown()
+{
+    const QHash<Job*, ClientRequest*> running = runningRequests;
+    runningRequests.clear();
+
+    if (!running.empty()) {
+        qCDebug(qhrCore) << "Killing" << running.size() << "running jobs of" << q_ptr;
+    }
+
+    for (auto it = running.constBegin(), end = running.constEnd(); it != end; ++it) {
+        it.key()->kill(BJob::Quietly);
+        it.value()->fail(shutdownError());
+        delete it.value();
+    }
+
+    processQueue();
+
+    thread.quit();
+}
+
+Client::Client(QObject *parent)
+    : QObject(parent), cld_ptr(new ClientPrivate(this))
+{
+    Q_D(Client);
+    d->thread.setObjectName(QStringLiteral("QHR::Client"));
+    d->worker = new ClientWorker(d);
+    d->worker->moveToThread(&d->thread);
+    connect(&d->thread, &QThread::finished, d->worker, &QObject::deleteLater);
+    d->thread.start();
+}
+
+Client::~Client()
+{
+    Q_D(Client);
+    d->stopping.store(true, std::memory_order_release);
+    QCoreApplication::postEvent(d->worker, new QEvent(ClientPrivate::shutdownEventType()));
+    d->thread.wait();
+
+    // requests that have been pushed while the network thread was shutting down
+    while (ClientRequest *request = d->queue.pop()) {
+        request->fail(ClientPrivate::shutdownError());
+        delete request;
+    }
+}
+
+QThread *Client::networkThread() const
+{
+    Q_D(const Client);
+    return const_cast<QThread*>(&d->thread);
+}
+
+AbstractConfiguration *Client::configuration() const
+{
+    Q_D(const Client);
+    return d->configuration.load(std::memory_order_acquire);
+}
+
+void Client::setConfiguration(AbstractConfiguration *configuration)
+{
+    Q_D(Client);
+    qCDebug(qhrCore) << "Setting configuration of" << this << "to" << configuration;
+    d->configuration.store(configuration, std::memory_order_release);
+}
+
+void Client::enqueue(JobFactory create, std::function<void(Job*)> deliver, std::function<void(const JobError&)> fail)
+{
+    Q_D(Client);
+
+    if (Q_UNLIKELY(d->stopping.load(std::memory_order_acquire))) {
+        fail(ClientPrivate::shutdownError());
+        return;
+    }
+
+    auto request = new ClientRequest;
+    request->create = std::move(create);
+    request->deliver = std::move(deliver);
+    request->fail = std::move(fail);
+
+    d->queue.push(request);
+
+    if (!d->wakeUpPending.exchange(true)) {
+        QCoreApplication::postEvent(d->worker, new QEvent(ClientPrivate::wakeUpEventType()));
+    }
+}
+
+#include "moc_client.cpp"
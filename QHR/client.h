@@ -0,0 +1,216 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_CLIENT_H
+#define QHR_CLIENT_H
+
+#include <QObject>
+#include <QThread>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QException>
+#include <QJsonDocument>
+#include "qhr_global.h"
+#include "job.h"
+#include <functional>
+#include <memory>
+
+namespace QHR {
+
+class ClientPrivate;
+
+/*!
+ * \brief Exception used to report failed jobs to a QFuture returned by Client.
+ *
+ * \headerfile "" <QHR/Client>
+ */
+class QHR_LIBRARY JobError : public QException
+{
+public:
+    /*!
+     * \brief Constructs a new %JobError object without error.
+     */
+    JobError();
+
+    /*!
+     * \brief Constructs a new %JobError object with the given error \a code, \a errorString and \a apiErrorCode.
+     */
+    JobError(int code, const QString &errorString, const QString &apiErrorCode = QString());
+
+    /*!
+     * \brief Destroys the %JobError object.
+     */
+    ~JobError() override;
+
+    /*!
+     * \brief Returns the error code of the failed job, see BJob::error().
+     */
+    int code() const;
+
+    /*!
+     * \brief Returns the human readable and translated error string of the failed job.
+     */
+    QString errorString() const;
+
+    /*!
+     * \brief Returns the error code string returned by the API, see Job::apiErrorCode().
+     */
+    QString apiErrorCode() const;
+
+    const char *what() const noexcept override;
+
+    void raise() const override;
+
+    JobError *clone() const override;
+
+private:
+    QString m_errorString;
+    QString m_apiErrorCode;
+    QByteArray m_what;
+    int m_code = 0;
+};
+
+/*!
+ * \brief Thread-safe facade that runs jobs on a dedicated network thread.
+ *
+ * Jobs are bound to the event loop of the thread they have been created in. %Client owns
+ * its own network thread with a running event loop, so that jobs can be submitted from any
+ * thread, also from threads without event loop like the ones of a QThreadPool.
+ *
+ * submit() takes a factory function that is called \b inside the network thread to create
+ * the job and returns a QFuture that will receive the result. Submitting is lock-free and
+ * does not block the calling thread. If a job fails, the future will throw a JobError when
+ * the result is requested. call() is a blocking variant for worker threads.
+ *
+ * \code{.cpp}
+ * QHR::Client client;
+ * QFuture<QHR::ServerList> servers = client.submit([](){ return new QHR::GetServersJob; }, &QHR::GetServersJob::servers);
+ * \endcode
+ *
+ * The jobs created by the factory have to use auto deletion, what is the default. Jobs that
+ * are still running when the %Client is destroyed will be killed and their futures will
+ * throw a JobError with BJob::KilledJobError.
+ *
+ * \headerfile "" <QHR/Client>
+ */
+class QHR_LIBRARY Client : public QObject
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief Function creating a new job inside the network thread.
+     */
+    using JobFactory = std::function<Job*()>;
+
+    /*!
+     * \brief Constructs a new %Client object with the given \a parent and starts the network thread.
+     */
+    explicit Client(QObject *parent = nullptr);
+
+    /*!
+     * \brief Kills all running jobs and stops the network thread.
+     */
+    ~Client() override;
+
+    /*!
+     * \brief Returns the network thread the jobs are running in.
+     */
+    QThread *networkThread() const;
+
+    /*!
+     * \brief Returns the configuration used for jobs without own configuration.
+     */
+    AbstractConfiguration *configuration() const;
+
+    /*!
+     * \brief Sets the \a configuration used for jobs without own configuration.
+     *
+     * If not set, the jobs will use QHR::defaultConfiguration(). This function is thread-safe.
+     */
+    void setConfiguration(AbstractConfiguration *configuration);
+
+    /*!
+     * \brief Submits a job created by \a factory and returns a future for Job::result().
+     *
+     * This function is thread-safe and lock-free.
+     */
+    QFuture<QJsonDocument> submit(JobFactory factory)
+    {
+        return submit(std::move(factory), &Job::result);
+    }
+
+    /*!
+     * \brief Submits a job created by \a factory and returns a future for the value of \a getter.
+     *
+     * The \a getter will be called in the network thread after the job has been finished
+     * successfully. This function is thread-safe and lock-free.
+     */
+    template<typename Factory, typename JobT, typename T>
+    QFuture<T> submit(Factory factory, T (JobT::*getter)() const)
+    {
+        QFutureInterface<T> promise;
+        promise.reportStarted();
+        enqueue([factory]() -> Job* {
+            return factory();
+        }, [promise, getter](Job *job) mutable {
+            promise.reportResult((static_cast<JobT*>(job)->*getter)());
+            promise.reportFinished();
+        }, [promise](const JobError &error) mutable {
+            promise.reportException(error);
+            promise.reportFinished();
+        });
+        return promise.future();
+    }
+
+    /*!
+     * \brief Runs a job created by \a factory and blocks until it has been finished.
+     *
+     * Returns Job::result(). If the job fails, a default constructed document will be returned
+     * and \a error will be set if not \c nullptr. Must not be called from networkThread().
+     */
+    QJsonDocument call(JobFactory factory, JobError *error = nullptr)
+    {
+        return waitFor(submit(std::move(factory)), error);
+    }
+
+    /*!
+     * \brief Runs a job created by \a factory and blocks until it has been finished.
+     *
+     * Returns the value of \a getter. If the job fails, a default constructed value will be
+     * returned and \a error will be set if not \c nullptr. Must not be called from networkThread().
+     */
+    template<typename Factory, typename JobT, typename T>
+    T call(Factory factory, T (JobT::*getter)() const, JobError *error = nullptr)
+    {
+        return waitFor(submit(std::move(factory), getter), error);
+    }
+
+protected:
+    const std::unique_ptr<ClientPrivate> cld_ptr;
+
+private:
+    void enqueue(JobFactory create, std::function<void(Job*)> deliver, std::function<void(const JobError&)> fail);
+
+    template<typename T>
+    T waitFor(QFuture<T> future, JobError *error)
+    {
+        Q_ASSERT_X(QThread::currentThread() != networkThread(), "QHR::Client::call", "can not block the network thread");
+        try {
+            return future.result();
+        } catch (const JobError &e) {
+            if (error) {
+                *error = e;
+            }
+        }
+        return T();
+    }
+
+    Q_DECLARE_PRIVATE_D(cld_ptr, Client)
+    Q_DISABLE_COPY(Client)
+};
+
+}
+
+#endif // QHR_CLIENT_H
@@ -0,0 +1,98 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_CLIENT_P_H
+#define QHR_CLIENT_P_H
+
+#include "client.h"
+#include <QThread>
+#include <QEvent>
+#include <QHash>
+#include <atomic>
+
+namespace QHR {
+
+struct ClientRequest
+{
+    std::atomic<ClientRequest*> next{nullptr};
+    Client::JobFactory create;
+    std::function<void(Job*)> deliver;
+    std::function<void(const JobError&)> fail;
+};
+
+/*
+ * Intrusive multi producer single consumer queue after Dmitry Vyukov.
+ * push() is wait-free and can be called from any thread, pop() must only
+ * be called by the consumer. pop() might return nullptr while a producer
+ * is inside push(), the producer will wake up the consumer afterwards.
+ */
+class ClientRequestQueue
+{
+public:
+    ClientRequestQueue();
+
+    void push(ClientRequest *request);
+
+    ClientRequest *pop();
+
+private:
+    ClientRequest m_stub;
+    std::atomic<ClientRequest*> m_head;
+    ClientRequest *m_tail = nullptr;
+
+    Q_DISABLE_COPY(ClientRequestQueue)
+};
+
+class ClientPrivate;
+
+// does not need Q_OBJECT, it only receives the custom events
+class ClientWorker : public QObject
+{
+public:
+    explicit ClientWorker(ClientPrivate *d);
+
+    bool event(QEvent *event) override;
+
+private:
+    ClientPrivate *d = nullptr;
+};
+
+class ClientPrivate
+{
+public:
+    explicit ClientPrivate(Client *q);
+    ~ClientPrivate();
+
+    static QEvent::Type wakeUpEventType();
+
+    static QEvent::Type shutdownEventType();
+
+    static JobError shutdownError();
+
+    void processQueue();
+
+    void startRequest(ClientRequest *request);
+
+    void shutdown();
+
+    ClientRequestQueue queue;
+    QThread thread;
+    QHash<Job*, ClientRequest*> runningRequests;
+    ClientWorker *worker = nullptr;
+    std::atomic<AbstractConfiguration*> configuration{nullptr};
+    std::atomic<bool> wakeUpPending{false};
+    std::atomic<bool> stopping{false};
+
+protected:
+    Client *q_ptr = nullptr;
+
+private:
+    Q_DISABLE_COPY(ClientPrivate)
+    Q_DECLARE_PUBLIC(Client)
+};
+
+}
+
+#endif // QHR_CLIENT_P_H
@@ -0,0 +1,79 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "endpoints.h"
+#include "requestexecutor_p.h"
+#include "logging.h"
+#include <QUrl>
+#include <algorithm>
+#include <cstring>
+
+using namespace QHR;
+
+static inline bool isPlainPathChar(QChar c)
+{
+    // unreserved characters and the colon of IPv6 addresses
+    const ushort u = c.unicode();
+    return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '-' || u == '.' || u == '_' || u == '~' || u == ':';
+}
+
+static inline bool isPlainPathArgument(const QString &arg)
+{
+    return std::all_of(arg.cbegin(), arg.cend(), isPlainPathChar);
+}
+
+QString EndpointHelpers::formatPath(const char *pathTemplate, const QString *args, int argCount)
+{
+    int size = static_cast<int>(std::strlen(pathTemplate));
+    for (int i = 0; i < argCount; ++i) {
+        const QString &arg = args[i];
+        // "." and ".." are path segments of their own even if percent encoded
+        if (Q_UNLIKELY(arg.isEmpty() || arg == QLatin1String(".") || arg == QLatin1String(".."))) {
+            qCWarning(qhrCore) << "Invalid endpoint path argument" << arg << "for" << pathTemplate;
+            return QString();
+        }
+        size += isPlainPathArgument(arg) ? arg.size() : arg.size() * 3;
+    }
+
+    QString path;
+    path.reserve(size);
+
+    int arg = 0;
+    const char *literal = pathTemplate;
+    const char *p = pathTemplate;
+    while (*p) {
+        if (*p != '{') {
+            ++p;
+            continue;
+        }
+
+        path.append(QLatin1String(literal, static_cast<int>(p - literal)));
+        while (*p && *p != '}') {
+            ++p;
+        }
+
+        Q_ASSERT_X(arg < argCount, "format endpoint path", "missing argument");
+        const QString &value = args[arg++];
+        if (Q_LIKELY(isPlainPathArgument(value))) {
+            path.append(value);
+        } else {
+            // slashes, question marks and hash signs would change the target of the request
+            path.append(QString::fromLatin1(QUrl::toPercentEncoding(value, QByteArrayLiteral(":"))));
+        }
+
+        if (*p) {
+            ++p;
+        }
+        literal = p;
+    }
+    path.append(QLatin1String(literal, static_cast<int>(p - literal)));
+
+    return path;
+}
+
+Job *QHR::createJob(const Request &request, QObject *parent)
+{
+    return new RequestJob(request, parent);
+}
@@ -0,0 +1,282 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_ENDPOINTS_H
+#define QHR_ENDPOINTS_H
+
+#include <QString>
+#include "qhr_global.h"
+#include "requestexecutor.h"
+#include <type_traits>
+#include <utility>
+
+namespace QHR {
+
+/*!
+ * \brief Defines how a HTTP 404 reply of an endpoint is interpreted.
+ */
+enum class NotFoundMeaning : quint8 {
+    Error,          /**< 404 is reported as QHR::NotFound. */
+    EmptyResult     /**< 404 means that there are no items, it is reported as empty successful result. */
+};
+
+/*!
+ * \brief Compile-time properties shared by all endpoints.
+ *
+ * Every endpoint in the QHR::Endpoints namespace derives from this and adds a static
+ * \c path() function returning the path template. Placeholders in the template are
+ * written in curly braces, like \c "/rdns/{ip}", and will be replaced by the arguments
+ * given to makeRequest() in order of appearance.
+ *
+ * \headerfile "" <QHR/Endpoints>
+ */
+template<Request::Operation Method, Request::Content Content, NotFoundMeaning NotFound = NotFoundMeaning::Error, bool Auth = true>
+struct EndpointTraits
+{
+    static constexpr Request::Operation method = Method;
+    static constexpr Request::Content expectedContent = Content;
+    static constexpr NotFoundMeaning notFound = NotFound;
+    static constexpr bool requiresAuth = Auth;
+};
+
+namespace EndpointHelpers {
+
+constexpr int placeholderCount(const char *path, int count = 0)
+{
+    return *path == '\0' ? count : placeholderCount(path + 1, *path == '{' ? count + 1 : count);
+}
+
+inline QString pathArgument(const QString &value)
+{
+    return value;
+}
+
+template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+inline QString pathArgument(T value)
+{
+    return QString::number(value);
+}
+
+/*!
+ * \internal
+ * \brief Replaces the placeholders in \a pathTemplate by \a args.
+ *
+ * The result is built with a single allocation. Arguments that contain other characters than
+ * unreserved ones and colons will be percent encoded. If an argument is empty, \c "." or
+ * \c "..", a null string is returned.
+ */
+QHR_LIBRARY QString formatPath(const char *pathTemplate, const QString *args, int argCount);
+
+}
+
+/*!
+ * \brief Creates a Request for the endpoint \a E with the given path \a args.
+ *
+ * The number of arguments is checked at compile time against the placeholders of the
+ * path template. Query items and form values can be added to the returned request.
+ * Arguments will be percent encoded, so they can not change the target of the request.
+ * If an argument is empty, \c "." or \c "..", the path of the returned request is a null
+ * string and the request will fail with QHR::InvalidInput.
+ *
+ * \code{.cpp}
+ * QHR::Request r = QHR::makeRequest<QHR::Endpoints::RdnsUpdate>(QStringLiteral("1.2.3.4"));
+ * r.form.addQueryItem(QStringLiteral("ptr"), QStringLiteral("host.example.com"));
+ * executor.submit(r, callback);
+ * \endcode
+ */
+template<typename E, typename... Args>
+Request makeRequest(Args&&... args)
+{
+    static_assert(EndpointHelpers::placeholderCount(E::path()) == sizeof...(Args), "number of arguments does not match the placeholders of the endpoint path");
+
+    // the first element only avoids a zero sized array
+    const QString values[] = {QString(), EndpointHelpers::pathArgument(std::forward<Args>(args))...};
+
+    Request request(E::method, EndpointHelpers::formatPath(E::path(), values + 1, static_cast<int>(sizeof...(Args))), QUrlQuery(), E::expectedContent);
+    request.requiresAuth = E::requiresAuth;
+    request.notFoundIsEmpty = E::notFound == NotFoundMeaning::EmptyResult;
+    return request;
+}
+
+/*!
+ * \brief Creates a Job that performs the \a request.
+ *
+ * The job has the given \a parent, uses the default configuration if none is set and
+ * has to be started by the caller.
+ */
+QHR_LIBRARY Job *createJob(const Request &request, QObject *parent = nullptr);
+
+/*!
+ * \brief Creates a Job for the endpoint \a E with the given path \a args.
+ *
+ * The job has the given \a parent and has to be started by the caller.
+ */
+template<typename E, typename... Args>
+Job *makeJob(QObject *parent, Args&&... args)
+{
+    return createJob(makeRequest<E>(std::forward<Args>(args)...), parent);
+}
+
+#define QHR_ENDPOINT(Name, Method, Path, Content, NotFound) \
+    struct Name : EndpointTraits<Request::Method, Request::Content, NotFoundMeaning::NotFound> { \
+        static constexpr const char *path() { return Path; } \
+    };
+
+/*!
+ * \brief Endpoints of the Robot webservice.
+ *
+ * See https://robot.your-server.de/doc/webservice/en.html for the documentation of the
+ * parameters and the returned data.
+ */
+namespace Endpoints {
+
+// Server
+QHR_ENDPOINT(ServerList,                    Get,    "/server",                                              JsonArray,  EmptyResult)
+QHR_ENDPOINT(ServerGet,                     Get,    "/server/{server-number}",                              JsonObject, Error)
+QHR_ENDPOINT(ServerUpdate,                  Post,   "/server/{server-number}",                              JsonObject, Error)
+QHR_ENDPOINT(ServerCancellationGet,         Get,    "/server/{server-number}/cancellation",                 JsonObject, Error)
+QHR_ENDPOINT(ServerCancellationCreate,      Post,   "/server/{server-number}/cancellation",                 JsonObject, Error)
+QHR_ENDPOINT(ServerCancellationDelete,      Delete, "/server/{server-number}/cancellation",                 NoContent,  Error)
+QHR_ENDPOINT(ServerReversal,                Post,   "/server/{server-number}/reversal",                     JsonObject, Error)
+
+// IP
+QHR_ENDPOINT(IpList,                        Get,    "/ip",                                                  JsonArray,  EmptyResult)
+QHR_ENDPOINT(IpGet,                         Get,    "/ip/{ip}",                                             JsonObject, Error)
+QHR_ENDPOINT(IpUpdate,                      Post,   "/ip/{ip}",                                             JsonObject, Error)
+QHR_ENDPOINT(IpCancellationGet,             Get,    "/ip/{ip}/cancellation",                                JsonObject, Error)
+QHR_ENDPOINT(IpCancellationCreate,          Post,   "/ip/{ip}/cancellation",                                JsonObject, Error)
+QHR_ENDPOINT(IpCancellationDelete,          Delete, "/ip/{ip}/cancellation",                                NoContent,  Error)
+
+// Subnet
+QHR_ENDPOINT(SubnetList,                    Get,    "/subnet",                                              JsonArray,  EmptyResult)
+QHR_ENDPOINT(SubnetGet,                     Get,    "/subnet/{net-ip}",                                     JsonObject, Error)
+QHR_ENDPOINT(SubnetUpdate,                  Post,   "/subnet/{net-ip}",                                     JsonObject, Error)
+QHR_ENDPOINT(SubnetCancellationGet,         Get,    "/subnet/{net-ip}/cancellation",                        JsonObject, Error)
+QHR_ENDPOINT(SubnetCancellationCreate,      Post,   "/subnet/{net-ip}/cancellation",                        JsonObject, Error)
+QHR_ENDPOINT(SubnetCancellationDelete,      Delete, "/subnet/{net-ip}/cancellation",                        NoContent,  Error)
+
+// Separate MAC addresses
+QHR_ENDPOINT(IpMacGet,                      Get,    "/ip/{ip}/mac",                                         JsonObject, Error)
+QHR_ENDPOINT(IpMacCreate,                   Put,    "/ip/{ip}/mac",                                         JsonObject, Error)
+QHR_ENDPOINT(IpMacDelete,                   Delete, "/ip/{ip}/mac",                                         JsonObject, Error)
+QHR_ENDPOINT(SubnetMacGet,                  Get,    "/subnet/{net-ip}/mac",                                 JsonObject, Error)
+QHR_ENDPOINT(SubnetMacCreate,               Put,    "/subnet/{net-ip}/mac",                                 JsonObject, Error)
+QHR_ENDPOINT(SubnetMacDelete,               Delete, "/subnet/{net-ip}/mac",                                 JsonObject, Error)
+
+// Reverse DNS
+QHR_ENDPOINT(RdnsList,                      Get,    "/rdns",                                                JsonArray,  EmptyResult)
+QHR_ENDPOINT(RdnsGet,                       Get,    "/rdns/{ip}",                                           JsonObject, Error)
+QHR_ENDPOINT(RdnsCreate,                    Put,    "/rdns/{ip}",                                           JsonObject, Error)
+QHR_ENDPOINT(RdnsUpdate,                    Post,   "/rdns/{ip}",                                           JsonObject, Error)
+QHR_ENDPOINT(RdnsDelete,                    Delete, "/rdns/{ip}",                                           NoContent,  Error)
+
+// Failover
+QHR_ENDPOINT(FailoverList,                  Get,    "/failover",                                            JsonArray,  EmptyResult)
+QHR_ENDPOINT(FailoverGet,                   Get,    "/failover/{failover-ip}",                              JsonObject, Error)
+QHR_ENDPOINT(FailoverSwitch,                Post,   "/failover/{failover-ip}",                              JsonObject, Error)
+QHR_ENDPOINT(FailoverDelete,                Delete, "/failover/{failover-ip}",                              JsonObject, Error)
+
+// Reset
+QHR_ENDPOINT(ResetList,                     Get,    "/reset",                                               JsonArray,  EmptyResult)
+QHR_ENDPOINT(ResetGet,                      Get,    "/reset/{server-number}",                               JsonObject, Error)
+QHR_ENDPOINT(ResetExecute,                  Post,   "/reset/{server-number}",                               JsonObject, Error)
+
+// Wake on LAN
+QHR_ENDPOINT(WolGet,                        Get,    "/wol/{server-number}",                                 JsonObject, Error)
+QHR_ENDPOINT(WolSend,                       Post,   "/wol/{server-number}",                                 JsonObject, Error)
+
+// Boot configuration
+QHR_ENDPOINT(BootGet,                       Get,    "/boot/{server-number}",                                JsonObject, Error)
+QHR_ENDPOINT(BootRescueGet,                 Get,    "/boot/{server-number}/rescue",                         JsonObject, Error)
+QHR_ENDPOINT(BootRescueActivate,            Post,   "/boot/{server-number}/rescue",                         JsonObject, Error)
+QHR_ENDPOINT(BootRescueDeactivate,          Delete, "/boot/{server-number}/rescue",                         JsonObject, Error)
+QHR_ENDPOINT(BootRescueLast,                Get,    "/boot/{server-number}/rescue/last",                    JsonObject, Error)
+QHR_ENDPOINT(BootLinuxGet,                  Get,    "/boot/{server-number}/linux",                          JsonObject, Error)
+QHR_ENDPOINT(BootLinuxActivate,             Post,   "/boot/{server-number}/linux",                          JsonObject, Error)
+QHR_ENDPOINT(BootLinuxDeactivate,           Delete, "/boot/{server-number}/linux",                          JsonObject, Error)
+QHR_ENDPOINT(BootLinuxLast,                 Get,    "/boot/{server-number}/linux/last",                     JsonObject, Error)
+QHR_ENDPOINT(BootVncGet,                    Get,    "/boot/{server-number}/vnc",                            JsonObject, Error)
+QHR_ENDPOINT(BootVncActivate,               Post,   "/boot/{server-number}/vnc",                            JsonObject, Error)
+QHR_ENDPOINT(BootVncDeactivate,             Delete, "/boot/{server-number}/vnc",                            JsonObject, Error)
+QHR_ENDPOINT(BootWindowsGet,                Get,    "/boot/{server-number}/windows",                        JsonObject, Error)
+QHR_ENDPOINT(BootWindowsActivate,           Post,   "/boot/{server-number}/windows",                        JsonObject, Error)
+QHR_ENDPOINT(BootWindowsDeactivate,         Delete, "/boot/{server-number}/windows",                        JsonObject, Error)
+QHR_ENDPOINT(BootPleskGet,                  Get,    "/boot/{server-number}/plesk",                          JsonObject, Error)
+QHR_ENDPOINT(BootPleskActivate,             Post,   "/boot/{server-number}/plesk",                          JsonObject, Error)
+QHR_ENDPOINT(BootPleskDeactivate,           Delete, "/boot/{server-number}/plesk",                          JsonObject, Error)
+QHR_ENDPOINT(BootCpanelGet,                 Get,    "/boot/{server-number}/cpanel",                         JsonObject, Error)
+QHR_ENDPOINT(BootCpanelActivate,            Post,   "/boot/{server-number}/cpanel",                         JsonObject, Error)
+QHR_ENDPOINT(BootCpanelDeactivate,          Delete, "/boot/{server-number}/cpanel",                         JsonObject, Error)
+
+// Traffic
+QHR_ENDPOINT(TrafficQuery,                  Post,   "/traffic",                                             JsonObject, Error)
+
+// SSH keys
+QHR_ENDPOINT(KeyList,                       Get,    "/key",                                                 JsonArray,  EmptyResult)
+QHR_ENDPOINT(KeyCreate,                     Post,   "/key",                                                 JsonObject, Error)
+QHR_ENDPOINT(KeyGet,                        Get,    "/key/{fingerprint}",                                   JsonObject, Error)
+QHR_ENDPOINT(KeyUpdate,                     Post,   "/key/{fingerprint}",                                   JsonObject, Error)
+QHR_ENDPOINT(KeyDelete,                     Delete, "/key/{fingerprint}",                                   NoContent,  Error)
+
+// Firewall
+QHR_ENDPOINT(FirewallGet,                   Get,    "/firewall/{server-id}",                                JsonObject, Error)
+QHR_ENDPOINT(FirewallUpdate,                Post,   "/firewall/{server-id}",                                JsonObject, Error)
+QHR_ENDPOINT(FirewallDelete,                Delete, "/firewall/{server-id}",                                JsonObject, Error)
+QHR_ENDPOINT(FirewallTemplateList,          Get,    "/firewall/template",                                   JsonArray,  EmptyResult)
+QHR_ENDPOINT(FirewallTemplateCreate,        Post,   "/firewall/template",                                   JsonObject, Error)
+QHR_ENDPOINT(FirewallTemplateGet,           Get,    "/firewall/template/{template-id}",                     JsonObject, Error)
+QHR_ENDPOINT(FirewallTemplateUpdate,        Post,   "/firewall/template/{template-id}",                     JsonObject, Error)
+QHR_ENDPOINT(FirewallTemplateDelete,        Delete, "/firewall/template/{template-id}",                     NoContent,  Error)
+
+// vSwitch
+QHR_ENDPOINT(VSwitchList,                   Get,    "/vswitch",                                             JsonArray,  EmptyResult)
+QHR_ENDPOINT(VSwitchCreate,                 Post,   "/vswitch",                                             JsonObject, Error)
+QHR_ENDPOINT(VSwitchGet,                    Get,    "/vswitch/{vswitch-id}",                                JsonObject, Error)
+QHR_ENDPOINT(VSwitchUpdate,                 Post,   "/vswitch/{vswitch-id}",                                JsonObject, Error)
+QHR_ENDPOINT(VSwitchCancel,                 Delete, "/vswitch/{vswitch-id}",                                NoContent,  Error)
+QHR_ENDPOINT(VSwitchServerAdd,              Post,   "/vswitch/{vswitch-id}/server",                         NoContent,  Error)
+QHR_ENDPOINT(VSwitchServerRemove,           Delete, "/vswitch/{vswitch-id}/server",                         NoContent,  Error)
+
+// Storage Box
+QHR_ENDPOINT(StorageBoxList,                Get,    "/storagebox",                                          JsonArray,  EmptyResult)
+QHR_ENDPOINT(StorageBoxGet,                 Get,    "/storagebox/{storagebox-id}",                          JsonObject, Error)
+QHR_ENDPOINT(StorageBoxUpdate,              Post,   "/storagebox/{storagebox-id}",                          JsonObject, Error)
+QHR_ENDPOINT(StorageBoxPassword,            Post,   "/storagebox/{storagebox-id}/password",                 JsonObject, Error)
+QHR_ENDPOINT(StorageBoxSnapshotList,        Get,    "/storagebox/{storagebox-id}/snapshot",                 JsonArray,  EmptyResult)
+QHR_ENDPOINT(StorageBoxSnapshotCreate,      Post,   "/storagebox/{storagebox-id}/snapshot",                 JsonObject, Error)
+QHR_ENDPOINT(StorageBoxSnapshotRevert,      Post,   "/storagebox/{storagebox-id}/snapshot/{snapshot-name}", NoContent,  Error)
+QHR_ENDPOINT(StorageBoxSnapshotDelete,      Delete, "/storagebox/{storagebox-id}/snapshot/{snapshot-name}", NoContent,  Error)
+QHR_ENDPOINT(StorageBoxSnapshotComment,     Post,   "/storagebox/{storagebox-id}/snapshot/{snapshot-name}/comment", NoContent, Error)
+QHR_ENDPOINT(StorageBoxSnapshotPlanGet,     Get,    "/storagebox/{storagebox-id}/snapshotplan",             JsonArray,  Error)
+QHR_ENDPOINT(StorageBoxSnapshotPlanUpdate,  Post,   "/storagebox/{storagebox-id}/snapshotplan",             JsonArray,  Error)
+QHR_ENDPOINT(StorageBoxSubaccountList,      Get,    "/storagebox/{storagebox-id}/subaccount",               JsonArray,  EmptyResult)
+QHR_ENDPOINT(StorageBoxSubaccountCreate,    Post,   "/storagebox/{storagebox-id}/subaccount",               JsonObject, Error)
+QHR_ENDPOINT(StorageBoxSubaccountUpdate,    Put,    "/storagebox/{storagebox-id}/subaccount/{username}",    NoContent,  Error)
+QHR_ENDPOINT(StorageBoxSubaccountDelete,    Delete, "/storagebox/{storagebox-id}/subaccount/{username}",    NoContent,  Error)
+QHR_ENDPOINT(StorageBoxSubaccountPassword,  Post,   "/storagebox/{storagebox-id}/subaccount/{username}/password", JsonObject, Error)
+
+// Ordering
+QHR_ENDPOINT(OrderServerProductList,        Get,    "/order/server/product",                                JsonArray,  EmptyResult)
+QHR_ENDPOINT(OrderServerProductGet,         Get,    "/order/server/product/{product-id}",                   JsonObject, Error)
+QHR_ENDPOINT(OrderServerTransactionList,    Get,    "/order/server/transaction",                            JsonArray,  EmptyResult)
+QHR_ENDPOINT(OrderServerTransactionCreate,  Post,   "/order/server/transaction",                            JsonObject, Error)
+QHR_ENDPOINT(OrderServerTransactionGet,     Get,    "/order/server/transaction/{transaction-id}",           JsonObject, Error)
+QHR_ENDPOINT(OrderMarketProductList,        Get,    "/order/server_market/product",                         JsonArray,  EmptyResult)
+QHR_ENDPOINT(OrderMarketProductGet,         Get,    "/order/server_market/product/{product-id}",            JsonObject, Error)
+QHR_ENDPOINT(OrderMarketTransactionList,    Get,    "/order/server_market/transaction",                     JsonArray,  EmptyResult)
+QHR_ENDPOINT(OrderMarketTransactionCreate,  Post,   "/order/server_market/transaction",                     JsonObject, Error)
+QHR_ENDPOINT(OrderMarketTransactionGet,     Get,    "/order/server_market/transaction/{transaction-id}",    JsonObject, Error)
+QHR_ENDPOINT(OrderAddonProductList,         Get,    "/order/server_addon/{server-number}/product",          JsonArray,  EmptyResult)
+QHR_ENDPOINT(OrderAddonTransactionList,     Get,    "/order/server_addon/transaction",                      JsonArray,  EmptyResult)
+QHR_ENDPOINT(OrderAddonTransactionCreate,   Post,   "/order/server_addon/transaction",                      JsonObject, Error)
+QHR_ENDPOINT(OrderAddonTransactionGet,      Get,    "/order/server_addon/transaction/{transaction-id}",     JsonObject, Error)
+
+}
+
+#undef QHR_ENDPOINT
+
+}
+
+#endif // QHR_ENDPOINTS_H
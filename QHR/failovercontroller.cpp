@@ -0,0 +1,298 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "failovercontroller_p.h"
+#include "logging.h"
+#include <QTcpSocket>
+#include <QPointer>
+#include <algorithm>
+#include <memory>
+
+using namespace QHR;
+
+FailoverControllerPrivate::FailoverControllerPrivate(FailoverController *q)
+    : q_ptr(q)
+{
+    probeTimer.setInterval(1000);
+    probeTimer.setTimerType(Qt::PreciseTimer);
+}
+
+FailoverControllerPrivate::~FailoverControllerPrivate() = default;
+
+void FailoverControllerPrivate::setState(FailoverController::State newState)
+{
+    if (state != newState) {
+        Q_Q(FailoverController);
+        state = newState;
+        Q_EMIT q->stateChanged(state);
+    }
+}
+
+void FailoverControllerPrivate::probe()
+{
+    Q_Q(FailoverController);
+
+    if (probing) {
+        // the previous probe is still waiting for its timeout
+        return;
+    }
+
+    probing = true;
+    const quint64 id = ++probeId;
+    probeElapsed.start();
+
+    QTimer::singleShot(probeTimeout, q, [this, id](){
+        probeFinished(id, false);
+    });
+
+    QPointer<FailoverController> guard(q);
+    auto report = [this, guard, id](bool healthy){
+        if (guard) {
+            probeFinished(id, healthy);
+        }
+    };
+
+    if (customProbe) {
+        customProbe(report);
+    } else {
+        tcpProbe(report);
+    }
+}
+
+void FailoverControllerPrivate::tcpProbe(const std::function<void(bool healthy)> &report)
+{
+    Q_Q(FailoverController);
+
+    if (Q_UNLIKELY(host.isEmpty() || port == 0)) {
+        qCWarning(qhrCore) << "Failover controller has neither a probe target nor a custom probe.";
+        report(false);
+        return;
+    }
+
+    auto *socket = new QTcpSocket(q);
+    auto done = std::make_shared<bool>(false);
+    auto finish = [socket, done, report](bool healthy){
+        if (!*done) {
+            *done = true;
+            socket->abort();
+            socket->deleteLater();
+            report(healthy);
+        }
+    };
+
+    QObject::connect(socket, &QTcpSocket::connected, socket, [finish](){
+        finish(true);
+    });
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    QObject::connect(socket, &QAbstractSocket::errorOccurred, socket, [finish](){
+        finish(false);
+    });
+#else
+    QObject::connect(socket, static_cast<void (QAbstractSocket::*)(QAbstractSocket::SocketError)>(&QAbstractSocket::error), socket, [finish](){
+        finish(false);
+    });
+#endif
+    // the probe itself has already been reported as failed by the timeout
+    QTimer::singleShot(probeTimeout, socket, [finish](){
+        finish(false);
+    });
+
+    socket->connectToHost(host, port);
+}
+
+void FailoverControllerPrivate::probeFinished(quint64 id, bool healthy)
+{
+    if (id != probeId || !probing) {
+        return;
+    }
+    probing = false;
+
+    Q_Q(FailoverController);
+    Q_EMIT q->probed(healthy, probeElapsed.elapsed());
+
+    if (state != FailoverController::Monitoring) {
+        return;
+    }
+
+    if (healthy) {
+        failures = 0;
+        return;
+    }
+
+    ++failures;
+    qCWarning(qhrCore) << "Health probe for failover IP" << failoverIp << "failed" << failures << "time(s) in a row.";
+
+    if (failures < failureThreshold) {
+        return;
+    }
+
+    if (Q_UNLIKELY(failoverIp.isEmpty() || backupServerIp.isEmpty())) {
+        qCCritical(qhrCore) << "Can not switch failover IP: failover IP or backup server IP not set.";
+        return;
+    }
+
+    probeTimer.stop();
+    setState(FailoverController::Switching);
+    Q_EMIT q->switchTriggered(failures);
+    switcher.switchTo(failoverIp, backupServerIp);
+}
+
+void FailoverControllerPrivate::switchFinished(const FailoverSwitchResult &result)
+{
+    if (state != FailoverController::Switching || result.failoverIp != failoverIp) {
+        return;
+    }
+
+    Q_Q(FailoverController);
+
+    const bool stopped = stopRequested;
+    stopRequested = false;
+
+    if (result.isOk()) {
+        setState(FailoverController::Switched);
+    } else if (stopped) {
+        setState(FailoverController::Stopped);
+    } else {
+        // the next failed probe triggers the switch again
+        failures = failureThreshold - 1;
+        setState(FailoverController::Monitoring);
+        probeTimer.start();
+    }
+
+    Q_EMIT q->switchFinished(result);
+}
+
+FailoverController::FailoverController(QObject *parent)
+    : QObject(parent), fcd_ptr(new FailoverControllerPrivate(this))
+{
+    Q_D(FailoverController);
+    connect(&d->probeTimer, &QTimer::timeout, this, [d](){
+        d->probe();
+    });
+    connect(&d->switcher, &FailoverSwitcher::switchFinished, this, [d](const FailoverSwitchResult &result){
+        d->switchFinished(result);
+    });
+}
+
+FailoverController::~FailoverController() = default;
+
+FailoverSwitcher *FailoverController::switcher() const
+{
+    Q_D(const FailoverController);
+    return const_cast<FailoverSwitcher*>(&d->switcher);
+}
+
+void FailoverController::setFailover(const QString &failoverIp, const QString &backupServerIp)
+{
+    Q_D(FailoverController);
+    d->failoverIp = failoverIp;
+    d->backupServerIp = backupServerIp;
+}
+
+QString FailoverController::failoverIp() const
+{
+    Q_D(const FailoverController);
+    return d->failoverIp;
+}
+
+QString FailoverController::backupServerIp() const
+{
+    Q_D(const FailoverController);
+    return d->backupServerIp;
+}
+
+void FailoverController::setProbeTarget(const QString &host, quint16 port)
+{
+    Q_D(FailoverController);
+    d->host = host;
+    d->port = port;
+}
+
+void FailoverController::setProbe(const Probe &probe)
+{
+    Q_D(FailoverController);
+    d->customProbe = probe;
+}
+
+FailoverController::State FailoverController::state() const
+{
+    Q_D(const FailoverController);
+    return d->state;
+}
+
+int FailoverController::probeInterval() const
+{
+    Q_D(const FailoverController);
+    return d->probeTimer.interval();
+}
+
+void FailoverController::setProbeInterval(int probeInterval)
+{
+    Q_D(FailoverController);
+    d->probeTimer.setInterval(std::max(1, probeInterval));
+}
+
+int FailoverController::probeTimeout() const
+{
+    Q_D(const FailoverController);
+    return d->probeTimeout;
+}
+
+void FailoverController::setProbeTimeout(int probeTimeout)
+{
+    Q_D(FailoverController);
+    d->probeTimeout = std::max(1, probeTimeout);
+}
+
+int FailoverController::failureThreshold() const
+{
+    Q_D(const FailoverController);
+    return d->failureThreshold;
+}
+
+void FailoverController::setFailureThreshold(int failureThreshold)
+{
+    Q_D(FailoverController);
+    d->failureThreshold = std::max(1, failureThreshold);
+}
+
+void FailoverController::start()
+{
+    Q_D(FailoverController);
+
+    d->stopRequested = false;
+
+    if (d->state == Monitoring || d->state == Switching) {
+        return;
+    }
+
+    qCDebug(qhrCore) << "Starting failover controller for" << d->failoverIp;
+
+    d->switcher.warmUp();
+    d->failures = 0;
+    d->probing = false;
+    d->setState(Monitoring);
+    d->probeTimer.start();
+    d->probe();
+}
+
+void FailoverController::stop()
+{
+    Q_D(FailoverController);
+
+    qCDebug(qhrCore) << "Stopping failover controller for" << d->failoverIp;
+
+    d->probeTimer.stop();
+    d->probing = false;
+    ++d->probeId;
+    if (d->state == Monitoring) {
+        d->setState(Stopped);
+    } else if (d->state == Switching) {
+        // do not resume monitoring if the running switch fails
+        d->stopRequested = true;
+    }
+}
+
+#include "moc_failovercontroller.cpp"
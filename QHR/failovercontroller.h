@@ -0,0 +1,221 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_FAILOVERCONTROLLER_H
+#define QHR_FAILOVERCONTROLLER_H
+
+#include <QObject>
+#include <QString>
+#include "qhr_global.h"
+#include "failoverswitcher.h"
+#include <functional>
+#include <memory>
+
+namespace QHR {
+
+class FailoverControllerPrivate;
+
+/*!
+ * \brief Monitors the server a failover IP is routed to and switches it to a backup server.
+ *
+ * The controller probes the health of the primary server every
+ * \link FailoverController::probeInterval probeInterval\endlink milliseconds. By default
+ * a probe is a TCP connection attempt to the host and port set via setProbeTarget(), a custom
+ * probe can be set via setProbe(). A probe that does not report within
+ * \link FailoverController::probeTimeout probeTimeout\endlink milliseconds counts as failed.
+ *
+ * After \link FailoverController::failureThreshold failureThreshold\endlink consecutive failed
+ * probes, the failover IP will be routed to the backup server by the FailoverSwitcher returned
+ * by switcher(), that is warmed up when the controller is started. After a successful switch,
+ * the controller stops probing and has to be started again, for example after the primary
+ * server has been repaired and the failover IP has been routed back. If the switch fails, the
+ * controller continues probing and tries again after the next failed probe.
+ *
+ * \headerfile "" <QHR/FailoverController>
+ */
+class QHR_LIBRARY FailoverController : public QObject
+{
+    Q_OBJECT
+    /*!
+     * \brief Current state of the controller.
+     *
+     * \par Access functions
+     * \li QHR::FailoverController::State state() const
+     *
+     * \par Notifier signal
+     * \li void stateChanged(QHR::FailoverController::State state)
+     */
+    Q_PROPERTY(QHR::FailoverController::State state READ state NOTIFY stateChanged)
+    /*!
+     * \brief Interval in milliseconds between two probes, the default value is \c 1000.
+     *
+     * \par Access functions
+     * \li int probeInterval() const
+     * \li void setProbeInterval(int probeInterval)
+     */
+    Q_PROPERTY(int probeInterval READ probeInterval WRITE setProbeInterval)
+    /*!
+     * \brief Time in milliseconds after a probe counts as failed, the default value is \c 500.
+     *
+     * \par Access functions
+     * \li int probeTimeout() const
+     * \li void setProbeTimeout(int probeTimeout)
+     */
+    Q_PROPERTY(int probeTimeout READ probeTimeout WRITE setProbeTimeout)
+    /*!
+     * \brief Number of consecutive failed probes that trigger the switch, the default value is \c 3.
+     *
+     * \par Access functions
+     * \li int failureThreshold() const
+     * \li void setFailureThreshold(int failureThreshold)
+     */
+    Q_PROPERTY(int failureThreshold READ failureThreshold WRITE setFailureThreshold)
+public:
+    /*!
+     * \brief State of the controller.
+     */
+    enum State : quint8 {
+        Stopped = 0,    /**< The controller is not running. */
+        Monitoring,     /**< The primary server is probed. */
+        Switching,      /**< The failover IP is being switched to the backup server. */
+        Switched        /**< The failover IP has been switched to the backup server. */
+    };
+    Q_ENUM(State)
+
+    /*!
+     * \brief Asynchronous health probe, has to call \a report exactly once with the result.
+     */
+    using Probe = std::function<void(const std::function<void(bool healthy)> &report)>;
+
+    /*!
+     * \brief Constructs a new %FailoverController object with the given \a parent.
+     */
+    explicit FailoverController(QObject *parent = nullptr);
+
+    /*!
+     * \brief Destroys the %FailoverController object.
+     */
+    ~FailoverController() override;
+
+    /*!
+     * \brief Returns the switcher used to route the failover IP.
+     *
+     * Use it to set the configuration, timeouts and attempts.
+     */
+    FailoverSwitcher *switcher() const;
+
+    /*!
+     * \brief Sets the \a failoverIp to switch and the main IP of the \a backupServerIp to route it to.
+     */
+    void setFailover(const QString &failoverIp, const QString &backupServerIp);
+
+    /*!
+     * \brief Returns the monitored failover IP.
+     */
+    QString failoverIp() const;
+
+    /*!
+     * \brief Returns the main IP of the backup server.
+     */
+    QString backupServerIp() const;
+
+    /*!
+     * \brief Probes the primary server by connecting to \a port on \a host.
+     */
+    void setProbeTarget(const QString &host, quint16 port);
+
+    /*!
+     * \brief Sets a custom \a probe, replaces the TCP probe.
+     */
+    void setProbe(const Probe &probe);
+
+    /*!
+     * \brief Getter function for the \link FailoverController::state state\endlink property.
+     * \sa stateChanged()
+     */
+    State state() const;
+
+    /*!
+     * \brief Getter function for the \link FailoverController::probeInterval probeInterval\endlink property.
+     * \sa setProbeInterval()
+     */
+    int probeInterval() const;
+
+    /*!
+     * \brief Setter function for the \link FailoverController::probeInterval probeInterval\endlink property.
+     * \sa probeInterval()
+     */
+    void setProbeInterval(int probeInterval);
+
+    /*!
+     * \brief Getter function for the \link FailoverController::probeTimeout probeTimeout\endlink property.
+     * \sa setProbeTimeout()
+     */
+    int probeTimeout() const;
+
+    /*!
+     * \brief Setter function for the \link FailoverController::probeTimeout probeTimeout\endlink property.
+     * \sa probeTimeout()
+     */
+    void setProbeTimeout(int probeTimeout);
+
+    /*!
+     * \brief Getter function for the \link FailoverController::failureThreshold failureThreshold\endlink property.
+     * \sa setFailureThreshold()
+     */
+    int failureThreshold() const;
+
+    /*!
+     * \brief Setter function for the \link FailoverController::failureThreshold failureThreshold\endlink property.
+     * \sa failureThreshold()
+     */
+    void setFailureThreshold(int failureThreshold);
+
+public Q_SLOTS:
+    /*!
+     * \brief Warms up the switcher and starts probing.
+     */
+    void start();
+
+    /*!
+     * \brief Stops probing, a running switch will not be aborted.
+     *
+     * If a running switch fails, the controller stops instead of resuming monitoring.
+     */
+    void stop();
+
+Q_SIGNALS:
+    /*!
+     * \brief Emitted after every probe, \a latency is the duration of the probe in milliseconds.
+     */
+    void probed(bool healthy, qint64 latency);
+
+    /*!
+     * \brief Emitted right before the failover IP will be switched.
+     */
+    void switchTriggered(int failedProbes);
+
+    /*!
+     * \brief Emitted when the triggered switch has been finished.
+     */
+    void switchFinished(const QHR::FailoverSwitchResult &result);
+
+    /*!
+     * \brief Notifier signal for the \link FailoverController::state state\endlink property.
+     * \sa state()
+     */
+    void stateChanged(QHR::FailoverController::State state);
+
+protected:
+    const std::unique_ptr<FailoverControllerPrivate> fcd_ptr;
+
+private:
+    Q_DECLARE_PRIVATE_D(fcd_ptr, FailoverController)
+    Q_DISABLE_COPY(FailoverController)
+};
+
+}
+
+#endif // QHR_FAILOVERCONTROLLER_H
@@ -0,0 +1,58 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_FAILOVERCONTROLLER_P_H
+#define QHR_FAILOVERCONTROLLER_P_H
+
+#include "failovercontroller.h"
+#include <QTimer>
+#include <QElapsedTimer>
+
+namespace QHR {
+
+class FailoverControllerPrivate
+{
+public:
+    explicit FailoverControllerPrivate(FailoverController *q);
+    ~FailoverControllerPrivate();
+
+    void setState(FailoverController::State newState);
+
+    void probe();
+
+    void tcpProbe(const std::function<void(bool healthy)> &report);
+
+    void probeFinished(quint64 id, bool healthy);
+
+    void switchFinished(const FailoverSwitchResult &result);
+
+    FailoverSwitcher switcher;
+    QTimer probeTimer;
+    QElapsedTimer probeElapsed;
+    FailoverController::Probe customProbe;
+    QString failoverIp;
+    QString backupServerIp;
+    QString host;
+    // increased for every probe, late reports of timed out probes are ignored
+    quint64 probeId = 0;
+    int failures = 0;
+    int probeTimeout = 500;
+    int failureThreshold = 3;
+    quint16 port = 0;
+    FailoverController::State state = FailoverController::Stopped;
+    bool probing = false;
+    bool stopRequested = false;
+
+protected:
+    FailoverController *q_ptr = nullptr;
+
+private:
+    Q_DISABLE_COPY(FailoverControllerPrivate)
+    Q_DECLARE_PUBLIC(FailoverController)
+};
+
+}
+
+#endif // QHR_FAILOVERCONTROLLER_P_H
@@ -0,0 +1,530 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "failoverswitcher_p.h"
+#include "job_p.h"
+#include "endpoints.h"
+#include "abstractconfiguration.h"
+#include "abstractnamfactory.h"
+#include "abstractcredentialprovider.h"
+#include <QJsonDocument>
+#include <QUrlQuery>
+#include <algorithm>
+
+using namespace QHR;
+
+FailoverSwitcherPrivate::FailoverSwitcherPrivate(FailoverSwitcher *q)
+    : q_ptr(q)
+{
+
+}
+
+FailoverSwitcherPrivate::~FailoverSwitcherPrivate() = default;
+
+AbstractConfiguration *FailoverSwitcherPrivate::activeConfiguration() const
+{
+    return configuration ? configuration : QHR::defaultConfiguration();
+}
+
+QNetworkAccessManager *FailoverSwitcherPrivate::networkAccessManager()
+{
+    // never the pooled manager, its connections might be busy with other requests
+    if (!nam) {
+        auto namf = QHR::networkAccessManagerFactory();
+        nam.reset(namf ? namf->create(nullptr) : new QNetworkAccessManager);
+    }
+    return nam.get();
+}
+
+QByteArray FailoverSwitcherPrivate::authorizationHeader(AbstractConfiguration *config)
+{
+    if (!authHeader.isEmpty()) {
+        return authHeader;
+    }
+
+    credentialProvider = config->credentialProvider();
+    if (credentialProvider) {
+        authHeader = credentialProvider->authorizationHeader();
+    } else if (!config->username().isEmpty() && !config->password().isEmpty()) {
+        const QString auth = config->username() + QLatin1Char(':') + config->password();
+        authHeader = QByteArrayLiteral("Basic ") + auth.toUtf8().toBase64();
+    }
+
+    return authHeader;
+}
+
+void FailoverSwitcherPrivate::authorize(FailoverSwitchState *state)
+{
+    Q_Q(FailoverSwitcher);
+
+    state->waitingForCredentials = false;
+
+    AbstractConfiguration *config = activeConfiguration();
+    if (Q_UNLIKELY(!config)) {
+        qCCritical(qhrCore) << "Can not switch failover IP: missing configuration.";
+        finish(state, MissingConfig);
+        return;
+    }
+
+    const QByteArray auth = authorizationHeader(config);
+    if (!auth.isEmpty()) {
+        state->request.setRawHeader(QByteArrayLiteral("Authorization"), auth);
+        sendAttempt(state);
+        return;
+    }
+
+    if (Q_UNLIKELY(!credentialProvider)) {
+        qCCritical(qhrCore) << "Can not switch failover IP: missing username or password.";
+        finish(state, MissingPassword);
+        return;
+    }
+
+    // waiting for the credentials counts like an attempt against the timeout
+    state->waitingForCredentials = true;
+    state->attemptId = ++lastAttemptId;
+    const quint64 attemptId = state->attemptId;
+    QTimer::singleShot(timeout, Qt::PreciseTimer, q, [this, attemptId](){
+        credentialsTimedOut(attemptId);
+    });
+
+    waitForCredentials();
+}
+
+void FailoverSwitcherPrivate::waitForCredentials()
+{
+    Q_Q(FailoverSwitcher);
+
+    if (waitingForCredentials) {
+        return;
+    }
+    waitingForCredentials = true;
+
+    qCDebug(qhrCore) << "Waiting for credentials from" << credentialProvider.data();
+
+    credentialConnections[0] = QObject::connect(credentialProvider.data(), &AbstractCredentialProvider::credentialsReady, q, [this](){
+        QObject::disconnect(credentialConnections[0]);
+        QObject::disconnect(credentialConnections[1]);
+        waitingForCredentials = false;
+        authHeader.clear();
+        credentialsAvailable();
+    });
+
+    credentialConnections[1] = QObject::connect(credentialProvider.data(), &AbstractCredentialProvider::credentialsFailed, q, [this](const QString &errorString){
+        QObject::disconnect(credentialConnections[0]);
+        QObject::disconnect(credentialConnections[1]);
+        waitingForCredentials = false;
+        std::vector<quint64> waiting;
+        for (const std::unique_ptr<FailoverSwitchState> &s : running) {
+            if (s->waitingForCredentials) {
+                waiting.push_back(s->attemptId);
+            }
+        }
+        // finishing a switch might start or abort others in a slot connected to switchFinished()
+        for (quint64 attemptId : waiting) {
+            auto it = std::find_if(running.begin(), running.end(), [attemptId](const std::unique_ptr<FailoverSwitchState> &s){
+                return s->waitingForCredentials && s->attemptId == attemptId;
+            });
+            if (it != running.end()) {
+                (*it)->waitingForCredentials = false;
+                finish(it->get(), CredentialsUnavailable, errorString);
+            }
+        }
+    });
+
+    // the provider might live in another thread
+    QMetaObject::invokeMethod(credentialProvider.data(), "requestCredentials");
+}
+
+void FailoverSwitcherPrivate::credentialsAvailable()
+{
+    std::vector<quint64> waiting;
+    for (const std::unique_ptr<FailoverSwitchState> &s : running) {
+        if (s->waitingForCredentials) {
+            waiting.push_back(s->attemptId);
+        }
+    }
+
+    for (quint64 attemptId : waiting) {
+        auto it = std::find_if(running.begin(), running.end(), [attemptId](const std::unique_ptr<FailoverSwitchState> &s){
+            return s->waitingForCredentials && s->attemptId == attemptId;
+        });
+        if (it != running.end()) {
+            authorize(it->get());
+        }
+    }
+}
+
+void FailoverSwitcherPrivate::credentialsTimedOut(quint64 attemptId)
+{
+    auto it = std::find_if(running.begin(), running.end(), [attemptId](const std::unique_ptr<FailoverSwitchState> &s){
+        return s->waitingForCredentials && s->attemptId == attemptId;
+    });
+    if (it == running.end()) {
+        return;
+    }
+
+    qCWarning(qhrCore) << "Failover switch for" << (*it)->result.failoverIp << "timed out after" << timeout << "ms while waiting for credentials.";
+    (*it)->waitingForCredentials = false;
+    finish(it->get(), RequestTimedOut, QString::number(timeout / 1000.0));
+}
+
+void FailoverSwitcherPrivate::openConnection()
+{
+    AbstractConfiguration *config = activeConfiguration();
+    if (Q_UNLIKELY(!config)) {
+        qCWarning(qhrCore) << "Can not warm up failover switch connection: missing configuration.";
+        return;
+    }
+
+    if (authorizationHeader(config).isEmpty() && credentialProvider) {
+        // the provider might live in another thread
+        QMetaObject::invokeMethod(credentialProvider.data(), "requestCredentials");
+    }
+
+    const QUrl url = config->baseUrl();
+#ifndef QT_NO_SSL
+    if (url.scheme() == QLatin1String("https")) {
+        networkAccessManager()->connectToHostEncrypted(url.host(), static_cast<quint16>(url.port(443)));
+        return;
+    }
+#endif
+    networkAccessManager()->connectToHost(url.host(), static_cast<quint16>(url.port(80)));
+}
+
+void FailoverSwitcherPrivate::sendAttempt(FailoverSwitchState *state)
+{
+    ++state->result.attempts;
+    state->timedOut = false;
+    state->attemptId = ++lastAttemptId;
+    state->attemptElapsed.start();
+
+    state->verifying = false;
+    state->reply = networkAccessManager()->post(state->request, state->payload);
+    watchReply(state);
+}
+
+void FailoverSwitcherPrivate::sendVerification(FailoverSwitchState *state)
+{
+    state->timedOut = false;
+    state->attemptId = ++lastAttemptId;
+    state->attemptElapsed.start();
+
+    QNetworkRequest request = state->request;
+    request.setRawHeader(QByteArrayLiteral("Content-Type"), QByteArray());
+    state->verifying = true;
+    state->reply = networkAccessManager()->get(request);
+    watchReply(state);
+}
+
+void FailoverSwitcherPrivate::watchReply(FailoverSwitchState *state)
+{
+    Q_Q(FailoverSwitcher);
+
+    QObject::connect(state->reply, &QNetworkReply::finished, q, [this, state](){
+        attemptFinished(state);
+    });
+
+    const quint64 attemptId = state->attemptId;
+    QTimer::singleShot(timeout, Qt::PreciseTimer, q, [this, attemptId](){
+        attemptTimedOut(attemptId);
+    });
+}
+
+void FailoverSwitcherPrivate::attemptTimedOut(quint64 attemptId)
+{
+    auto it = std::find_if(running.begin(), running.end(), [attemptId](const std::unique_ptr<FailoverSwitchState> &s){
+        return s->attemptId == attemptId;
+    });
+    if (it == running.end() || !(*it)->reply) {
+        return;
+    }
+
+    qCWarning(qhrCore) << "Failover switch attempt for" << (*it)->result.failoverIp << "timed out after" << timeout << "ms.";
+    (*it)->timedOut = true;
+    // emits finished() synchronously
+    (*it)->reply->abort();
+}
+
+void FailoverSwitcherPrivate::attemptFinished(FailoverSwitchState *state)
+{
+    QNetworkReply *reply = state->reply;
+    state->reply = nullptr;
+    reply->deleteLater();
+
+    FailoverSwitchResult &result = state->result;
+    const QNetworkReply::NetworkError networkError = reply->error();
+    const QByteArray data = reply->readAll();
+
+    if (state->verifying) {
+        state->verifying = false;
+        const QJsonObject failover = QJsonDocument::fromJson(data).object().value(QStringLiteral("failover")).toObject();
+        if (networkError == QNetworkReply::NoError && failover.value(QStringLiteral("active_server_ip")).toString() == result.activeServerIp) {
+            qCDebug(qhrCore) << "Failover IP" << result.failoverIp << "has been routed to" << result.activeServerIp << "by a previous attempt";
+            result.failover = failover;
+            finish(state, BJob::NoError);
+        } else if (result.attempts < maxAttempts) {
+            qCWarning(qhrCore) << "Failover IP" << result.failoverIp << "is still locked - retrying immediately.";
+            sendAttempt(state);
+        } else {
+            finish(state, JobPrivate::errorForApiCode(result.apiErrorCode), state->errorText);
+        }
+        return;
+    }
+
+    result.requestLatency = state->attemptElapsed.elapsed();
+    result.httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    if (Q_LIKELY(networkError == QNetworkReply::NoError)) {
+        result.failover = QJsonDocument::fromJson(data).object().value(QStringLiteral("failover")).toObject();
+        finish(state, BJob::NoError);
+        return;
+    }
+
+    int error;
+    QString errorText;
+    bool retry = false;
+
+    const QJsonObject apiError = QJsonDocument::fromJson(data).object().value(QStringLiteral("error")).toObject();
+    result.apiErrorCode = apiError.value(QStringLiteral("code")).toString();
+
+    if (result.apiErrorCode == QLatin1String("FAILOVER_ALREADY_ROUTED")) {
+        // a previous attempt might have been applied although its reply got lost
+        qCDebug(qhrCore) << "Failover IP" << result.failoverIp << "is already routed to" << result.activeServerIp;
+        finish(state, BJob::NoError);
+        return;
+    } else if (result.apiErrorCode == QLatin1String("FAILOVER_LOCKED") && result.attempts > 1) {
+        // the lock might be held by the switch of a previous attempt whose reply got lost
+        qCDebug(qhrCore) << "Failover IP" << result.failoverIp << "is locked, checking current routing.";
+        state->errorText = apiError.value(QStringLiteral("message")).toString();
+        if (state->errorText.isEmpty()) {
+            state->errorText = result.apiErrorCode;
+        }
+        sendVerification(state);
+        return;
+    } else if (!result.apiErrorCode.isEmpty()) {
+        error = JobPrivate::errorForApiCode(result.apiErrorCode);
+        errorText = apiError.value(QStringLiteral("message")).toString();
+        if (errorText.isEmpty()) {
+            errorText = result.apiErrorCode;
+        }
+        retry = result.httpStatus >= 500;
+        if (error == Unauthorized) {
+            authHeader.clear();
+            if (credentialProvider) {
+                credentialProvider->invalidate();
+            }
+            // the credentials might have been changed since they have been cached
+            if (!state->authRetried && result.attempts < maxAttempts) {
+                qCWarning(qhrCore) << "Failover switch attempt" << result.attempts << "for" << result.failoverIp << "has been rejected as unauthorized - retrying with fetched credentials.";
+                state->authRetried = true;
+                authorize(state);
+                return;
+            }
+        }
+    } else if (state->timedOut || networkError == QNetworkReply::TimeoutError) {
+        error = RequestTimedOut;
+        errorText = QString::number(timeout / 1000.0);
+        retry = true;
+    } else {
+        error = NetworkError;
+        errorText = reply->errorString();
+        retry = true;
+    }
+
+    if (retry && result.attempts < maxAttempts) {
+        qCWarning(qhrCore) << "Failover switch attempt" << result.attempts << "for" << result.failoverIp << "failed:" << errorText << "- retrying immediately.";
+        sendAttempt(state);
+        return;
+    }
+
+    finish(state, error, errorText);
+}
+
+void FailoverSwitcherPrivate::finish(FailoverSwitchState *state, int error, const QString &errorText)
+{
+    Q_Q(FailoverSwitcher);
+
+    auto it = std::find_if(running.begin(), running.end(), [state](const std::unique_ptr<FailoverSwitchState> &s){
+        return s.get() == state;
+    });
+    Q_ASSERT(it != running.end());
+
+    FailoverSwitchResult result = std::move(state->result);
+    result.error = error;
+    if (error != BJob::NoError) {
+        result.errorString = JobPrivate::errorMessage(error, errorText);
+    }
+    result.latency = state->elapsed.elapsed();
+    running.erase(it);
+
+    if (result.isOk()) {
+        qCInfo(qhrCore) << "Switched failover IP" << result.failoverIp << "to" << result.activeServerIp << "in" << result.latency << "ms after" << result.attempts << "attempt(s).";
+    } else {
+        qCCritical(qhrCore) << "Failed to switch failover IP" << result.failoverIp << "to" << result.activeServerIp << "after" << result.latency << "ms:" << result.errorString;
+    }
+
+    Q_EMIT q->switchFinished(result);
+}
+
+void FailoverSwitcherPrivate::abort(FailoverSwitchState *state)
+{
+    Q_Q(FailoverSwitcher);
+    if (state->reply) {
+        QNetworkReply *reply = state->reply;
+        state->reply = nullptr;
+        QObject::disconnect(reply, nullptr, q, nullptr);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+std::vector<std::unique_ptr<FailoverSwitchState>>::iterator FailoverSwitcherPrivate::find(const QString &failoverIp)
+{
+    return std::find_if(running.begin(), running.end(), [&failoverIp](const std::unique_ptr<FailoverSwitchState> &s){
+        return s->result.failoverIp == failoverIp;
+    });
+}
+
+FailoverSwitcher::FailoverSwitcher(QObject *parent)
+    : QObject(parent), fsd_ptr(new FailoverSwitcherPrivate(this))
+{
+    Q_D(FailoverSwitcher);
+    d->keepAliveTimer.setTimerType(Qt::VeryCoarseTimer);
+    connect(&d->keepAliveTimer, &QTimer::timeout, this, [d](){
+        d->openConnection();
+    });
+}
+
+FailoverSwitcher::~FailoverSwitcher()
+{
+    Q_D(FailoverSwitcher);
+    for (const std::unique_ptr<FailoverSwitchState> &state : d->running) {
+        d->abort(state.get());
+    }
+}
+
+void FailoverSwitcher::setConfiguration(AbstractConfiguration *configuration)
+{
+    Q_D(FailoverSwitcher);
+    if (d->configuration != configuration) {
+        d->configuration = configuration;
+        d->authHeader.clear();
+    }
+}
+
+int FailoverSwitcher::timeout() const
+{
+    Q_D(const FailoverSwitcher);
+    return d->timeout;
+}
+
+void FailoverSwitcher::setTimeout(int timeout)
+{
+    Q_D(FailoverSwitcher);
+    d->timeout = std::max(1, timeout);
+}
+
+int FailoverSwitcher::maxAttempts() const
+{
+    Q_D(const FailoverSwitcher);
+    return d->maxAttempts;
+}
+
+void FailoverSwitcher::setMaxAttempts(int maxAttempts)
+{
+    Q_D(FailoverSwitcher);
+    d->maxAttempts = std::max(1, maxAttempts);
+}
+
+int FailoverSwitcher::keepAliveInterval() const
+{
+    Q_D(const FailoverSwitcher);
+    return d->keepAliveInterval;
+}
+
+void FailoverSwitcher::setKeepAliveInterval(int keepAliveInterval)
+{
+    Q_D(FailoverSwitcher);
+    d->keepAliveInterval = std::max(0, keepAliveInterval);
+    if (d->keepAliveTimer.isActive()) {
+        if (d->keepAliveInterval > 0) {
+            d->keepAliveTimer.start(d->keepAliveInterval);
+        } else {
+            d->keepAliveTimer.stop();
+        }
+    }
+}
+
+bool FailoverSwitcher::isSwitching(const QString &failoverIp) const
+{
+    Q_D(const FailoverSwitcher);
+    return std::any_of(d->running.cbegin(), d->running.cend(), [&failoverIp](const std::unique_ptr<FailoverSwitchState> &s){
+        return s->result.failoverIp == failoverIp;
+    });
+}
+
+void FailoverSwitcher::warmUp()
+{
+    Q_D(FailoverSwitcher);
+    qCDebug(qhrCore) << "Warming up failover switch connection.";
+    d->openConnection();
+    if (d->keepAliveInterval > 0) {
+        d->keepAliveTimer.start(d->keepAliveInterval);
+    }
+}
+
+void FailoverSwitcher::switchTo(const QString &failoverIp, const QString &activeServerIp)
+{
+    Q_D(FailoverSwitcher);
+
+    auto existing = d->find(failoverIp);
+    if (existing != d->running.end()) {
+        qCWarning(qhrCore) << "Aborting running switch of failover IP" << failoverIp;
+        FailoverSwitchState *old = existing->get();
+        d->abort(old);
+        d->finish(old, BJob::KilledJobError);
+    }
+
+    d->running.emplace_back(new FailoverSwitchState);
+    FailoverSwitchState *state = d->running.back().get();
+    state->elapsed.start();
+    state->result.failoverIp = failoverIp;
+    state->result.activeServerIp = activeServerIp;
+
+    AbstractConfiguration *config = d->activeConfiguration();
+    if (Q_UNLIKELY(!config)) {
+        qCCritical(qhrCore) << "Can not switch failover IP: missing configuration.";
+        d->finish(state, MissingConfig);
+        return;
+    }
+
+    const QString path = makeRequest<Endpoints::FailoverSwitch>(failoverIp).path;
+    if (Q_UNLIKELY(path.isNull())) {
+        qCCritical(qhrCore) << "Can not switch failover IP: invalid failover IP" << failoverIp;
+        d->finish(state, InvalidInput, QStringLiteral("failover-ip"));
+        return;
+    }
+
+    QUrl url = config->baseUrl();
+    QString basePath = url.path();
+    if (basePath.endsWith(QLatin1Char('/'))) {
+        basePath.chop(1);
+    }
+    url.setPath(basePath + path);
+
+    state->request.setUrl(url);
+    state->request.setRawHeader(QByteArrayLiteral("Content-Type"), QByteArrayLiteral("application/x-www-form-urlencoded"));
+    state->request.setRawHeader(QByteArrayLiteral("Accept"), QByteArrayLiteral("application/json"));
+    state->request.setRawHeader(QByteArrayLiteral("User-Agent"), config->userAgent().toUtf8());
+
+    QUrlQuery form;
+    form.addQueryItem(QStringLiteral("active_server_ip"), activeServerIp);
+    state->payload = form.toString(QUrl::FullyEncoded).toUtf8();
+
+    qCDebug(qhrCore) << "Switching failover IP" << failoverIp << "to" << activeServerIp;
+    d->authorize(state);
+}
+
+#include "moc_failoverswitcher.cpp"
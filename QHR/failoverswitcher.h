@@ -0,0 +1,195 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_FAILOVERSWITCHER_H
+#define QHR_FAILOVERSWITCHER_H
+
+#include <QObject>
+#include <QString>
+#include <QJsonObject>
+#include <QMetaType>
+#include "qhr_global.h"
+#include <memory>
+
+namespace QHR {
+
+class FailoverSwitcherPrivate;
+class AbstractConfiguration;
+
+/*!
+ * \brief Outcome of a failover switch performed by FailoverSwitcher.
+ *
+ * \headerfile "" <QHR/FailoverSwitcher>
+ */
+struct FailoverSwitchResult
+{
+    QString failoverIp;
+    QString activeServerIp;
+    QJsonObject failover;       /**< The failover object returned by the API on success. */
+    QString errorString;        /**< Human readable and translated error string. */
+    QString apiErrorCode;       /**< Error code returned by the API, like \c "FAILOVER_LOCKED". */
+    qint64 latency = 0;         /**< Milliseconds from calling FailoverSwitcher::switchTo() until the result, including retries. */
+    qint64 requestLatency = 0;  /**< Milliseconds of the last attempt. */
+    int error = 0;              /**< BJob::NoError or one of the error codes of Job. */
+    int httpStatus = 0;
+    int attempts = 0;
+
+    bool isOk() const { return error == 0; }
+};
+
+/*!
+ * \brief Switches failover IP addresses with the lowest possible latency.
+ *
+ * Other than jobs, the switcher uses its own QNetworkAccessManager that is not shared with
+ * other requests, so a switch never waits for a free connection. warmUp() resolves the
+ * credentials and opens the encrypted connection to the API in advance, if a keep alive
+ * interval is set, the connection is refreshed periodically so it is still open when needed.
+ *
+ * switchTo() sends \c POST /failover/{ip} immediately: it does not pass any queue, the
+ * request rate limiting and the response cache. Every attempt is aborted after
+ * \link FailoverSwitcher::timeout timeout\endlink milliseconds and failed attempts caused
+ * by network errors, timeouts or server errors are repeated immediately without any back
+ * off. If the API answers that the failover IP is already routed to the requested server,
+ * the switch is reported as successful. If a repeated attempt is answered with
+ * \c FAILOVER_LOCKED, the lock might be held by the switch of a previous attempt whose reply
+ * got lost, so the current routing is requested via \c GET /failover/{ip} and the switch is
+ * reported as successful if the failover IP already points to the requested server.
+ *
+ * The \c Authorization header is cached. If the configuration uses an AbstractCredentialProvider
+ * that has not fetched the credentials yet, the switch waits for them up to
+ * \link FailoverSwitcher::timeout timeout\endlink milliseconds. If the API rejects the cached
+ * credentials, they are fetched again and the attempt is repeated once, as long as
+ * \link FailoverSwitcher::maxAttempts maxAttempts\endlink has not been reached.
+ *
+ * The outcome is reported via switchFinished() together with the end-to-end latency.
+ *
+ * \headerfile "" <QHR/FailoverSwitcher>
+ */
+class QHR_LIBRARY FailoverSwitcher : public QObject
+{
+    Q_OBJECT
+    /*!
+     * \brief Timeout in milliseconds for a single attempt.
+     *
+     * The default value is \c 5000.
+     *
+     * \par Access functions
+     * \li int timeout() const
+     * \li void setTimeout(int timeout)
+     */
+    Q_PROPERTY(int timeout READ timeout WRITE setTimeout)
+    /*!
+     * \brief Maximum number of attempts per switch.
+     *
+     * The default value is \c 3.
+     *
+     * \par Access functions
+     * \li int maxAttempts() const
+     * \li void setMaxAttempts(int maxAttempts)
+     */
+    Q_PROPERTY(int maxAttempts READ maxAttempts WRITE setMaxAttempts)
+    /*!
+     * \brief Interval in milliseconds to refresh the warm connection.
+     *
+     * The default value is \c 20000. \c 0 disables refreshing after warmUp().
+     *
+     * \par Access functions
+     * \li int keepAliveInterval() const
+     * \li void setKeepAliveInterval(int keepAliveInterval)
+     */
+    Q_PROPERTY(int keepAliveInterval READ keepAliveInterval WRITE setKeepAliveInterval)
+public:
+    /*!
+     * \brief Constructs a new %FailoverSwitcher object with the given \a parent.
+     */
+    explicit FailoverSwitcher(QObject *parent = nullptr);
+
+    /*!
+     * \brief Destroys the %FailoverSwitcher object, aborting running switches.
+     */
+    ~FailoverSwitcher() override;
+
+    /*!
+     * \brief Sets the \a configuration used for the requests.
+     *
+     * If not set, QHR::defaultConfiguration() will be used.
+     */
+    void setConfiguration(AbstractConfiguration *configuration);
+
+    /*!
+     * \brief Getter function for the \link FailoverSwitcher::timeout timeout\endlink property.
+     * \sa setTimeout()
+     */
+    int timeout() const;
+
+    /*!
+     * \brief Setter function for the \link FailoverSwitcher::timeout timeout\endlink property.
+     * \sa timeout()
+     */
+    void setTimeout(int timeout);
+
+    /*!
+     * \brief Getter function for the \link FailoverSwitcher::maxAttempts maxAttempts\endlink property.
+     * \sa setMaxAttempts()
+     */
+    int maxAttempts() const;
+
+    /*!
+     * \brief Setter function for the \link FailoverSwitcher::maxAttempts maxAttempts\endlink property.
+     * \sa maxAttempts()
+     */
+    void setMaxAttempts(int maxAttempts);
+
+    /*!
+     * \brief Getter function for the \link FailoverSwitcher::keepAliveInterval keepAliveInterval\endlink property.
+     * \sa setKeepAliveInterval()
+     */
+    int keepAliveInterval() const;
+
+    /*!
+     * \brief Setter function for the \link FailoverSwitcher::keepAliveInterval keepAliveInterval\endlink property.
+     * \sa keepAliveInterval()
+     */
+    void setKeepAliveInterval(int keepAliveInterval);
+
+    /*!
+     * \brief Returns \c true while a switch of \a failoverIp is running.
+     */
+    bool isSwitching(const QString &failoverIp) const;
+
+public Q_SLOTS:
+    /*!
+     * \brief Prepares the credentials and opens the connection to the API.
+     *
+     * Starts refreshing the connection if a keep alive interval is set.
+     */
+    void warmUp();
+
+    /*!
+     * \brief Routes \a failoverIp to the server with the main IP \a activeServerIp.
+     *
+     * A running switch of the same failover IP will be aborted.
+     */
+    void switchTo(const QString &failoverIp, const QString &activeServerIp);
+
+Q_SIGNALS:
+    /*!
+     * \brief Emitted when a switch has been finished, check FailoverSwitchResult::error for the outcome.
+     */
+    void switchFinished(const QHR::FailoverSwitchResult &result);
+
+protected:
+    const std::unique_ptr<FailoverSwitcherPrivate> fsd_ptr;
+
+private:
+    Q_DECLARE_PRIVATE_D(fsd_ptr, FailoverSwitcher)
+    Q_DISABLE_COPY(FailoverSwitcher)
+};
+
+}
+
+Q_DECLARE_METATYPE(QHR::FailoverSwitchResult)
+
+#endif // QHR_FAILOVERSWITCHER_H
@@ -0,0 +1,102 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_FAILOVERSWITCHER_P_H
+#define QHR_FAILOVERSWITCHER_P_H
+
+#include "failoverswitcher.h"
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QNetworkAccessManager>
+#include <vector>
+
+namespace QHR {
+
+class AbstractCredentialProvider;
+
+struct FailoverSwitchState
+{
+    FailoverSwitchResult result;
+    QNetworkRequest request;
+    QByteArray payload;
+    // error of the last attempt while verifying the routing
+    QString errorText;
+    QElapsedTimer elapsed;
+    QElapsedTimer attemptElapsed;
+    QNetworkReply *reply = nullptr;
+    // identifies the current attempt for its timeout timer
+    quint64 attemptId = 0;
+    bool timedOut = false;
+    bool verifying = false;
+    bool waitingForCredentials = false;
+    // the credentials have been fetched again after the API rejected them
+    bool authRetried = false;
+};
+
+class FailoverSwitcherPrivate
+{
+public:
+    explicit FailoverSwitcherPrivate(FailoverSwitcher *q);
+    ~FailoverSwitcherPrivate();
+
+    AbstractConfiguration *activeConfiguration() const;
+
+    QNetworkAccessManager *networkAccessManager();
+
+    QByteArray authorizationHeader(AbstractConfiguration *config);
+
+    void authorize(FailoverSwitchState *state);
+
+    void waitForCredentials();
+
+    void credentialsAvailable();
+
+    void credentialsTimedOut(quint64 attemptId);
+
+    void openConnection();
+
+    void sendAttempt(FailoverSwitchState *state);
+
+    void sendVerification(FailoverSwitchState *state);
+
+    void watchReply(FailoverSwitchState *state);
+
+    void attemptTimedOut(quint64 attemptId);
+
+    void attemptFinished(FailoverSwitchState *state);
+
+    void finish(FailoverSwitchState *state, int error, const QString &errorText = QString());
+
+    void abort(FailoverSwitchState *state);
+
+    std::vector<std::unique_ptr<FailoverSwitchState>>::iterator find(const QString &failoverIp);
+
+    std::vector<std::unique_ptr<FailoverSwitchState>> running;
+    std::unique_ptr<QNetworkAccessManager> nam;
+    QTimer keepAliveTimer;
+    QByteArray authHeader;
+    QPointer<AbstractCredentialProvider> credentialProvider;
+    QMetaObject::Connection credentialConnections[2];
+    AbstractConfiguration *configuration = nullptr;
+    quint64 lastAttemptId = 0;
+    int timeout = 5000;
+    int maxAttempts = 3;
+    int keepAliveInterval = 20000;
+    bool waitingForCredentials = false;
+
+protected:
+    FailoverSwitcher *q_ptr = nullptr;
+
+private:
+    Q_DISABLE_COPY(FailoverSwitcherPrivate)
+    Q_DECLARE_PUBLIC(FailoverSwitcher)
+};
+
+}
+
+#endif // QHR_FAILOVERSWITCHER_P_H
@@ -0,0 +1,124 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "getproductcatalogjob_p.h"
+#include <QTimer>
+#include <QJsonArray>
+
+using namespace QHR;
+
+GetProductCatalogJobPrivate::GetProductCatalogJobPrivate(GetProductCatalogJob *q)
+    : JobPrivate(q)
+{
+    namOperation = NetworkOperation::Get;
+    expectedContentType = ExpectedContentType::JsonArray;
+}
+
+GetProductCatalogJobPrivate::~GetProductCatalogJobPrivate() = default;
+
+QString GetProductCatalogJobPrivate::buildUrlPath() const
+{
+    if (source == ProductCatalog::ServerProducts) {
+        return QStringLiteral("/order/server/product");
+    }
+    return QStringLiteral("/order/server_market/product");
+}
+
+void GetProductCatalogJobPrivate::emitDescription()
+{
+    QString _title;
+    if (source == ProductCatalog::ServerProducts) {
+        //: Job title
+        //% "Getting server products"
+        _title = qtTrId("libqhr-job-desc-get-server-products-title");
+    } else {
+        //: Job title
+        //% "Getting server market products"
+        _title = qtTrId("libqhr-job-desc-get-server-market-products-title");
+    }
+
+    Q_Q(GetProductCatalogJob);
+    Q_EMIT q->description(q, _title);
+}
+
+void GetProductCatalogJobPrivate::successCallback(const QByteArray &replyData)
+{
+    Q_UNUSED(replyData)
+    Q_Q(GetProductCatalogJob);
+
+    catalog = ProductCatalog::fromJson(jsonResult.array(), source, previous);
+
+    if (previous.isNull()) {
+        return;
+    }
+
+    changes = ProductCatalog::diff(previous, catalog);
+
+    qCDebug(qhrCore) << "Product catalog refreshed:" << changes.added.size() << "added," << changes.changed.size() << "changed," << changes.removed.size() << "removed";
+
+    const ProductCatalog::Changes &_changes = changes;
+    for (int row : _changes.added) {
+        Q_EMIT q->offerAdded(catalog.offer(row));
+    }
+    for (int row : _changes.changed) {
+        Q_EMIT q->offerChanged(catalog.offer(row));
+    }
+    for (const QString &id : _changes.removed) {
+        Q_EMIT q->offerRemoved(id);
+    }
+}
+
+GetProductCatalogJob::GetProductCatalogJob(ProductCatalog::Source source, QObject *parent)
+    : Job(* new GetProductCatalogJobPrivate(this), parent)
+{
+    Q_D(GetProductCatalogJob);
+    d->source = source;
+    qCDebug(qhrCore) << "Creating new" << this;
+}
+
+GetProductCatalogJob::~GetProductCatalogJob() = default;
+
+void GetProductCatalogJob::start()
+{
+    QTimer::singleShot(0, this, &GetProductCatalogJob::sendRequest);
+}
+
+ProductCatalog::Source GetProductCatalogJob::source() const
+{
+    Q_D(const GetProductCatalogJob);
+    return d->source;
+}
+
+void GetProductCatalogJob::setSource(ProductCatalog::Source source)
+{
+    Q_D(GetProductCatalogJob);
+    d->source = source;
+}
+
+ProductCatalog GetProductCatalogJob::previousCatalog() const
+{
+    Q_D(const GetProductCatalogJob);
+    return d->previous;
+}
+
+void GetProductCatalogJob::setPreviousCatalog(const ProductCatalog &previous)
+{
+    Q_D(GetProductCatalogJob);
+    d->previous = previous;
+}
+
+ProductCatalog GetProductCatalogJob::catalog() const
+{
+    Q_D(const GetProductCatalogJob);
+    return d->catalog;
+}
+
+ProductCatalog::Changes GetProductCatalogJob::changes() const
+{
+    Q_D(const GetProductCatalogJob);
+    return d->changes;
+}
+
+#include "moc_getproductcatalogjob.cpp"
@@ -0,0 +1,121 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_GETPRODUCTCATALOGJOB_H
+#define QHR_GETPRODUCTCATALOGJOB_H
+
+#include <QObject>
+#include <QString>
+#include "qhr_global.h"
+#include "job.h"
+#include "productcatalog.h"
+
+namespace QHR {
+
+class GetProductCatalogJobPrivate;
+
+/*!
+ * \brief Gets the server or server market product catalog as indexed ProductCatalog.
+ *
+ * After setting the mandatory properties, call start() to perform the request.
+ * The reply is converted into a ProductCatalog that can be queried locally via catalog().
+ *
+ * To refresh a catalog, set the catalog of the last run via setPreviousCatalog(). Offers of
+ * unchanged products are then taken over from it and, if nothing has changed, the previous
+ * catalog with all its indexes is reused. The differences are reported via offerAdded(),
+ * offerChanged() and offerRemoved() before BJob::result() is emitted and are available via
+ * changes(). Without a previous catalog, no change signals are emitted.
+ *
+ * \par Mandatory properties
+ * \li Job::configuratoin
+ * \li setSource()
+ *
+ * \par API method
+ * GET
+ *
+ * \par API route
+ * /order/server/product or /order/server_market/product
+ *
+ * \par API docs
+ * https://robot.your-server.de/doc/webservice/de.html#get-order-server-product
+ * https://robot.your-server.de/doc/webservice/de.html#get-order-server_market-product
+ *
+ * \headerfile "" <QHR/GetProductCatalogJob>
+ */
+class QHR_LIBRARY GetProductCatalogJob : public Job
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief Creates a new %GetProductCatalogJob object for the catalog \a source with the given \a parent.
+     */
+    explicit GetProductCatalogJob(ProductCatalog::Source source = ProductCatalog::ServerMarket, QObject *parent = nullptr);
+
+    /*!
+     * \brief Destroys the %GetProductCatalogJob object.
+     */
+    ~GetProductCatalogJob();
+
+    /*!
+     * \brief Starts the job asynchronously.
+     */
+    void start() override;
+
+    /*!
+     * \brief Returns the requested catalog.
+     */
+    ProductCatalog::Source source() const;
+
+    /*!
+     * \brief Sets the requested catalog \a source.
+     */
+    void setSource(ProductCatalog::Source source);
+
+    /*!
+     * \brief Returns the catalog of the last refresh.
+     */
+    ProductCatalog previousCatalog() const;
+
+    /*!
+     * \brief Sets the \a previous catalog to refresh incrementally and to report changes.
+     */
+    void setPreviousCatalog(const ProductCatalog &previous);
+
+    /*!
+     * \brief Returns the product catalog after a successful request.
+     */
+    ProductCatalog catalog() const;
+
+    /*!
+     * \brief Returns the changes compared to the previous catalog after a successful request.
+     *
+     * The rows refer to catalog().
+     */
+    ProductCatalog::Changes changes() const;
+
+Q_SIGNALS:
+    /*!
+     * \brief Emitted for every \a offer that is not part of the previous catalog.
+     */
+    void offerAdded(const QHR::ProductOffer &offer);
+
+    /*!
+     * \brief Emitted for every \a offer whose data differs from the previous catalog.
+     */
+    void offerChanged(const QHR::ProductOffer &offer);
+
+    /*!
+     * \brief Emitted for the \a id of every offer of the previous catalog that is gone.
+     */
+    void offerRemoved(const QString &id);
+
+private:
+    Q_DECLARE_PRIVATE_D(bd_ptr, GetProductCatalogJob)
+    Q_DISABLE_COPY(GetProductCatalogJob)
+};
+
+}
+
+#endif // QHR_GETPRODUCTCATALOGJOB_H
@@ -0,0 +1,38 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_GETPRODUCTCATALOGJOB_P_H
+#define QHR_GETPRODUCTCATALOGJOB_P_H
+
+#include "getproductcatalogjob.h"
+#include "job_p.h"
+
+namespace QHR {
+
+class GetProductCatalogJobPrivate : public JobPrivate
+{
+public:
+    explicit GetProductCatalogJobPrivate(GetProductCatalogJob *q);
+    ~GetProductCatalogJobPrivate() override;
+
+    QString buildUrlPath() const override;
+
+    void emitDescription() override;
+
+    void successCallback(const QByteArray &replyData) override;
+
+    ProductCatalog catalog;
+    ProductCatalog previous;
+    ProductCatalog::Changes changes;
+    ProductCatalog::Source source = ProductCatalog::ServerMarket;
+
+private:
+    Q_DISABLE_COPY(GetProductCatalogJobPrivate)
+    Q_DECLARE_PUBLIC(GetProductCatalogJob)
+};
+
+}
+
+#endif // QHR_GETPRODUCTCATALOGJOB_P_H
@@ -5,6 +5,7 @@
 
 #include "getserversjob_p.h"
 #include <QTimer>
+#include <QJsonArray>
 
 using namespace QHR;
 
@@ -44,6 +45,12 @@ void GetServersJobPrivate::extractError()
     JobPrivate::extractError();
 }
 
+void GetServersJobPrivate::successCallback(const QByteArray &replyData)
+{
+    Q_UNUSED(replyData)
+    servers = Server::listFromJson(jsonResult.array());
+}
+
 GetServersJob::GetServersJob(QObject *parent)
     : Job(* new GetServersJobPrivate(this), parent)
 {
@@ -68,4 +75,10 @@ QString GetServersJob::errorString() const
     }
 }
 
+ServerList GetServersJob::servers() const
+{
+    Q_D(const GetServersJob);
+    return d->servers;
+}
+
 #include "moc_getserversjob.cpp"
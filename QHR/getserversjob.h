@@ -9,6 +9,7 @@
 #include <QObject>
 #include "qhr_global.h"
 #include "job.h"
+#include "server.h"
 
 namespace QHR {
 
@@ -60,6 +61,14 @@ public:
      */
     QString errorString() const override;
 
+    /*!
+     * \brief Returns the list of servers after a successful request.
+     *
+     * The list is created once from the JSON data when the request has been finished.
+     * If streaming is enabled via Job::setStreamingEnabled(), the list will be empty.
+     */
+    ServerList servers() const;
+
 private:
     Q_DECLARE_PRIVATE_D(bd_ptr, GetServersJob)
     Q_DISABLE_COPY(GetServersJob)
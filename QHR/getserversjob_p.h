@@ -23,6 +23,10 @@ public:
 
     void extractError() override;
 
+    void successCallback(const QByteArray &replyData) override;
+
+    ServerList servers;
+
 private:
     Q_DISABLE_COPY(GetServersJobPrivate)
     Q_DECLARE_PUBLIC(GetServersJob)
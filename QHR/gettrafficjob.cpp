@@ -0,0 +1,231 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "gettrafficjob_p.h"
+#include <QTimer>
+#include <QUrlQuery>
+
+using namespace QHR;
+
+GetTrafficJobPrivate::GetTrafficJobPrivate(GetTrafficJob *q)
+    : JobPrivate(q)
+{
+    namOperation = NetworkOperation::Post;
+    expectedContentType = ExpectedContentType::JsonObject;
+}
+
+GetTrafficJobPrivate::~GetTrafficJobPrivate() = default;
+
+QString GetTrafficJobPrivate::buildUrlPath() const
+{
+    return QStringLiteral("/traffic");
+}
+
+QString GetTrafficJobPrivate::formatDateTime(const QDateTime &dt) const
+{
+    const QDateTime utc = dt.toUTC();
+    switch (type) {
+    case TrafficData::Day:
+        return utc.toString(QStringLiteral("yyyy-MM-dd'T'HH"));
+    case TrafficData::Month:
+        return utc.toString(QStringLiteral("yyyy-MM-dd"));
+    case TrafficData::Year:
+        return utc.toString(QStringLiteral("yyyy-MM"));
+    default:
+        return QString();
+    }
+}
+
+std::pair<QByteArray, QByteArray> GetTrafficJobPrivate::buildPayload() const
+{
+    QUrlQuery form;
+    for (const QString &ip : ips) {
+        form.addQueryItem(QStringLiteral("ip[]"), ip);
+    }
+    for (const QString &subnet : subnets) {
+        form.addQueryItem(QStringLiteral("subnet[]"), subnet);
+    }
+
+    switch (type) {
+    case TrafficData::Day:
+        form.addQueryItem(QStringLiteral("type"), QStringLiteral("day"));
+        break;
+    case TrafficData::Month:
+        form.addQueryItem(QStringLiteral("type"), QStringLiteral("month"));
+        break;
+    case TrafficData::Year:
+        form.addQueryItem(QStringLiteral("type"), QStringLiteral("year"));
+        break;
+    default:
+        break;
+    }
+
+    form.addQueryItem(QStringLiteral("from"), formatDateTime(from));
+    form.addQueryItem(QStringLiteral("to"), formatDateTime(to));
+    form.addQueryItem(QStringLiteral("single_values"), singleValues ? QStringLiteral("true") : QStringLiteral("false"));
+
+    return std::make_pair(form.toString(QUrl::FullyEncoded).toUtf8(), QByteArrayLiteral("application/x-www-form-urlencoded"));
+}
+
+bool GetTrafficJobPrivate::checkInput()
+{
+    if (!JobPrivate::checkInput()) {
+        return false;
+    }
+
+    if (Q_UNLIKELY(type == TrafficData::Invalid)) {
+        emitError(InvalidInput, QStringLiteral("type"));
+        qCCritical(qhrCore) << "Can not send request: missing traffic type.";
+        return false;
+    }
+
+    if (Q_UNLIKELY(!from.isValid() || !to.isValid())) {
+        emitError(InvalidInput, QStringLiteral("from, to"));
+        qCCritical(qhrCore) << "Can not send request: invalid time range.";
+        return false;
+    }
+
+    if (Q_UNLIKELY(ips.empty() && subnets.empty())) {
+        emitError(InvalidInput, QStringLiteral("ip, subnet"));
+        qCCritical(qhrCore) << "Can not send request: neither IP addresses nor subnets set.";
+        return false;
+    }
+
+    return true;
+}
+
+bool GetTrafficJobPrivate::checkOutput(const QByteArray &data)
+{
+    Q_Q(GetTrafficJob);
+
+    if (data.isEmpty()) {
+        q->setError(EmptyReply);
+        qCCritical(qhrCore) << "Invalid reply: content expected, but reply is empty.";
+        return false;
+    }
+
+    // no QJsonDocument is created, the reply is read directly into the columns
+    QString errorString;
+    traffic = TrafficData::fromJson(data, &errorString);
+    if (traffic.isNull()) {
+        q->setError(JsonParseError);
+        q->setErrorText(errorString);
+        qCCritical(qhrCore) << "Invalid traffic data in reply:" << errorString;
+        return false;
+    }
+
+    return true;
+}
+
+void GetTrafficJobPrivate::emitDescription()
+{
+    //: Job title
+    //% "Getting traffic statistics"
+    const QString _title = qtTrId("libqhr-job-desc-get-traffic-title");
+
+    Q_Q(GetTrafficJob);
+    Q_EMIT q->description(q, _title);
+}
+
+void GetTrafficJobPrivate::successCallback(const QByteArray &replyData)
+{
+    // followers of a shared request do not run checkOutput()
+    if (traffic.isNull() && !replyData.isEmpty()) {
+        traffic = TrafficData::fromJson(replyData);
+    }
+}
+
+GetTrafficJob::GetTrafficJob(QObject *parent)
+    : Job(* new GetTrafficJobPrivate(this), parent)
+{
+    qCDebug(qhrCore) << "Creating new" << this;
+}
+
+GetTrafficJob::~GetTrafficJob() = default;
+
+void GetTrafficJob::start()
+{
+    QTimer::singleShot(0, this, &GetTrafficJob::sendRequest);
+}
+
+TrafficData::Type GetTrafficJob::type() const
+{
+    Q_D(const GetTrafficJob);
+    return d->type;
+}
+
+void GetTrafficJob::setType(TrafficData::Type type)
+{
+    Q_D(GetTrafficJob);
+    d->type = type;
+}
+
+QDateTime GetTrafficJob::from() const
+{
+    Q_D(const GetTrafficJob);
+    return d->from;
+}
+
+void GetTrafficJob::setFrom(const QDateTime &from)
+{
+    Q_D(GetTrafficJob);
+    d->from = from;
+}
+
+QDateTime GetTrafficJob::to() const
+{
+    Q_D(const GetTrafficJob);
+    return d->to;
+}
+
+void GetTrafficJob::setTo(const QDateTime &to)
+{
+    Q_D(GetTrafficJob);
+    d->to = to;
+}
+
+QStringList GetTrafficJob::ips() const
+{
+    Q_D(const GetTrafficJob);
+    return d->ips;
+}
+
+void GetTrafficJob::setIps(const QStringList &ips)
+{
+    Q_D(GetTrafficJob);
+    d->ips = ips;
+}
+
+QStringList GetTrafficJob::subnets() const
+{
+    Q_D(const GetTrafficJob);
+    return d->subnets;
+}
+
+void GetTrafficJob::setSubnets(const QStringList &subnets)
+{
+    Q_D(GetTrafficJob);
+    d->subnets = subnets;
+}
+
+bool GetTrafficJob::singleValues() const
+{
+    Q_D(const GetTrafficJob);
+    return d->singleValues;
+}
+
+void GetTrafficJob::setSingleValues(bool singleValues)
+{
+    Q_D(GetTrafficJob);
+    d->singleValues = singleValues;
+}
+
+TrafficData GetTrafficJob::traffic() const
+{
+    Q_D(const GetTrafficJob);
+    return d->traffic;
+}
+
+#include "moc_gettrafficjob.cpp"
@@ -0,0 +1,143 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_GETTRAFFICJOB_H
+#define QHR_GETTRAFFICJOB_H
+
+#include <QObject>
+#include <QStringList>
+#include <QDateTime>
+#include "qhr_global.h"
+#include "job.h"
+#include "trafficdata.h"
+
+namespace QHR {
+
+class GetTrafficJobPrivate;
+
+/*!
+ * \brief Gets traffic statistics for IP addresses and subnets.
+ *
+ * After setting the mandatory properties, call start() to perform the request.
+ * The reply is scanned directly into a TrafficData object that stores the
+ * values column wise and can be queried via traffic(). Job::result() will
+ * not contain the JSON data.
+ *
+ * \par Mandatory properties
+ * \li Job::configuratoin
+ * \li setType()
+ * \li setFrom() and setTo()
+ * \li setIps() and/or setSubnets()
+ *
+ * \par API method
+ * POST
+ *
+ * \par API route
+ * /traffic
+ *
+ * \par API docs
+ * https://robot.your-server.de/doc/webservice/de.html#post-traffic
+ *
+ * \headerfile "" <QHR/GetTrafficJob>
+ */
+class QHR_LIBRARY GetTrafficJob : public Job
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief Creates a new %GetTrafficJob object with the given \a parent.
+     */
+    explicit GetTrafficJob(QObject *parent = nullptr);
+
+    /*!
+     * \brief Destroys the %GetTrafficJob object.
+     */
+    ~GetTrafficJob();
+
+    /*!
+     * \brief Starts the job asynchronously.
+     */
+    void start() override;
+
+    /*!
+     * \brief Returns the type of the requested statistics.
+     */
+    TrafficData::Type type() const;
+
+    /*!
+     * \brief Sets the \a type of the requested statistics.
+     */
+    void setType(TrafficData::Type type);
+
+    /*!
+     * \brief Returns the begin of the requested time range.
+     */
+    QDateTime from() const;
+
+    /*!
+     * \brief Sets the begin of the requested time range.
+     *
+     * Depending on the type, only the hour, day or month will be used.
+     */
+    void setFrom(const QDateTime &from);
+
+    /*!
+     * \brief Returns the end of the requested time range.
+     */
+    QDateTime to() const;
+
+    /*!
+     * \brief Sets the end of the requested time range.
+     *
+     * Depending on the type, only the hour, day or month will be used.
+     */
+    void setTo(const QDateTime &to);
+
+    /*!
+     * \brief Returns the IP addresses to get statistics for.
+     */
+    QStringList ips() const;
+
+    /*!
+     * \brief Sets the IP addresses to get statistics for.
+     */
+    void setIps(const QStringList &ips);
+
+    /*!
+     * \brief Returns the subnets to get statistics for.
+     */
+    QStringList subnets() const;
+
+    /*!
+     * \brief Sets the subnets to get statistics for.
+     */
+    void setSubnets(const QStringList &subnets);
+
+    /*!
+     * \brief Returns \c true if single values are requested.
+     */
+    bool singleValues() const;
+
+    /*!
+     * \brief Set \a singleValues to \c true to get one value per hour, day or month.
+     *
+     * The default value is \c false, what returns one summed up value per IP for the
+     * whole time range.
+     */
+    void setSingleValues(bool singleValues);
+
+    /*!
+     * \brief Returns the traffic statistics after a successful request.
+     */
+    TrafficData traffic() const;
+
+private:
+    Q_DECLARE_PRIVATE_D(bd_ptr, GetTrafficJob)
+    Q_DISABLE_COPY(GetTrafficJob)
+};
+
+}
+
+#endif // QHR_GETTRAFFICJOB_H
@@ -0,0 +1,49 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_GETTRAFFICJOB_P_H
+#define QHR_GETTRAFFICJOB_P_H
+
+#include "gettrafficjob.h"
+#include "job_p.h"
+
+namespace QHR {
+
+class GetTrafficJobPrivate : public JobPrivate
+{
+public:
+    explicit GetTrafficJobPrivate(GetTrafficJob *q);
+    ~GetTrafficJobPrivate() override;
+
+    QString buildUrlPath() const override;
+
+    std::pair<QByteArray, QByteArray> buildPayload() const override;
+
+    bool checkInput() override;
+
+    bool checkOutput(const QByteArray &data) override;
+
+    void emitDescription() override;
+
+    void successCallback(const QByteArray &replyData) override;
+
+    QString formatDateTime(const QDateTime &dt) const;
+
+    TrafficData traffic;
+    QStringList ips;
+    QStringList subnets;
+    QDateTime from;
+    QDateTime to;
+    TrafficData::Type type = TrafficData::Invalid;
+    bool singleValues = false;
+
+private:
+    Q_DISABLE_COPY(GetTrafficJobPrivate)
+    Q_DECLARE_PUBLIC(GetTrafficJob)
+};
+
+}
+
+#endif // QHR_GETTRAFFICJOB_P_H
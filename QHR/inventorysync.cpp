@@ -0,0 +1,242 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "inventorysync_p.h"
+#include "jsonhash_p.h"
+#include "endpoints.h"
+#include "job.h"
+#include "logging.h"
+#include <QPair>
+#include <algorithm>
+
+using namespace QHR;
+
+InventorySyncPrivate::InventorySyncPrivate(InventorySync *q)
+    : q_ptr(q)
+{
+
+}
+
+InventorySyncPrivate::~InventorySyncPrivate() = default;
+
+QVector<InventorySyncPrivate::Incoming> InventorySyncPrivate::prepare(const QJsonArray &servers)
+{
+    QVector<Incoming> incoming;
+    incoming.reserve(servers.size());
+
+    for (const QJsonValue &v : servers) {
+        const QJsonObject json = v.toObject();
+        const QJsonValue wrapped = json.value(QStringLiteral("server"));
+        Incoming in;
+        in.object = wrapped.isObject() ? wrapped.toObject() : json;
+        in.serverNumber = in.object.value(QStringLiteral("server_number")).toInt();
+        if (Q_UNLIKELY(in.serverNumber <= 0)) {
+            qCWarning(qhrCore) << "Skipping server without server number in inventory sync.";
+            continue;
+        }
+        in.hash = jsonRecordHash(in.object);
+        incoming.push_back(in);
+    }
+
+    const auto byNumber = [](const Incoming &a, const Incoming &b) {
+        return a.serverNumber < b.serverNumber;
+    };
+
+    // the API already returns the servers ordered, so this is usually a single pass
+    if (!std::is_sorted(incoming.cbegin(), incoming.cend(), byNumber)) {
+        std::stable_sort(incoming.begin(), incoming.end(), byNumber);
+    }
+
+    return incoming;
+}
+
+QVector<InventorySyncPrivate::Entry>::const_iterator InventorySyncPrivate::find(int serverNumber) const
+{
+    auto it = std::lower_bound(entries.cbegin(), entries.cend(), serverNumber, [](const Entry &e, int number) {
+        return e.serverNumber < number;
+    });
+    if (it != entries.cend() && it->serverNumber != serverNumber) {
+        return entries.cend();
+    }
+    return it;
+}
+
+InventorySync::InventorySync(QObject *parent)
+    : QObject(parent), isd_ptr(new InventorySyncPrivate(this))
+{
+    Q_D(InventorySync);
+    connect(&d->timer, &QTimer::timeout, this, &InventorySync::sync);
+}
+
+InventorySync::~InventorySync() = default;
+
+void InventorySync::setConfiguration(AbstractConfiguration *configuration)
+{
+    Q_D(InventorySync);
+    d->configuration = configuration;
+}
+
+void InventorySync::update(const QJsonArray &servers)
+{
+    Q_D(InventorySync);
+
+    const QVector<InventorySyncPrivate::Incoming> incoming = InventorySyncPrivate::prepare(servers);
+
+    QVector<InventorySyncPrivate::Entry> next;
+    next.reserve(incoming.size());
+
+    QVector<Server> added;
+    QVector<Server> removed;
+    QVector<QPair<Server,Server>> changed;
+
+    auto oldIt = d->entries.cbegin();
+    const auto oldEnd = d->entries.cend();
+    int lastNumber = 0;
+
+    for (const InventorySyncPrivate::Incoming &in : incoming) {
+        if (Q_UNLIKELY(in.serverNumber == lastNumber)) {
+            qCWarning(qhrCore) << "Skipping duplicate server" << in.serverNumber << "in inventory sync.";
+            continue;
+        }
+        lastNumber = in.serverNumber;
+
+        while (oldIt != oldEnd && oldIt->serverNumber < in.serverNumber) {
+            removed.push_back(oldIt->server);
+            ++oldIt;
+        }
+
+        InventorySyncPrivate::Entry entry;
+        entry.serverNumber = in.serverNumber;
+        entry.hash = in.hash;
+
+        if (oldIt != oldEnd && oldIt->serverNumber == in.serverNumber) {
+            if (oldIt->hash == in.hash) {
+                entry.server = oldIt->server;
+            } else {
+                entry.server = Server::fromJson(in.object);
+                changed.push_back(qMakePair(entry.server, oldIt->server));
+            }
+            ++oldIt;
+        } else {
+            entry.server = Server::fromJson(in.object);
+            added.push_back(entry.server);
+        }
+
+        next.push_back(entry);
+    }
+
+    while (oldIt != oldEnd) {
+        removed.push_back(oldIt->server);
+        ++oldIt;
+    }
+
+    const int oldCount = d->entries.size();
+    d->entries = next;
+    ++d->generation;
+
+    qCDebug(qhrCore) << "Inventory sync:" << added.size() << "added," << removed.size() << "removed," << changed.size() << "changed," << d->entries.size() << "total";
+
+    // signals are emitted after the new snapshot has been applied
+    for (const Server &s : removed) {
+        Q_EMIT serverRemoved(s);
+    }
+    for (const Server &s : added) {
+        Q_EMIT serverAdded(s);
+    }
+    for (const QPair<Server,Server> &p : changed) {
+        Q_EMIT serverChanged(p.first, p.second);
+    }
+
+    if (oldCount != d->entries.size()) {
+        Q_EMIT serverCountChanged(d->entries.size());
+    }
+
+    Q_EMIT synced(added.size(), removed.size(), changed.size());
+}
+
+ServerList InventorySync::servers() const
+{
+    Q_D(const InventorySync);
+    ServerList list;
+    list.reserve(d->entries.size());
+    for (const InventorySyncPrivate::Entry &e : d->entries) {
+        list.push_back(e.server);
+    }
+    return list;
+}
+
+Server InventorySync::server(int serverNumber) const
+{
+    Q_D(const InventorySync);
+    const auto it = d->find(serverNumber);
+    return it != d->entries.cend() ? it->server : Server();
+}
+
+int InventorySync::serverCount() const
+{
+    Q_D(const InventorySync);
+    return d->entries.size();
+}
+
+quint64 InventorySync::generation() const
+{
+    Q_D(const InventorySync);
+    return d->generation;
+}
+
+bool InventorySync::isSyncing() const
+{
+    Q_D(const InventorySync);
+    return !d->job.isNull();
+}
+
+int InventorySync::interval() const
+{
+    Q_D(const InventorySync);
+    return d->timer.isActive() ? d->timer.interval() : 0;
+}
+
+void InventorySync::setInterval(int interval)
+{
+    Q_D(InventorySync);
+    if (this->interval() != interval) {
+        qCDebug(qhrCore) << "Changing inventory sync interval to" << interval;
+        if (interval > 0) {
+            d->timer.start(interval);
+        } else {
+            d->timer.stop();
+        }
+        Q_EMIT intervalChanged(interval);
+    }
+}
+
+void InventorySync::sync()
+{
+    Q_D(InventorySync);
+
+    if (d->job) {
+        qCDebug(qhrCore) << "Inventory sync already running.";
+        return;
+    }
+
+    Job *job = QHR::makeJob<Endpoints::ServerList>(this);
+    if (d->configuration) {
+        job->setConfiguration(d->configuration);
+    }
+    d->job = job;
+
+    connect(job, &BJob::result, this, [this, job](){
+        if (job->error() != BJob::NoError) {
+            qCWarning(qhrCore) << "Inventory sync failed:" << job->errorString();
+            Q_EMIT syncFailed(job->error(), job->errorString());
+        } else {
+            update(job->result().array());
+        }
+    });
+
+    job->start();
+}
+
+#include "moc_inventorysync.cpp"
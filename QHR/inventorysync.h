@@ -0,0 +1,180 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_INVENTORYSYNC_H
+#define QHR_INVENTORYSYNC_H
+
+#include <QObject>
+#include <QJsonArray>
+#include "qhr_global.h"
+#include "server.h"
+#include <memory>
+
+namespace QHR {
+
+class InventorySyncPrivate;
+class AbstractConfiguration;
+
+/*!
+ * \brief Keeps a snapshot of all servers and reports only the changes between syncs.
+ *
+ * Every call of sync() fetches \c /server and compares the result with the previous snapshot,
+ * that is kept sorted by server number. The comparison is a linear merge over both sorted lists.
+ * Every record is identified by a hash over its JSON data, so only added and changed servers are
+ * converted into Server objects, unchanged ones are kept from the previous snapshot. After the
+ * new snapshot has been applied, serverAdded(), serverRemoved() and serverChanged() are emitted
+ * for every single change, followed by synced().
+ *
+ * If \link InventorySync::interval interval\endlink is greater than \c 0, sync() will be called
+ * periodically. Data fetched by other means can be applied via update().
+ *
+ * \headerfile "" <QHR/InventorySync>
+ */
+class QHR_LIBRARY InventorySync : public QObject
+{
+    Q_OBJECT
+    /*!
+     * \brief Interval in milliseconds for automatic syncs.
+     *
+     * The default value is \c 0, what disables automatic syncs.
+     *
+     * \par Access functions
+     * \li int interval() const
+     * \li void setInterval(int interval)
+     *
+     * \par Notifier signal
+     * \li void intervalChanged(int interval)
+     */
+    Q_PROPERTY(int interval READ interval WRITE setInterval NOTIFY intervalChanged)
+    /*!
+     * \brief Number of servers in the current snapshot.
+     *
+     * \par Access functions
+     * \li int serverCount() const
+     *
+     * \par Notifier signal
+     * \li void serverCountChanged(int serverCount)
+     */
+    Q_PROPERTY(int serverCount READ serverCount NOTIFY serverCountChanged)
+public:
+    /*!
+     * \brief Constructs a new %InventorySync object with the given \a parent.
+     */
+    explicit InventorySync(QObject *parent = nullptr);
+
+    /*!
+     * \brief Destroys the %InventorySync object.
+     */
+    ~InventorySync() override;
+
+    /*!
+     * \brief Sets the \a configuration used for the requests.
+     *
+     * If not set, QHR::defaultConfiguration() will be used.
+     */
+    void setConfiguration(AbstractConfiguration *configuration);
+
+    /*!
+     * \brief Applies the \a servers returned by \c /server as new snapshot.
+     *
+     * Emits the change signals and synced().
+     */
+    void update(const QJsonArray &servers);
+
+    /*!
+     * \brief Returns all servers of the current snapshot sorted by server number.
+     */
+    ServerList servers() const;
+
+    /*!
+     * \brief Returns the server with \a serverNumber or a null Server if not found.
+     */
+    Server server(int serverNumber) const;
+
+    /*!
+     * \brief Getter function for the \link InventorySync::serverCount serverCount\endlink property.
+     * \sa serverCountChanged()
+     */
+    int serverCount() const;
+
+    /*!
+     * \brief Returns the number of snapshots that have been applied.
+     */
+    quint64 generation() const;
+
+    /*!
+     * \brief Returns \c true while a sync request is running.
+     */
+    bool isSyncing() const;
+
+    /*!
+     * \brief Getter function for the \link InventorySync::interval interval\endlink property.
+     * \sa setInterval(), intervalChanged()
+     */
+    int interval() const;
+
+    /*!
+     * \brief Setter function for the \link InventorySync::interval interval\endlink property.
+     * \sa interval(), intervalChanged()
+     */
+    void setInterval(int interval);
+
+public Q_SLOTS:
+    /*!
+     * \brief Fetches \c /server and applies the result via update().
+     *
+     * Does nothing if a sync is already running.
+     */
+    void sync();
+
+Q_SIGNALS:
+    /*!
+     * \brief Emitted for every \a server that is not part of the previous snapshot.
+     */
+    void serverAdded(const QHR::Server &server);
+
+    /*!
+     * \brief Emitted for every \a server of the previous snapshot that has been removed.
+     */
+    void serverRemoved(const QHR::Server &server);
+
+    /*!
+     * \brief Emitted for every \a server whose data differs from the \a previous snapshot.
+     */
+    void serverChanged(const QHR::Server &server, const QHR::Server &previous);
+
+    /*!
+     * \brief Emitted after a snapshot has been applied and all change signals have been emitted.
+     */
+    void synced(int added, int removed, int changed);
+
+    /*!
+     * \brief Emitted if fetching \c /server failed.
+     */
+    void syncFailed(int error, const QString &errorString);
+
+    /*!
+     * \brief Notifier signal for the \link InventorySync::interval interval\endlink property.
+     * \sa setInterval(), interval()
+     */
+    void intervalChanged(int interval);
+
+    /*!
+     * \brief Notifier signal for the \link InventorySync::serverCount serverCount\endlink property.
+     * \sa serverCount()
+     */
+    void serverCountChanged(int serverCount);
+
+protected:
+    const std::unique_ptr<InventorySyncPrivate> isd_ptr;
+
+private:
+    Q_DECLARE_PRIVATE_D(isd_ptr, InventorySync)
+    Q_DISABLE_COPY(InventorySync)
+};
+
+}
+
+#endif // QHR_INVENTORYSYNC_H
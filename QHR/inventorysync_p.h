@@ -0,0 +1,57 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_INVENTORYSYNC_P_H
+#define QHR_INVENTORYSYNC_P_H
+
+#include "inventorysync.h"
+#include <QVector>
+#include <QJsonObject>
+#include <QTimer>
+#include <QPointer>
+
+namespace QHR {
+
+class Job;
+
+class InventorySyncPrivate
+{
+public:
+    explicit InventorySyncPrivate(InventorySync *q);
+    ~InventorySyncPrivate();
+
+    struct Entry {
+        Server server;
+        quint64 hash = 0;
+        int serverNumber = 0;
+    };
+
+    struct Incoming {
+        QJsonObject object;
+        quint64 hash = 0;
+        int serverNumber = 0;
+    };
+
+    static QVector<Incoming> prepare(const QJsonArray &servers);
+
+    QVector<Entry>::const_iterator find(int serverNumber) const;
+
+    QVector<Entry> entries;
+    QTimer timer;
+    QPointer<Job> job;
+    AbstractConfiguration *configuration = nullptr;
+    quint64 generation = 0;
+
+protected:
+    InventorySync *q_ptr = nullptr;
+
+private:
+    Q_DISABLE_COPY(InventorySyncPrivate)
+    Q_DECLARE_PUBLIC(InventorySync)
+};
+
+}
+
+#endif // QHR_INVENTORYSYNC_P_H
@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "ipaddress.h"
+#include <QSharedData>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonValue>
+
+namespace QHR {
+
+class IpAddressData : public QSharedData
+{
+public:
+    QString ip;
+    QString serverIp;
+    QString separateMac;
+    int serverNumber = 0;
+    int trafficHourly = 0;
+    int trafficDaily = 0;
+    int trafficMonthly = 0;
+    bool locked = false;
+    bool trafficWarnings = false;
+};
+
+}
+
+using namespace QHR;
+
+IpAddress::IpAddress() = default;
+
+IpAddress::IpAddress(const IpAddress &other) = default;
+
+IpAddress::IpAddress(IpAddress &&other) noexcept = default;
+
+IpAddress &IpAddress::operator=(const IpAddress &other) = default;
+
+IpAddress &IpAddress::operator=(IpAddress &&other) noexcept = default;
+
+IpAddress::~IpAddress() = default;
+
+void IpAddress::swap(IpAddress &other) noexcept
+{
+    d.swap(other.d);
+}
+
+bool IpAddress::isNull() const
+{
+    return !d;
+}
+
+QString IpAddress::ip() const
+{
+    return d ? d->ip : QString();
+}
+
+QString IpAddress::serverIp() const
+{
+    return d ? d->serverIp : QString();
+}
+
+int IpAddress::serverNumber() const
+{
+    return d ? d->serverNumber : 0;
+}
+
+QString IpAddress::separateMac() const
+{
+    return d ? d->separateMac : QString();
+}
+
+bool IpAddress::isLocked() const
+{
+    return d ? d->locked : false;
+}
+
+bool IpAddress::trafficWarnings() const
+{
+    return d ? d->trafficWarnings : false;
+}
+
+int IpAddress::trafficHourly() const
+{
+    return d ? d->trafficHourly : 0;
+}
+
+int IpAddress::trafficDaily() const
+{
+    return d ? d->trafficDaily : 0;
+}
+
+int IpAddress::trafficMonthly() const
+{
+    return d ? d->trafficMonthly : 0;
+}
+
+IpAddress IpAddress::fromJson(const QJsonObject &json)
+{
+    const QJsonValue wrapped = json.value(QStringLiteral("ip"));
+    const QJsonObject o = wrapped.isObject() ? wrapped.toObject() : json;
+
+    IpAddress address;
+    if (o.isEmpty()) {
+        return address;
+    }
+
+    address.d = new IpAddressData;
+    address.d->ip = o.value(QStringLiteral("ip")).toString();
+    address.d->serverIp = o.value(QStringLiteral("server_ip")).toString();
+    address.d->serverNumber = o.value(QStringLiteral("server_number")).toInt();
+    address.d->separateMac = o.value(QStringLiteral("separate_mac")).toString();
+    address.d->locked = o.value(QStringLiteral("locked")).toBool();
+    address.d->trafficWarnings = o.value(QStringLiteral("traffic_warnings")).toBool();
+    address.d->trafficHourly = o.value(QStringLiteral("traffic_hourly")).toInt();
+    address.d->trafficDaily = o.value(QStringLiteral("traffic_daily")).toInt();
+    address.d->trafficMonthly = o.value(QStringLiteral("traffic_monthly")).toInt();
+
+    return address;
+}
+
+QVector<IpAddress> IpAddress::listFromJson(const QJsonArray &json)
+{
+    QVector<IpAddress> list;
+    list.reserve(json.size());
+    for (const QJsonValue &v : json) {
+        list.push_back(IpAddress::fromJson(v.toObject()));
+    }
+    return list;
+}
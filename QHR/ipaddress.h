@@ -0,0 +1,142 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_IPADDRESS_H
+#define QHR_IPADDRESS_H
+
+#include <QSharedDataPointer>
+#include <QString>
+#include <QVector>
+#include <QMetaType>
+#include "qhr_global.h"
+
+class QJsonObject;
+class QJsonArray;
+
+namespace QHR {
+
+class IpAddressData;
+
+/*!
+ * \brief Contains information about a single IP address.
+ *
+ * Objects of this class are returned by the API for the \c /ip routes.
+ *
+ * This class is implicitly shared. All values are read once from the JSON data
+ * and stored in plain members, so accessing them is cheap.
+ *
+ * \headerfile "" <QHR/IpAddress>
+ */
+class QHR_LIBRARY IpAddress
+{
+public:
+    /*!
+     * \brief Constructs a new null %IpAddress object.
+     */
+    IpAddress();
+
+    /*!
+     * \brief Constructs a copy of \a other.
+     */
+    IpAddress(const IpAddress &other);
+
+    /*!
+     * \brief Move-constructs an %IpAddress instance, making it point at the same object that \a other was pointing to.
+     */
+    IpAddress(IpAddress &&other) noexcept;
+
+    /*!
+     * \brief Assigns \a other to this address and returns a reference to this address.
+     */
+    IpAddress &operator=(const IpAddress &other);
+
+    /*!
+     * \brief Move-assigns \a other to this %IpAddress instance.
+     */
+    IpAddress &operator=(IpAddress &&other) noexcept;
+
+    /*!
+     * \brief Destroys the %IpAddress object.
+     */
+    ~IpAddress();
+
+    /*!
+     * \brief Swaps this address with \a other.
+     */
+    void swap(IpAddress &other) noexcept;
+
+    /*!
+     * \brief Returns \c true if this address does not contain any data.
+     */
+    bool isNull() const;
+
+    /*!
+     * \brief Returns the IP address.
+     */
+    QString ip() const;
+
+    /*!
+     * \brief Returns the main IP address of the server the address belongs to.
+     */
+    QString serverIp() const;
+
+    /*!
+     * \brief Returns the number of the server the address belongs to.
+     */
+    int serverNumber() const;
+
+    /*!
+     * \brief Returns the separate MAC address, if any.
+     */
+    QString separateMac() const;
+
+    /*!
+     * \brief Returns \c true if the address has been locked.
+     */
+    bool isLocked() const;
+
+    /*!
+     * \brief Returns \c true if traffic warnings are enabled.
+     */
+    bool trafficWarnings() const;
+
+    /*!
+     * \brief Returns the hourly traffic limit in MB.
+     */
+    int trafficHourly() const;
+
+    /*!
+     * \brief Returns the daily traffic limit in MB.
+     */
+    int trafficDaily() const;
+
+    /*!
+     * \brief Returns the monthly traffic limit in GB.
+     */
+    int trafficMonthly() const;
+
+    /*!
+     * \brief Creates a new %IpAddress object from \a json.
+     *
+     * \a json can either be the address object itself or an object containing
+     * the address object in the \c ip key, as returned by the API.
+     */
+    static IpAddress fromJson(const QJsonObject &json);
+
+    /*!
+     * \brief Creates a list of %IpAddress objects from the \a json array.
+     */
+    static QVector<IpAddress> listFromJson(const QJsonArray &json);
+
+private:
+    QSharedDataPointer<IpAddressData> d;
+};
+
+}
+
+Q_DECLARE_SHARED(QHR::IpAddress)
+Q_DECLARE_METATYPE(QHR::IpAddress)
+
+#endif // QHR_IPADDRESS_H
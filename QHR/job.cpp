@@ -5,11 +5,23 @@
 
 #include "job_p.h"
 #include "abstractnamfactory.h"
+#include "abstractcredentialprovider.h"
+#include "responsecache_p.h"
+#include "ratelimiter_p.h"
+#include "jsonstreamparser_p.h"
 #include <QReadWriteLock>
 #include <QGlobalStatic>
 #include <QNetworkAccessManager>
+#include <QThreadStorage>
+#include <QThread>
+#include <QCoreApplication>
+#include <QPointer>
+#include <QHash>
 #include <QJsonParseError>
+#include <QJsonObject>
+#include <QJsonArray>
 #include <QSslError>
+#include <atomic>
 
 #if defined(QT_DEBUG)
 Q_LOGGING_CATEGORY(qhrCore, "qhr.core")
@@ -22,74 +34,81 @@ using namespace QHR;
 class DefaultValues
 {
 public:
+    // The pointers are read by every job, so they are kept in atomics
+    // that can be read without taking a lock.
+    std::atomic<AbstractConfiguration*> configuration{nullptr};
+    std::atomic<AbstractNamFactory*> namFactory{nullptr};
+    std::atomic<ResponseCache*> responseCache{nullptr};
+
+    // The retry policy can not be stored in an atomic. Readers keep a thread
+    // local copy and only take the lock if the version has been changed.
     mutable QReadWriteLock lock;
-
-    AbstractConfiguration *configuration() const
-    {
-        return m_configuration;
-    }
-
-    void setConfiguration(AbstractConfiguration *config)
-    {
-        m_configuration = config;
-    }
-
-    AbstractNamFactory *namFactory() const
-    {
-        return m_namFactory;
-    }
-
-    void setNamFactory(AbstractNamFactory *factory)
-    {
-        m_namFactory = factory;
-    }
-
-private:
-    AbstractConfiguration *m_configuration = nullptr;
-    AbstractNamFactory *m_namFactory = nullptr;
+    std::atomic<quint64> retryPolicyVersion{1};
+    RetryPolicy retryPolicy;
 };
 Q_GLOBAL_STATIC(DefaultValues, defVals)
 
 AbstractConfiguration *QHR::defaultConfiguration()
 {
-    const DefaultValues *defs = defVals();
-    Q_ASSERT(defs);
-
-    defs->lock.lockForRead();
-    AbstractConfiguration *config = defs->configuration();
-    defs->lock.unlock();
-
-    return config;
+    return defVals()->configuration.load(std::memory_order_acquire);
 }
 
 void QHR::setDefaultConfiguration(AbstractConfiguration *configuration)
 {
-    DefaultValues *defs = defVals();
-    Q_ASSERT(defs);
-    QWriteLocker locker(&defs->lock);
     qCDebug(qhrCore) << "Setting defaultConfiguration to" << configuration;
-    defs->setConfiguration(configuration);
+    defVals()->configuration.store(configuration, std::memory_order_release);
 }
 
 AbstractNamFactory *QHR::networkAccessManagerFactory()
 {
+    return defVals()->namFactory.load(std::memory_order_acquire);
+}
+
+void QHR::setNetworkAccessManagerFactory(AbstractNamFactory *factory)
+{
+    qCDebug(qhrCore) << "Setting networkAccessManagerFactory to" << factory;
+    defVals()->namFactory.store(factory, std::memory_order_release);
+}
+
+ResponseCache *QHR::responseCache()
+{
+    return defVals()->responseCache.load(std::memory_order_acquire);
+}
+
+void QHR::setResponseCache(ResponseCache *cache)
+{
+    qCDebug(qhrCore) << "Setting responseCache to" << cache;
+    defVals()->responseCache.store(cache, std::memory_order_release);
+}
+
+RetryPolicy QHR::defaultRetryPolicy()
+{
+    struct CachedPolicy {
+        quint64 version = 0;
+        RetryPolicy policy;
+    };
+    static thread_local CachedPolicy cached;
+
     const DefaultValues *defs = defVals();
     Q_ASSERT(defs);
 
-    defs->lock.lockForRead();
-    AbstractNamFactory *factory = defs->namFactory();
-    defs->lock.unlock();
+    if (cached.version != defs->retryPolicyVersion.load(std::memory_order_acquire)) {
+        QReadLocker locker(&defs->lock);
+        cached.policy = defs->retryPolicy;
+        cached.version = defs->retryPolicyVersion.load(std::memory_order_relaxed);
+    }
 
-    return factory;
+    return cached.policy;
 }
 
-void QHR::setNetworkAccessManagerFactory(AbstractNamFactory *factory)
+void QHR::setDefaultRetryPolicy(const RetryPolicy &policy)
 {
     DefaultValues *defs = defVals();
     Q_ASSERT(defs);
     QWriteLocker locker(&defs->lock);
-    qCDebug(qhrCore) << "Setting networkAccessManagerFactory to" << factory;
-    defs->setNamFactory(factory);
+    qCDebug(qhrCore) << "Setting defaultRetryPolicy to" << policy.maxAttempts() << "attempts";
+    defs->retryPolicy = policy;
+    defs->retryPolicyVersion.fetch_add(1, std::memory_order_release);
 }
 
 JobPrivate::JobPrivate(Job *parent)
@@ -100,9 +119,53 @@ JobPrivate::JobPrivate(Job *parent)
 
 JobPrivate::~JobPrivate() = default;
 
+namespace {
+
+// Owns the pooled manager of a thread. QThreadStorage destroys its data when the thread
+// exits, also for adopted threads that never return to an event loop, where a deleteLater()
+// queued on QThread::finished would never be processed.
+struct PooledNetworkAccessManager
+{
+    PooledNetworkAccessManager() = default;
+    ~PooledNetworkAccessManager() { delete nam.data(); }
+
+    // the manager of the main thread is owned by the application, that is destroyed first
+    QPointer<QNetworkAccessManager> nam;
+
+    Q_DISABLE_COPY(PooledNetworkAccessManager)
+};
+
+}
+
+QNetworkAccessManager *JobPrivate::pooledNetworkAccessManager()
+{
+    // One manager per thread, shared by all jobs created in that thread. Reusing
+    // the manager keeps HTTP connections alive between requests and lets the
+    // manager reuse TLS sessions instead of doing a full handshake per job.
+    static QThreadStorage<PooledNetworkAccessManager*> pool;
+
+    if (!pool.hasLocalData()) {
+        pool.setLocalData(new PooledNetworkAccessManager);
+    }
+
+    QPointer<QNetworkAccessManager> &nam = pool.localData()->nam;
+    if (!nam) {
+        nam = new QNetworkAccessManager;
+        QThread *thread = QThread::currentThread();
+        QCoreApplication *app = QCoreApplication::instance();
+        if (app && app->thread() == thread) {
+            nam->setParent(app);
+        }
+        qCDebug(qhrCore) << "Created pooled" << nam.data() << "for thread" << thread;
+    }
+
+    return nam.data();
+}
+
 void JobPrivate::handleSslErrors(QNetworkReply *reply, const QList<QSslError> &errors)
 {
     Q_Q(Job);
+    sslErrorOccurred = true;
     q->setError(NetworkError);
     if (!errors.empty()) {
         q->setErrorText(errors.first().errorString());
@@ -115,68 +178,899 @@ void JobPrivate::handleSslErrors(QNetworkReply *reply, const QList<QSslError> &e
     reply->abort();
 }
 
-#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
-void JobPrivate::requestTimedOut()
+#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
+void JobPrivate::requestTimedOut()
+{
+    Q_Q(Job);
+    QNetworkReply *nr = reply;
+    reply = nullptr;
+    delete nr;
+
+    q->setError(RequestTimedOut);
+    q->setErrorText(QString::number(requestTimeout));
+
+    if (scheduleRetry(QNetworkReply::TimeoutError, 0)) {
+        return;
+    }
+
+    unregisterFlight();
+    Q_EMIT q->failed(q->error(), q->errorString());
+    notifyFollowers(false, QByteArray());
+    q->emitResult();
+    metrics.finish(q, endpoint(), q->error());
+}
+#endif
+
+void JobPrivate::requestFinished()
+{
+    Q_Q(Job);
+
+    //: Job info message to display state information
+    //% "Checking reply"
+    Q_EMIT q->infoMessage(q, qtTrId("libqhr-info-msg-req-checking"));
+    qCDebug(qhrCore) << "Request finished, checking reply.";
+    metrics.mark(JobMetrics::Finished);
+    qCDebug(qhrCore) << "HTTP status code:" << reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 8, 0))
+    if (protocolOptions & Http2) {
+        qCDebug(qhrCore) << "HTTP/2 used:" << reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+    }
+#endif
+
+    if (streamParser && !readStream()) {
+        // a slot connected to itemReceived() deleted or killed the job
+        return;
+    }
+
+    QByteArray replyData = reply->readAll();
+    metrics.bytesReceived += replyData.size();
+
+    qCDebug(qhrCore) << "Reply data:" << replyData;
+
+#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
+    if (Q_LIKELY(timeoutTimer && timeoutTimer->isActive())) {
+        qCDebug(qhrCore) << "Stopping request timeout timer with" << timeoutTimer->remainingTime()/1000 << "seconds left.";
+        timeoutTimer->stop();
+    }
+#endif
+
+    const QNetworkReply::NetworkError networkError = reply->error();
+    const int httpStatusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool success = false;
+
+    if (Q_LIKELY(networkError == QNetworkReply::NoError)) {
+        metrics.beginParse();
+        success = streamParser ? checkStream() : checkOutput(replyData);
+        metrics.endParse();
+    } else if (notFoundIsEmpty && httpStatusCode == 404) {
+        // list endpoints of the API answer with 404 if there are no items
+        qCDebug(qhrCore) << "Resource not found, using empty result.";
+        jsonResult = expectedContentType == ExpectedContentType::JsonObject ? QJsonDocument(QJsonObject()) : QJsonDocument(QJsonArray());
+        // the error body must neither be cached nor be handed to successCallback()
+        replyData = jsonResult.toJson(QJsonDocument::Compact);
+        success = true;
+    } else {
+        parseApiError(replyData);
+        extractError();
+    }
+
+    reply->deleteLater();
+    reply = nullptr;
+
+    if (!success && protocolFallback(networkError)) {
+        return;
+    }
+
+    if (!success && scheduleRetry(networkError, httpStatusCode)) {
+        return;
+    }
+
+    unregisterFlight();
+    updateResponseCache(success, replyData);
+
+    metrics.beginDispatch();
+
+    if (success) {
+        successCallback(replyData);
+        Q_EMIT q->succeeded(jsonResult);
+    } else {
+        Q_EMIT q->failed(q->error(), q->errorString());
+    }
+
+    notifyFollowers(success, replyData);
+
+    q->emitResult();
+
+    metrics.finish(q, endpoint(), q->error());
+}
+
+bool JobPrivate::isIdempotent() const
+{
+    switch (namOperation) {
+    case NetworkOperation::Head:
+    case NetworkOperation::Get:
+    case NetworkOperation::Put:
+    case NetworkOperation::Delete:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool JobPrivate::scheduleRetry(QNetworkReply::NetworkError networkError, int httpStatusCode)
+{
+    Q_Q(Job);
+
+    if (retryCount + 1 >= retryPolicy.maxAttempts() || sslErrorOccurred) {
+        return false;
+    }
+
+    // items that have already been emitted can not be taken back
+    if (streamParser && streamParser->itemCount() > 0) {
+        return false;
+    }
+
+    if (!isIdempotent() && !retryPolicy.retryNonIdempotent()) {
+        return false;
+    }
+
+    RetryPolicy::ErrorClass errorClass = RetryPolicy::NoErrors;
+    if (q->error() == RateLimitExceeded) {
+        errorClass = RetryPolicy::RateLimited;
+    } else if (httpStatusCode >= 500 || q->error() == ServerMaintenance || q->error() == InternalServerError) {
+        errorClass = RetryPolicy::ServerErrors;
+    } else if (networkError == QNetworkReply::TimeoutError || networkError == QNetworkReply::OperationCanceledError) {
+        // transfer timeouts set via QNetworkRequest are reported as canceled operations
+        errorClass = RetryPolicy::Timeouts;
+    } else if (networkError > QNetworkReply::NoError && networkError <= QNetworkReply::UnknownNetworkError) {
+        errorClass = RetryPolicy::NetworkErrors;
+    }
+
+    if (errorClass == RetryPolicy::NoErrors || !retryPolicy.retryOn().testFlag(errorClass)) {
+        return false;
+    }
+
+    ++retryCount;
+    JobMetrics::count(&MetricsRegistry::retries);
+    const int delay = retryPolicy.delay(retryCount);
+
+    qCInfo(qhrCore) << "Request failed with" << q->errorString() << "- retrying in" << delay << "ms, attempt" << retryCount + 1 << "of" << retryPolicy.maxAttempts();
+
+    //: Job info message to display state information
+    //% "Retrying request"
+    Q_EMIT q->infoMessage(q, qtTrId("libqhr-info-msg-req-retry"));
+
+    QTimer::singleShot(delay, q, [this](){
+        retryRequest();
+    });
+
+    return true;
+}
+
+QHash<QString, quint8> &JobPrivate::refusedProtocols()
+{
+    // Connections are kept per network access manager and the pooled
+    // manager is per thread, so track refused protocols per thread, too.
+    static QThreadStorage<QHash<QString, quint8>> refused;
+    return refused.localData();
+}
+
+quint8 JobPrivate::applyProtocolOptions(QNetworkRequest &request, AbstractConfiguration *config, NetworkOperation operation)
+{
+    quint8 options = NoProtocolOptions;
+    const quint8 refused = refusedProtocols().value(request.url().authority());
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 8, 0))
+    if (config->isHttp2Allowed() && !(refused & Http2)) {
+        request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+        options |= Http2;
+    }
+#endif
+    if (operation == NetworkOperation::Get && config->isPipeliningAllowed() && !(refused & Pipelining)) {
+        request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
+        options |= Pipelining;
+    }
+    return options;
+}
+
+bool JobPrivate::refuseProtocols(const QUrl &url, quint8 options, QNetworkReply::NetworkError networkError)
+{
+    if (options == NoProtocolOptions) {
+        return false;
+    }
+
+    // only errors caused by the protocol itself, transient network errors
+    // like closed connections must not disable HTTP/2 or pipelining for good
+    switch (networkError) {
+    case QNetworkReply::ProtocolUnknownError:
+    case QNetworkReply::ProtocolFailure:
+        break;
+    default:
+        return false;
+    }
+
+    qCWarning(qhrCore) << "Request to" << url.authority() << "failed with" << networkError << "- falling back to plain HTTP/1.1 for this host.";
+    refusedProtocols()[url.authority()] |= options;
+    return true;
+}
+
+bool JobPrivate::protocolFallback(QNetworkReply::NetworkError networkError)
+{
+    if (aborted || !refuseProtocols(requestUrl, protocolOptions, networkError)) {
+        return false;
+    }
+
+    // the server might have processed the request before closing the
+    // connection and items that have already been emitted can not be taken back
+    if (!isIdempotent() || (streamParser && streamParser->itemCount() > 0)) {
+        return false;
+    }
+
+    buildNetworkRequest();
+    retryRequest();
+    return true;
+}
+
+void JobPrivate::retryRequest()
+{
+    if (Q_UNLIKELY(aborted)) {
+        return;
+    }
+
+    Q_Q(Job);
+    q->setError(BJob::NoError);
+    q->setErrorText(QString());
+
+    if (!RateLimiter::instance()->acquire(this)) {
+        return;
+    }
+
+    dispatchRequest();
+}
+
+void JobPrivate::buildNetworkRequest()
+{
+    QNetworkRequest nr(requestUrl);
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    if (Q_LIKELY(requestTimeout > 0)) {
+        nr.setTransferTimeout(static_cast<int>(requestTimeout) * 1000);
+    }
+#endif
+
+    nr.setRawHeader(QByteArrayLiteral("User-Agent"), configuration->userAgent().toUtf8());
+
+    switch (expectedContentType) {
+    case ExpectedContentType::JsonObject:
+    case ExpectedContentType::JsonArray:
+        nr.setRawHeader(QByteArrayLiteral("Accept"), QByteArrayLiteral("application/json"));
+        break;
+    case ExpectedContentType::Invalid:
+        Q_ASSERT_X(false, "sending request", "invalid exepected content type");
+        break;
+    default:
+        break;
+    }
+
+    const QMap<QByteArray, QByteArray> reqHeaders = buildRequestHeaders();
+    if (!reqHeaders.empty()) {
+        QMap<QByteArray, QByteArray>::const_iterator i = reqHeaders.constBegin();
+        while (i != reqHeaders.constEnd()) {
+            nr.setRawHeader(i.key(), i.value());
+            ++i;
+        }
+    }
+
+    const auto payload = buildPayload();
+
+    if (!payload.second.isEmpty()) {
+        nr.setRawHeader(QByteArrayLiteral("Content-Type"), payload.second);
+    }
+
+    protocolOptions = applyProtocolOptions(nr, configuration, namOperation);
+
+    if (requiresAuth) {
+        nr.setRawHeader(QByteArrayLiteral("Authorization"), authorizationHeader());
+    }
+
+    if (qhrCore().isDebugEnabled()) {
+        qCDebug(qhrCore) << "Start performing" << operationName(namOperation) << "network operation.";
+        qCDebug(qhrCore) << "API URL:" << requestUrl;
+        const auto rhl = nr.rawHeaderList();
+        for (const QByteArray &h : rhl) {
+            if (h == QByteArrayLiteral("Authorization")) {
+                qCDebug(qhrCore) << h << ":" << "**************";
+            } else {
+                qCDebug(qhrCore) << h << ":" << nr.rawHeader(h);
+            }
+        }
+        if (!payload.first.isEmpty()) {
+            qCDebug(qhrCore) << "Payload:" << payload.first;
+        }
+    }
+
+    networkRequest = nr;
+    payloadData = payload.first;
+}
+
+void JobPrivate::dispatchRequest()
+{
+    Q_Q(Job);
+
+#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
+    if (Q_LIKELY(requestTimeout > 0)) {
+        if (!timeoutTimer) {
+            timeoutTimer = new QTimer(q);
+            timeoutTimer->setSingleShot(true);
+            timeoutTimer->setTimerType(Qt::VeryCoarseTimer);
+            QObject::connect(timeoutTimer, &QTimer::timeout, q, [this](){
+                requestTimedOut();
+            });
+        }
+        timeoutTimer->start(static_cast<int>(requestTimeout) * 1000);
+        qCDebug(qhrCore) << "Started request timeout timer with" << requestTimeout << "seconds.";
+    }
+#endif
+
+    apiErrorCode.clear();
+    apiErrorMessage.clear();
+
+    metrics.mark(JobMetrics::Dispatched);
+    metrics.bytesSent += payloadData.size();
+
+    //: Job info message to display state information
+    //% "Sending request"
+    Q_EMIT q->infoMessage(q, qtTrId("libqhr-info-msg-req-send"));
+    qCDebug(qhrCore) << "Sending network request.";
+
+    switch(namOperation) {
+    case NetworkOperation::Head:
+        reply = nam->head(networkRequest);
+        break;
+    case NetworkOperation::Post:
+        reply = nam->post(networkRequest, payloadData);
+        break;
+    case NetworkOperation::Put:
+        reply = nam->put(networkRequest, payloadData);
+        break;
+    case NetworkOperation::Delete:
+        reply = nam->deleteResource(networkRequest);
+        break;
+    case NetworkOperation::Get:
+        reply = nam->get(networkRequest);
+        break;
+    default:
+        Q_ASSERT_X(false, "sending request", "invalid network operation");
+        break;
+    }
+
+    if (metrics.isActive()) {
+        QObject::connect(reply, &QNetworkReply::encrypted, q, [this](){
+            metrics.mark(JobMetrics::Encrypted);
+        });
+        QObject::connect(reply, &QNetworkReply::metaDataChanged, q, [this](){
+            metrics.mark(JobMetrics::FirstByte);
+        });
+    }
+
+    if (streaming && expectedContentType == ExpectedContentType::JsonArray) {
+        const QPointer<Job> guard(q);
+        streamParser = std::make_shared<JsonStreamParser>([this, guard](const QByteArray &item){
+            handleStreamItem(item);
+            // stop parsing if a slot connected to itemReceived() deleted or killed the job
+            return !guard.isNull() && !aborted;
+        });
+        QObject::connect(reply, &QNetworkReply::readyRead, q, [this](){
+            readStream();
+        });
+    } else {
+        streamParser.reset();
+    }
+
+    connectReply();
+}
+
+bool JobPrivate::readStream()
+{
+    Q_ASSERT(reply);
+    Q_ASSERT(streamParser);
+
+    // error replies are read completely in requestFinished()
+    const int httpStatusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (httpStatusCode < 200 || httpStatusCode > 299) {
+        return true;
+    }
+
+    const QByteArray data = reply->readAll();
+    metrics.bytesReceived += data.size();
+    if (streamParser->state() == JsonStreamParser::Failed) {
+        return true;
+    }
+
+    // the job might be deleted while the items are emitted, so
+    // keep the parser alive until it has returned
+    const std::shared_ptr<JsonStreamParser> parser = streamParser;
+    const QPointer<Job> guard(q_ptr);
+    const bool valid = parser->feed(data);
+    if (!guard || aborted) {
+        return false;
+    }
+
+    if (!valid) {
+        qCCritical(qhrCore) << "Invalid JSON data in streamed reply:" << parser->errorString();
+    }
+
+    return true;
+}
+
+void JobPrivate::handleStreamItem(const QByteArray &item)
+{
+    Q_Q(Job);
+
+    if (Q_UNLIKELY(q->error() != BJob::NoError)) {
+        return;
+    }
+
+    QJsonParseError jsonError;
+    QJsonValue value;
+    if (item.startsWith('{') || item.startsWith('[')) {
+        const QJsonDocument doc = QJsonDocument::fromJson(item, &jsonError);
+        value = doc.isObject() ? QJsonValue(doc.object()) : QJsonValue(doc.array());
+    } else {
+        // QJsonDocument can only parse objects and arrays
+        const QJsonDocument doc = QJsonDocument::fromJson('[' + item + ']', &jsonError);
+        value = doc.array().at(0);
+    }
+
+    if (Q_UNLIKELY(jsonError.error != QJsonParseError::NoError)) {
+        q->setError(JsonParseError);
+        q->setErrorText(jsonError.errorString());
+        qCCritical(qhrCore) << "Invalid JSON data in streamed item at offset" << jsonError.offset << ":" << jsonError.errorString();
+        return;
+    }
+
+    Q_EMIT q->itemReceived(value);
+}
+
+bool JobPrivate::checkStream()
+{
+    Q_Q(Job);
+
+    if (q->error() != BJob::NoError) {
+        return false;
+    }
+
+    switch (streamParser->state()) {
+    case JsonStreamParser::Finished:
+        if (streamParser->itemCount() == 0) {
+            q->setError(EmptyJson);
+            qCCritical(qhrCore) << "Invalid reply: content expected, but reply is empty.";
+            return false;
+        }
+        return true;
+    case JsonStreamParser::Start:
+        q->setError(EmptyReply);
+        qCCritical(qhrCore) << "Invalid reply: content expected, but reply is empty.";
+        return false;
+    case JsonStreamParser::Failed:
+        q->setError(streamParser->itemCount() == 0 ? WrongOutputType : JsonParseError);
+        q->setErrorText(streamParser->errorString());
+        return false;
+    default:
+        q->setError(JsonParseError);
+        q->setErrorText(QStringLiteral("unterminated array"));
+        qCCritical(qhrCore) << "Invalid reply: JSON array is incomplete.";
+        return false;
+    }
+}
+
+bool JobPrivate::emitItems()
+{
+    Q_Q(Job);
+    const QPointer<Job> guard(q);
+    const QJsonArray items = jsonResult.array();
+    for (const QJsonValue &item : items) {
+        Q_EMIT q->itemReceived(item);
+        if (!guard || aborted) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void JobPrivate::connectReply()
+{
+    Q_Q(Job);
+
+    QObject::connect(reply, &QNetworkReply::sslErrors, q, [this](const QList<QSslError> &errors){
+        handleSslErrors(reply, errors);
+    });
+
+    QObject::connect(reply, &QNetworkReply::finished, q, [this](){
+        requestFinished();
+    });
+}
+
+QHash<QByteArray, JobPrivate*> &JobPrivate::inFlightRequests()
+{
+    // Coalescing is done per thread, because replies of the pooled network
+    // access manager can only be used in the thread it lives in.
+    static QThreadStorage<QHash<QByteArray, JobPrivate*>> flights;
+    return flights.localData();
+}
+
+bool JobPrivate::joinFlight()
+{
+    if (streaming || namOperation != NetworkOperation::Get || (expectedContentType != ExpectedContentType::JsonArray && expectedContentType != ExpectedContentType::JsonObject)) {
+        return false;
+    }
+
+    const QByteArray key = requestKey();
+    QHash<QByteArray, JobPrivate*> &flights = inFlightRequests();
+    JobPrivate *l = flights.value(key);
+    if (l && l != this) {
+        qCDebug(qhrCore) << "Joining in-flight request of" << l->q_ptr << "for" << requestUrl;
+        leader = l;
+        l->followers.append(this);
+        metrics.coalesced = true;
+        JobMetrics::count(&MetricsRegistry::coalesced);
+        return true;
+    }
+
+    flights.insert(key, this);
+    flightKey = key;
+    return false;
+}
+
+void JobPrivate::unregisterFlight()
+{
+    if (flightKey.isEmpty()) {
+        return;
+    }
+
+    QHash<QByteArray, JobPrivate*> &flights = inFlightRequests();
+    if (flights.value(flightKey) == this) {
+        flights.remove(flightKey);
+    }
+    flightKey.clear();
+}
+
+void JobPrivate::abortRequest()
+{
+    aborted = true;
+    RateLimiter::instance()->cancel(this);
+    leaveFlight();
+#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
+    if (timeoutTimer) {
+        timeoutTimer->stop();
+    }
+#endif
+    if (reply) {
+        // the reply belongs to a network access manager that might outlive
+        // this job, so abort it without calling back into this job
+        reply->disconnect(q_ptr);
+        reply->abort();
+        reply->deleteLater();
+        reply = nullptr;
+    }
+}
+
+void JobPrivate::leaveFlight()
+{
+    if (leader) {
+        leader->followers.removeAll(this);
+        leader = nullptr;
+        return;
+    }
+
+    if (followers.empty()) {
+        unregisterFlight();
+        return;
+    }
+
+    // The leading job is destroyed or killed before its request has been
+    // finished, so the first waiting job takes over the lead.
+    JobPrivate *heir = followers.takeFirst();
+    heir->leader = nullptr;
+    heir->followers = followers;
+    followers.clear();
+    for (JobPrivate *f : qAsConst(heir->followers)) {
+        f->leader = heir;
+    }
+
+    if (!flightKey.isEmpty()) {
+        inFlightRequests().insert(flightKey, heir);
+        heir->flightKey = flightKey;
+        flightKey.clear();
+    }
+
+    // A network access manager created by the factory is a child of this job
+    // and will be destroyed together with it and its replies.
+    if (reply && nam && nam->parent() != q_ptr) {
+        qCDebug(qhrCore) << "Handing over in-flight request for" << requestUrl << "to" << heir->q_ptr;
+        reply->disconnect(q_ptr);
+        heir->reply = reply;
+        heir->nam = nam;
+        reply = nullptr;
+        heir->connectReply();
+    } else {
+        // there is no reply while waiting for the rate limiter or for a retry
+        qCDebug(qhrCore) << "Resending request for" << requestUrl << "from" << heir->q_ptr;
+        heir->sendNetworkRequest();
+    }
+}
+
+void JobPrivate::notifyFollowers(bool success, const QByteArray &replyData)
+{
+    if (followers.empty()) {
+        return;
+    }
+
+    Q_Q(Job);
+    const int errorCode = q->error();
+    const QString errorText = q->errorText();
+    const QJsonDocument result = jsonResult;
+
+    // slots connected to a follower might delete other followers or this job
+    QVector<std::pair<JobPrivate*,QPointer<Job>>> _followers;
+    _followers.reserve(followers.size());
+    for (JobPrivate *f : qAsConst(followers)) {
+        f->leader = nullptr;
+        _followers.push_back(std::make_pair(f, QPointer<Job>(f->q_ptr)));
+    }
+    followers.clear();
+
+    for (const auto &follower : qAsConst(_followers)) {
+        if (!follower.second) {
+            continue;
+        }
+        JobPrivate *f = follower.first;
+        Job *fq = follower.second.data();
+        f->metrics.beginDispatch();
+        if (success) {
+            f->jsonResult = result;
+            f->successCallback(replyData);
+            Q_EMIT fq->succeeded(f->jsonResult);
+        } else {
+            fq->setError(errorCode);
+            fq->setErrorText(errorText);
+            Q_EMIT fq->failed(fq->error(), fq->errorString());
+        }
+        if (!follower.second) {
+            continue;
+        }
+        fq->emitResult();
+        if (follower.second) {
+            f->metrics.finish(fq, f->endpoint(), fq->error());
+        }
+    }
+}
+
+QString JobPrivate::operationName(NetworkOperation operation)
+{
+    switch(operation) {
+    case NetworkOperation::Head:
+        return QStringLiteral("HEAD");
+    case NetworkOperation::Post:
+        return QStringLiteral("POST");
+    case NetworkOperation::Put:
+        return QStringLiteral("PUT");
+    case NetworkOperation::Delete:
+        return QStringLiteral("DELETE");
+    case NetworkOperation::Get:
+        return QStringLiteral("GET");
+    default:
+        Q_ASSERT_X(false, "operation name", "invalid network operation");
+        return QString();
+    }
+}
+
+QString JobPrivate::account() const
+{
+    if (credentialProvider) {
+        return credentialProvider->username();
+    }
+    return configuration ? configuration->username() : QString();
+}
+
+QString JobPrivate::endpoint() const
+{
+    return RateLimiter::endpoint(namOperation, requestUrl.path());
+}
+
+QByteArray JobPrivate::requestKey() const
 {
-    Q_Q(Job);
-    QNetworkReply *nr = reply;
-    reply = nullptr;
-    delete nr;
+    return QByteArray::number(static_cast<int>(namOperation)) + ' ' + account().toUtf8() + ' ' + requestUrl.toEncoded();
+}
 
-    q->setError(RequestTimedOut);
-    q->setErrorText(QString::number(requestTimeout));
-    q->emitResult();
+ResponseCache *JobPrivate::cache() const
+{
+    return configuration ? configuration->responseCache() : QHR::responseCache();
 }
-#endif
 
-void JobPrivate::requestFinished()
+QByteArray JobPrivate::authorizationHeader() const
+{
+    if (!requiresAuth || !configuration) {
+        return QByteArray();
+    }
+
+    if (credentialProvider) {
+        return credentialProvider->authorizationHeader();
+    }
+
+    const QString auth = configuration->username() + QLatin1Char(':') + configuration->password();
+    return QByteArrayLiteral("Basic ") + auth.toUtf8().toBase64();
+}
+
+bool JobPrivate::finishFromCache()
 {
+    ResponseCache *_cache = cache();
+    if (!_cache || namOperation != NetworkOperation::Get) {
+        return false;
+    }
+
+    QByteArray data;
+    QJsonDocument json;
+    const auto found = ResponseCachePrivate::get(_cache)->lookup(requestKey(), account(), authorizationHeader(), &data, &json);
+    if (found == ResponseCachePrivate::Miss) {
+        JobMetrics::count(&MetricsRegistry::cacheMisses);
+        return false;
+    }
+
     Q_Q(Job);
+    qCDebug(qhrCore) << "Using" << (found == ResponseCachePrivate::Stale ? "stale" : "fresh") << "cached response for" << requestUrl;
+    JobMetrics::count(&MetricsRegistry::cacheHits);
+    metrics.fromCache = true;
+    metrics.beginDispatch();
+    jsonResult = json;
+    if (streaming && !emitItems()) {
+        // a slot connected to itemReceived() deleted or killed the job
+        return true;
+    }
+    successCallback(data);
+    Q_EMIT q->succeeded(jsonResult);
 
-    //: Job info message to display state information
-    //% "Checking reply"
-    Q_EMIT q->infoMessage(q, qtTrId("libqhr-info-msg-req-checking"));
-    qCDebug(qhrCore) << "Request finished, checking reply.";
-    qCDebug(qhrCore) << "HTTP status code:" << reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (found == ResponseCachePrivate::Stale) {
+        revalidate(_cache);
+    }
 
-    const QByteArray replyData = reply->readAll();
+    q->emitResult();
+    metrics.finish(q, endpoint(), BJob::NoError);
 
-    qCDebug(qhrCore) << "Reply data:" << replyData;
+    return true;
+}
 
-#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
-    if (Q_LIKELY(timeoutTimer && timeoutTimer->isActive())) {
-        qCDebug(qhrCore) << "Stopping request timeout timer with" << timeoutTimer->remainingTime()/1000 << "seconds left.";
-        timeoutTimer->stop();
+void JobPrivate::revalidate(ResponseCache *cache)
+{
+    ResponseCachePrivate *cp = ResponseCachePrivate::get(cache);
+    const QByteArray key = requestKey();
+    if (!cp->beginRevalidation(key)) {
+        return;
+    }
+
+    // do not exceed the request limit only to refresh the cache
+    const QString ep = endpoint();
+    const QString acc = account();
+    if (!RateLimiter::tryAcquire(acc.toUtf8() + ' ' + ep.toUtf8(), ep)) {
+        qCDebug(qhrCore) << "Request limit reached, not revalidating cached response for" << requestUrl;
+        cp->endRevalidation(key);
+        return;
+    }
+
+    // The job will be finished before the response arrives, so the
+    // revalidation must not depend on the job or its network access manager.
+    QNetworkAccessManager *_nam = nullptr;
+    bool ownNam = false;
+    if (auto namf = QHR::networkAccessManagerFactory()) {
+        _nam = namf->create(nullptr);
+        ownNam = true;
+    } else {
+        _nam = JobPrivate::pooledNetworkAccessManager();
     }
-#endif
 
-    if (Q_LIKELY(reply->error() == QNetworkReply::NoError)) {
-        if (checkOutput(replyData)) {
-            successCallback(replyData);
-            Q_EMIT q->succeeded(jsonResult);
+    buildNetworkRequest();
+    qCDebug(qhrCore) << "Revalidating cached response for" << requestUrl;
+
+    QNetworkReply *r = _nam->get(networkRequest);
+    const QByteArray secret = authorizationHeader();
+    const QString path = requestUrl.path();
+    const ExpectedContentType type = expectedContentType;
+    QObject::connect(r, &QNetworkReply::finished, _nam, [cp, r, _nam, ownNam, key, acc, secret, path, type](){
+        if (r->error() == QNetworkReply::NoError) {
+            const QByteArray data = r->readAll();
+            QJsonParseError jpe;
+            const QJsonDocument json = QJsonDocument::fromJson(data, &jpe);
+            if (jpe.error == QJsonParseError::NoError && ((type == ExpectedContentType::JsonArray && json.isArray()) || (type == ExpectedContentType::JsonObject && json.isObject()))) {
+                cp->insert(key, acc, secret, path, data, json);
+            }
         } else {
-            Q_EMIT q->failed(q->error(), q->errorString());
+            qCWarning(qhrCore) << "Failed to revalidate cached response for" << path << ":" << r->errorString();
         }
-    } else {
-        extractError();
-        Q_EMIT q->failed(q->error(), q->errorString());
+        cp->endRevalidation(key);
+        r->deleteLater();
+        if (ownNam) {
+            _nam->deleteLater();
+        }
+    });
+}
+
+void JobPrivate::updateResponseCache(bool success, const QByteArray &replyData)
+{
+    ResponseCache *_cache = cache();
+    if (!_cache) {
+        return;
     }
 
-    reply->deleteLater();
-    reply = nullptr;
+    switch (namOperation) {
+    case NetworkOperation::Get:
+        if (success && !streamParser) {
+            ResponseCachePrivate::get(_cache)->insert(requestKey(), account(), authorizationHeader(), requestUrl.path(), replyData, jsonResult);
+        }
+        break;
+    case NetworkOperation::Put:
+    case NetworkOperation::Post:
+    case NetworkOperation::Delete:
+        // the request might have changed the resource even if we got an error
+        ResponseCachePrivate::get(_cache)->invalidate(account(), authorizationHeader(), requestUrl.path());
+        break;
+    default:
+        break;
+    }
+}
 
-    q->emitResult();
+void JobPrivate::parseApiError(const QByteArray &replyData)
+{
+    // error replies of the API look like:
+    // {"error":{"status":403,"code":"RATE_LIMIT_EXCEEDED","message":"...","max_request":200,"interval":3600}}
+    const QJsonObject error = QJsonDocument::fromJson(replyData).object().value(QStringLiteral("error")).toObject();
+    apiErrorCode = error.value(QStringLiteral("code")).toString();
+    apiErrorMessage = error.value(QStringLiteral("message")).toString();
+    apiMaxRequests = error.value(QStringLiteral("max_request")).toInt();
+    apiInterval = error.value(QStringLiteral("interval")).toInt();
 }
 
 void JobPrivate::extractError()
 {
     Q_ASSERT(reply);
     Q_Q(Job);
+
+    if (apiErrorCode == QLatin1String("RATE_LIMIT_EXCEEDED")) {
+        const QString ep = endpoint();
+        RateLimiter::limitExceeded(account().toUtf8() + ' ' + ep.toUtf8(), ep, apiMaxRequests, apiInterval);
+    }
+
     if (q->error() == BJob::NoError) {
-        qCCritical(qhrCore) << "Network error:" << reply->errorString();
-        q->setError(NetworkError);
-        q->setErrorText(reply->errorString());
+        if (!apiErrorCode.isEmpty()) {
+            qCCritical(qhrCore) << "API error:" << apiErrorCode << apiErrorMessage;
+            q->setError(JobPrivate::errorForApiCode(apiErrorCode));
+            if (q->error() == Unauthorized && credentialProvider) {
+                QMetaObject::invokeMethod(credentialProvider.data(), "invalidate");
+            }
+            q->setErrorText(apiErrorMessage.isEmpty() ? apiErrorCode : apiErrorMessage);
+        } else {
+            qCCritical(qhrCore) << "Network error:" << reply->errorString();
+            q->setError(NetworkError);
+            q->setErrorText(reply->errorString());
+        }
+    }
+}
+
+int JobPrivate::errorForApiCode(const QString &apiErrorCode)
+{
+    if (apiErrorCode == QLatin1String("UNAUTHORIZED")) {
+        return Unauthorized;
+    } else if (apiErrorCode == QLatin1String("RATE_LIMIT_EXCEEDED")) {
+        return RateLimitExceeded;
+    } else if (apiErrorCode == QLatin1String("INVALID_INPUT")) {
+        return InvalidInput;
+    } else if (apiErrorCode == QLatin1String("NOT_FOUND") || apiErrorCode.endsWith(QLatin1String("_NOT_FOUND"))) {
+        return NotFound;
+    } else if (apiErrorCode == QLatin1String("CONFLICT") || apiErrorCode.endsWith(QLatin1String("_ALREADY_EXISTS"))) {
+        return Conflict;
+    } else if (apiErrorCode == QLatin1String("MAINTENANCE")) {
+        return ServerMaintenance;
+    } else if (apiErrorCode == QLatin1String("INTERNAL_ERROR")) {
+        return InternalServerError;
     }
+    return ApiError;
 }
 
 void JobPrivate::successCallback(const QByteArray &replyData)
@@ -191,6 +1085,7 @@ void JobPrivate::emitError(int errorCode, const QString &errorText)
     q->setErrorText(errorText);
     q->emitResult();
     Q_EMIT q->failed(errorCode, q->errorString());
+    metrics.finish(q, requestUrl.isValid() ? endpoint() : JobPrivate::operationName(namOperation), errorCode);
 }
 
 QString JobPrivate::buildUrlPath() const
@@ -215,13 +1110,13 @@ std::pair<QByteArray, QByteArray> JobPrivate::buildPayload() const
 
 bool JobPrivate::checkInput()
 {
-    if (Q_UNLIKELY(requiresAuth && configuration->username().isEmpty())) {
+    if (Q_UNLIKELY(requiresAuth && account().isEmpty())) {
         emitError(MissingUser);
         qCCritical(qhrCore) << "Can not send request: missing username.";
         return false;
     }
 
-    if (Q_UNLIKELY(requiresAuth && configuration->password().isEmpty())) {
+    if (Q_UNLIKELY(requiresAuth && (credentialProvider ? credentialProvider->authorizationHeader().isEmpty() : configuration->password().isEmpty()))) {
         emitError(MissingPassword);
         qCCritical(qhrCore) << "Can not send request: missing password.";
         return false;
@@ -277,197 +1172,167 @@ void JobPrivate::emitDescription()
 
 }
 
-Job::Job(QObject *parent)
-    : BJob(parent), bd_ptr(new JobPrivate(this))
+void JobPrivate::waitForCredentials()
 {
+    Q_Q(Job);
+    qCDebug(qhrCore) << "Waiting for credentials from" << credentialProvider.data();
 
-}
-
-Job::Job(JobPrivate &dd, QObject *parent)
-    : BJob(parent), bd_ptr(&dd)
-{
+    credentialConnections[0] = QObject::connect(credentialProvider.data(), &AbstractCredentialProvider::credentialsReady, q, [this](){
+        QObject::disconnect(credentialConnections[0]);
+        QObject::disconnect(credentialConnections[1]);
+        if (Q_LIKELY(!aborted)) {
+            prepareRequest();
+        }
+    });
+    credentialConnections[1] = QObject::connect(credentialProvider.data(), &AbstractCredentialProvider::credentialsFailed, q, [this](const QString &errorString){
+        QObject::disconnect(credentialConnections[0]);
+        QObject::disconnect(credentialConnections[1]);
+        if (Q_LIKELY(!aborted)) {
+            emitError(CredentialsUnavailable, errorString);
+        }
+    });
 
+    // the provider might live in another thread
+    QMetaObject::invokeMethod(credentialProvider.data(), "requestCredentials");
 }
 
-Job::~Job() = default;
-
-void Job::sendRequest()
+void JobPrivate::prepareRequest()
 {
-    Q_D(Job);
+    Q_Q(Job);
 
-    d->emitDescription();
+    if (Q_UNLIKELY(!checkInput())) {
+        return;
+    }
 
-    //: Job info message to display state information
-    //% "Setting up request"
-    Q_EMIT infoMessage(this, qtTrId("libqhr-info-msg-req-setup"));
-    qCDebug(qhrCore) << "Setting up network request.";
+    if (!hasRetryPolicy) {
+        retryPolicy = QHR::defaultRetryPolicy();
+    }
+    retryCount = 0;
+    sslErrorOccurred = false;
 
-    if (!d->configuration) {
-        d->configuration = QHR::defaultConfiguration();
-        if (d->configuration) {
-            qCDebug(qhrCore) << "Using default configuration" << d->configuration;
-            Q_EMIT configurationChanged(d->configuration);
-        } else {
-            d->emitError(MissingConfig);
-            qCCritical(qhrCore) << "Can not send request: missing configuration.";
-            return;
-        }
+    QUrl url = configuration->baseUrl();
+    QString basePath = url.path();
+    if (basePath.endsWith(QLatin1Char('/'))) {
+        basePath.chop(1);
     }
+    url.setPath(basePath + buildUrlPath());
+    url.setQuery(buildUrlQuery());
 
-    if (Q_UNLIKELY(!d->checkInput())) {
+    if (Q_UNLIKELY(!url.isValid())) {
+        emitError(InvalidRequestUrl, url.toString());
         return;
     }
 
-    QUrl url;
-    url.setScheme(QStringLiteral("https"));
+    requestUrl = url;
 
-    url.setHost(QStringLiteral("robot-ws.your-server.de"));
-    url.setPath(d->buildUrlPath());
-    url.setQuery(d->buildUrlQuery());
+    if (finishFromCache()) {
+        return;
+    }
 
-    if (Q_UNLIKELY(!url.isValid())) {
-        d->emitError(InvalidRequestUrl, url.toString());
+    if (joinFlight()) {
+        //: Job info message to display state information
+        //% "Waiting for identical request"
+        Q_EMIT q->infoMessage(q, qtTrId("libqhr-info-msg-req-waiting"));
         return;
     }
 
-    if (!d->nam) {
+    sendNetworkRequest();
+}
+
+void JobPrivate::sendNetworkRequest()
+{
+    Q_Q(Job);
+
+    if (!nam) {
 
         auto namf = QHR::networkAccessManagerFactory();
         if (namf) {
-            d->nam = namf->create(this);
+            nam = namf->create(q);
         } else {
-            d->nam = new QNetworkAccessManager(this);
-            qCDebug(qhrCore) << "Using default created" << d->nam;
+            nam = JobPrivate::pooledNetworkAccessManager();
+            qCDebug(qhrCore) << "Using pooled" << nam;
         }
-
-        connect(d->nam, &QNetworkAccessManager::sslErrors, this, [d](QNetworkReply *reply, const QList<QSslError> &errors){
-            d->handleSslErrors(reply, errors);
-        });
     }
 
-    QNetworkRequest nr(url);
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
-    if (Q_LIKELY(d->requestTimeout > 0)) {
-        nr.setTransferTimeout(static_cast<int>(d->requestTimeout) * 1000);
+    buildNetworkRequest();
+
+    if (!RateLimiter::instance()->acquire(this)) {
+        //: Job info message to display state information
+        //% "Waiting for request limit"
+        Q_EMIT q->infoMessage(q, qtTrId("libqhr-info-msg-req-rate-limited"));
+        return;
     }
-#endif
 
-    nr.setRawHeader(QByteArrayLiteral("User-Agent"), d->configuration->userAgent().toUtf8());
+    dispatchRequest();
+}
 
-    switch (d->expectedContentType) {
-    case ExpectedContentType::JsonObject:
-    case ExpectedContentType::JsonArray:
-        nr.setRawHeader(QByteArrayLiteral("Accept"), QByteArrayLiteral("application/json"));
-        break;
-    case ExpectedContentType::Invalid:
-        Q_ASSERT_X(false, "sending request", "invalid exepected content type");
-        break;
-    default:
-        break;
-    }
+Job::Job(QObject *parent)
+    : BJob(parent), bd_ptr(new JobPrivate(this))
+{
+    setCapabilities(Killable);
+}
 
-    const QMap<QByteArray, QByteArray> reqHeaders = d->buildRequestHeaders();
-    if (!reqHeaders.empty()) {
-        QMap<QByteArray, QByteArray>::const_iterator i = reqHeaders.constEnd();
-        while (i != reqHeaders.constEnd()) {
-            nr.setRawHeader(i.key(), i.value());
-            ++i;
-        }
-    }
+Job::Job(JobPrivate &dd, QObject *parent)
+    : BJob(parent), bd_ptr(&dd)
+{
+    setCapabilities(Killable);
+}
 
-    const auto payload = d->buildPayload();
+Job::~Job()
+{
+    Q_D(Job);
+    d->abortRequest();
+}
 
-    if (!payload.second.isEmpty()) {
-        nr.setRawHeader(QByteArrayLiteral("Content-Type"), payload.second);
-    }
+bool Job::doKill()
+{
+    Q_D(Job);
+    qCDebug(qhrCore) << "Killing" << this;
+    d->abortRequest();
+    return true;
+}
 
-    if (d->requiresAuth) {
-        const QString auth = d->configuration->username() + QLatin1Char(':') + d->configuration->password();
-        const QByteArray authHeader = QByteArrayLiteral("Basic ") + auth.toUtf8().toBase64();
-        nr.setRawHeader(QByteArrayLiteral("Authorization"), authHeader);
-    }
+void Job::sendRequest()
+{
+    Q_D(Job);
 
-    if (qhrCore().isDebugEnabled()) {
-        QString opName;
-        switch(d->namOperation) {
-        case NetworkOperation::Head:
-            opName = QStringLiteral("HEAD");
-            break;
-        case NetworkOperation::Post:
-            opName = QStringLiteral("POST");
-            break;
-        case NetworkOperation::Put:
-            opName = QStringLiteral("PUT");
-            break;
-        case NetworkOperation::Delete:
-            opName = QStringLiteral("DELETE");
-            break;
-        case NetworkOperation::Get:
-            opName = QStringLiteral("GET");
-            break;
-        default:
-            Q_ASSERT_X(false, "sending request", "invalid network operation");
-            break;
-        }
-        qCDebug(qhrCore) << "Start performing" << opName << "network operation.";
-        qCDebug(qhrCore) << "API URL:" << url;
-        const auto rhl = nr.rawHeaderList();
-        for (const QByteArray &h : rhl) {
-            if (h == QByteArrayLiteral("Authorization")) {
-                qCDebug(qhrCore) << h << ":" << "**************";
-            } else {
-                qCDebug(qhrCore) << h << ":" << nr.rawHeader(h);
-            }
-        }
-        if (!payload.first.isEmpty()) {
-            qCDebug(qhrCore) << "Payload:" << payload.first;
-        }
+    if (Q_UNLIKELY(d->aborted)) {
+        return;
     }
 
-#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
-    if (Q_LIKELY(d->requestTimeout > 0)) {
-        if (!d->timeoutTimer) {
-            d->timeoutTimer = new QTimer(this);
-            d->timeoutTimer->setSingleShot(true);
-            d->timeoutTimer->setTimerType(Qt::VeryCoarseTimer);
-            connect(d->timeoutTimer, &QTimer::timeout, this, [d](){
-                d->requestTimedOut();
-            });
-        }
-        d->timeoutTimer->start(static_cast<int>(d->requestTimeout) * 1000);
-        qCDebug(qhrCore) << "Started request timeout timer with" << d->requestTimeout << "seconds.";
-    }
-#endif
+    d->metrics.start();
+
+    d->emitDescription();
 
     //: Job info message to display state information
-    //% "Sending request"
-    Q_EMIT infoMessage(this, qtTrId("libqhr-info-msg-req-send"));
-    qCDebug(qhrCore) << "Sending network request.";
+    //% "Setting up request"
+    Q_EMIT infoMessage(this, qtTrId("libqhr-info-msg-req-setup"));
+    qCDebug(qhrCore) << "Setting up network request.";
 
-    switch(d->namOperation) {
-    case NetworkOperation::Head:
-        d->reply = d->nam->head(nr);
-        break;
-    case NetworkOperation::Post:
-        d->reply = d->nam->post(nr, payload.first);
-        break;
-    case NetworkOperation::Put:
-        d->reply = d->nam->put(nr, payload.first);
-        break;
-    case NetworkOperation::Delete:
-        d->reply = d->nam->deleteResource(nr);
-        break;
-    case NetworkOperation::Get:
-        d->reply = d->nam->get(nr);
-        break;
-    default:
-        Q_ASSERT_X(false, "sending request", "invalid network operation");
-        break;
+    if (!d->configuration) {
+        d->configuration = QHR::defaultConfiguration();
+        if (d->configuration) {
+            qCDebug(qhrCore) << "Using default configuration" << d->configuration;
+            Q_EMIT configurationChanged(d->configuration);
+        } else {
+            d->emitError(MissingConfig);
+            qCCritical(qhrCore) << "Can not send request: missing configuration.";
+            return;
+        }
     }
 
-    connect(d->reply, &QNetworkReply::finished, this, [d](){
-        d->requestFinished();
-    });
+    if (d->requiresAuth) {
+        d->credentialProvider = d->configuration->credentialProvider();
+        if (d->credentialProvider && !d->credentialProvider->isReady()) {
+            //: Job info message to display state information
+            //% "Waiting for credentials"
+            Q_EMIT infoMessage(this, qtTrId("libqhr-info-msg-req-credentials"));
+            d->waitForCredentials();
+            return;
+        }
+    }
+
+    d->prepareRequest();
 }
 
 AbstractConfiguration* Job::configuration() const
@@ -488,7 +1353,12 @@ void Job::setConfiguration(AbstractConfiguration *configuration)
 
 QString Job::errorString() const
 {
-    switch (error()) {
+    return JobPrivate::errorMessage(error(), errorText());
+}
+
+QString JobPrivate::errorMessage(int error, const QString &errorText)
+{
+    switch (error) {
     case MissingConfig:
         //: Error message
         //% "No configuration set."
@@ -504,11 +1374,11 @@ QString Job::errorString() const
     case InvalidRequestUrl:
         //: Error message, %1 will be the invalid URL string.
         //% "The URL (%1) generated to perform the request is not valid, please check your input values."
-        return qtTrId("libqhr-error-invalid-req-url").arg(errorText());
+        return qtTrId("libqhr-error-invalid-req-url").arg(errorText);
     case JsonParseError:
         //: Error message, %1 will be the JSON parser error string.
         //% "Failed to parse the received JSON data: %1"
-        return qtTrId("libqhr-error-json-parser").arg(errorText());
+        return qtTrId("libqhr-error-json-parser").arg(errorText);
     case WrongOutputType:
         //: Error message
         //% "Unexpected JSON type in received data."
@@ -519,7 +1389,36 @@ QString Job::errorString() const
         //% "Unexpected empty reply data."
         return qtTrId("libqhr-error-empty-json");
     case NetworkError:
-        return errorText();
+    case ApiError:
+        return errorText;
+    case Unauthorized:
+        //: Error message
+        //% "Invalid username or password."
+        return qtTrId("libqhr-error-unauthorized");
+    case RateLimitExceeded:
+        //: Error message
+        //% "The request limit of the API has been exceeded. Please try again later."
+        return qtTrId("libqhr-error-rate-limit-exceeded");
+    case InvalidInput:
+        //: Error message, %1 will be the error message returned by the API.
+        //% "Invalid input values: %1"
+        return qtTrId("libqhr-error-invalid-input").arg(errorText);
+    case Conflict:
+        //: Error message, %1 will be the error message returned by the API.
+        //% "The request conflicts with the current state of the resource: %1"
+        return qtTrId("libqhr-error-conflict").arg(errorText);
+    case ServerMaintenance:
+        //: Error message
+        //% "The API is currently in maintenance mode. Please try again later."
+        return qtTrId("libqhr-error-maintenance");
+    case InternalServerError:
+        //: Error message
+        //% "The API has encountered an internal error. Please try again later."
+        return qtTrId("libqhr-error-internal");
+    case CredentialsUnavailable:
+        //: Error message, %1 will be the error message of the credential provider.
+        //% "Failed to get the credentials: %1"
+        return qtTrId("libqhr-error-credentials-unavailable").arg(errorText);
     default:
         //: Error message
         //% "Sorry, but unfortunately an unknown error has occurred."
@@ -533,4 +1432,35 @@ QJsonDocument Job::result() const
     return d->jsonResult;
 }
 
+RetryPolicy Job::retryPolicy() const
+{
+    Q_D(const Job);
+    return d->hasRetryPolicy ? d->retryPolicy : QHR::defaultRetryPolicy();
+}
+
+void Job::setRetryPolicy(const RetryPolicy &policy)
+{
+    Q_D(Job);
+    d->retryPolicy = policy;
+    d->hasRetryPolicy = true;
+}
+
+bool Job::isStreamingEnabled() const
+{
+    Q_D(const Job);
+    return d->streaming;
+}
+
+void Job::setStreamingEnabled(bool enabled)
+{
+    Q_D(Job);
+    d->streaming = enabled;
+}
+
+QString Job::apiErrorCode() const
+{
+    Q_D(const Job);
+    return d->apiErrorCode;
+}
+
 #include "moc_job.cpp"
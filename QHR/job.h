@@ -8,6 +8,7 @@
 
 #include <QObject>
 #include <QJsonDocument>
+#include <QJsonValue>
 #if defined(QHR_WITH_KDE)
 #include <KF5/KCoreAddons/KJob>
 #else
@@ -16,6 +17,7 @@
 #include "qhr_global.h"
 #include "logging.h"
 #include "abstractconfiguration.h"
+#include "retrypolicy.h"
 #include <memory>
 
 namespace QHR {
@@ -26,6 +28,7 @@ using BJob = KJob;
 
 class JobPrivate;
 class AbstractNamFactory;
+class ResponseCache;
 
 /*!
  * \brief Error codes for Job.
@@ -41,7 +44,16 @@ enum {
     EmptyJson,              /**< The response data is empty but that was not expected. */
     EmptyReply,             /**< The response data is empty but that was not expected. */
     NetworkError,           /**< Network related error. */
-    NotFound                /**< The requested resource could not be found. */
+    NotFound,               /**< The requested resource could not be found. */
+    Unauthorized,           /**< The API rejected the username or password. */
+    RateLimitExceeded,      /**< The request limit of the API endpoint has been exceeded. */
+    InvalidInput,           /**< The API rejected the input values. */
+    Conflict,               /**< The request conflicts with the current state of the resource. */
+    ServerMaintenance,      /**< The API is in maintenance mode. */
+    InternalServerError,    /**< The API has encountered an internal error. */
+    ApiError,               /**< Other error returned by the API, see Job::apiErrorCode(). */
+    SubJobsFailed,          /**< One or more jobs of a JobGroup have been failed. */
+    CredentialsUnavailable  /**< The AbstractCredentialProvider failed to fetch the credentials. */
 };
 
 /*!
@@ -50,6 +62,10 @@ enum {
  * This class is used by all classes that perform API requests. It is not meant to be used
  * by itself. It provides basic properties and functions used by all classes that perform
  * API requests.
+ *
+ * Identical \c GET requests for the same account that are started in the same thread while
+ * another one is still running will not be sent again. They will wait for the running request
+ * and will get the same result data and error information.
  */
 class QHR_LIBRARY Job : public BJob
 {
@@ -108,6 +124,54 @@ public:
      */
     QJsonDocument result() const;
 
+    /*!
+     * \brief Returns the error code returned by the API.
+     *
+     * If the API request failed and the API returned an error object, this will
+     * return the code from that object, like \c RATE_LIMIT_EXCEEDED or \c SERVER_NOT_FOUND.
+     * Otherwise this returns a null string.
+     */
+    QString apiErrorCode() const;
+
+    /*!
+     * \brief Returns \c true if streaming of the result items is enabled.
+     * \sa setStreamingEnabled(), itemReceived()
+     */
+    bool isStreamingEnabled() const;
+
+    /*!
+     * \brief Set \a enabled to \c true to enable streaming of the result items.
+     *
+     * If streaming is enabled and the API returns a JSON array, the reply will be parsed
+     * while it is downloaded and every array element will be emitted via itemReceived()
+     * as soon as it is complete. Only the current element will be buffered, so result()
+     * will return an empty document after the job has been finished.
+     *
+     * Streaming jobs will not share requests with other jobs and will not be retried
+     * after the first item has been emitted. Results taken from the ResponseCache will
+     * also be emitted item by item.
+     *
+     * Streaming is disabled by default and has to be enabled before starting the job.
+     *
+     * \sa isStreamingEnabled(), itemReceived()
+     */
+    void setStreamingEnabled(bool enabled);
+
+    /*!
+     * \brief Returns the retry policy used by this job.
+     *
+     * If no policy has been set via setRetryPolicy(), this returns QHR::defaultRetryPolicy().
+     */
+    RetryPolicy retryPolicy() const;
+
+    /*!
+     * \brief Sets the retry \a policy used by this job.
+     *
+     * Retries will be performed by the same job. Signals like succeeded(), failed() and
+     * BJob::result() will only be emitted after the last attempt.
+     */
+    void setRetryPolicy(const RetryPolicy &policy);
+
 protected:
     const std::unique_ptr<JobPrivate> bd_ptr;
 
@@ -126,6 +190,13 @@ protected:
      */
     void sendRequest();
 
+    /*!
+     * \brief Aborts a running or queued request.
+     *
+     * Jobs that are waiting for the same request will take it over.
+     */
+    bool doKill() override;
+
 Q_SIGNALS:
     /*!
      * \brief Notifier signal for the \link Job::configuration configuration\endlink property.
@@ -155,6 +226,17 @@ Q_SIGNALS:
      */
     void failed(int errorCode, const QString &errorString);
 
+    /*!
+     * \brief Emitted for every element of the result array if streaming is enabled.
+     *
+     * \a item contains a single element of the JSON array returned by the API. It will
+     * be emitted before succeeded() or failed(). A connected slot may delete or kill the
+     * job, no further items will be emitted then.
+     *
+     * \sa setStreamingEnabled()
+     */
+    void itemReceived(const QJsonValue &item);
+
 private:
     Q_DECLARE_PRIVATE_D(bd_ptr, Job)
     Q_DISABLE_COPY(Job)
@@ -174,6 +256,16 @@ QHR_LIBRARY AbstractConfiguration* defaultConfiguration();
 
 /*!
  * \brief Sets a pointer to a global network access manager \a factory.
+ *
+ * If no factory is set, all jobs created in the same thread will share one
+ * long-lived QNetworkAccessManager that is owned by the library. This keeps
+ * connections to the API host alive and reuses TLS sessions between jobs.
+ * The pooled manager will be destroyed when its thread finishes.
+ *
+ * If you set your own factory, it is up to the factory if it returns a
+ * new manager for every job or a shared one. Set \c nullptr to go back
+ * to the pooled default.
+ *
  * \sa QHR::networkAccessManagerFactory()
  */
 QHR_LIBRARY void setNetworkAccessManagerFactory(AbstractNamFactory *factory);
@@ -184,6 +276,55 @@ QHR_LIBRARY void setNetworkAccessManagerFactory(AbstractNamFactory *factory);
  */
 QHR_LIBRARY AbstractNamFactory* networkAccessManagerFactory();
 
+/*!
+ * \brief Sets the global default retry \a policy.
+ *
+ * This policy will be used by all jobs that have no own policy set via Job::setRetryPolicy().
+ * The default policy does not retry any request.
+ *
+ * \sa QHR::defaultRetryPolicy()
+ */
+QHR_LIBRARY void setDefaultRetryPolicy(const RetryPolicy &policy);
+
+/*!
+ * \brief Returns the global default retry policy.
+ * \sa QHR::setDefaultRetryPolicy()
+ */
+QHR_LIBRARY RetryPolicy defaultRetryPolicy();
+
+/*!
+ * \brief Sets the request limit for an API \a endpoint.
+ *
+ * The \a endpoint is the HTTP method and the API path where parameters like server
+ * numbers or IP addresses are replaced by \c {}, for example <CODE>GET /server</CODE>
+ * or <CODE>POST /reset/{}</CODE>. The limit is set as \a maxRequests per \a interval
+ * seconds and will be tracked per account.
+ *
+ * Jobs for an endpoint whose limit is exhausted will be queued and started automatically
+ * as soon as the budget allows it. Limits will also be learned from \c RATE_LIMIT_EXCEEDED
+ * replies of the API. Set \a maxRequests to \c 0 to remove the limit for the \a endpoint.
+ */
+QHR_LIBRARY void setRateLimit(const QString &endpoint, int maxRequests, int interval);
+
+/*!
+ * \brief Sets a pointer to a global response \a cache.
+ *
+ * If a cache is set, jobs performing \c GET requests will use it to look up
+ * and store responses. Set \c nullptr to disable caching, what is the default.
+ * The library does not take ownership of the \a cache, it has to outlive all jobs
+ * and background revalidations using it. Configurations can use their own cache by
+ * reimplementing AbstractConfiguration::responseCache().
+ *
+ * \sa QHR::responseCache(), ResponseCache
+ */
+QHR_LIBRARY void setResponseCache(ResponseCache *cache);
+
+/*!
+ * \brief Returns a pointer to the global response cache.
+ * \sa QHR::setResponseCache()
+ */
+QHR_LIBRARY ResponseCache* responseCache();
+
 }
 
 #endif // QHR_JOB_H
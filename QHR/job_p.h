@@ -7,15 +7,21 @@
 #define QHR_JOB_P_H
 
 #include "job.h"
+#include "metrics_p.h"
 #include <QMap>
+#include <QHash>
+#include <QVector>
 #if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
 #include <QTimer>
 #endif
 #include <QNetworkReply>
+#include <QNetworkRequest>
 #include <QUrlQuery>
+#include <QUrl>
+#include <QPointer>
 #include <utility>
+#include <memory>
 
-class QNetworkRequest;
 
 namespace QHR {
 
@@ -36,6 +42,15 @@ enum class NetworkOperation : qint8 {
     Custom  = 6
 };
 
+enum ProtocolOption : quint8 {
+    NoProtocolOptions   = 0x00,
+    Http2               = 0x01,
+    Pipelining          = 0x02
+};
+
+class JsonStreamParser;
+class AbstractCredentialProvider;
+
 class JobPrivate
 {
 public:
@@ -43,17 +58,43 @@ public:
     virtual ~JobPrivate();
 
     QJsonDocument jsonResult;
+    QUrl requestUrl;
+    QNetworkRequest networkRequest;
+    QByteArray payloadData;
+    QByteArray rateLimitKey;
+    QString apiErrorCode;
+    QString apiErrorMessage;
+    RetryPolicy retryPolicy;
+    std::shared_ptr<JsonStreamParser> streamParser;
+    JobMetrics metrics;
+    QByteArray flightKey;
+    QVector<JobPrivate*> followers;
+    JobPrivate *leader = nullptr;
     QNetworkAccessManager *nam = nullptr;
 #if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
     QTimer *timeoutTimer = nullptr;
 #endif
     QNetworkReply *reply = nullptr;
     AbstractConfiguration *configuration = nullptr;
+    QPointer<AbstractCredentialProvider> credentialProvider;
+    QMetaObject::Connection credentialConnections[2];
     NetworkOperation namOperation = NetworkOperation::Invalid;
     ExpectedContentType expectedContentType = ExpectedContentType::Invalid;
     quint16 requestTimeout = 300;
-    quint8 retryCount;
+    int apiMaxRequests = 0;
+    int apiInterval = 0;
+    quint8 retryCount = 0;
+    quint8 protocolOptions = NoProtocolOptions;
     bool requiresAuth = true;
+    bool notFoundIsEmpty = false;
+    bool hasRetryPolicy = false;
+    bool sslErrorOccurred = false;
+    bool streaming = false;
+    bool aborted = false;
+
+    static QNetworkAccessManager *pooledNetworkAccessManager();
+
+    static QString operationName(NetworkOperation operation);
 
     void handleSslErrors(QNetworkReply *reply, const QList<QSslError> &errors);
 
@@ -63,8 +104,76 @@ public:
 
     void requestFinished();
 
+    void waitForCredentials();
+
+    void prepareRequest();
+
+    void sendNetworkRequest();
+
+    void buildNetworkRequest();
+
+    void dispatchRequest();
+
+    bool isIdempotent() const;
+
+    bool scheduleRetry(QNetworkReply::NetworkError networkError, int httpStatusCode);
+
+    static QHash<QString, quint8> &refusedProtocols();
+
+    static quint8 applyProtocolOptions(QNetworkRequest &request, AbstractConfiguration *config, NetworkOperation operation);
+
+    static bool refuseProtocols(const QUrl &url, quint8 options, QNetworkReply::NetworkError networkError);
+
+    bool protocolFallback(QNetworkReply::NetworkError networkError);
+
+    void retryRequest();
+
+    bool readStream();
+
+    virtual void handleStreamItem(const QByteArray &item);
+
+    bool checkStream();
+
+    bool emitItems();
+
+    void connectReply();
+
+    void parseApiError(const QByteArray &replyData);
+
+    static int errorForApiCode(const QString &apiErrorCode);
+
+    static QString errorMessage(int error, const QString &errorText);
+
+    static QHash<QByteArray, JobPrivate*> &inFlightRequests();
+
+    bool joinFlight();
+
+    void unregisterFlight();
+
+    void leaveFlight();
+
+    void abortRequest();
+
+    void notifyFollowers(bool success, const QByteArray &replyData);
+
     void emitError(int errorCode, const QString &errorText = QString());
 
+    QString account() const;
+
+    QString endpoint() const;
+
+    QByteArray requestKey() const;
+
+    ResponseCache *cache() const;
+
+    QByteArray authorizationHeader() const;
+
+    bool finishFromCache();
+
+    void revalidate(ResponseCache *cache);
+
+    void updateResponseCache(bool success, const QByteArray &replyData);
+
     virtual QString buildUrlPath() const;
 
     virtual QUrlQuery buildUrlQuery() const;
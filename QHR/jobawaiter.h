@@ -0,0 +1,176 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_JOBAWAITER_H
+#define QHR_JOBAWAITER_H
+
+// The library itself is built with C++14, this header is only available
+// to users compiling their own code with coroutine support.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && defined(__has_include)
+#if __has_include(<coroutine>)
+
+#include "job.h"
+#include "client.h"
+#include <coroutine>
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+/*!
+ * \brief Defined if QHR/JobAwaiter provides coroutine support.
+ */
+#define QHR_HAS_COROUTINES 1
+
+namespace QHR {
+
+/*!
+ * \brief Result of a job awaited with awaitJob().
+ *
+ * If the job has been failed, \a error contains the error information and \a value
+ * is default constructed.
+ *
+ * \headerfile "" <QHR/JobAwaiter>
+ */
+template<typename T>
+struct JobResult
+{
+    T value{};
+    JobError error;
+
+    /*!
+     * \brief Returns \c true if the job has been finished without error.
+     */
+    bool isOk() const noexcept { return error.code() == BJob::NoError; }
+
+    explicit operator bool() const noexcept { return isOk(); }
+};
+
+/*!
+ * \brief Awaitable that starts a job and resumes the coroutine when the job has been finished.
+ *
+ * Use awaitJob() to create it. The coroutine will be resumed directly in the thread of the
+ * job when BJob::finished() is emitted, while the job is still alive. This is also the case
+ * if the job has been killed quietly. If the job is destroyed before it has been finished,
+ * the coroutine will be resumed from the destructor with BJob::KilledJobError, the job must
+ * not be used anymore then.
+ *
+ * \headerfile "" <QHR/JobAwaiter>
+ */
+template<typename JobT, typename Getter>
+class JobAwaiter
+{
+    static_assert(std::is_base_of<Job, JobT>::value, "JobT has to be derived from QHR::Job");
+public:
+    using value_type = std::decay_t<std::invoke_result_t<Getter, const JobT*>>;
+
+    JobAwaiter(JobT *job, Getter getter) noexcept
+        : m_job(job), m_getter(getter)
+    {
+        Q_ASSERT_X(job, "QHR::awaitJob", "invalid job");
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        JobT *job = m_job;
+        QObject::connect(job, &BJob::finished, job, [this, job, handle](BJob *finished){
+            // ~BJob() emits finished() if the job is destroyed early, the Job part is
+            // already gone then and the dynamic type is BJob again
+            if (!qobject_cast<Job*>(finished)) {
+                //: Error message if a job awaited in a coroutine has been destroyed before it has been finished
+                //% "The job has been destroyed before it has been finished."
+                m_result.error = JobError(BJob::KilledJobError, qtTrId("libqhr-error-awaited-job-destroyed"));
+            } else if (job->error() == BJob::NoError) {
+                m_result.value = (job->*m_getter)();
+            } else {
+                m_result.error = JobError(job->error(), job->errorString(), job->apiErrorCode());
+            }
+            handle.resume();
+        }, Qt::DirectConnection);
+        // the coroutine might already have been resumed when start() returns,
+        // so this must not be touched afterwards
+        job->start();
+    }
+
+    JobResult<value_type> await_resume() noexcept
+    {
+        return std::move(m_result);
+    }
+
+private:
+    JobT *m_job = nullptr;
+    Getter m_getter;
+    JobResult<value_type> m_result;
+};
+
+/*!
+ * \brief Starts the \a job and awaits Job::result().
+ *
+ * The \a job must not have been started yet.
+ *
+ * \code{.cpp}
+ * QHR::Task provision()
+ * {
+ *     const auto servers = co_await QHR::awaitJob(new QHR::GetServersJob, &QHR::GetServersJob::servers);
+ *     if (!servers) {
+ *         qWarning() << servers.error.errorString();
+ *         co_return;
+ *     }
+ *     // ...
+ * }
+ * \endcode
+ */
+template<typename JobT>
+JobAwaiter<JobT, QJsonDocument (Job::*)() const> awaitJob(JobT *job) noexcept
+{
+    return {job, &Job::result};
+}
+
+/*!
+ * \brief Starts the \a job and awaits the value returned by \a getter.
+ *
+ * The \a job must not have been started yet. The \a getter will only be called if the
+ * job has been finished without error.
+ */
+template<typename JobT, typename Base, typename T>
+JobAwaiter<JobT, T (Base::*)() const> awaitJob(JobT *job, T (Base::*getter)() const) noexcept
+{
+    static_assert(std::is_base_of<Base, JobT>::value, "getter has to be a member function of JobT");
+    return {job, getter};
+}
+
+/*!
+ * \brief Fire and forget coroutine type.
+ *
+ * A %Task starts running immediately and destroys itself after it has been finished.
+ * It can be used to write flows of jobs as straight-line code. Many tasks can run at the
+ * same time on one thread, every task only occupies its coroutine frame while waiting.
+ * Exceptions escaping a task will terminate the application.
+ *
+ * \headerfile "" <QHR/JobAwaiter>
+ */
+class Task
+{
+public:
+    struct promise_type
+    {
+        Task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+}
+
+#endif // __has_include(<coroutine>)
+#endif // __cpp_impl_coroutine
+
+#endif // QHR_JOBAWAITER_H
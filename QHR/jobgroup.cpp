@@ -0,0 +1,210 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "jobgroup_p.h"
+#include <QTimer>
+
+using namespace QHR;
+
+JobGroupPrivate::JobGroupPrivate(JobGroup *q)
+    : q_ptr(q)
+{
+
+}
+
+JobGroupPrivate::~JobGroupPrivate() = default;
+
+void JobGroupPrivate::startNext()
+{
+    // jobs might finish synchronously inside start(), they will
+    // be handled by the loop below instead of recursing into it
+    if (starting) {
+        return;
+    }
+    starting = true;
+
+    while (!aborting && nextJob < jobs.size() && (maxInFlight <= 0 || runningJobs.size() < maxInFlight)) {
+        BJob *job = jobs.at(nextJob++);
+        runningJobs.append(job);
+        qCDebug(qhrCore) << "Starting" << job << "in job group" << q_ptr;
+        job->start();
+    }
+
+    starting = false;
+
+    if (runningJobs.empty() && (aborting || nextJob >= jobs.size())) {
+        finish();
+    }
+}
+
+void JobGroupPrivate::jobFinished(BJob *job)
+{
+    if (!runningJobs.removeOne(job)) {
+        return;
+    }
+
+    Q_Q(JobGroup);
+
+    ++finishedCount;
+    q->setProcessedAmount(BJob::Items, static_cast<qulonglong>(finishedCount));
+
+    if (job->error() != BJob::NoError) {
+        failedJobs.append(job);
+        if (failureMode == JobGroup::FailFast && !aborting) {
+            qCDebug(qhrCore) << "Job" << job << "failed, aborting job group" << q;
+            aborting = true;
+            Q_EMIT q->jobFinished(job);
+            killRunning();
+            startNext();
+            return;
+        }
+    }
+
+    Q_EMIT q->jobFinished(job);
+
+    startNext();
+}
+
+void JobGroupPrivate::killRunning()
+{
+    const QVector<BJob*> _running = runningJobs;
+    runningJobs.clear();
+    for (BJob *job : _running) {
+        job->kill(BJob::Quietly);
+    }
+}
+
+void JobGroupPrivate::finish()
+{
+    Q_Q(JobGroup);
+
+    if (q->isFinished()) {
+        return;
+    }
+
+    if (!failedJobs.empty()) {
+        q->setError(SubJobsFailed);
+        q->setErrorText(failedJobs.first()->errorString());
+        qCWarning(qhrCore) << failedJobs.size() << "of" << jobs.size() << "jobs failed in job group" << q;
+    }
+
+    q->emitResult();
+}
+
+JobGroup::JobGroup(QObject *parent)
+    : BJob(parent), gd_ptr(new JobGroupPrivate(this))
+{
+    setCapabilities(Killable);
+}
+
+JobGroup::~JobGroup() = default;
+
+void JobGroup::addJob(BJob *job)
+{
+    Q_D(JobGroup);
+    Q_ASSERT_X(job, "add job to group", "invalid job");
+
+    if (Q_UNLIKELY(isFinished())) {
+        qCWarning(qhrCore) << "Can not add" << job << "to already finished job group" << this;
+        return;
+    }
+
+    job->setParent(this);
+    job->setAutoDelete(false);
+    connect(job, &BJob::finished, this, [d](BJob *j){
+        d->jobFinished(j);
+    });
+    d->jobs.append(job);
+
+    setTotalAmount(BJob::Items, static_cast<qulonglong>(d->jobs.size()));
+
+    if (d->started) {
+        d->startNext();
+    }
+}
+
+QList<BJob*> JobGroup::jobs() const
+{
+    Q_D(const JobGroup);
+    return d->jobs.toList();
+}
+
+QList<BJob*> JobGroup::failedJobs() const
+{
+    Q_D(const JobGroup);
+    return d->failedJobs;
+}
+
+int JobGroup::finishedCount() const
+{
+    Q_D(const JobGroup);
+    return d->finishedCount;
+}
+
+void JobGroup::start()
+{
+    Q_D(JobGroup);
+    d->started = true;
+    QTimer::singleShot(0, this, [d](){
+        d->startNext();
+    });
+}
+
+bool JobGroup::doKill()
+{
+    Q_D(JobGroup);
+    d->aborting = true;
+    d->killRunning();
+    return true;
+}
+
+QString JobGroup::errorString() const
+{
+    Q_D(const JobGroup);
+    if (error() == SubJobsFailed) {
+        //: Error message, %1 will be replaced by the number of failed jobs,
+        //: %2 by the number of all jobs and %3 by the error message of the first failed job.
+        //% "%1 of %2 jobs have been failed. First error: %3"
+        return qtTrId("libqhr-error-sub-jobs-failed").arg(QString::number(d->failedJobs.size()), QString::number(d->jobs.size()), errorText());
+    }
+    return BJob::errorString();
+}
+
+int JobGroup::maxInFlight() const
+{
+    Q_D(const JobGroup);
+    return d->maxInFlight;
+}
+
+void JobGroup::setMaxInFlight(int maxInFlight)
+{
+    Q_D(JobGroup);
+    if (d->maxInFlight != maxInFlight) {
+        qCDebug(qhrCore) << "Changing maxInFlight from" << d->maxInFlight << "to" << maxInFlight;
+        d->maxInFlight = maxInFlight;
+        Q_EMIT maxInFlightChanged(d->maxInFlight);
+        if (d->started) {
+            d->startNext();
+        }
+    }
+}
+
+JobGroup::FailureMode JobGroup::failureMode() const
+{
+    Q_D(const JobGroup);
+    return d->failureMode;
+}
+
+void JobGroup::setFailureMode(FailureMode failureMode)
+{
+    Q_D(JobGroup);
+    if (d->failureMode != failureMode) {
+        qCDebug(qhrCore) << "Changing failureMode from" << d->failureMode << "to" << failureMode;
+        d->failureMode = failureMode;
+        Q_EMIT failureModeChanged(d->failureMode);
+    }
+}
+
+#include "moc_jobgroup.cpp"
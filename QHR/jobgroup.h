@@ -0,0 +1,176 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_JOBGROUP_H
+#define QHR_JOBGROUP_H
+
+#include <QObject>
+#include <QList>
+#include "qhr_global.h"
+#include "job.h"
+#include <memory>
+
+namespace QHR {
+
+class JobGroupPrivate;
+
+/*!
+ * \brief Runs a set of jobs as a unit.
+ *
+ * Add the jobs via addJob() and call start() or BJob::exec(). The group will start at most
+ * \link JobGroup::maxInFlight maxInFlight\endlink jobs at the same time and will start the
+ * next job as soon as a running one has been finished. After all jobs have been finished,
+ * the group emits a single BJob::result() signal. BJob::exec() on the group drives all of
+ * its jobs with a single event loop, so there is no need to call it on the single jobs.
+ *
+ * The group takes ownership of the added jobs and disables their auto-deletion, so that
+ * their results can be inspected in the slot connected to BJob::result() of the group.
+ * The jobs will be deleted together with the group.
+ *
+ * If one or more jobs have been failed, BJob::error() of the group will return
+ * QHR::SubJobsFailed and failedJobs() will return the failed jobs.
+ *
+ * \headerfile "" <QHR/JobGroup>
+ */
+class QHR_LIBRARY JobGroup : public BJob
+{
+    Q_OBJECT
+    /*!
+     * \brief Maximum number of jobs running at the same time.
+     *
+     * The default value is \c 6, what is the number of parallel connections per host used by
+     * QNetworkAccessManager. Set it to \c 0 to start all jobs at once.
+     *
+     * \par Access functions
+     * \li int maxInFlight() const
+     * \li void setMaxInFlight(int maxInFlight)
+     *
+     * \par Notifier signal
+     * \li void maxInFlightChanged(int maxInFlight)
+     */
+    Q_PROPERTY(int maxInFlight READ maxInFlight WRITE setMaxInFlight NOTIFY maxInFlightChanged)
+    /*!
+     * \brief Defines how the group handles failed jobs.
+     *
+     * The default value is JobGroup::CollectAll.
+     *
+     * \par Access functions
+     * \li FailureMode failureMode() const
+     * \li void setFailureMode(FailureMode failureMode)
+     *
+     * \par Notifier signal
+     * \li void failureModeChanged(FailureMode failureMode)
+     */
+    Q_PROPERTY(QHR::JobGroup::FailureMode failureMode READ failureMode WRITE setFailureMode NOTIFY failureModeChanged)
+public:
+    /*!
+     * \brief Defines how the group handles failed jobs.
+     */
+    enum FailureMode : quint8 {
+        CollectAll, /**< All jobs will be run, failed jobs will be collected. */
+        FailFast    /**< The first failed job will kill all running jobs and finish the group. */
+    };
+    Q_ENUM(FailureMode)
+
+    /*!
+     * \brief Constructs a new %JobGroup object with the given \a parent.
+     */
+    explicit JobGroup(QObject *parent = nullptr);
+
+    /*!
+     * \brief Destroys the %JobGroup object and all of its jobs.
+     */
+    ~JobGroup() override;
+
+    /*!
+     * \brief Adds the \a job to the group.
+     *
+     * Jobs can also be added while the group is running, but not after it has been finished.
+     */
+    void addJob(BJob *job);
+
+    /*!
+     * \brief Returns all jobs of the group in the order they have been added.
+     */
+    QList<BJob*> jobs() const;
+
+    /*!
+     * \brief Returns the jobs that have been failed.
+     */
+    QList<BJob*> failedJobs() const;
+
+    /*!
+     * \brief Returns the number of jobs that have been finished.
+     */
+    int finishedCount() const;
+
+    /*!
+     * \brief Starts the jobs of the group asynchronously.
+     */
+    void start() override;
+
+    /*!
+     * \brief Returns a human readable and translated error string.
+     */
+    QString errorString() const override;
+
+    /*!
+     * \brief Getter function for the \link JobGroup::maxInFlight maxInFlight\endlink property.
+     * \sa setMaxInFlight(), maxInFlightChanged()
+     */
+    int maxInFlight() const;
+
+    /*!
+     * \brief Setter function for the \link JobGroup::maxInFlight maxInFlight\endlink property.
+     * \sa maxInFlight(), maxInFlightChanged()
+     */
+    void setMaxInFlight(int maxInFlight);
+
+    /*!
+     * \brief Getter function for the \link JobGroup::failureMode failureMode\endlink property.
+     * \sa setFailureMode(), failureModeChanged()
+     */
+    FailureMode failureMode() const;
+
+    /*!
+     * \brief Setter function for the \link JobGroup::failureMode failureMode\endlink property.
+     * \sa failureMode(), failureModeChanged()
+     */
+    void setFailureMode(FailureMode failureMode);
+
+Q_SIGNALS:
+    /*!
+     * \brief Emitted every time a \a job of the group has been finished.
+     */
+    void jobFinished(QHR::BJob *job);
+
+    /*!
+     * \brief Notifier signal for the \link JobGroup::maxInFlight maxInFlight\endlink property.
+     * \sa setMaxInFlight(), maxInFlight()
+     */
+    void maxInFlightChanged(int maxInFlight);
+
+    /*!
+     * \brief Notifier signal for the \link JobGroup::failureMode failureMode\endlink property.
+     * \sa setFailureMode(), failureMode()
+     */
+    void failureModeChanged(QHR::JobGroup::FailureMode failureMode);
+
+protected:
+    const std::unique_ptr<JobGroupPrivate> gd_ptr;
+
+    /*!
+     * \brief Kills all running jobs and does not start the remaining ones.
+     */
+    bool doKill() override;
+
+private:
+    Q_DECLARE_PRIVATE_D(gd_ptr, JobGroup)
+    Q_DISABLE_COPY(JobGroup)
+};
+
+}
+
+#endif // QHR_JOBGROUP_H
@@ -0,0 +1,49 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_JOBGROUP_P_H
+#define QHR_JOBGROUP_P_H
+
+#include "jobgroup.h"
+#include <QVector>
+
+namespace QHR {
+
+class JobGroupPrivate
+{
+public:
+    explicit JobGroupPrivate(JobGroup *q);
+    ~JobGroupPrivate();
+
+    QVector<BJob*> jobs;
+    QVector<BJob*> runningJobs;
+    QList<BJob*> failedJobs;
+    int nextJob = 0;
+    int finishedCount = 0;
+    int maxInFlight = 6;
+    JobGroup::FailureMode failureMode = JobGroup::CollectAll;
+    bool started = false;
+    bool starting = false;
+    bool aborting = false;
+
+    void startNext();
+
+    void jobFinished(BJob *job);
+
+    void killRunning();
+
+    void finish();
+
+protected:
+    JobGroup *q_ptr = nullptr;
+
+private:
+    Q_DISABLE_COPY(JobGroupPrivate)
+    Q_DECLARE_PUBLIC(JobGroup)
+};
+
+}
+
+#endif // QHR_JOBGROUP_P_H
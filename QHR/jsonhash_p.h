@@ -0,0 +1,33 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_JSONHASH_P_H
+#define QHR_JSONHASH_P_H
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QByteArray>
+
+namespace QHR {
+
+/*
+ * Content hash of a JSON record, used to detect changed records between two
+ * snapshots of a listing without comparing the objects themselves. FNV-1a over
+ * the compact JSON, keys of QJsonObject are always sorted.
+ */
+inline quint64 jsonRecordHash(const QJsonObject &object)
+{
+    const QByteArray data = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+    for (const char c : data) {
+        hash ^= static_cast<quint8>(c);
+        hash *= Q_UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+}
+
+#endif // QHR_JSONHASH_P_H
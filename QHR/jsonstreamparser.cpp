@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "jsonstreamparser_p.h"
+#include <utility>
+
+using namespace QHR;
+
+static inline bool isJsonWhitespace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+JsonStreamParser::JsonStreamParser(ItemHandler handler)
+    : m_handler(std::move(handler))
+{
+
+}
+
+bool JsonStreamParser::feed(const QByteArray &data)
+{
+    const char *it = data.constData();
+    const char *end = it + data.size();
+
+    for (; it != end && m_state != Failed && m_state != Stopped; ++it) {
+        const char c = *it;
+
+        if (m_state == InArray) {
+            if (m_inString) {
+                m_item.append(c);
+                if (m_escaped) {
+                    m_escaped = false;
+                } else if (c == '\\') {
+                    m_escaped = true;
+                } else if (c == '"') {
+                    m_inString = false;
+                }
+                continue;
+            }
+
+            switch (c) {
+            case '"':
+                m_inString = true;
+                m_item.append(c);
+                break;
+            case '{':
+            case '[':
+                ++m_depth;
+                m_item.append(c);
+                break;
+            case '}':
+            case ']':
+                if (m_depth == 0) {
+                    if (c == '}') {
+                        fail(QStringLiteral("unbalanced object end"));
+                    } else if ((!m_item.isEmpty() || m_itemCount > 0) && !flushItem()) {
+                        fail(QStringLiteral("missing value"));
+                    } else if (m_state != Stopped) {
+                        m_state = Finished;
+                    }
+                } else {
+                    --m_depth;
+                    m_item.append(c);
+                }
+                break;
+            case ',':
+                if (m_depth == 0) {
+                    if (!flushItem()) {
+                        fail(QStringLiteral("missing value"));
+                    }
+                } else {
+                    m_item.append(c);
+                }
+                break;
+            default:
+                if (!isJsonWhitespace(c)) {
+                    m_item.append(c);
+                }
+                break;
+            }
+
+        } else if (m_state == Start) {
+            if (c == '[') {
+                m_state = InArray;
+            } else if (!isJsonWhitespace(c)) {
+                fail(QStringLiteral("array expected"));
+            }
+        } else if (m_state == Finished) {
+            if (!isJsonWhitespace(c)) {
+                fail(QStringLiteral("garbage at the end of the document"));
+            }
+        }
+    }
+
+    return m_state != Failed;
+}
+
+bool JsonStreamParser::flushItem()
+{
+    if (m_item.isEmpty()) {
+        return false;
+    }
+
+    ++m_itemCount;
+    if (!m_handler(m_item)) {
+        m_state = Stopped;
+    }
+    m_item.clear();
+
+    return true;
+}
+
+void JsonStreamParser::fail(const QString &errorString)
+{
+    m_state = Failed;
+    m_errorString = errorString;
+    m_item.clear();
+}
@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_JSONSTREAMPARSER_P_H
+#define QHR_JSONSTREAMPARSER_P_H
+
+#include <QByteArray>
+#include <QString>
+#include <functional>
+
+namespace QHR {
+
+/*!
+ * \internal
+ * \brief Splits a JSON array that is received in chunks into its elements.
+ *
+ * The parser only tracks the nesting depth and string state to find the
+ * boundaries of the top level array elements. Every complete element is
+ * handed over to the item handler as raw JSON data without insignificant
+ * whitespace, so only the current element has to be buffered. If the
+ * handler returns \c false, the parser stops and ignores all further data.
+ */
+class JsonStreamParser
+{
+public:
+    enum State : qint8 {
+        Start,
+        InArray,
+        Finished,
+        Failed,
+        Stopped
+    };
+
+    using ItemHandler = std::function<bool(const QByteArray &item)>;
+
+    explicit JsonStreamParser(ItemHandler handler);
+
+    bool feed(const QByteArray &data);
+
+    State state() const { return m_state; }
+
+    int itemCount() const { return m_itemCount; }
+
+    QString errorString() const { return m_errorString; }
+
+private:
+    bool flushItem();
+
+    void fail(const QString &errorString);
+
+    ItemHandler m_handler;
+    QByteArray m_item;
+    QString m_errorString;
+    int m_depth = 0;
+    int m_itemCount = 0;
+    State m_state = Start;
+    bool m_inString = false;
+    bool m_escaped = false;
+};
+
+}
+
+#endif // QHR_JSONSTREAMPARSER_P_H
@@ -0,0 +1,422 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "metrics_p.h"
+#include "job.h"
+#include <QGlobalStatic>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QThreadStorage>
+#include <algorithm>
+
+using namespace QHR;
+
+Q_GLOBAL_STATIC(MetricsRegistry, registry)
+
+constexpr int EndpointStats::bucketCount;
+constexpr int MetricsRegistry::errorSlots;
+
+// upper bucket bounds in microseconds: 5ms ... 10s
+const std::array<quint64, EndpointStats::bucketCount - 1> MetricsRegistry::bucketBounds = {{
+    5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+}};
+
+static const char *phaseNames[EndpointStats::PhaseCount] = {
+    "queue", "tls", "ttfb", "download", "parse", "dispatch"
+};
+
+MetricsRegistry::~MetricsRegistry()
+{
+    qDeleteAll(endpoints);
+}
+
+EndpointStats *MetricsRegistry::stats(const QString &endpoint)
+{
+    // Entries are never removed, so every thread can keep its own lookup
+    // table and only needs the lock when it sees an endpoint the first time.
+    static QThreadStorage<QHash<QString, EndpointStats*>> localStats;
+    QHash<QString, EndpointStats*> &local = localStats.localData();
+
+    EndpointStats *s = local.value(endpoint);
+    if (Q_LIKELY(s)) {
+        return s;
+    }
+
+    {
+        QReadLocker locker(&lock);
+        s = endpoints.value(endpoint);
+    }
+
+    if (!s) {
+        QWriteLocker locker(&lock);
+        s = endpoints.value(endpoint);
+        if (!s) {
+            s = new EndpointStats(endpoint);
+            endpoints.insert(endpoint, s);
+        }
+    }
+
+    local.insert(endpoint, s);
+    return s;
+}
+
+void MetricsRegistry::countError(int error)
+{
+    int slot = errorSlots - 1;
+    if (error == BJob::KilledJobError) {
+        slot = 0;
+    } else if (error > BJob::UserDefinedError && error - BJob::UserDefinedError < errorSlots - 1) {
+        slot = error - BJob::UserDefinedError;
+    }
+    errors[static_cast<size_t>(slot)].fetch_add(1, std::memory_order_relaxed);
+}
+
+bool JobMetrics::start()
+{
+    active = registry()->enabled.load(std::memory_order_relaxed);
+    if (active) {
+        marks.fill(-1);
+        parseStart = -1;
+        parseTime = -1;
+        dispatchStart = -1;
+        bytesSent = 0;
+        bytesReceived = 0;
+        attempts = 0;
+        fromCache = false;
+        coalesced = false;
+        timer.start();
+    }
+    return active;
+}
+
+void JobMetrics::mark(Mark m)
+{
+    if (active) {
+        const qint64 now = timer.nsecsElapsed() / 1000;
+        // only the first time the job waited in the queue is of interest
+        if (m != Queued || marks[Queued] < 0) {
+            marks[m] = now;
+        }
+        if (m == Dispatched) {
+            ++attempts;
+            marks[Encrypted] = -1;
+            marks[FirstByte] = -1;
+        }
+    }
+}
+
+void JobMetrics::beginParse()
+{
+    if (active) {
+        parseStart = timer.nsecsElapsed() / 1000;
+    }
+}
+
+void JobMetrics::endParse()
+{
+    if (active && parseStart >= 0) {
+        parseTime = timer.nsecsElapsed() / 1000 - parseStart;
+    }
+}
+
+void JobMetrics::beginDispatch()
+{
+    if (active) {
+        dispatchStart = timer.nsecsElapsed() / 1000;
+    }
+}
+
+void JobMetrics::count(std::atomic<quint64> MetricsRegistry::*counter)
+{
+    MetricsRegistry *r = registry();
+    if (r->enabled.load(std::memory_order_relaxed)) {
+        (r->*counter).fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void JobMetrics::finish(const Job *job, const QString &endpoint, int error)
+{
+    if (!active) {
+        return;
+    }
+    active = false;
+
+    const qint64 now = timer.nsecsElapsed() / 1000;
+
+    JobTimings t;
+    t.endpoint = endpoint;
+    if (marks[Queued] >= 0 && marks[Dispatched] >= 0) {
+        t.queueTime = marks[Dispatched] - marks[Queued];
+    }
+    if (marks[Dispatched] >= 0) {
+        if (marks[Encrypted] >= 0) {
+            t.tlsTime = marks[Encrypted] - marks[Dispatched];
+        }
+        if (marks[FirstByte] >= 0) {
+            t.timeToFirstByte = marks[FirstByte] - marks[Dispatched];
+            if (marks[Finished] >= 0) {
+                t.downloadTime = marks[Finished] - marks[FirstByte];
+            }
+        }
+    }
+    t.parseTime = parseTime;
+    if (dispatchStart >= 0) {
+        t.dispatchTime = now - dispatchStart;
+    }
+    t.totalTime = now;
+    t.bytesSent = bytesSent;
+    t.bytesReceived = bytesReceived;
+    t.error = error;
+    t.attempts = attempts;
+    t.fromCache = fromCache;
+    t.coalesced = coalesced;
+
+    MetricsRegistry *r = registry();
+    EndpointStats *s = r->stats(endpoint);
+
+    s->requests.fetch_add(1, std::memory_order_relaxed);
+    s->bytesSent.fetch_add(static_cast<quint64>(bytesSent), std::memory_order_relaxed);
+    s->bytesReceived.fetch_add(static_cast<quint64>(bytesReceived), std::memory_order_relaxed);
+    s->latencySum.fetch_add(static_cast<quint64>(now), std::memory_order_relaxed);
+
+    size_t bucket = 0;
+    while (bucket < MetricsRegistry::bucketBounds.size() && static_cast<quint64>(now) > MetricsRegistry::bucketBounds[bucket]) {
+        ++bucket;
+    }
+    s->buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    s->addPhase(EndpointStats::QueuePhase, t.queueTime);
+    s->addPhase(EndpointStats::TlsPhase, t.tlsTime);
+    s->addPhase(EndpointStats::FirstBytePhase, t.timeToFirstByte);
+    s->addPhase(EndpointStats::DownloadPhase, t.downloadTime);
+    s->addPhase(EndpointStats::ParsePhase, t.parseTime);
+    s->addPhase(EndpointStats::DispatchPhase, t.dispatchTime);
+
+    if (error != BJob::NoError) {
+        s->errors.fetch_add(1, std::memory_order_relaxed);
+        r->countError(error);
+    }
+
+    JobObserver *o = r->observer.load(std::memory_order_acquire);
+    if (o) {
+        o->jobFinished(job, t);
+    }
+}
+
+JobObserver::~JobObserver() = default;
+
+bool Metrics::isEnabled()
+{
+    return registry()->enabled.load(std::memory_order_relaxed);
+}
+
+void Metrics::setEnabled(bool enabled)
+{
+    qCDebug(qhrCore) << "Setting metrics collection to" << enabled;
+    registry()->enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Metrics::setObserver(JobObserver *observer)
+{
+    registry()->observer.store(observer, std::memory_order_release);
+}
+
+QVector<quint64> Metrics::latencyBucketBounds()
+{
+    QVector<quint64> bounds;
+    bounds.reserve(static_cast<int>(MetricsRegistry::bucketBounds.size()));
+    for (quint64 b : MetricsRegistry::bucketBounds) {
+        bounds.push_back(b);
+    }
+    return bounds;
+}
+
+MetricsSnapshot Metrics::snapshot()
+{
+    MetricsRegistry *r = registry();
+    MetricsSnapshot snap;
+
+    {
+        QReadLocker locker(&r->lock);
+        snap.endpoints.reserve(r->endpoints.size());
+        for (const EndpointStats *s : qAsConst(r->endpoints)) {
+            EndpointMetrics em;
+            em.endpoint = s->name;
+            em.requests = s->requests.load(std::memory_order_relaxed);
+            em.errors = s->errors.load(std::memory_order_relaxed);
+            em.bytesSent = s->bytesSent.load(std::memory_order_relaxed);
+            em.bytesReceived = s->bytesReceived.load(std::memory_order_relaxed);
+            em.latencySum = s->latencySum.load(std::memory_order_relaxed);
+            em.latencyBuckets.reserve(EndpointStats::bucketCount);
+            for (const auto &b : s->buckets) {
+                em.latencyBuckets.push_back(b.load(std::memory_order_relaxed));
+            }
+            for (int i = 0; i < EndpointStats::PhaseCount; ++i) {
+                const quint64 count = s->phaseCounts[static_cast<size_t>(i)].load(std::memory_order_relaxed);
+                if (count > 0) {
+                    const QString phase = QString::fromLatin1(phaseNames[i]);
+                    em.phaseSums.insert(phase, s->phaseSums[static_cast<size_t>(i)].load(std::memory_order_relaxed));
+                    em.phaseCounts.insert(phase, count);
+                }
+            }
+            snap.endpoints.push_back(em);
+        }
+    }
+
+    std::sort(snap.endpoints.begin(), snap.endpoints.end(), [](const EndpointMetrics &a, const EndpointMetrics &b){
+        return a.endpoint < b.endpoint;
+    });
+
+    for (int i = 0; i < MetricsRegistry::errorSlots; ++i) {
+        const quint64 count = r->errors[static_cast<size_t>(i)].load(std::memory_order_relaxed);
+        if (count > 0) {
+            int code = -1;
+            if (i == 0) {
+                code = BJob::KilledJobError;
+            } else if (i < MetricsRegistry::errorSlots - 1) {
+                code = BJob::UserDefinedError + i;
+            }
+            snap.errors.insert(code, count);
+        }
+    }
+
+    snap.cacheHits = r->cacheHits.load(std::memory_order_relaxed);
+    snap.cacheMisses = r->cacheMisses.load(std::memory_order_relaxed);
+    snap.coalesced = r->coalesced.load(std::memory_order_relaxed);
+    snap.queued = r->queued.load(std::memory_order_relaxed);
+    snap.retries = r->retries.load(std::memory_order_relaxed);
+
+    return snap;
+}
+
+static QByteArray seconds(quint64 usecs)
+{
+    return QByteArray::number(static_cast<double>(usecs) / 1000000.0, 'g', 10);
+}
+
+static QByteArray escapeLabel(const QString &value)
+{
+    QByteArray escaped = value.toUtf8();
+    escaped.replace('\\', "\\\\");
+    escaped.replace('"', "\\\"");
+    escaped.replace('\n', "\\n");
+    return escaped;
+}
+
+QByteArray Metrics::toPrometheus()
+{
+    const MetricsSnapshot snap = snapshot();
+    const QVector<quint64> bounds = latencyBucketBounds();
+
+    QByteArray out;
+    out.reserve(4096);
+
+    out += "# HELP qhr_requests_total Number of finished API jobs.\n"
+           "# TYPE qhr_requests_total counter\n";
+    for (const EndpointMetrics &em : snap.endpoints) {
+        out += "qhr_requests_total{endpoint=\"" + escapeLabel(em.endpoint) + "\"} " + QByteArray::number(em.requests) + '\n';
+    }
+
+    out += "# HELP qhr_request_errors_total Number of failed API jobs.\n"
+           "# TYPE qhr_request_errors_total counter\n";
+    for (const EndpointMetrics &em : snap.endpoints) {
+        out += "qhr_request_errors_total{endpoint=\"" + escapeLabel(em.endpoint) + "\"} " + QByteArray::number(em.errors) + '\n';
+    }
+
+    out += "# HELP qhr_request_bytes_total Number of sent payload bytes.\n"
+           "# TYPE qhr_request_bytes_total counter\n";
+    for (const EndpointMetrics &em : snap.endpoints) {
+        out += "qhr_request_bytes_total{endpoint=\"" + escapeLabel(em.endpoint) + "\"} " + QByteArray::number(em.bytesSent) + '\n';
+    }
+
+    out += "# HELP qhr_response_bytes_total Number of received body bytes.\n"
+           "# TYPE qhr_response_bytes_total counter\n";
+    for (const EndpointMetrics &em : snap.endpoints) {
+        out += "qhr_response_bytes_total{endpoint=\"" + escapeLabel(em.endpoint) + "\"} " + QByteArray::number(em.bytesReceived) + '\n';
+    }
+
+    out += "# HELP qhr_request_duration_seconds Total duration of API jobs.\n"
+           "# TYPE qhr_request_duration_seconds histogram\n";
+    for (const EndpointMetrics &em : snap.endpoints) {
+        const QByteArray label = escapeLabel(em.endpoint);
+        quint64 cumulative = 0;
+        for (int i = 0; i < em.latencyBuckets.size(); ++i) {
+            cumulative += em.latencyBuckets.at(i);
+            const QByteArray le = i < bounds.size() ? seconds(bounds.at(i)) : QByteArrayLiteral("+Inf");
+            out += "qhr_request_duration_seconds_bucket{endpoint=\"" + label + "\",le=\"" + le + "\"} " + QByteArray::number(cumulative) + '\n';
+        }
+        out += "qhr_request_duration_seconds_sum{endpoint=\"" + label + "\"} " + seconds(em.latencySum) + '\n';
+        out += "qhr_request_duration_seconds_count{endpoint=\"" + label + "\"} " + QByteArray::number(em.requests) + '\n';
+    }
+
+    out += "# HELP qhr_phase_duration_seconds Duration of the single phases of API jobs.\n"
+           "# TYPE qhr_phase_duration_seconds summary\n";
+    for (const EndpointMetrics &em : snap.endpoints) {
+        const QByteArray label = escapeLabel(em.endpoint);
+        for (auto i = em.phaseSums.constBegin(); i != em.phaseSums.constEnd(); ++i) {
+            const QByteArray phase = i.key().toLatin1();
+            out += "qhr_phase_duration_seconds_sum{endpoint=\"" + label + "\",phase=\"" + phase + "\"} " + seconds(i.value()) + '\n';
+            out += "qhr_phase_duration_seconds_count{endpoint=\"" + label + "\",phase=\"" + phase + "\"} " + QByteArray::number(em.phaseCounts.value(i.key())) + '\n';
+        }
+    }
+
+    out += "# HELP qhr_errors_total Number of failed API jobs by error code.\n"
+           "# TYPE qhr_errors_total counter\n";
+    for (auto i = snap.errors.constBegin(); i != snap.errors.constEnd(); ++i) {
+        out += "qhr_errors_total{code=\"" + QByteArray::number(i.key()) + "\"} " + QByteArray::number(i.value()) + '\n';
+    }
+
+    out += "# HELP qhr_cache_hits_total Number of jobs finished from the response cache.\n"
+           "# TYPE qhr_cache_hits_total counter\n"
+           "qhr_cache_hits_total " + QByteArray::number(snap.cacheHits) + '\n';
+    out += "# HELP qhr_cache_misses_total Number of GET jobs without cached response.\n"
+           "# TYPE qhr_cache_misses_total counter\n"
+           "qhr_cache_misses_total " + QByteArray::number(snap.cacheMisses) + '\n';
+    out += "# HELP qhr_coalesced_total Number of jobs that shared an identical running request.\n"
+           "# TYPE qhr_coalesced_total counter\n"
+           "qhr_coalesced_total " + QByteArray::number(snap.coalesced) + '\n';
+    out += "# HELP qhr_queued_total Number of times jobs have been queued because of the request limit.\n"
+           "# TYPE qhr_queued_total counter\n"
+           "qhr_queued_total " + QByteArray::number(snap.queued) + '\n';
+    out += "# HELP qhr_retries_total Number of retried requests.\n"
+           "# TYPE qhr_retries_total counter\n"
+           "qhr_retries_total " + QByteArray::number(snap.retries) + '\n';
+
+    return out;
+}
+
+void Metrics::reset()
+{
+    MetricsRegistry *r = registry();
+
+    {
+        QReadLocker locker(&r->lock);
+        for (EndpointStats *s : qAsConst(r->endpoints)) {
+            s->requests.store(0, std::memory_order_relaxed);
+            s->errors.store(0, std::memory_order_relaxed);
+            s->bytesSent.store(0, std::memory_order_relaxed);
+            s->bytesReceived.store(0, std::memory_order_relaxed);
+            s->latencySum.store(0, std::memory_order_relaxed);
+            for (auto &b : s->buckets) {
+                b.store(0, std::memory_order_relaxed);
+            }
+            for (auto &p : s->phaseSums) {
+                p.store(0, std::memory_order_relaxed);
+            }
+            for (auto &p : s->phaseCounts) {
+                p.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    for (auto &e : r->errors) {
+        e.store(0, std::memory_order_relaxed);
+    }
+    r->cacheHits.store(0, std::memory_order_relaxed);
+    r->cacheMisses.store(0, std::memory_order_relaxed);
+    r->coalesced.store(0, std::memory_order_relaxed);
+    r->queued.store(0, std::memory_order_relaxed);
+    r->retries.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,158 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_METRICS_H
+#define QHR_METRICS_H
+
+#include <QString>
+#include <QVector>
+#include <QMap>
+#include "qhr_global.h"
+
+namespace QHR {
+
+class Job;
+
+/*!
+ * \brief Timing and size information about a single finished job.
+ *
+ * All durations are in microseconds. Durations for phases that did not
+ * happen, like the TLS handshake on a reused connection or all network
+ * phases for a cached response, are set to \c -1.
+ *
+ * QNetworkAccessManager does not report host lookup and TCP connect times
+ * separately, so they are part of timeToFirstByte.
+ */
+struct QHR_LIBRARY JobTimings
+{
+    QString endpoint;               /**< The API endpoint like <CODE>GET /server</CODE>. */
+    qint64 queueTime = -1;          /**< Time spent waiting for the request limit. */
+    qint64 tlsTime = -1;            /**< Time from sending the request until the connection was encrypted. */
+    qint64 timeToFirstByte = -1;    /**< Time from sending the request until the response headers arrived. */
+    qint64 downloadTime = -1;       /**< Time from the response headers until the reply was finished. */
+    qint64 parseTime = -1;          /**< Time spent checking and parsing the reply data. */
+    qint64 dispatchTime = -1;       /**< Time spent emitting the result signals. */
+    qint64 totalTime = -1;          /**< Time from starting the request until the job finished. */
+    qint64 bytesSent = 0;           /**< Size of the request payload. */
+    qint64 bytesReceived = 0;       /**< Size of the response body. */
+    int error = 0;                  /**< The error code of the job, \c 0 on success. */
+    int attempts = 0;               /**< Number of sent requests including retries. */
+    bool fromCache = false;         /**< \c true if the result was taken from the ResponseCache. */
+    bool coalesced = false;         /**< \c true if the result was shared by another running job. */
+};
+
+/*!
+ * \brief Interface for classes that want to get informed about finished jobs.
+ *
+ * Set an implementation via Metrics::setObserver(). The observer will be called
+ * in the thread of the finished job, so implementations have to be thread-safe
+ * if jobs are used in multiple threads.
+ *
+ * \headerfile "" <QHR/Metrics>
+ */
+class QHR_LIBRARY JobObserver
+{
+public:
+    /*!
+     * \brief Destroys the %JobObserver object.
+     */
+    virtual ~JobObserver();
+
+    /*!
+     * \brief Will be called when a \a job has been finished.
+     *
+     * \a timings contains information about the phases of the job.
+     */
+    virtual void jobFinished(const Job *job, const JobTimings &timings) = 0;
+};
+
+/*!
+ * \brief Aggregated metrics of a single API endpoint.
+ */
+struct QHR_LIBRARY EndpointMetrics
+{
+    QString endpoint;                   /**< The API endpoint like <CODE>GET /server</CODE>. */
+    quint64 requests = 0;               /**< Number of finished jobs. */
+    quint64 errors = 0;                 /**< Number of failed jobs. */
+    quint64 bytesSent = 0;              /**< Sum of sent payload bytes. */
+    quint64 bytesReceived = 0;          /**< Sum of received body bytes. */
+    quint64 latencySum = 0;             /**< Sum of the total job durations in microseconds. */
+    QVector<quint64> latencyBuckets;    /**< Number of jobs per Metrics::latencyBucketBounds(), the last bucket counts all slower jobs. */
+    QMap<QString, quint64> phaseSums;   /**< Sum of the phase durations in microseconds by phase name. */
+    QMap<QString, quint64> phaseCounts; /**< Number of measured phase durations by phase name. */
+};
+
+/*!
+ * \brief Snapshot of all collected metrics.
+ */
+struct QHR_LIBRARY MetricsSnapshot
+{
+    QVector<EndpointMetrics> endpoints; /**< Metrics per endpoint. */
+    QMap<int, quint64> errors;          /**< Number of failed jobs by error code. */
+    quint64 cacheHits = 0;              /**< Number of jobs finished from the ResponseCache. */
+    quint64 cacheMisses = 0;            /**< Number of GET jobs that did not find a cached response. */
+    quint64 coalesced = 0;              /**< Number of jobs that waited for an identical running request. */
+    quint64 queued = 0;                 /**< Number of times a job has been queued because of the request limit. */
+    quint64 retries = 0;                /**< Number of retried requests. */
+};
+
+/*!
+ * \brief Collects metrics about all jobs.
+ *
+ * Collecting metrics is disabled by default and can be enabled via setEnabled().
+ * Counters are updated with atomic operations only, so collecting is cheap and does
+ * not take any lock on the hot path. Use snapshot() to get the current values or
+ * toPrometheus() to get them in the Prometheus text exposition format.
+ *
+ * \headerfile "" <QHR/Metrics>
+ */
+class QHR_LIBRARY Metrics
+{
+public:
+    /*!
+     * \brief Returns \c true if metrics are collected.
+     */
+    static bool isEnabled();
+
+    /*!
+     * \brief Set \a enabled to \c true to collect metrics.
+     */
+    static void setEnabled(bool enabled);
+
+    /*!
+     * \brief Sets an \a observer that will be called for every finished job.
+     *
+     * The \a observer will only be called if metrics are enabled. The library
+     * does not take ownership. Set \c nullptr to remove the observer.
+     */
+    static void setObserver(JobObserver *observer);
+
+    /*!
+     * \brief Returns the upper bounds of the latency histogram buckets in microseconds.
+     */
+    static QVector<quint64> latencyBucketBounds();
+
+    /*!
+     * \brief Returns a snapshot of the current metrics.
+     */
+    static MetricsSnapshot snapshot();
+
+    /*!
+     * \brief Returns the current metrics in the Prometheus text exposition format.
+     */
+    static QByteArray toPrometheus();
+
+    /*!
+     * \brief Resets all counters to \c 0.
+     */
+    static void reset();
+
+private:
+    Metrics() = delete;
+};
+
+}
+
+#endif // QHR_METRICS_H
@@ -0,0 +1,127 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_METRICS_P_H
+#define QHR_METRICS_P_H
+
+#include "metrics.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QReadWriteLock>
+#include <array>
+#include <atomic>
+
+namespace QHR {
+
+class EndpointStats
+{
+public:
+    enum Phase : int {
+        QueuePhase = 0,
+        TlsPhase,
+        FirstBytePhase,
+        DownloadPhase,
+        ParsePhase,
+        DispatchPhase,
+        PhaseCount
+    };
+
+    static constexpr int bucketCount = 12;
+
+    explicit EndpointStats(const QString &_name) : name(_name) {}
+
+    void addPhase(Phase phase, qint64 usecs)
+    {
+        if (usecs >= 0) {
+            phaseSums[phase].fetch_add(static_cast<quint64>(usecs), std::memory_order_relaxed);
+            phaseCounts[phase].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    const QString name;
+    std::atomic<quint64> requests{0};
+    std::atomic<quint64> errors{0};
+    std::atomic<quint64> bytesSent{0};
+    std::atomic<quint64> bytesReceived{0};
+    std::atomic<quint64> latencySum{0};
+    std::array<std::atomic<quint64>, bucketCount> buckets{};
+    std::array<std::atomic<quint64>, PhaseCount> phaseSums{};
+    std::array<std::atomic<quint64>, PhaseCount> phaseCounts{};
+};
+
+class MetricsRegistry
+{
+public:
+    static constexpr int errorSlots = 65;
+
+    ~MetricsRegistry();
+
+    EndpointStats *stats(const QString &endpoint);
+
+    void countError(int error);
+
+    static const std::array<quint64, EndpointStats::bucketCount - 1> bucketBounds;
+
+    std::atomic<bool> enabled{false};
+    std::atomic<JobObserver*> observer{nullptr};
+    std::atomic<quint64> cacheHits{0};
+    std::atomic<quint64> cacheMisses{0};
+    std::atomic<quint64> coalesced{0};
+    std::atomic<quint64> queued{0};
+    std::atomic<quint64> retries{0};
+    std::array<std::atomic<quint64>, errorSlots> errors{};
+
+    QReadWriteLock lock;
+    QHash<QString, EndpointStats*> endpoints;
+};
+
+/*!
+ * \internal
+ * \brief Records the phase timestamps of a single job.
+ */
+class JobMetrics
+{
+public:
+    enum Mark : int {
+        Queued = 0,
+        Dispatched,
+        Encrypted,
+        FirstByte,
+        Finished,
+        MarkCount
+    };
+
+    bool start();
+
+    bool isActive() const { return active; }
+
+    void mark(Mark m);
+
+    void beginParse();
+
+    void endParse();
+
+    void beginDispatch();
+
+    void finish(const Job *job, const QString &endpoint, int error);
+
+    static void count(std::atomic<quint64> MetricsRegistry::*counter);
+
+    QElapsedTimer timer;
+    std::array<qint64, MarkCount> marks{};
+    qint64 parseStart = -1;
+    qint64 parseTime = -1;
+    qint64 dispatchStart = -1;
+    qint64 bytesSent = 0;
+    qint64 bytesReceived = 0;
+    int attempts = 0;
+    bool active = false;
+    bool fromCache = false;
+    bool coalesced = false;
+};
+
+}
+
+#endif // QHR_METRICS_P_H
@@ -0,0 +1,423 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "poweractionjob_p.h"
+#include "endpoints.h"
+#include "job.h"
+#include "logging.h"
+#include <QTimer>
+#include <QJsonValue>
+#include <algorithm>
+
+using namespace QHR;
+
+PowerActionJobPrivate::PowerActionJobPrivate(PowerActionJob *q)
+    : q_ptr(q)
+{
+
+}
+
+PowerActionJobPrivate::~PowerActionJobPrivate() = default;
+
+QHash<int, QStringList> PowerActionJobPrivate::resetTypes(const QJsonArray &listing)
+{
+    QHash<int, QStringList> types;
+    types.reserve(listing.size());
+    for (const QJsonValue &v : listing) {
+        const QJsonObject json = v.toObject();
+        const QJsonValue wrapped = json.value(QStringLiteral("reset"));
+        const QJsonObject reset = wrapped.isObject() ? wrapped.toObject() : json;
+        const int serverNumber = reset.value(QStringLiteral("server_number")).toInt();
+        if (serverNumber <= 0) {
+            continue;
+        }
+        QStringList &serverTypes = types[serverNumber];
+        const QJsonArray typeArray = reset.value(QStringLiteral("type")).toArray();
+        serverTypes.reserve(typeArray.size());
+        for (const QJsonValue &type : typeArray) {
+            serverTypes.append(type.toString());
+        }
+    }
+    return types;
+}
+
+void PowerActionJobPrivate::emitDescription()
+{
+    Q_Q(PowerActionJob);
+
+    QString _title;
+    if (action == PowerActionJob::WakeOnLan) {
+        //: Job title
+        //% "Waking servers"
+        _title = qtTrId("libqhr-job-desc-power-action-wol-title");
+    } else {
+        //: Job title
+        //% "Resetting servers"
+        _title = qtTrId("libqhr-job-desc-power-action-reset-title");
+    }
+
+    Q_EMIT q->description(q, _title);
+}
+
+void PowerActionJobPrivate::fetchResetListing()
+{
+    Q_Q(PowerActionJob);
+
+    // a normal job, so that the listing is taken from the response cache if possible
+    Job *job = makeJob<Endpoints::ResetList>(q);
+    if (configuration) {
+        job->setConfiguration(configuration);
+    }
+    listingJob = job;
+    QObject::connect(job, &BJob::finished, q, [this](BJob *j){
+        listingFinished(static_cast<Job*>(j));
+    });
+    job->start();
+}
+
+void PowerActionJobPrivate::listingFinished(Job *job)
+{
+    listingJob.clear();
+
+    if (killed) {
+        return;
+    }
+
+    if (job->error() != BJob::NoError) {
+        Q_Q(PowerActionJob);
+        qCWarning(qhrCore) << "Failed to get reset listing, sending resets without checking the reset types:" << job->errorString();
+        //: Warning message, %1 will be replaced by the error message.
+        //% "The reset options could not be requested, the reset types will not be checked: %1"
+        Q_EMIT q->warning(q, qtTrId("libqhr-warn-power-action-reset-listing-failed").arg(job->errorString()));
+        dispatch(nullptr);
+        return;
+    }
+
+    const QHash<int, QStringList> allowedTypes = resetTypes(job->result().array());
+    dispatch(&allowedTypes);
+}
+
+void PowerActionJobPrivate::dispatch(const QHash<int, QStringList> *allowedTypes)
+{
+    if (!executor) {
+        executor.reset(new RequestExecutor(configuration));
+    }
+    executor->setMaxInFlight(maxInFlight);
+
+    QVector<Request> requests;
+    requests.reserve(targets.size());
+    QVector<PowerActionResult> skippedResults;
+
+    for (int i = 0; i < targets.size(); ++i) {
+        const PowerActionTarget &target = targets.at(i);
+
+        Request request;
+        if (action == PowerActionJob::WakeOnLan) {
+            request = makeRequest<Endpoints::WolSend>(target.serverNumber);
+        } else {
+            if (allowedTypes) {
+                const auto found = allowedTypes->constFind(target.serverNumber);
+                if (found == allowedTypes->cend() || !found.value().contains(target.resetType)) {
+                    PowerActionResult result;
+                    result.serverNumber = target.serverNumber;
+                    result.resetType = target.resetType;
+                    result.error = InvalidInput;
+                    result.skipped = true;
+                    //: Error message, %1 will be replaced by the reset type, %2 by the server number.
+                    //% "Reset type “%1” is not available for server %2."
+                    result.errorString = qtTrId("libqhr-error-power-action-reset-type-not-available").arg(target.resetType, QString::number(target.serverNumber));
+                    skippedResults.push_back(result);
+                    continue;
+                }
+            }
+            request = makeRequest<Endpoints::ResetExecute>(target.serverNumber);
+            request.form.addQueryItem(QStringLiteral("type"), target.resetType);
+        }
+        request.tag = static_cast<quint64>(i);
+        requests.push_back(request);
+    }
+
+    qCDebug(qhrCore) << "Sending" << requests.size() << "power actions," << skippedResults.size() << "skipped";
+
+    remaining = requests.size();
+
+    for (const PowerActionResult &result : skippedResults) {
+        report(result);
+        if (killed) {
+            return;
+        }
+    }
+
+    if (requests.empty()) {
+        finish();
+        return;
+    }
+
+    executor->submit(requests, [this](const Response &response){
+        actionFinished(static_cast<int>(response.tag), response);
+    });
+}
+
+void PowerActionJobPrivate::actionFinished(int index, const Response &response)
+{
+    const PowerActionTarget &target = targets.at(index);
+
+    PowerActionResult result;
+    result.serverNumber = target.serverNumber;
+    if (action == PowerActionJob::Reset) {
+        result.resetType = target.resetType;
+    }
+    result.error = response.error;
+    result.errorString = response.errorString;
+    result.apiErrorCode = response.apiErrorCode;
+    result.httpStatus = response.httpStatus;
+    if (response.isOk()) {
+        const QJsonObject json = response.json.object();
+        const QJsonValue wrapped = json.value(action == PowerActionJob::WakeOnLan ? QStringLiteral("wol") : QStringLiteral("reset"));
+        result.reply = wrapped.isObject() ? wrapped.toObject() : json;
+    } else {
+        qCWarning(qhrCore) << "Power action for server" << target.serverNumber << "failed:" << response.errorString;
+    }
+
+    --remaining;
+    report(result);
+
+    if (remaining == 0 && !killed) {
+        finish();
+    }
+}
+
+void PowerActionJobPrivate::report(const PowerActionResult &result)
+{
+    Q_Q(PowerActionJob);
+
+    if (result.skipped) {
+        ++skipped;
+    } else if (result.isOk()) {
+        ++succeeded;
+    } else {
+        ++failed;
+    }
+    results.push_back(result);
+
+    const auto processed = static_cast<qulonglong>(results.size());
+    q->setProcessedAmount(BJob::Items, processed);
+    q->emitPercent(processed, static_cast<qulonglong>(targets.size()));
+
+    Q_EMIT q->serverFinished(result);
+}
+
+void PowerActionJobPrivate::finish()
+{
+    Q_Q(PowerActionJob);
+
+    if (q->isFinished()) {
+        return;
+    }
+
+    if (failed + skipped > 0) {
+        q->setError(SubJobsFailed);
+        const auto firstFailed = std::find_if(results.cbegin(), results.cend(), [](const PowerActionResult &r){
+            return !r.isOk();
+        });
+        q->setErrorText(firstFailed->errorString);
+        qCWarning(qhrCore) << failed << "power actions failed and" << skipped << "have been skipped of" << targets.size();
+    }
+
+    q->emitResult();
+}
+
+PowerActionJob::PowerActionJob(Action action, QObject *parent)
+    : BJob(parent), pad_ptr(new PowerActionJobPrivate(this))
+{
+    Q_D(PowerActionJob);
+    d->action = action;
+    setCapabilities(Killable);
+}
+
+PowerActionJob::~PowerActionJob() = default;
+
+void PowerActionJob::setConfiguration(AbstractConfiguration *configuration)
+{
+    Q_D(PowerActionJob);
+    d->configuration = configuration;
+}
+
+void PowerActionJob::addServer(int serverNumber, const QString &resetType)
+{
+    Q_D(PowerActionJob);
+
+    if (Q_UNLIKELY(d->started)) {
+        qCWarning(qhrCore) << "Can not add server" << serverNumber << "to already started power action job" << this;
+        return;
+    }
+
+    if (Q_UNLIKELY(serverNumber <= 0)) {
+        qCWarning(qhrCore) << "Skipping invalid server number" << serverNumber << "in power action job" << this;
+        return;
+    }
+
+    if (d->serverNumbers.contains(serverNumber)) {
+        qCDebug(qhrCore) << "Server" << serverNumber << "already added to power action job" << this;
+        return;
+    }
+
+    d->serverNumbers.insert(serverNumber);
+    PowerActionTarget target;
+    target.serverNumber = serverNumber;
+    target.resetType = resetType;
+    d->targets.push_back(target);
+}
+
+void PowerActionJob::addServers(const QVector<int> &serverNumbers)
+{
+    Q_D(PowerActionJob);
+    d->targets.reserve(d->targets.size() + serverNumbers.size());
+    for (int serverNumber : serverNumbers) {
+        addServer(serverNumber);
+    }
+}
+
+QVector<int> PowerActionJob::servers() const
+{
+    Q_D(const PowerActionJob);
+    QVector<int> numbers;
+    numbers.reserve(d->targets.size());
+    for (const PowerActionTarget &target : d->targets) {
+        numbers.push_back(target.serverNumber);
+    }
+    return numbers;
+}
+
+QVector<PowerActionResult> PowerActionJob::results() const
+{
+    Q_D(const PowerActionJob);
+    return d->results;
+}
+
+int PowerActionJob::succeededCount() const
+{
+    Q_D(const PowerActionJob);
+    return d->succeeded;
+}
+
+int PowerActionJob::failedCount() const
+{
+    Q_D(const PowerActionJob);
+    return d->failed;
+}
+
+int PowerActionJob::skippedCount() const
+{
+    Q_D(const PowerActionJob);
+    return d->skipped;
+}
+
+PowerActionJob::Action PowerActionJob::action() const
+{
+    Q_D(const PowerActionJob);
+    return d->action;
+}
+
+void PowerActionJob::setAction(Action action)
+{
+    Q_D(PowerActionJob);
+    d->action = action;
+}
+
+QString PowerActionJob::defaultResetType() const
+{
+    Q_D(const PowerActionJob);
+    return d->defaultResetType;
+}
+
+void PowerActionJob::setDefaultResetType(const QString &defaultResetType)
+{
+    Q_D(PowerActionJob);
+    d->defaultResetType = defaultResetType;
+}
+
+int PowerActionJob::maxInFlight() const
+{
+    Q_D(const PowerActionJob);
+    return d->maxInFlight;
+}
+
+void PowerActionJob::setMaxInFlight(int maxInFlight)
+{
+    Q_D(PowerActionJob);
+    d->maxInFlight = std::max(1, maxInFlight);
+    if (d->executor) {
+        d->executor->setMaxInFlight(d->maxInFlight);
+    }
+}
+
+bool PowerActionJob::checkResetTypes() const
+{
+    Q_D(const PowerActionJob);
+    return d->checkResetTypes;
+}
+
+void PowerActionJob::setCheckResetTypes(bool checkResetTypes)
+{
+    Q_D(PowerActionJob);
+    d->checkResetTypes = checkResetTypes;
+}
+
+void PowerActionJob::start()
+{
+    Q_D(PowerActionJob);
+
+    if (d->started) {
+        return;
+    }
+    d->started = true;
+
+    for (PowerActionTarget &target : d->targets) {
+        if (target.resetType.isEmpty()) {
+            target.resetType = d->defaultResetType;
+        }
+    }
+
+    setTotalAmount(BJob::Items, static_cast<qulonglong>(d->targets.size()));
+
+    QTimer::singleShot(0, this, [d](){
+        d->emitDescription();
+        if (d->targets.empty()) {
+            d->finish();
+        } else if (d->action == Reset && d->checkResetTypes) {
+            d->fetchResetListing();
+        } else {
+            d->dispatch(nullptr);
+        }
+    });
+}
+
+bool PowerActionJob::doKill()
+{
+    Q_D(PowerActionJob);
+    d->killed = true;
+    if (d->executor) {
+        d->executor->abortAll();
+    }
+    if (d->listingJob) {
+        d->listingJob->kill(BJob::Quietly);
+    }
+    return true;
+}
+
+QString PowerActionJob::errorString() const
+{
+    Q_D(const PowerActionJob);
+    if (error() == SubJobsFailed) {
+        //: Error message, %1 will be replaced by the number of failed servers, %2 by the number
+        //: of skipped servers, %3 by the number of all servers and %4 by the first error message.
+        //% "Power actions failed for %1 and have been skipped for %2 of %3 servers. First error: %4"
+        return qtTrId("libqhr-error-power-actions-failed").arg(QString::number(d->failed), QString::number(d->skipped), QString::number(d->targets.size()), errorText());
+    }
+    return BJob::errorString();
+}
+
+#include "moc_poweractionjob.cpp"
@@ -0,0 +1,254 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_POWERACTIONJOB_H
+#define QHR_POWERACTIONJOB_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QJsonObject>
+#include <QMetaType>
+#include "qhr_global.h"
+#include "bjob.h"
+#include <memory>
+
+namespace QHR {
+
+class PowerActionJobPrivate;
+class AbstractConfiguration;
+
+/*!
+ * \brief Outcome of the power action for a single server of a PowerActionJob.
+ *
+ * \headerfile "" <QHR/PowerActionJob>
+ */
+struct PowerActionResult
+{
+    QString resetType;      /**< The requested reset type, empty for Wake-on-LAN. */
+    QJsonObject reply;      /**< The reset or wol object returned by the API on success. */
+    QString errorString;    /**< Human readable and translated error string. */
+    QString apiErrorCode;   /**< Error code returned by the API, like \c "RESET_FAILED". */
+    int serverNumber = 0;
+    int error = 0;          /**< BJob::NoError or one of the error codes of Job. */
+    int httpStatus = 0;
+    bool skipped = false;   /**< \c true if no request has been sent because the reset type is not available for the server. */
+
+    bool isOk() const { return error == 0; }
+};
+
+/*!
+ * \brief Resets or wakes many servers at once.
+ *
+ * Add the servers via addServer() and start the job. Depending on the
+ * \link PowerActionJob::action action\endlink, the job sends \c POST /reset/{server-number}
+ * or \c POST /wol/{server-number} for every server, with at most
+ * \link PowerActionJob::maxInFlight maxInFlight\endlink requests running at the same time.
+ * The reset type can be set per server, servers without an own type use
+ * \link PowerActionJob::defaultResetType defaultResetType\endlink.
+ *
+ * Before resetting, the job requests the \c /reset listing once, using the ResponseCache if
+ * one is set, and skips all servers whose reset options do not contain the requested type or
+ * that are not listed at all. If the listing can not be fetched, the job emits BJob::warning()
+ * and sends all resets without checking them, the API will reject invalid types anyway.
+ *
+ * Every finished server is reported immediately via serverFinished() and the progress is
+ * reported in BJob::Items via the BJob progress signals. After all servers have been processed,
+ * BJob::result() is emitted. If actions failed or have been skipped, BJob::error() returns
+ * QHR::SubJobsFailed; results() contains the outcome for every server.
+ *
+ * \headerfile "" <QHR/PowerActionJob>
+ */
+class QHR_LIBRARY PowerActionJob : public BJob
+{
+    Q_OBJECT
+    /*!
+     * \brief The power action performed on all servers.
+     *
+     * The default value is PowerActionJob::Reset.
+     *
+     * \par Access functions
+     * \li Action action() const
+     * \li void setAction(Action action)
+     */
+    Q_PROPERTY(QHR::PowerActionJob::Action action READ action WRITE setAction)
+    /*!
+     * \brief Reset type used for servers that have been added without an own type.
+     *
+     * The default value is \c "sw". See the API documentation of \c /reset for available types.
+     *
+     * \par Access functions
+     * \li QString defaultResetType() const
+     * \li void setDefaultResetType(const QString &defaultResetType)
+     */
+    Q_PROPERTY(QString defaultResetType READ defaultResetType WRITE setDefaultResetType)
+    /*!
+     * \brief Maximum number of requests running at the same time.
+     *
+     * The default value is \c 6.
+     *
+     * \par Access functions
+     * \li int maxInFlight() const
+     * \li void setMaxInFlight(int maxInFlight)
+     */
+    Q_PROPERTY(int maxInFlight READ maxInFlight WRITE setMaxInFlight)
+    /*!
+     * \brief Set to \c false to send all resets without checking the \c /reset listing.
+     *
+     * The default value is \c true.
+     *
+     * \par Access functions
+     * \li bool checkResetTypes() const
+     * \li void setCheckResetTypes(bool checkResetTypes)
+     */
+    Q_PROPERTY(bool checkResetTypes READ checkResetTypes WRITE setCheckResetTypes)
+public:
+    /*!
+     * \brief Power actions that can be performed.
+     */
+    enum Action : quint8 {
+        Reset = 0,  /**< Resets the servers via \c /reset/{server-number}. */
+        WakeOnLan   /**< Sends a Wake-on-LAN packet via \c /wol/{server-number}. */
+    };
+    Q_ENUM(Action)
+
+    /*!
+     * \brief Constructs a new %PowerActionJob object performing \a action with the given \a parent.
+     */
+    explicit PowerActionJob(Action action = Reset, QObject *parent = nullptr);
+
+    /*!
+     * \brief Destroys the %PowerActionJob object.
+     */
+    ~PowerActionJob() override;
+
+    /*!
+     * \brief Sets the \a configuration used for the requests.
+     *
+     * If not set, QHR::defaultConfiguration() will be used.
+     */
+    void setConfiguration(AbstractConfiguration *configuration);
+
+    /*!
+     * \brief Adds the server with \a serverNumber.
+     *
+     * If \a resetType is empty, \link PowerActionJob::defaultResetType defaultResetType\endlink
+     * will be used. The type is ignored for Wake-on-LAN. Servers can only be added before the job
+     * has been started, servers added more than once are only processed once.
+     */
+    void addServer(int serverNumber, const QString &resetType = QString());
+
+    /*!
+     * \brief Adds all servers in \a serverNumbers using the default reset type.
+     */
+    void addServers(const QVector<int> &serverNumbers);
+
+    /*!
+     * \brief Returns the numbers of the added servers in the order they have been added.
+     */
+    QVector<int> servers() const;
+
+    /*!
+     * \brief Returns the results of all finished servers in the order they have been finished.
+     */
+    QVector<PowerActionResult> results() const;
+
+    /*!
+     * \brief Returns the number of servers whose power action has been successful.
+     */
+    int succeededCount() const;
+
+    /*!
+     * \brief Returns the number of servers whose power action has been failed.
+     */
+    int failedCount() const;
+
+    /*!
+     * \brief Returns the number of servers that have been skipped because of an unavailable reset type.
+     */
+    int skippedCount() const;
+
+    /*!
+     * \brief Getter function for the \link PowerActionJob::action action\endlink property.
+     * \sa setAction()
+     */
+    Action action() const;
+
+    /*!
+     * \brief Setter function for the \link PowerActionJob::action action\endlink property.
+     * \sa action()
+     */
+    void setAction(Action action);
+
+    /*!
+     * \brief Getter function for the \link PowerActionJob::defaultResetType defaultResetType\endlink property.
+     * \sa setDefaultResetType()
+     */
+    QString defaultResetType() const;
+
+    /*!
+     * \brief Setter function for the \link PowerActionJob::defaultResetType defaultResetType\endlink property.
+     * \sa defaultResetType()
+     */
+    void setDefaultResetType(const QString &defaultResetType);
+
+    /*!
+     * \brief Getter function for the \link PowerActionJob::maxInFlight maxInFlight\endlink property.
+     * \sa setMaxInFlight()
+     */
+    int maxInFlight() const;
+
+    /*!
+     * \brief Setter function for the \link PowerActionJob::maxInFlight maxInFlight\endlink property.
+     * \sa maxInFlight()
+     */
+    void setMaxInFlight(int maxInFlight);
+
+    /*!
+     * \brief Getter function for the \link PowerActionJob::checkResetTypes checkResetTypes\endlink property.
+     * \sa setCheckResetTypes()
+     */
+    bool checkResetTypes() const;
+
+    /*!
+     * \brief Setter function for the \link PowerActionJob::checkResetTypes checkResetTypes\endlink property.
+     * \sa checkResetTypes()
+     */
+    void setCheckResetTypes(bool checkResetTypes);
+
+    /*!
+     * \brief Starts the power actions asynchronously.
+     */
+    void start() override;
+
+    /*!
+     * \brief Returns a human readable and translated error string.
+     */
+    QString errorString() const override;
+
+Q_SIGNALS:
+    /*!
+     * \brief Emitted as soon as the power action for a single server has been finished or skipped.
+     */
+    void serverFinished(const QHR::PowerActionResult &result);
+
+protected:
+    const std::unique_ptr<PowerActionJobPrivate> pad_ptr;
+
+    /*!
+     * \brief Aborts all running requests, servers that have not been finished will not be reported.
+     */
+    bool doKill() override;
+
+private:
+    Q_DECLARE_PRIVATE_D(pad_ptr, PowerActionJob)
+    Q_DISABLE_COPY(PowerActionJob)
+};
+
+}
+
+Q_DECLARE_METATYPE(QHR::PowerActionResult)
+
+#endif // QHR_POWERACTIONJOB_H
@@ -0,0 +1,74 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_POWERACTIONJOB_P_H
+#define QHR_POWERACTIONJOB_P_H
+
+#include "poweractionjob.h"
+#include "requestexecutor.h"
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QPointer>
+#include <QJsonArray>
+
+namespace QHR {
+
+struct PowerActionTarget
+{
+    QString resetType;
+    int serverNumber = 0;
+};
+
+class PowerActionJobPrivate
+{
+public:
+    explicit PowerActionJobPrivate(PowerActionJob *q);
+    ~PowerActionJobPrivate();
+
+    static QHash<int, QStringList> resetTypes(const QJsonArray &listing);
+
+    void emitDescription();
+
+    void fetchResetListing();
+
+    void listingFinished(Job *job);
+
+    void dispatch(const QHash<int, QStringList> *allowedTypes);
+
+    void actionFinished(int index, const Response &response);
+
+    void report(const PowerActionResult &result);
+
+    void finish();
+
+    QVector<PowerActionTarget> targets;
+    QSet<int> serverNumbers;
+    QVector<PowerActionResult> results;
+    QString defaultResetType = QStringLiteral("sw");
+    std::unique_ptr<RequestExecutor> executor;
+    QPointer<Job> listingJob;
+    AbstractConfiguration *configuration = nullptr;
+    int maxInFlight = 6;
+    int remaining = 0;
+    int succeeded = 0;
+    int failed = 0;
+    int skipped = 0;
+    PowerActionJob::Action action = PowerActionJob::Reset;
+    bool checkResetTypes = true;
+    bool started = false;
+    bool killed = false;
+
+protected:
+    PowerActionJob *q_ptr = nullptr;
+
+private:
+    Q_DISABLE_COPY(PowerActionJobPrivate)
+    Q_DECLARE_PUBLIC(PowerActionJob)
+};
+
+}
+
+#endif // QHR_POWERACTIONJOB_P_H
@@ -0,0 +1,593 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "productcatalog.h"
+#include "jsonhash_p.h"
+#include "logging.h"
+#include <QSharedData>
+#include <QHash>
+#include <QJsonValue>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <numeric>
+
+namespace QHR {
+
+class ProductCatalogData : public QSharedData
+{
+public:
+    static constexpr int attributeCount = 6;
+    static constexpr int categoryCount = 3;
+
+    int words() const { return (ids.size() + 63) / 64; }
+
+    QVector<quint64> allRows() const;
+
+    QVector<quint64> evaluate(const ProductQuery &query) const;
+
+    void evaluate(const ProductQuery::Range &range, QVector<quint64> &bits) const;
+
+    void evaluate(ProductCatalog::Category category, const QStringList &values, QVector<quint64> &bits) const;
+
+    QVector<QString> ids;
+    QVector<QString> productIds;
+    QVector<QString> names;
+    QVector<QJsonObject> products;
+    // hash of the product object a row has been created from
+    QVector<quint64> hashes;
+    QVector<double> attributes[attributeCount];
+    // dictionary encoded categories, the dictionaries are sorted
+    QVector<quint32> codes[categoryCount];
+    QStringList dictionaries[categoryCount];
+    // one bitmap over all rows per dictionary entry
+    QVector<QVector<quint64>> bitmaps[categoryCount];
+    // rows ordered by attribute value, ties ordered by row
+    QVector<double> sortedValues[attributeCount];
+    QVector<int> sortedRows[attributeCount];
+    QHash<QString, int> idIndex;
+    ProductCatalog::Source source = ProductCatalog::ServerProducts;
+};
+
+}
+
+using namespace QHR;
+
+namespace {
+
+struct OfferRow
+{
+    QString id;
+    QString productId;
+    QString name;
+    QString categories[ProductCatalogData::categoryCount];
+    QJsonObject product;
+    double attributes[ProductCatalogData::attributeCount] = {};
+    quint64 hash = 0;
+    // taken over from the previous catalog
+    bool reused = false;
+};
+
+// the API returns prices as strings like "39.0000"
+double toNumber(const QJsonValue &value)
+{
+    if (value.isDouble()) {
+        return value.toDouble();
+    }
+    return value.toString().toDouble();
+}
+
+QString toId(const QJsonValue &value)
+{
+    if (value.isDouble()) {
+        return QString::number(static_cast<qint64>(value.toDouble()));
+    }
+    return value.toString();
+}
+
+QString locationOf(const QString &datacenter)
+{
+    const int dash = datacenter.indexOf(QLatin1Char('-'));
+    return dash < 0 ? datacenter : datacenter.left(dash);
+}
+
+void appendMarketProduct(const QJsonObject &product, quint64 hash, QVector<OfferRow> &rows)
+{
+    OfferRow row;
+    row.productId = toId(product.value(QStringLiteral("id")));
+    row.id = row.productId;
+    row.name = product.value(QStringLiteral("name")).toString();
+    row.categories[ProductCatalog::Datacenter] = product.value(QStringLiteral("datacenter")).toString();
+    row.categories[ProductCatalog::Location] = locationOf(row.categories[ProductCatalog::Datacenter]);
+    row.categories[ProductCatalog::Cpu] = product.value(QStringLiteral("cpu")).toString();
+    row.product = product;
+    row.attributes[ProductCatalog::Price] = toNumber(product.value(QStringLiteral("price")));
+    row.attributes[ProductCatalog::SetupPrice] = toNumber(product.value(QStringLiteral("price_setup")));
+    row.attributes[ProductCatalog::CpuBenchmark] = toNumber(product.value(QStringLiteral("cpu_benchmark")));
+    row.attributes[ProductCatalog::MemorySize] = toNumber(product.value(QStringLiteral("memory_size")));
+    row.attributes[ProductCatalog::HddSize] = toNumber(product.value(QStringLiteral("hdd_size")));
+    row.attributes[ProductCatalog::HddCount] = toNumber(product.value(QStringLiteral("hdd_count")));
+    row.hash = hash;
+    rows.push_back(row);
+}
+
+void appendServerProduct(const QJsonObject &product, quint64 hash, QVector<OfferRow> &rows)
+{
+    OfferRow base;
+    base.productId = toId(product.value(QStringLiteral("id")));
+    base.name = product.value(QStringLiteral("name")).toString();
+    base.product = product;
+    base.hash = hash;
+
+    const auto append = [&base, &rows](const QString &location, const QJsonValue &price, const QJsonValue &setupPrice) {
+        OfferRow row = base;
+        row.id = location.isEmpty() ? base.productId : base.productId + QLatin1Char('/') + location;
+        row.categories[ProductCatalog::Datacenter] = location;
+        row.categories[ProductCatalog::Location] = location;
+        row.attributes[ProductCatalog::Price] = toNumber(price.toObject().value(QStringLiteral("net")));
+        row.attributes[ProductCatalog::SetupPrice] = toNumber(setupPrice.toObject().value(QStringLiteral("net")));
+        rows.push_back(row);
+    };
+
+    // current API versions return the prices per location
+    const QJsonArray prices = product.value(QStringLiteral("prices")).toArray();
+    if (!prices.empty()) {
+        for (const QJsonValue &v : prices) {
+            const QJsonObject price = v.toObject();
+            append(price.value(QStringLiteral("location")).toString(), price.value(QStringLiteral("price")), price.value(QStringLiteral("price_setup")));
+        }
+        return;
+    }
+
+    const QJsonValue price = product.value(QStringLiteral("price"));
+    const QJsonValue setupPrice = product.value(QStringLiteral("price_setup"));
+    const QJsonValue location = product.value(QStringLiteral("location"));
+    if (location.isArray() && !location.toArray().empty()) {
+        const QJsonArray locations = location.toArray();
+        for (const QJsonValue &l : locations) {
+            append(l.toString(), price, setupPrice);
+        }
+    } else {
+        append(location.toString(), price, setupPrice);
+    }
+}
+
+void buildIndexes(ProductCatalogData *d, const QVector<OfferRow> &rows)
+{
+    const int n = rows.size();
+
+    d->ids.reserve(n);
+    d->productIds.reserve(n);
+    d->names.reserve(n);
+    d->products.reserve(n);
+    d->hashes.reserve(n);
+    d->idIndex.reserve(n);
+    for (QVector<double> &column : d->attributes) {
+        column.reserve(n);
+    }
+
+    QHash<QString, quint32> dictionaries[ProductCatalogData::categoryCount];
+    for (QVector<quint32> &column : d->codes) {
+        column.reserve(n);
+    }
+
+    for (const OfferRow &row : rows) {
+        d->idIndex.insert(row.id, d->ids.size());
+        d->ids.push_back(row.id);
+        d->productIds.push_back(row.productId);
+        d->names.push_back(row.name);
+        d->products.push_back(row.product);
+        d->hashes.push_back(row.hash);
+        for (int a = 0; a < ProductCatalogData::attributeCount; ++a) {
+            d->attributes[a].push_back(row.attributes[a]);
+        }
+        for (int c = 0; c < ProductCatalogData::categoryCount; ++c) {
+            auto it = dictionaries[c].find(row.categories[c]);
+            if (it == dictionaries[c].end()) {
+                it = dictionaries[c].insert(row.categories[c], static_cast<quint32>(dictionaries[c].size()));
+            }
+            d->codes[c].push_back(it.value());
+        }
+    }
+
+    const int words = d->words();
+
+    for (int c = 0; c < ProductCatalogData::categoryCount; ++c) {
+        QStringList &dictionary = d->dictionaries[c];
+        dictionary = dictionaries[c].keys();
+        std::sort(dictionary.begin(), dictionary.end());
+
+        // codes have been assigned in order of appearance, map them to the sorted dictionary
+        QVector<quint32> remap(dictionary.size());
+        for (int i = 0; i < dictionary.size(); ++i) {
+            remap[static_cast<int>(dictionaries[c].value(dictionary.at(i)))] = static_cast<quint32>(i);
+        }
+
+        QVector<QVector<quint64>> &bitmaps = d->bitmaps[c];
+        bitmaps.fill(QVector<quint64>(words, 0), dictionary.size());
+        QVector<quint32> &codes = d->codes[c];
+        for (int row = 0; row < n; ++row) {
+            const quint32 code = remap.at(static_cast<int>(codes.at(row)));
+            codes[row] = code;
+            bitmaps[static_cast<int>(code)][row / 64] |= Q_UINT64_C(1) << (row % 64);
+        }
+    }
+
+    for (int a = 0; a < ProductCatalogData::attributeCount; ++a) {
+        const QVector<double> &column = d->attributes[a];
+        QVector<int> &sortedRows = d->sortedRows[a];
+        sortedRows.resize(n);
+        std::iota(sortedRows.begin(), sortedRows.end(), 0);
+        std::sort(sortedRows.begin(), sortedRows.end(), [&column](int l, int r){
+            const double lv = column.at(l);
+            const double rv = column.at(r);
+            return lv < rv || (lv == rv && l < r);
+        });
+        QVector<double> &sortedValues = d->sortedValues[a];
+        sortedValues.reserve(n);
+        for (int row : sortedRows) {
+            sortedValues.push_back(column.at(row));
+        }
+    }
+}
+
+void intersect(QVector<quint64> &bits, const QVector<quint64> &other, bool *initialized)
+{
+    if (!*initialized) {
+        bits = other;
+        *initialized = true;
+        return;
+    }
+    quint64 *b = bits.data();
+    const quint64 *o = other.constData();
+    for (int i = 0, words = bits.size(); i < words; ++i) {
+        b[i] &= o[i];
+    }
+}
+
+}
+
+QVector<quint64> ProductCatalogData::allRows() const
+{
+    QVector<quint64> bits(words(), ~Q_UINT64_C(0));
+    const int rest = ids.size() % 64;
+    if (rest != 0) {
+        bits.last() = (Q_UINT64_C(1) << rest) - 1;
+    }
+    return bits;
+}
+
+void ProductCatalogData::evaluate(const ProductQuery::Range &range, QVector<quint64> &bits) const
+{
+    const QVector<double> &values = sortedValues[range.attribute];
+    const QVector<int> &rows = sortedRows[range.attribute];
+    const auto begin = std::lower_bound(values.cbegin(), values.cend(), range.min);
+    const auto end = std::upper_bound(begin, values.cend(), range.max);
+
+    bits.fill(0, words());
+    quint64 *b = bits.data();
+    const int *row = rows.constData() + (begin - values.cbegin());
+    const int *rowEnd = rows.constData() + (end - values.cbegin());
+    for (; row < rowEnd; ++row) {
+        b[*row / 64] |= Q_UINT64_C(1) << (*row % 64);
+    }
+}
+
+void ProductCatalogData::evaluate(ProductCatalog::Category category, const QStringList &values, QVector<quint64> &bits) const
+{
+    const QStringList &dictionary = dictionaries[category];
+    bits.fill(0, words());
+    quint64 *b = bits.data();
+    for (const QString &value : values) {
+        const auto it = std::lower_bound(dictionary.cbegin(), dictionary.cend(), value);
+        if (it == dictionary.cend() || *it != value) {
+            continue;
+        }
+        const QVector<quint64> &bitmap = bitmaps[category].at(static_cast<int>(it - dictionary.cbegin()));
+        const quint64 *m = bitmap.constData();
+        for (int i = 0, words = bitmap.size(); i < words; ++i) {
+            b[i] |= m[i];
+        }
+    }
+}
+
+QVector<quint64> ProductCatalogData::evaluate(const ProductQuery &query) const
+{
+    if (query.isEmpty()) {
+        return allRows();
+    }
+
+    QStringList equals[categoryCount];
+    for (const ProductQuery::Equals &e : query.m_equals) {
+        equals[e.category].append(e.value);
+    }
+
+    QVector<quint64> bits;
+    QVector<quint64> predicate;
+    bool initialized = false;
+
+    // bitmaps first, they are the cheapest predicates
+    for (int c = 0; c < categoryCount; ++c) {
+        if (!equals[c].empty()) {
+            evaluate(static_cast<ProductCatalog::Category>(c), equals[c], predicate);
+            intersect(bits, predicate, &initialized);
+        }
+    }
+
+    for (const ProductQuery::Range &range : query.m_ranges) {
+        evaluate(range, predicate);
+        intersect(bits, predicate, &initialized);
+    }
+
+    return bits;
+}
+
+ProductCatalog::ProductCatalog() = default;
+
+ProductCatalog::ProductCatalog(const ProductCatalog &other) = default;
+
+ProductCatalog::ProductCatalog(ProductCatalog &&other) noexcept = default;
+
+ProductCatalog &ProductCatalog::operator=(const ProductCatalog &other) = default;
+
+ProductCatalog &ProductCatalog::operator=(ProductCatalog &&other) noexcept = default;
+
+ProductCatalog::~ProductCatalog() = default;
+
+void ProductCatalog::swap(ProductCatalog &other) noexcept
+{
+    std::swap(d, other.d);
+}
+
+bool ProductCatalog::isNull() const
+{
+    return !d;
+}
+
+ProductCatalog::Source ProductCatalog::source() const
+{
+    return d ? d->source : ServerProducts;
+}
+
+int ProductCatalog::size() const
+{
+    return d ? d->ids.size() : 0;
+}
+
+int ProductCatalog::indexOf(const QString &id) const
+{
+    return d ? d->idIndex.value(id, -1) : -1;
+}
+
+ProductOffer ProductCatalog::offer(int row) const
+{
+    ProductOffer offer;
+    if (Q_UNLIKELY(!d || row < 0 || row >= d->ids.size())) {
+        qCWarning(qhrCore) << "Invalid product catalog row" << row;
+        return offer;
+    }
+
+    offer.id = d->ids.at(row);
+    offer.productId = d->productIds.at(row);
+    offer.name = d->names.at(row);
+    offer.datacenter = d->dictionaries[Datacenter].at(static_cast<int>(d->codes[Datacenter].at(row)));
+    offer.location = d->dictionaries[Location].at(static_cast<int>(d->codes[Location].at(row)));
+    offer.cpu = d->dictionaries[Cpu].at(static_cast<int>(d->codes[Cpu].at(row)));
+    offer.product = d->products.at(row);
+    offer.price = d->attributes[Price].at(row);
+    offer.setupPrice = d->attributes[SetupPrice].at(row);
+    offer.cpuBenchmark = static_cast<int>(d->attributes[CpuBenchmark].at(row));
+    offer.memorySize = static_cast<int>(d->attributes[MemorySize].at(row));
+    offer.hddSize = static_cast<int>(d->attributes[HddSize].at(row));
+    offer.hddCount = static_cast<int>(d->attributes[HddCount].at(row));
+    return offer;
+}
+
+QVector<ProductOffer> ProductCatalog::offers(const QVector<int> &rows) const
+{
+    QVector<ProductOffer> _offers;
+    _offers.reserve(rows.size());
+    for (int row : rows) {
+        _offers.push_back(offer(row));
+    }
+    return _offers;
+}
+
+double ProductCatalog::value(Attribute attribute, int row) const
+{
+    if (Q_UNLIKELY(!d || row < 0 || row >= d->ids.size())) {
+        qCWarning(qhrCore) << "Invalid product catalog row" << row;
+        return 0.0;
+    }
+    return d->attributes[attribute].at(row);
+}
+
+QStringList ProductCatalog::values(Category category) const
+{
+    return d ? d->dictionaries[category] : QStringList();
+}
+
+QVector<int> ProductCatalog::query(const ProductQuery &query) const
+{
+    QVector<int> rows;
+    if (!d) {
+        return rows;
+    }
+
+    const QVector<quint64> bits = d->evaluate(query);
+    const quint64 *b = bits.constData();
+
+    const int limit = query.m_limit > 0 ? query.m_limit : d->ids.size();
+    rows.reserve(std::min(limit, 64));
+
+    // walking the price index returns the matches already ordered by price
+    for (int row : d->sortedRows[Price]) {
+        if (b[row / 64] & (Q_UINT64_C(1) << (row % 64))) {
+            rows.push_back(row);
+            if (rows.size() == limit) {
+                break;
+            }
+        }
+    }
+
+    return rows;
+}
+
+int ProductCatalog::count(const ProductQuery &query) const
+{
+    if (!d) {
+        return 0;
+    }
+
+    const QVector<quint64> bits = d->evaluate(query);
+    int _count = 0;
+    for (quint64 word : bits) {
+        _count += static_cast<int>(qPopulationCount(word));
+    }
+    return _count;
+}
+
+ProductCatalog::Changes ProductCatalog::diff(const ProductCatalog &previous, const ProductCatalog &current)
+{
+    Changes changes;
+
+    if (previous.d.constData() == current.d.constData() || !current.d) {
+        if (previous.d && !current.d) {
+            changes.removed = previous.d->ids.toList();
+        }
+        return changes;
+    }
+
+    const ProductCatalogData *prev = previous.d.constData();
+    const ProductCatalogData *cur = current.d.constData();
+
+    for (int row = 0; row < cur->ids.size(); ++row) {
+        const int prevRow = prev ? prev->idIndex.value(cur->ids.at(row), -1) : -1;
+        if (prevRow < 0) {
+            changes.added.push_back(row);
+        } else if (prev->hashes.at(prevRow) != cur->hashes.at(row)) {
+            changes.changed.push_back(row);
+        }
+    }
+
+    if (prev) {
+        for (const QString &id : prev->ids) {
+            if (!cur->idIndex.contains(id)) {
+                changes.removed.append(id);
+            }
+        }
+    }
+
+    return changes;
+}
+
+ProductCatalog ProductCatalog::fromJson(const QJsonArray &products, Source source, const ProductCatalog &previous)
+{
+    const ProductCatalogData *prev = previous.d && previous.d->source == source ? previous.d.constData() : nullptr;
+
+    // hash of a product -> first row created from it in the previous catalog
+    QHash<quint64, int> previousRows;
+    if (prev) {
+        previousRows.reserve(prev->hashes.size());
+        for (int row = prev->hashes.size() - 1; row >= 0; --row) {
+            previousRows.insert(prev->hashes.at(row), row);
+        }
+    }
+
+    QVector<OfferRow> rows;
+    rows.reserve(products.size());
+
+    for (const QJsonValue &v : products) {
+        const QJsonObject json = v.toObject();
+        const QJsonValue wrapped = json.value(QStringLiteral("product"));
+        const QJsonObject product = wrapped.isObject() ? wrapped.toObject() : json;
+        const quint64 hash = jsonRecordHash(product);
+
+        const int prevRow = prev ? previousRows.value(hash, -1) : -1;
+        if (prevRow >= 0) {
+            // unchanged product, take over its rows instead of extracting them again
+            for (int row = prevRow; row < prev->hashes.size() && prev->hashes.at(row) == hash; ++row) {
+                OfferRow r;
+                r.id = prev->ids.at(row);
+                r.productId = prev->productIds.at(row);
+                r.name = prev->names.at(row);
+                r.product = prev->products.at(row);
+                for (int c = 0; c < ProductCatalogData::categoryCount; ++c) {
+                    r.categories[c] = prev->dictionaries[c].at(static_cast<int>(prev->codes[c].at(row)));
+                }
+                for (int a = 0; a < ProductCatalogData::attributeCount; ++a) {
+                    r.attributes[a] = prev->attributes[a].at(row);
+                }
+                r.hash = hash;
+                r.reused = true;
+                rows.push_back(r);
+            }
+        } else if (source == ServerMarket) {
+            appendMarketProduct(product, hash, rows);
+        } else {
+            appendServerProduct(product, hash, rows);
+        }
+    }
+
+    // drop offers with duplicate IDs, the first one wins
+    QHash<QString, int> seen;
+    seen.reserve(rows.size());
+    int reused = 0;
+    for (auto it = rows.begin(); it != rows.end();) {
+        if (Q_UNLIKELY(it->id.isEmpty() || seen.contains(it->id))) {
+            qCWarning(qhrCore) << "Skipping product catalog offer with empty or duplicate ID" << it->id;
+            it = rows.erase(it);
+        } else {
+            seen.insert(it->id, 0);
+            // counted after dropping duplicates, a dropped reused row must not make the catalog look unchanged
+            reused += it->reused ? 1 : 0;
+            ++it;
+        }
+    }
+
+    if (prev && reused == rows.size() && rows.size() == prev->ids.size()) {
+        bool unchanged = true;
+        for (int row = 0; row < rows.size() && unchanged; ++row) {
+            unchanged = rows.at(row).id == prev->ids.at(row);
+        }
+        if (unchanged) {
+            qCDebug(qhrCore) << "Product catalog unchanged, keeping indexes of" << rows.size() << "offers";
+            return previous;
+        }
+    }
+
+    ProductCatalog catalog;
+    catalog.d = new ProductCatalogData;
+    catalog.d->source = source;
+    buildIndexes(catalog.d.data(), rows);
+
+    qCDebug(qhrCore) << "Built product catalog index with" << rows.size() << "offers," << reused << "taken over from the previous catalog";
+
+    return catalog;
+}
+
+ProductQuery &ProductQuery::range(ProductCatalog::Attribute attribute, double min, double max)
+{
+    Range r;
+    r.min = min;
+    r.max = max;
+    r.attribute = attribute;
+    m_ranges.push_back(r);
+    return *this;
+}
+
+ProductQuery &ProductQuery::equals(ProductCatalog::Category category, const QString &value)
+{
+    Equals e;
+    e.value = value;
+    e.category = category;
+    m_equals.push_back(e);
+    return *this;
+}
+
+ProductQuery &ProductQuery::setLimit(int limit)
+{
+    m_limit = std::max(0, limit);
+    return *this;
+}
@@ -0,0 +1,285 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_PRODUCTCATALOG_H
+#define QHR_PRODUCTCATALOG_H
+
+#include <QSharedDataPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMetaType>
+#include "qhr_global.h"
+#include <limits>
+
+namespace QHR {
+
+class ProductCatalogData;
+class ProductQuery;
+
+/*!
+ * \brief A single orderable offer of a ProductCatalog.
+ *
+ * \headerfile "" <QHR/ProductCatalog>
+ */
+struct ProductOffer
+{
+    QString id;                 /**< Unique in the catalog: the product ID for server market products, product ID and location like \c "EX44/FSN1" for server products. */
+    QString productId;          /**< ID of the product as used for ordering. */
+    QString name;
+    QString cpu;                /**< CPU model, empty for server products. */
+    QString datacenter;         /**< Datacenter like \c "FSN1-DC8", the location for server products. */
+    QString location;           /**< Location like \c "FSN1". */
+    QJsonObject product;        /**< The complete product object returned by the API. */
+    double price = 0.0;         /**< Monthly net price in euro. */
+    double setupPrice = 0.0;    /**< Net setup price in euro. */
+    int cpuBenchmark = 0;       /**< CPU benchmark score, \c 0 if unknown. */
+    int memorySize = 0;         /**< Memory size in GB, \c 0 if unknown. */
+    int hddSize = 0;            /**< Size of a single disk in GB, \c 0 if unknown. */
+    int hddCount = 0;           /**< Number of disks, \c 0 if unknown. */
+
+    bool isValid() const { return !id.isEmpty(); }
+};
+
+/*!
+ * \brief Indexed in-memory copy of the server or server market product catalog.
+ *
+ * The offers are stored column wise. For every numeric Attribute there is a sorted index,
+ * for every Category there is a bitmap per distinct value. query() evaluates a ProductQuery
+ * by intersecting the bitmaps of the equality predicates with the row ranges found by binary
+ * search in the sorted indexes and walks the price index to return the matching rows ordered
+ * by price. No JSON data is touched while querying.
+ *
+ * The catalog of \c /order/server/product contains one offer per product and location. These
+ * products do not contain structured hardware data, so their numeric hardware attributes are
+ * \c 0 and the CPU is empty.
+ *
+ * This class is implicitly shared.
+ *
+ * \headerfile "" <QHR/ProductCatalog>
+ */
+class QHR_LIBRARY ProductCatalog
+{
+public:
+    /*!
+     * \brief The catalog the offers have been taken from.
+     */
+    enum Source : quint8 {
+        ServerProducts = 0, /**< New servers from \c /order/server/product. */
+        ServerMarket        /**< Server auction offers from \c /order/server_market/product. */
+    };
+
+    /*!
+     * \brief Numeric attributes usable for range predicates.
+     */
+    enum Attribute : quint8 {
+        Price = 0,      /**< Monthly net price in euro. */
+        SetupPrice,     /**< Net setup price in euro. */
+        CpuBenchmark,   /**< CPU benchmark score. */
+        MemorySize,     /**< Memory size in GB. */
+        HddSize,        /**< Size of a single disk in GB. */
+        HddCount        /**< Number of disks. */
+    };
+
+    /*!
+     * \brief Textual attributes usable for equality predicates.
+     */
+    enum Category : quint8 {
+        Datacenter = 0, /**< Datacenter like \c "FSN1-DC8". */
+        Location,       /**< Location like \c "FSN1". */
+        Cpu             /**< CPU model. */
+    };
+
+    /*!
+     * \brief Changes between two catalogs, see diff().
+     */
+    struct Changes
+    {
+        QVector<int> added;     /**< Rows of the new catalog that are not part of the previous one. */
+        QVector<int> changed;   /**< Rows of the new catalog whose data differs from the previous one. */
+        QStringList removed;    /**< IDs of the offers of the previous catalog that are gone. */
+
+        bool isEmpty() const { return added.empty() && changed.empty() && removed.empty(); }
+    };
+
+    /*!
+     * \brief Constructs a null %ProductCatalog object.
+     */
+    ProductCatalog();
+
+    /*!
+     * \brief Constructs a copy of \a other.
+     */
+    ProductCatalog(const ProductCatalog &other);
+
+    /*!
+     * \brief Move-constructs a %ProductCatalog instance, making it point at the same object that \a other was pointing to.
+     */
+    ProductCatalog(ProductCatalog &&other) noexcept;
+
+    /*!
+     * \brief Assigns \a other to this object.
+     */
+    ProductCatalog &operator=(const ProductCatalog &other);
+
+    /*!
+     * \brief Move-assigns \a other to this object.
+     */
+    ProductCatalog &operator=(ProductCatalog &&other) noexcept;
+
+    /*!
+     * \brief Destroys the %ProductCatalog object.
+     */
+    ~ProductCatalog();
+
+    /*!
+     * \brief Swaps this object with \a other.
+     */
+    void swap(ProductCatalog &other) noexcept;
+
+    /*!
+     * \brief Returns \c true if this object does not contain any data.
+     */
+    bool isNull() const;
+
+    /*!
+     * \brief Returns the catalog the offers have been taken from.
+     */
+    Source source() const;
+
+    /*!
+     * \brief Returns the number of offers.
+     */
+    int size() const;
+
+    /*!
+     * \brief Returns the row of the offer with \a id or \c -1 if it is not part of the catalog.
+     */
+    int indexOf(const QString &id) const;
+
+    /*!
+     * \brief Returns the offer at \a row.
+     */
+    ProductOffer offer(int row) const;
+
+    /*!
+     * \brief Returns the offers at \a rows.
+     */
+    QVector<ProductOffer> offers(const QVector<int> &rows) const;
+
+    /*!
+     * \brief Returns the value of \a attribute for the offer at \a row.
+     */
+    double value(Attribute attribute, int row) const;
+
+    /*!
+     * \brief Returns the distinct values of \a category sorted alphabetically.
+     */
+    QStringList values(Category category) const;
+
+    /*!
+     * \brief Returns the rows of all offers matching \a query ordered by ascending price.
+     *
+     * If the query has a limit, only the cheapest offers up to the limit are returned.
+     */
+    QVector<int> query(const ProductQuery &query) const;
+
+    /*!
+     * \brief Returns the number of offers matching \a query, ignoring its limit.
+     */
+    int count(const ProductQuery &query) const;
+
+    /*!
+     * \brief Returns the changes from \a previous to \a current, offers are identified by ProductOffer::id.
+     */
+    static Changes diff(const ProductCatalog &previous, const ProductCatalog &current);
+
+    /*!
+     * \brief Creates a new %ProductCatalog from the \a products returned by the API for \a source.
+     *
+     * If \a previous is not null and has the same source, the data of unchanged products is
+     * taken over from it instead of being extracted again. If no product has been changed,
+     * \a previous itself is returned, including its indexes.
+     */
+    static ProductCatalog fromJson(const QJsonArray &products, Source source, const ProductCatalog &previous = ProductCatalog());
+
+private:
+    QSharedDataPointer<ProductCatalogData> d;
+};
+
+/*!
+ * \brief Predicates to search a ProductCatalog.
+ *
+ * All predicates have to match. Multiple values set for the same Category match if the
+ * offer has any of them. Range bounds are inclusive.
+ *
+ * \code{.cpp}
+ * QHR::ProductQuery query;
+ * query.range(QHR::ProductCatalog::MemorySize, 64)
+ *      .range(QHR::ProductCatalog::Price, 0, 60)
+ *      .equals(QHR::ProductCatalog::Location, QStringLiteral("FSN1"))
+ *      .setLimit(10);
+ * const QVector<QHR::ProductOffer> cheapest = catalog.offers(catalog.query(query));
+ * \endcode
+ *
+ * \headerfile "" <QHR/ProductCatalog>
+ */
+class QHR_LIBRARY ProductQuery
+{
+public:
+    /*!
+     * \brief Requires \a attribute to be between \a min and \a max.
+     */
+    ProductQuery &range(ProductCatalog::Attribute attribute, double min, double max = std::numeric_limits<double>::max());
+
+    /*!
+     * \brief Requires \a category to be \a value.
+     */
+    ProductQuery &equals(ProductCatalog::Category category, const QString &value);
+
+    /*!
+     * \brief Limits the result to the \a limit cheapest offers, \c 0 returns all matches.
+     */
+    ProductQuery &setLimit(int limit);
+
+    /*!
+     * \brief Returns the maximum number of returned offers, \c 0 if unlimited.
+     */
+    int limit() const { return m_limit; }
+
+    /*!
+     * \brief Returns \c true if the query has no predicates.
+     */
+    bool isEmpty() const { return m_ranges.empty() && m_equals.empty(); }
+
+private:
+    friend class ProductCatalog;
+    friend class ProductCatalogData;
+
+    struct Range {
+        double min;
+        double max;
+        ProductCatalog::Attribute attribute;
+    };
+
+    struct Equals {
+        QString value;
+        ProductCatalog::Category category;
+    };
+
+    QVector<Range> m_ranges;
+    QVector<Equals> m_equals;
+    int m_limit = 0;
+};
+
+}
+
+Q_DECLARE_SHARED(QHR::ProductCatalog)
+Q_DECLARE_METATYPE(QHR::ProductCatalog)
+Q_DECLARE_METATYPE(QHR::ProductOffer)
+
+#endif // QHR_PRODUCTCATALOG_H
@@ -0,0 +1,242 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "ratelimiter_p.h"
+#include <QGlobalStatic>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThreadStorage>
+#include <QDateTime>
+#include <QStringList>
+#include <cmath>
+#include <limits>
+
+using namespace QHR;
+
+namespace {
+
+struct Limit {
+    int maxRequests = 0;
+    int interval = 0;
+};
+
+struct Bucket {
+    double tokens = 0;
+    qint64 lastRefill = 0;
+};
+
+struct RateLimits {
+    QMutex lock;
+    QHash<QString, Limit> limits;
+    QHash<QByteArray, Bucket> buckets;
+};
+
+}
+
+Q_GLOBAL_STATIC(RateLimits, rateLimits)
+
+RateLimiter *RateLimiter::instance()
+{
+    static QThreadStorage<RateLimiter*> limiters;
+    if (!limiters.hasLocalData()) {
+        limiters.setLocalData(new RateLimiter);
+    }
+    return limiters.localData();
+}
+
+RateLimiter::RateLimiter()
+{
+    m_timer.setSingleShot(true);
+    QObject::connect(&m_timer, &QTimer::timeout, &m_timer, [this](){
+        processQueues();
+    });
+}
+
+RateLimiter::~RateLimiter() = default;
+
+bool RateLimiter::acquire(JobPrivate *job)
+{
+    const QString ep = job->endpoint();
+    const QByteArray key = job->account().toUtf8() + ' ' + ep.toUtf8();
+
+    auto it = m_queues.find(key);
+    if (it == m_queues.end() || it->jobs.empty()) {
+        const qint64 wait = takeToken(key, ep);
+        if (wait <= 0) {
+            return true;
+        }
+        scheduleTimer(wait);
+        if (it == m_queues.end()) {
+            it = m_queues.insert(key, Queue());
+            it->endpoint = ep;
+        }
+    }
+
+    qCInfo(qhrCore) << "Request limit for" << ep << "reached, queueing" << job->q_ptr;
+    it->jobs.enqueue(job);
+    job->rateLimitKey = key;
+    job->metrics.mark(JobMetrics::Queued);
+    JobMetrics::count(&MetricsRegistry::queued);
+
+    return false;
+}
+
+bool RateLimiter::tryAcquire(const QByteArray &bucketKey, const QString &endpoint)
+{
+    return takeToken(bucketKey, endpoint) <= 0;
+}
+
+void RateLimiter::cancel(JobPrivate *job)
+{
+    if (job->rateLimitKey.isEmpty()) {
+        return;
+    }
+
+    auto it = m_queues.find(job->rateLimitKey);
+    if (it != m_queues.end()) {
+        it->jobs.removeAll(job);
+        if (it->jobs.empty()) {
+            m_queues.erase(it);
+        }
+    }
+    job->rateLimitKey.clear();
+}
+
+void RateLimiter::setLimit(const QString &endpoint, int maxRequests, int interval)
+{
+    RateLimits *rl = rateLimits();
+    QMutexLocker locker(&rl->lock);
+    if (maxRequests > 0 && interval > 0) {
+        Limit l;
+        l.maxRequests = maxRequests;
+        l.interval = interval;
+        rl->limits.insert(endpoint, l);
+    } else {
+        rl->limits.remove(endpoint);
+    }
+}
+
+void RateLimiter::limitExceeded(const QByteArray &bucketKey, const QString &endpoint, int maxRequests, int interval)
+{
+    qCWarning(qhrCore) << "Request limit for" << endpoint << "exceeded:" << maxRequests << "requests per" << interval << "seconds.";
+
+    RateLimits *rl = rateLimits();
+    QMutexLocker locker(&rl->lock);
+    if (maxRequests > 0 && interval > 0) {
+        Limit &l = rl->limits[endpoint];
+        l.maxRequests = maxRequests;
+        l.interval = interval;
+    }
+
+    // the API told us that there is no budget left, so start from an empty bucket
+    Bucket &b = rl->buckets[bucketKey];
+    b.tokens = 0;
+    b.lastRefill = QDateTime::currentMSecsSinceEpoch();
+}
+
+QString RateLimiter::endpoint(NetworkOperation operation, const QString &path)
+{
+    // Replace path segments that are parameters like server numbers or IP
+    // addresses, so that /server/123 and /server/456 share the same limit.
+    QString ep = JobPrivate::operationName(operation) + QLatin1Char(' ');
+    const QStringList parts = path.split(QLatin1Char('/'));
+    for (const QString &part : parts) {
+        if (part.isEmpty()) {
+            continue;
+        }
+        ep += QLatin1Char('/');
+        bool isParam = true;
+        for (const QChar &c : part) {
+            if (!c.isDigit()) {
+                isParam = part.contains(QLatin1Char('.')) || part.contains(QLatin1Char(':'));
+                break;
+            }
+        }
+        if (isParam) {
+            ep += QLatin1String("{}");
+        } else {
+            ep += part;
+        }
+    }
+
+    return ep;
+}
+
+qint64 RateLimiter::takeToken(const QByteArray &bucketKey, const QString &endpoint)
+{
+    RateLimits *rl = rateLimits();
+    QMutexLocker locker(&rl->lock);
+
+    const Limit l = rl->limits.value(endpoint);
+    if (l.maxRequests <= 0 || l.interval <= 0) {
+        return 0;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const double rate = static_cast<double>(l.maxRequests) / (static_cast<double>(l.interval) * 1000.0);
+
+    auto it = rl->buckets.find(bucketKey);
+    if (it == rl->buckets.end()) {
+        it = rl->buckets.insert(bucketKey, Bucket());
+        it->tokens = l.maxRequests;
+    } else {
+        it->tokens = qMin(static_cast<double>(l.maxRequests), it->tokens + static_cast<double>(now - it->lastRefill) * rate);
+    }
+    it->lastRefill = now;
+
+    if (it->tokens >= 1.0) {
+        it->tokens -= 1.0;
+        return 0;
+    }
+
+    return qMax<qint64>(1, static_cast<qint64>(std::ceil((1.0 - it->tokens) / rate)));
+}
+
+void RateLimiter::processQueues()
+{
+    QVector<JobPrivate*> ready;
+    qint64 nextWait = 0;
+
+    auto it = m_queues.begin();
+    while (it != m_queues.end()) {
+        while (!it->jobs.empty()) {
+            const qint64 wait = takeToken(it.key(), it->endpoint);
+            if (wait > 0) {
+                nextWait = nextWait > 0 ? qMin(nextWait, wait) : wait;
+                break;
+            }
+            JobPrivate *job = it->jobs.dequeue();
+            job->rateLimitKey.clear();
+            ready.push_back(job);
+        }
+        if (it->jobs.empty()) {
+            it = m_queues.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (nextWait > 0) {
+        scheduleTimer(nextWait);
+    }
+
+    for (JobPrivate *job : qAsConst(ready)) {
+        job->dispatchRequest();
+    }
+}
+
+void RateLimiter::scheduleTimer(qint64 msecs)
+{
+    const int interval = static_cast<int>(qMin<qint64>(msecs, std::numeric_limits<int>::max()));
+    if (!m_timer.isActive() || m_timer.remainingTime() > interval) {
+        m_timer.start(interval);
+    }
+}
+
+void QHR::setRateLimit(const QString &endpoint, int maxRequests, int interval)
+{
+    qCDebug(qhrCore) << "Setting rate limit for" << endpoint << "to" << maxRequests << "requests per" << interval << "seconds";
+    RateLimiter::setLimit(endpoint, maxRequests, interval);
+}
@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_RATELIMITER_P_H
+#define QHR_RATELIMITER_P_H
+
+#include "job_p.h"
+#include <QHash>
+#include <QQueue>
+#include <QTimer>
+
+namespace QHR {
+
+/*!
+ * \internal
+ * \brief Token bucket scheduler for the request limits of the API.
+ *
+ * Buckets are shared by all threads and identified by account and endpoint.
+ * Every thread has its own instance holding the queue of jobs that wait for
+ * their bucket to be refilled.
+ */
+class RateLimiter
+{
+public:
+    static RateLimiter *instance();
+
+    ~RateLimiter();
+
+    bool acquire(JobPrivate *job);
+
+    void cancel(JobPrivate *job);
+
+    static bool tryAcquire(const QByteArray &bucketKey, const QString &endpoint);
+
+    static qint64 takeToken(const QByteArray &bucketKey, const QString &endpoint);
+
+    static void setLimit(const QString &endpoint, int maxRequests, int interval);
+
+    static void limitExceeded(const QByteArray &bucketKey, const QString &endpoint, int maxRequests, int interval);
+
+    static QString endpoint(NetworkOperation operation, const QString &path);
+
+private:
+    RateLimiter();
+
+    void processQueues();
+
+    void scheduleTimer(qint64 msecs);
+
+    struct Queue {
+        QString endpoint;
+        QQueue<JobPrivate*> jobs;
+    };
+
+    QHash<QByteArray, Queue> m_queues;
+    QTimer m_timer;
+
+    Q_DISABLE_COPY(RateLimiter)
+};
+
+}
+
+#endif // QHR_RATELIMITER_P_H
@@ -0,0 +1,383 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "rdnsreconciler_p.h"
+#include "endpoints.h"
+#include "logging.h"
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QPair>
+#include <QSet>
+#include <algorithm>
+
+using namespace QHR;
+
+RdnsReconcilerPrivate::RdnsReconcilerPrivate(RdnsReconciler *q)
+    : q_ptr(q)
+{
+
+}
+
+RdnsReconcilerPrivate::~RdnsReconcilerPrivate() = default;
+
+QString RdnsReconcilerPrivate::normalizedIp(const QString &ip)
+{
+    const QString trimmed = ip.trimmed();
+    const QHostAddress address(trimmed);
+    return address.isNull() ? trimmed.toLower() : address.toString();
+}
+
+QString RdnsReconcilerPrivate::normalizedPtr(const QString &ptr)
+{
+    QString normalized = ptr.trimmed().toLower();
+    if (normalized.endsWith(QLatin1Char('.'))) {
+        normalized.chop(1);
+    }
+    return normalized;
+}
+
+QVector<RdnsChange> RdnsReconcilerPrivate::diff(const QHash<QString, QString> &current, const QHash<QString, QString> &desired, bool deleteUnlisted, int *unchanged)
+{
+    // normalized IP -> (IP as listed, PTR)
+    QHash<QString, QPair<QString, QString>> listed;
+    listed.reserve(current.size());
+    for (auto it = current.cbegin(), end = current.cend(); it != end; ++it) {
+        listed.insert(normalizedIp(it.key()), qMakePair(it.key(), it.value()));
+    }
+
+    QVector<RdnsChange> changes;
+    QSet<QString> seen;
+    seen.reserve(desired.size());
+    int _unchanged = 0;
+
+    for (auto it = desired.cbegin(), end = desired.cend(); it != end; ++it) {
+        const QString ip = normalizedIp(it.key());
+        if (Q_UNLIKELY(seen.contains(ip))) {
+            qCWarning(qhrCore) << "Skipping duplicate IP address" << it.key() << "in desired reverse DNS state.";
+            continue;
+        }
+        seen.insert(ip);
+
+        const auto found = listed.constFind(ip);
+        const bool exists = found != listed.cend();
+
+        RdnsChange change;
+        change.ip = it.key().trimmed();
+        change.ptr = it.value().trimmed();
+
+        if (change.ptr.isEmpty()) {
+            if (!exists) {
+                ++_unchanged;
+                continue;
+            }
+            change.action = RdnsChange::Delete;
+            change.previousPtr = found.value().second;
+        } else if (!exists) {
+            change.action = RdnsChange::Create;
+        } else if (normalizedPtr(found.value().second) == normalizedPtr(change.ptr)) {
+            ++_unchanged;
+            continue;
+        } else {
+            change.action = RdnsChange::Update;
+            change.previousPtr = found.value().second;
+        }
+
+        changes.push_back(change);
+    }
+
+    if (deleteUnlisted) {
+        for (auto it = listed.cbegin(), end = listed.cend(); it != end; ++it) {
+            if (!seen.contains(it.key())) {
+                RdnsChange change;
+                change.ip = it.value().first;
+                change.previousPtr = it.value().second;
+                change.action = RdnsChange::Delete;
+                changes.push_back(change);
+            }
+        }
+    }
+
+    std::sort(changes.begin(), changes.end(), [](const RdnsChange &a, const RdnsChange &b){
+        return a.ip < b.ip;
+    });
+
+    if (unchanged) {
+        *unchanged = _unchanged;
+    }
+
+    return changes;
+}
+
+void RdnsReconcilerPrivate::listingFinished(const Response &response)
+{
+    Q_Q(RdnsReconciler);
+
+    if (!response.isOk()) {
+        qCWarning(qhrCore) << "Failed to get reverse DNS listing:" << response.errorString;
+        running = false;
+        Q_EMIT q->listingFailed(response.error, response.errorString);
+        return;
+    }
+
+    const QJsonArray entries = response.json.array();
+    QHash<QString, QString> current;
+    current.reserve(entries.size());
+    for (const QJsonValue &v : entries) {
+        const QJsonObject json = v.toObject();
+        const QJsonValue wrapped = json.value(QStringLiteral("rdns"));
+        const QJsonObject rdns = wrapped.isObject() ? wrapped.toObject() : json;
+        const QString ip = rdns.value(QStringLiteral("ip")).toString();
+        if (!ip.isEmpty()) {
+            current.insert(ip, rdns.value(QStringLiteral("ptr")).toString());
+        }
+    }
+
+    changes = diff(current, desired, deleteUnlisted, &unchanged);
+    done.fill(false, changes.size());
+    remaining = changes.size();
+
+    qCDebug(qhrCore) << "Reverse DNS reconciliation:" << current.size() << "listed," << changes.size() << "changes," << unchanged << "unchanged";
+
+    if (changes.empty()) {
+        finish();
+        return;
+    }
+
+    const quint32 currentRun = run;
+    for (int i = 0; i < changes.size() && running && currentRun == run; ++i) {
+        submitChange(i);
+    }
+}
+
+void RdnsReconcilerPrivate::submitChange(int index)
+{
+    const RdnsChange &change = changes.at(index);
+
+    Request request;
+    switch (change.action) {
+    case RdnsChange::Create:
+        request = makeRequest<Endpoints::RdnsCreate>(change.ip);
+        request.form.addQueryItem(QStringLiteral("ptr"), change.ptr);
+        break;
+    case RdnsChange::Update:
+        request = makeRequest<Endpoints::RdnsUpdate>(change.ip);
+        request.form.addQueryItem(QStringLiteral("ptr"), change.ptr);
+        break;
+    case RdnsChange::Delete:
+        request = makeRequest<Endpoints::RdnsDelete>(change.ip);
+        break;
+    }
+    request.tag = static_cast<quint64>(index);
+
+    const quint32 currentRun = run;
+    executor->submit(request, [this, currentRun, index](const Response &response){
+        if (currentRun == run) {
+            changeFinished(index, response);
+        }
+    });
+}
+
+void RdnsReconcilerPrivate::changeFinished(int index, const Response &response)
+{
+    Q_Q(RdnsReconciler);
+
+    RdnsChange &change = changes[index];
+
+    if (response.error == Conflict && change.action == RdnsChange::Create) {
+        // the entry has been created in the meantime
+        qCDebug(qhrCore) << "Reverse DNS entry for" << change.ip << "already exists, updating it.";
+        change.action = RdnsChange::Update;
+        submitChange(index);
+        return;
+    }
+
+    if (response.error == NotFound && change.action == RdnsChange::Delete) {
+        // already in the desired state
+        change.error = 0;
+    } else {
+        change.error = response.error;
+        change.errorString = response.errorString;
+    }
+
+    if (!change.isOk()) {
+        qCWarning(qhrCore) << "Failed to apply reverse DNS change for" << change.ip << ":" << change.errorString;
+    }
+
+    done[index] = true;
+    --remaining;
+
+    Q_EMIT q->changeFinished(change);
+
+    if (remaining == 0 && running) {
+        finish();
+    }
+}
+
+void RdnsReconcilerPrivate::finish()
+{
+    Q_Q(RdnsReconciler);
+
+    running = false;
+
+    int succeeded = 0;
+    for (const RdnsChange &change : changes) {
+        if (change.isOk()) {
+            ++succeeded;
+        }
+    }
+
+    Q_EMIT q->finished(succeeded, changes.size() - succeeded, unchanged);
+}
+
+RdnsReconciler::RdnsReconciler(QObject *parent)
+    : QObject(parent), rrd_ptr(new RdnsReconcilerPrivate(this))
+{
+
+}
+
+RdnsReconciler::~RdnsReconciler() = default;
+
+void RdnsReconciler::setConfiguration(AbstractConfiguration *configuration)
+{
+    Q_D(RdnsReconciler);
+    d->configuration = configuration;
+}
+
+QHash<QString, QString> RdnsReconciler::desired() const
+{
+    Q_D(const RdnsReconciler);
+    return d->desired;
+}
+
+void RdnsReconciler::setDesired(const QHash<QString, QString> &desired)
+{
+    Q_D(RdnsReconciler);
+    d->desired = desired;
+}
+
+QString RdnsReconciler::serverIp() const
+{
+    Q_D(const RdnsReconciler);
+    return d->serverIp;
+}
+
+void RdnsReconciler::setServerIp(const QString &serverIp)
+{
+    Q_D(RdnsReconciler);
+    d->serverIp = serverIp;
+}
+
+bool RdnsReconciler::deleteUnlisted() const
+{
+    Q_D(const RdnsReconciler);
+    return d->deleteUnlisted;
+}
+
+void RdnsReconciler::setDeleteUnlisted(bool deleteUnlisted)
+{
+    Q_D(RdnsReconciler);
+    d->deleteUnlisted = deleteUnlisted;
+}
+
+int RdnsReconciler::maxConcurrent() const
+{
+    Q_D(const RdnsReconciler);
+    return d->maxConcurrent;
+}
+
+void RdnsReconciler::setMaxConcurrent(int maxConcurrent)
+{
+    Q_D(RdnsReconciler);
+    d->maxConcurrent = std::max(1, maxConcurrent);
+    if (d->executor) {
+        d->executor->setMaxInFlight(d->maxConcurrent);
+    }
+}
+
+bool RdnsReconciler::isRunning() const
+{
+    Q_D(const RdnsReconciler);
+    return d->running;
+}
+
+QVector<RdnsChange> RdnsReconciler::changes() const
+{
+    Q_D(const RdnsReconciler);
+    return d->changes;
+}
+
+QVector<RdnsChange> RdnsReconciler::diff(const QHash<QString, QString> &current, const QHash<QString, QString> &desired, bool deleteUnlisted)
+{
+    return RdnsReconcilerPrivate::diff(current, desired, deleteUnlisted, nullptr);
+}
+
+void RdnsReconciler::start()
+{
+    Q_D(RdnsReconciler);
+
+    if (d->running) {
+        qCDebug(qhrCore) << "Reverse DNS reconciliation already running.";
+        return;
+    }
+
+    if (!d->executor || d->executorConfiguration != d->configuration) {
+        d->executor.reset(new RequestExecutor(d->configuration));
+        d->executorConfiguration = d->configuration;
+    }
+    d->executor->setMaxInFlight(d->maxConcurrent);
+
+    d->running = true;
+    ++d->run;
+    d->changes.clear();
+    d->done.clear();
+    d->remaining = 0;
+    d->unchanged = 0;
+
+    Request request = makeRequest<Endpoints::RdnsList>();
+    if (!d->serverIp.isEmpty()) {
+        request.query.addQueryItem(QStringLiteral("server_ip"), d->serverIp);
+    }
+
+    const quint32 currentRun = d->run;
+    d->executor->submit(request, [d, currentRun](const Response &response){
+        if (currentRun == d->run) {
+            d->listingFinished(response);
+        }
+    });
+}
+
+void RdnsReconciler::abort()
+{
+    Q_D(RdnsReconciler);
+
+    if (!d->running) {
+        return;
+    }
+
+    qCDebug(qhrCore) << "Aborting reverse DNS reconciliation.";
+
+    ++d->run;
+    d->executor->abortAll();
+
+    //: Error message if a reverse DNS change has not been applied because the reconciliation has been aborted.
+    //% "The reverse DNS change has been aborted."
+    const QString errorString = qtTrId("libqhr-error-rdns-change-aborted");
+
+    for (int i = 0; i < d->changes.size(); ++i) {
+        if (!d->done.at(i)) {
+            RdnsChange &change = d->changes[i];
+            change.error = BJob::KilledJobError;
+            change.errorString = errorString;
+            d->done[i] = true;
+            Q_EMIT changeFinished(change);
+        }
+    }
+    d->remaining = 0;
+
+    d->finish();
+}
+
+#include "moc_rdnsreconciler.cpp"
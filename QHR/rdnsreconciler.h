@@ -0,0 +1,198 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_RDNSRECONCILER_H
+#define QHR_RDNSRECONCILER_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QMetaType>
+#include "qhr_global.h"
+#include <memory>
+
+namespace QHR {
+
+class RdnsReconcilerPrivate;
+class AbstractConfiguration;
+
+/*!
+ * \brief A single reverse DNS change and its outcome.
+ *
+ * \headerfile "" <QHR/RdnsReconciler>
+ */
+struct RdnsChange
+{
+    /*!
+     * \brief The request needed to apply the change.
+     */
+    enum Action : quint8 {
+        Create = 0,     /**< No entry exists, \c PUT /rdns/{ip} */
+        Update,         /**< The entry has a different PTR, \c POST /rdns/{ip} */
+        Delete          /**< The entry has to be removed, \c DELETE /rdns/{ip} */
+    };
+
+    QString ip;
+    QString ptr;            /**< Desired PTR, empty for Delete. */
+    QString previousPtr;    /**< PTR before the change, empty for Create. */
+    QString errorString;    /**< Human readable and translated error string if the change failed. */
+    int error = 0;          /**< BJob::NoError or one of the error codes of Job. */
+    Action action = Create;
+
+    bool isOk() const { return error == 0; }
+};
+
+/*!
+ * \brief Brings the reverse DNS entries of many IP addresses into a desired state.
+ *
+ * Instead of sending one request per IP address, start() fetches the complete \c /rdns
+ * listing with a single request, optionally restricted to a single server via setServerIp().
+ * The listing is compared with the map set via setDesired() and only the entries that
+ * differ are written: missing entries are created, entries with a different PTR are updated
+ * and entries with an empty desired PTR are deleted. IP addresses are compared in their
+ * canonical form and PTRs case-insensitively without a trailing dot, so entries that only
+ * differ in notation do not cause requests.
+ *
+ * The changes are sent by a RequestExecutor with at most \link RdnsReconciler::maxConcurrent
+ * maxConcurrent\endlink requests in flight and with the usual rate limiting and retries.
+ * changeFinished() is emitted for every single change, finished() after all changes have
+ * been applied.
+ *
+ * \headerfile "" <QHR/RdnsReconciler>
+ */
+class QHR_LIBRARY RdnsReconciler : public QObject
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief Constructs a new %RdnsReconciler object with the given \a parent.
+     */
+    explicit RdnsReconciler(QObject *parent = nullptr);
+
+    /*!
+     * \brief Destroys the %RdnsReconciler object, aborting all running requests.
+     */
+    ~RdnsReconciler() override;
+
+    /*!
+     * \brief Sets the \a configuration used for the requests.
+     *
+     * If not set, QHR::defaultConfiguration() will be used. Has no effect on a running reconciliation.
+     */
+    void setConfiguration(AbstractConfiguration *configuration);
+
+    /*!
+     * \brief Returns the desired state as map from IP address to PTR.
+     */
+    QHash<QString, QString> desired() const;
+
+    /*!
+     * \brief Sets the \a desired state as map from IP address to PTR.
+     *
+     * An empty PTR deletes the entry of the IP address.
+     */
+    void setDesired(const QHash<QString, QString> &desired);
+
+    /*!
+     * \brief Returns the server IP the listing is restricted to.
+     */
+    QString serverIp() const;
+
+    /*!
+     * \brief Restricts the listing to the IP addresses of the server with the main \a serverIp.
+     *
+     * By default, the listing contains all entries of the account.
+     */
+    void setServerIp(const QString &serverIp);
+
+    /*!
+     * \brief Returns \c true if listed entries missing in the desired state will be deleted.
+     */
+    bool deleteUnlisted() const;
+
+    /*!
+     * \brief Set \a deleteUnlisted to \c true to delete all listed entries that are not part of the desired state.
+     *
+     * The default value is \c false. Use it together with setServerIp(), otherwise all entries
+     * of the account that are not part of the desired state will be deleted.
+     */
+    void setDeleteUnlisted(bool deleteUnlisted);
+
+    /*!
+     * \brief Returns the maximum number of concurrent write requests.
+     */
+    int maxConcurrent() const;
+
+    /*!
+     * \brief Sets the maximum number of concurrent write requests, the default value is \c 4.
+     */
+    void setMaxConcurrent(int maxConcurrent);
+
+    /*!
+     * \brief Returns \c true while a reconciliation is running.
+     */
+    bool isRunning() const;
+
+    /*!
+     * \brief Returns the changes of the last reconciliation together with their outcomes.
+     */
+    QVector<RdnsChange> changes() const;
+
+    /*!
+     * \brief Returns the changes needed to bring \a current into the \a desired state.
+     *
+     * Both maps use the IP address as key and the PTR as value. If \a deleteUnlisted is
+     * \c true, entries in \a current that are not part of \a desired will be deleted.
+     * The changes are sorted by IP address.
+     */
+    static QVector<RdnsChange> diff(const QHash<QString, QString> &current, const QHash<QString, QString> &desired, bool deleteUnlisted = false);
+
+public Q_SLOTS:
+    /*!
+     * \brief Fetches the listing and applies the needed changes.
+     *
+     * Does nothing if a reconciliation is already running.
+     */
+    void start();
+
+    /*!
+     * \brief Aborts a running reconciliation.
+     *
+     * Changes that have not been finished are reported with BJob::KilledJobError.
+     */
+    void abort();
+
+Q_SIGNALS:
+    /*!
+     * \brief Emitted for every applied \a change, check RdnsChange::error for the outcome.
+     */
+    void changeFinished(const QHR::RdnsChange &change);
+
+    /*!
+     * \brief Emitted after all changes have been processed.
+     *
+     * \a unchanged is the number of entries of the desired state that already had the desired PTR.
+     */
+    void finished(int succeeded, int failed, int unchanged);
+
+    /*!
+     * \brief Emitted if the listing could not be fetched, no changes will be made.
+     */
+    void listingFailed(int error, const QString &errorString);
+
+protected:
+    const std::unique_ptr<RdnsReconcilerPrivate> rrd_ptr;
+
+private:
+    Q_DECLARE_PRIVATE_D(rrd_ptr, RdnsReconciler)
+    Q_DISABLE_COPY(RdnsReconciler)
+};
+
+}
+
+Q_DECLARE_METATYPE(QHR::RdnsChange)
+
+#endif // QHR_RDNSRECONCILER_H
@@ -0,0 +1,59 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_RDNSRECONCILER_P_H
+#define QHR_RDNSRECONCILER_P_H
+
+#include "rdnsreconciler.h"
+#include "requestexecutor.h"
+
+namespace QHR {
+
+class RdnsReconcilerPrivate
+{
+public:
+    explicit RdnsReconcilerPrivate(RdnsReconciler *q);
+    ~RdnsReconcilerPrivate();
+
+    static QString normalizedIp(const QString &ip);
+
+    static QString normalizedPtr(const QString &ptr);
+
+    static QVector<RdnsChange> diff(const QHash<QString, QString> &current, const QHash<QString, QString> &desired, bool deleteUnlisted, int *unchanged);
+
+    void listingFinished(const Response &response);
+
+    void submitChange(int index);
+
+    void changeFinished(int index, const Response &response);
+
+    void finish();
+
+    QHash<QString, QString> desired;
+    QVector<RdnsChange> changes;
+    QVector<bool> done;
+    QString serverIp;
+    std::unique_ptr<RequestExecutor> executor;
+    AbstractConfiguration *configuration = nullptr;
+    AbstractConfiguration *executorConfiguration = nullptr;
+    // increased for every run, callbacks of aborted runs are ignored
+    quint32 run = 0;
+    int maxConcurrent = 4;
+    int remaining = 0;
+    int unchanged = 0;
+    bool deleteUnlisted = false;
+    bool running = false;
+
+protected:
+    RdnsReconciler *q_ptr = nullptr;
+
+private:
+    Q_DISABLE_COPY(RdnsReconcilerPrivate)
+    Q_DECLARE_PUBLIC(RdnsReconciler)
+};
+
+}
+
+#endif // QHR_RDNSRECONCILER_P_H
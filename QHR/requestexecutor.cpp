@@ -0,0 +1,718 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "requestexecutor_p.h"
+#include "abstractnamfactory.h"
+#include "abstractcredentialprovider.h"
+#include "ratelimiter_p.h"
+#include "responsecache_p.h"
+#include <QNetworkAccessManager>
+#include <QJsonParseError>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDateTime>
+#include <algorithm>
+
+using namespace QHR;
+
+RequestExecutorPrivate::RequestExecutorPrivate(RequestExecutor *q, AbstractConfiguration *config)
+    : retryPolicy(QHR::defaultRetryPolicy()), configuration(config), q_ptr(q)
+{
+    throttleTimer.setSingleShot(true);
+    QObject::connect(&throttleTimer, &QTimer::timeout, &context, [this](){
+        schedule();
+    });
+
+#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
+    timeoutTimer.setInterval(1000);
+    timeoutTimer.setTimerType(Qt::VeryCoarseTimer);
+    QObject::connect(&timeoutTimer, &QTimer::timeout, &context, [this](){
+        checkTimeouts();
+    });
+#endif
+}
+
+RequestExecutorPrivate::~RequestExecutorPrivate() = default;
+
+NetworkOperation RequestExecutorPrivate::networkOperation(Request::Operation operation)
+{
+    switch (operation) {
+    case Request::Put:
+        return NetworkOperation::Put;
+    case Request::Post:
+        return NetworkOperation::Post;
+    case Request::Delete:
+        return NetworkOperation::Delete;
+    default:
+        return NetworkOperation::Get;
+    }
+}
+
+AbstractConfiguration *RequestExecutorPrivate::activeConfiguration() const
+{
+    return configuration ? configuration : QHR::defaultConfiguration();
+}
+
+RequestState *RequestExecutorPrivate::prepareState(Request &&request, RequestExecutor::Callback &&callback)
+{
+    AbstractConfiguration *config = activeConfiguration();
+    Q_ASSERT(config);
+
+    RequestState *state = nullptr;
+    if (freeStates.empty()) {
+        pool.emplace_back(new RequestState);
+        state = pool.back().get();
+    } else {
+        state = freeStates.back();
+        freeStates.pop_back();
+    }
+
+    state->request = std::move(request);
+    state->callback = std::move(callback);
+    state->attempts = 0;
+
+    QUrl url = config->baseUrl();
+    QString basePath = url.path();
+    if (basePath.endsWith(QLatin1Char('/'))) {
+        basePath.chop(1);
+    }
+    url.setPath(basePath + state->request.path);
+    if (!state->request.query.isEmpty()) {
+        url.setQuery(state->request.query);
+    }
+
+    QNetworkRequest &nr = state->networkRequest;
+    nr = QNetworkRequest(url);
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0))
+    nr.setTransferTimeout(static_cast<int>(requestTimeout) * 1000);
+#endif
+
+    if (userAgent.isEmpty()) {
+        userAgent = config->userAgent().toUtf8();
+    }
+    nr.setRawHeader(QByteArrayLiteral("User-Agent"), userAgent);
+
+    if (state->request.expectedContent != Request::NoContent) {
+        nr.setRawHeader(QByteArrayLiteral("Accept"), QByteArrayLiteral("application/json"));
+    }
+
+    if (state->request.operation == Request::Put || state->request.operation == Request::Post) {
+        nr.setRawHeader(QByteArrayLiteral("Content-Type"), QByteArrayLiteral("application/x-www-form-urlencoded"));
+        state->payload = state->request.form.toString(QUrl::FullyEncoded).toUtf8();
+    } else {
+        state->payload.clear();
+    }
+
+    state->protocolOptions = JobPrivate::applyProtocolOptions(nr, config, networkOperation(state->request.operation));
+
+    if (authHeader.isEmpty()) {
+        if (credentialProvider) {
+            authHeader = credentialProvider->authorizationHeader();
+        } else {
+            const QString auth = config->username() + QLatin1Char(':') + config->password();
+            authHeader = QByteArrayLiteral("Basic ") + auth.toUtf8().toBase64();
+        }
+    }
+    if (state->request.requiresAuth) {
+        nr.setRawHeader(QByteArrayLiteral("Authorization"), authHeader);
+    }
+
+    state->endpoint = RateLimiter::endpoint(networkOperation(state->request.operation), url.path());
+    state->rateLimitKey = account.toUtf8() + ' ' + state->endpoint.toUtf8();
+
+    return state;
+}
+
+void RequestExecutorPrivate::releaseState(RequestState *state)
+{
+    // keep the allocated capacity, only drop the references
+    state->request = Request();
+    state->callback = nullptr;
+    state->reply = nullptr;
+    ++state->serial;
+    freeStates.push_back(state);
+}
+
+void RequestExecutorPrivate::schedule()
+{
+    if (waitingForCredentials || throttleTimer.isActive() || pending.empty()) {
+        return;
+    }
+
+    AbstractConfiguration *config = activeConfiguration();
+    if (Q_UNLIKELY(!config)) {
+        qCCritical(qhrCore) << "Can not send requests: missing configuration.";
+        failPending(MissingConfig);
+        return;
+    }
+
+    if (!checkCredentials(config)) {
+        return;
+    }
+
+    // the callbacks might destroy the executor, so invoke them after the loop
+    std::vector<std::pair<RequestExecutor::Callback,Response>> failed;
+
+    while (!pending.empty() && (maxInFlight <= 0 || static_cast<int>(inFlight.size()) < maxInFlight)) {
+        PendingRequest &next = pending.front();
+        RequestState *state = prepareState(std::move(next.request), std::move(next.callback));
+        pending.pop_front();
+
+        const QUrl url = state->networkRequest.url();
+        if (Q_UNLIKELY(state->request.path.isNull())) {
+            // makeRequest() got an invalid path argument
+            Response response;
+            response.tag = state->request.tag;
+            response.error = InvalidInput;
+            response.errorString = JobPrivate::errorMessage(InvalidInput, QStringLiteral("path"));
+            failed.emplace_back(std::move(state->callback), std::move(response));
+            releaseState(state);
+            continue;
+        }
+
+        if (Q_UNLIKELY(!url.isValid())) {
+            Response response;
+            response.tag = state->request.tag;
+            response.error = InvalidRequestUrl;
+            response.errorString = JobPrivate::errorMessage(InvalidRequestUrl, url.toString());
+            failed.emplace_back(std::move(state->callback), std::move(response));
+            releaseState(state);
+            continue;
+        }
+
+        const qint64 wait = RateLimiter::takeToken(state->rateLimitKey, state->endpoint);
+        if (wait > 0) {
+            qCDebug(qhrCore) << "Request limit for" << state->endpoint << "reached, waiting" << wait << "ms";
+            pending.push_front(PendingRequest{std::move(state->request), std::move(state->callback)});
+            releaseState(state);
+            throttleTimer.start(static_cast<int>(wait));
+            break;
+        }
+
+        inFlight.push_back(state);
+        dispatch(state);
+    }
+
+    for (auto &f : failed) {
+        f.first(f.second);
+    }
+}
+
+bool RequestExecutorPrivate::checkCredentials(AbstractConfiguration *config)
+{
+    credentialProvider = config->credentialProvider();
+    if (credentialProvider && !credentialProvider->isReady()) {
+        waitForCredentials();
+        return false;
+    }
+
+    if (account.isEmpty()) {
+        account = credentialProvider ? credentialProvider->username() : config->username();
+    }
+
+    if (Q_UNLIKELY(account.isEmpty())) {
+        qCCritical(qhrCore) << "Can not send requests: missing username.";
+        failPending(MissingUser);
+        return false;
+    }
+
+    if (Q_UNLIKELY(credentialProvider ? credentialProvider->authorizationHeader().isEmpty() : config->password().isEmpty())) {
+        qCCritical(qhrCore) << "Can not send requests: missing password.";
+        failPending(MissingPassword);
+        return false;
+    }
+
+    return true;
+}
+
+void RequestExecutorPrivate::waitForCredentials()
+{
+    if (waitingForCredentials) {
+        return;
+    }
+    waitingForCredentials = true;
+
+    AbstractCredentialProvider *provider = credentialProvider.data();
+
+    credentialConnections[0] = QObject::connect(provider, &AbstractCredentialProvider::credentialsReady, &context, [this](){
+        QObject::disconnect(credentialConnections[0]);
+        QObject::disconnect(credentialConnections[1]);
+        waitingForCredentials = false;
+        authHeader.clear();
+        account.clear();
+        schedule();
+    });
+
+    credentialConnections[1] = QObject::connect(provider, &AbstractCredentialProvider::credentialsFailed, &context, [this](const QString &errorString){
+        QObject::disconnect(credentialConnections[0]);
+        QObject::disconnect(credentialConnections[1]);
+        waitingForCredentials = false;
+        failPending(CredentialsUnavailable, errorString);
+    });
+
+    QMetaObject::invokeMethod(provider, "requestCredentials");
+}
+
+QNetworkAccessManager *RequestExecutorPrivate::networkAccessManager()
+{
+    if (!nam) {
+        auto namf = QHR::networkAccessManagerFactory();
+        if (namf) {
+            nam = namf->create(nullptr);
+            ownsNam = true;
+        } else {
+            nam = JobPrivate::pooledNetworkAccessManager();
+        }
+
+        // one connection for all requests instead of one per reply, the pooled
+        // manager might also be used by jobs, their replies are ignored
+        QObject::connect(nam, &QNetworkAccessManager::finished, &context, [this](QNetworkReply *reply){
+            replyFinished(reply);
+        });
+    }
+    return nam;
+}
+
+void RequestExecutorPrivate::dispatch(RequestState *state)
+{
+    QNetworkAccessManager *manager = networkAccessManager();
+    ++state->attempts;
+
+    switch (state->request.operation) {
+    case Request::Put:
+        state->reply = manager->put(state->networkRequest, state->payload);
+        break;
+    case Request::Post:
+        state->reply = manager->post(state->networkRequest, state->payload);
+        break;
+    case Request::Delete:
+        state->reply = manager->deleteResource(state->networkRequest);
+        break;
+    default:
+        state->reply = manager->get(state->networkRequest);
+        break;
+    }
+
+#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
+    state->deadline = QDateTime::currentMSecsSinceEpoch() + static_cast<qint64>(requestTimeout) * 1000;
+    if (!timeoutTimer.isActive()) {
+        timeoutTimer.start();
+    }
+#endif
+}
+
+void RequestExecutorPrivate::replyFinished(QNetworkReply *reply)
+{
+    // inFlight is limited by maxInFlight, a linear search is cheaper than a hash
+    auto it = std::find_if(inFlight.begin(), inFlight.end(), [reply](RequestState *s){
+        return s->reply == reply;
+    });
+    if (it == inFlight.end()) {
+        return;
+    }
+
+    RequestState *state = *it;
+    state->reply = nullptr;
+
+    Response response;
+    response.tag = state->request.tag;
+    response.attempts = state->attempts;
+    response.httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    const QNetworkReply::NetworkError networkError = reply->error();
+
+    if (Q_UNLIKELY(networkError != QNetworkReply::NoError) && protocolFallback(state, networkError)) {
+        reply->deleteLater();
+        return;
+    }
+
+    // the request might have changed the resource even if we got an error
+    if (state->request.operation != Request::Get) {
+        invalidateCache(state);
+    }
+
+    const QByteArray data = reply->readAll();
+
+    if (Q_LIKELY(networkError == QNetworkReply::NoError)) {
+        readReply(data, state->request.expectedContent, response);
+    } else if (state->request.notFoundIsEmpty && response.httpStatus == 404) {
+        response.json = state->request.expectedContent == Request::JsonObject ? QJsonDocument(QJsonObject()) : QJsonDocument(QJsonArray());
+    } else {
+        readError(state, reply, data, response);
+    }
+
+    reply->deleteLater();
+
+    if (!response.isOk() && scheduleRetry(state, response, networkError)) {
+        return;
+    }
+
+    inFlight.erase(it);
+    RequestExecutor::Callback callback = std::move(state->callback);
+    releaseState(state);
+
+    // schedule before invoking the callback, the callback might destroy the executor
+    schedule();
+
+    callback(response);
+}
+
+bool RequestExecutorPrivate::protocolFallback(RequestState *state, QNetworkReply::NetworkError networkError)
+{
+    if (!JobPrivate::refuseProtocols(state->networkRequest.url(), state->protocolOptions, networkError)) {
+        return false;
+    }
+
+    // the server might have processed the request before closing the connection
+    if (state->request.operation == Request::Post) {
+        return false;
+    }
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 8, 0))
+    state->networkRequest.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
+#endif
+    state->networkRequest.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, false);
+    state->protocolOptions = NoProtocolOptions;
+
+    dispatchRetry(state, state->serial);
+    return true;
+}
+
+void RequestExecutorPrivate::invalidateCache(const RequestState *state) const
+{
+    AbstractConfiguration *config = activeConfiguration();
+    ResponseCache *cache = config ? config->responseCache() : QHR::responseCache();
+    if (!cache) {
+        return;
+    }
+
+    // use the header that has been sent, a 401 reply clears authHeader
+    const QByteArray secret = state->networkRequest.rawHeader(QByteArrayLiteral("Authorization"));
+    ResponseCachePrivate::get(cache)->invalidate(account, secret, state->networkRequest.url().path());
+}
+
+void RequestExecutorPrivate::readReply(const QByteArray &data, Request::Content expectedContent, Response &response) const
+{
+    if (expectedContent == Request::NoContent) {
+        return;
+    }
+
+    if (data.isEmpty()) {
+        response.error = EmptyReply;
+    } else {
+        QJsonParseError jsonError;
+        response.json = QJsonDocument::fromJson(data, &jsonError);
+        if (jsonError.error != QJsonParseError::NoError) {
+            response.error = JsonParseError;
+            response.errorString = JobPrivate::errorMessage(JsonParseError, jsonError.errorString());
+            return;
+        } else if (response.json.isNull() || response.json.isEmpty()) {
+            response.error = EmptyJson;
+        } else if ((expectedContent == Request::JsonArray && !response.json.isArray()) || (expectedContent == Request::JsonObject && !response.json.isObject())) {
+            response.error = WrongOutputType;
+        }
+    }
+
+    if (response.error != BJob::NoError) {
+        response.errorString = JobPrivate::errorMessage(response.error, QString());
+    }
+}
+
+void RequestExecutorPrivate::readError(RequestState *state, QNetworkReply *reply, const QByteArray &data, Response &response)
+{
+    const QJsonObject error = QJsonDocument::fromJson(data).object().value(QStringLiteral("error")).toObject();
+    response.apiErrorCode = error.value(QStringLiteral("code")).toString();
+
+    if (!response.apiErrorCode.isEmpty()) {
+        const QString message = error.value(QStringLiteral("message")).toString();
+        qCCritical(qhrCore) << "API error:" << response.apiErrorCode << message;
+        response.error = JobPrivate::errorForApiCode(response.apiErrorCode);
+        response.errorString = JobPrivate::errorMessage(response.error, message.isEmpty() ? response.apiErrorCode : message);
+
+        if (response.error == RateLimitExceeded) {
+            RateLimiter::limitExceeded(state->rateLimitKey, state->endpoint, error.value(QStringLiteral("max_request")).toInt(), error.value(QStringLiteral("interval")).toInt());
+        } else if (response.error == Unauthorized) {
+            authHeader.clear();
+            account.clear();
+            if (credentialProvider) {
+                QMetaObject::invokeMethod(credentialProvider.data(), "invalidate");
+            }
+        }
+    } else if (reply->error() == QNetworkReply::OperationCanceledError || reply->error() == QNetworkReply::TimeoutError) {
+        response.error = RequestTimedOut;
+        response.errorString = JobPrivate::errorMessage(RequestTimedOut, QString::number(requestTimeout));
+    } else {
+        qCCritical(qhrCore) << "Network error:" << reply->errorString();
+        response.error = NetworkError;
+        response.errorString = JobPrivate::errorMessage(NetworkError, reply->errorString());
+    }
+}
+
+bool RequestExecutorPrivate::scheduleRetry(RequestState *state, const Response &response, QNetworkReply::NetworkError networkError)
+{
+    if (state->attempts >= retryPolicy.maxAttempts()) {
+        return false;
+    }
+
+    if (state->request.operation == Request::Post && !retryPolicy.retryNonIdempotent()) {
+        return false;
+    }
+
+    RetryPolicy::ErrorClass errorClass = RetryPolicy::NoErrors;
+    if (response.error == RateLimitExceeded) {
+        errorClass = RetryPolicy::RateLimited;
+    } else if (response.httpStatus >= 500 || response.error == ServerMaintenance || response.error == InternalServerError) {
+        errorClass = RetryPolicy::ServerErrors;
+    } else if (response.error == RequestTimedOut) {
+        errorClass = RetryPolicy::Timeouts;
+    } else if (networkError > QNetworkReply::NoError && networkError <= QNetworkReply::UnknownNetworkError) {
+        errorClass = RetryPolicy::NetworkErrors;
+    }
+
+    if (errorClass == RetryPolicy::NoErrors || !retryPolicy.retryOn().testFlag(errorClass)) {
+        return false;
+    }
+
+    JobMetrics::count(&MetricsRegistry::retries);
+    const int delay = retryPolicy.delay(state->attempts);
+    const quint32 serial = state->serial;
+
+    qCInfo(qhrCore) << "Request failed with" << response.errorString << "- retrying in" << delay << "ms, attempt" << state->attempts + 1 << "of" << retryPolicy.maxAttempts();
+
+    QTimer::singleShot(delay, &context, [this, state, serial](){
+        dispatchRetry(state, serial);
+    });
+
+    return true;
+}
+
+void RequestExecutorPrivate::dispatchRetry(RequestState *state, quint32 serial)
+{
+    if (state->serial != serial) {
+        return;
+    }
+
+    // retries count against the request limit like the first attempt
+    const qint64 wait = RateLimiter::takeToken(state->rateLimitKey, state->endpoint);
+    if (wait > 0) {
+        qCDebug(qhrCore) << "Request limit for" << state->endpoint << "reached, delaying retry by" << wait << "ms";
+        QTimer::singleShot(static_cast<int>(wait), &context, [this, state, serial](){
+            dispatchRetry(state, serial);
+        });
+        return;
+    }
+
+    dispatch(state);
+}
+
+void RequestExecutorPrivate::failPending(int error, const QString &errorText)
+{
+    std::deque<PendingRequest> failed;
+    failed.swap(pending);
+
+    Response response;
+    response.error = error;
+    response.errorString = JobPrivate::errorMessage(error, errorText);
+
+    for (PendingRequest &p : failed) {
+        response.tag = p.request.tag;
+        p.callback(response);
+    }
+}
+
+#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
+void RequestExecutorPrivate::checkTimeouts()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    bool running = false;
+    // aborting emits finished() synchronously, so collect first
+    std::vector<QNetworkReply*> expired;
+    for (RequestState *state : inFlight) {
+        if (state->reply) {
+            running = true;
+            if (state->deadline <= now) {
+                expired.push_back(state->reply);
+            }
+        }
+    }
+
+    for (QNetworkReply *reply : expired) {
+        reply->abort();
+    }
+
+    if (!running) {
+        timeoutTimer.stop();
+    }
+}
+#endif
+
+RequestJobPrivate::RequestJobPrivate(Job *q, const Request &request)
+    : JobPrivate(q), request(request)
+{
+    namOperation = RequestExecutorPrivate::networkOperation(request.operation);
+    requiresAuth = request.requiresAuth;
+    notFoundIsEmpty = request.notFoundIsEmpty;
+    switch (request.expectedContent) {
+    case Request::JsonArray:
+        expectedContentType = ExpectedContentType::JsonArray;
+        break;
+    case Request::NoContent:
+        expectedContentType = ExpectedContentType::Empty;
+        break;
+    default:
+        expectedContentType = ExpectedContentType::JsonObject;
+        break;
+    }
+}
+
+bool RequestJobPrivate::checkInput()
+{
+    if (!JobPrivate::checkInput()) {
+        return false;
+    }
+
+    if (Q_UNLIKELY(request.path.isNull())) {
+        emitError(InvalidInput, QStringLiteral("path"));
+        qCCritical(qhrCore) << "Can not send request: invalid path.";
+        return false;
+    }
+
+    return true;
+}
+
+QString RequestJobPrivate::buildUrlPath() const
+{
+    return request.path;
+}
+
+QUrlQuery RequestJobPrivate::buildUrlQuery() const
+{
+    return request.query;
+}
+
+std::pair<QByteArray, QByteArray> RequestJobPrivate::buildPayload() const
+{
+    if (request.operation == Request::Put || request.operation == Request::Post) {
+        return std::make_pair(request.form.toString(QUrl::FullyEncoded).toUtf8(), QByteArrayLiteral("application/x-www-form-urlencoded"));
+    }
+    return JobPrivate::buildPayload();
+}
+
+RequestJob::RequestJob(const Request &request, QObject *parent)
+    : Job(*new RequestJobPrivate(this, request), parent)
+{
+
+}
+
+void RequestJob::start()
+{
+    QTimer::singleShot(0, this, &Job::sendRequest);
+}
+
+RequestExecutor::RequestExecutor(AbstractConfiguration *configuration)
+    : d_ptr(new RequestExecutorPrivate(this, configuration))
+{
+
+}
+
+RequestExecutor::~RequestExecutor()
+{
+    Q_D(RequestExecutor);
+    abortAll();
+    if (d->ownsNam) {
+        delete d->nam;
+    }
+}
+
+void RequestExecutor::submit(const Request &request, const Callback &callback)
+{
+    Q_D(RequestExecutor);
+    Q_ASSERT_X(callback, "submit request", "invalid callback");
+    d->pending.push_back(RequestExecutorPrivate::PendingRequest{request, callback});
+    d->schedule();
+}
+
+void RequestExecutor::submit(const QVector<Request> &requests, const Callback &callback)
+{
+    Q_D(RequestExecutor);
+    Q_ASSERT_X(callback, "submit requests", "invalid callback");
+    for (const Request &request : requests) {
+        d->pending.push_back(RequestExecutorPrivate::PendingRequest{request, callback});
+    }
+    d->schedule();
+}
+
+void RequestExecutor::abortAll()
+{
+    Q_D(RequestExecutor);
+
+    d->pending.clear();
+    d->throttleTimer.stop();
+
+    // aborting emits finished() synchronously, take the states out before
+    std::vector<RequestState*> running;
+    running.swap(d->inFlight);
+    for (RequestState *state : running) {
+        QNetworkReply *reply = state->reply;
+        d->releaseState(state);
+        if (reply) {
+            reply->abort();
+            reply->deleteLater();
+        }
+    }
+}
+
+int RequestExecutor::pendingCount() const
+{
+    Q_D(const RequestExecutor);
+    return static_cast<int>(d->pending.size());
+}
+
+int RequestExecutor::inFlightCount() const
+{
+    Q_D(const RequestExecutor);
+    return static_cast<int>(d->inFlight.size());
+}
+
+int RequestExecutor::poolSize() const
+{
+    Q_D(const RequestExecutor);
+    return static_cast<int>(d->pool.size());
+}
+
+int RequestExecutor::maxInFlight() const
+{
+    Q_D(const RequestExecutor);
+    return d->maxInFlight;
+}
+
+void RequestExecutor::setMaxInFlight(int maxInFlight)
+{
+    Q_D(RequestExecutor);
+    d->maxInFlight = maxInFlight;
+    d->schedule();
+}
+
+RetryPolicy RequestExecutor::retryPolicy() const
+{
+    Q_D(const RequestExecutor);
+    return d->retryPolicy;
+}
+
+void RequestExecutor::setRetryPolicy(const RetryPolicy &policy)
+{
+    Q_D(RequestExecutor);
+    d->retryPolicy = policy;
+}
+
+Job *RequestExecutor::createJob(const Request &request, QObject *parent) const
+{
+    Q_D(const RequestExecutor);
+    auto job = new RequestJob(request, parent);
+    if (d->configuration) {
+        job->setConfiguration(d->configuration);
+    }
+    return job;
+}
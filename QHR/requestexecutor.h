@@ -0,0 +1,204 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_REQUESTEXECUTOR_H
+#define QHR_REQUESTEXECUTOR_H
+
+#include <QString>
+#include <QUrlQuery>
+#include <QVector>
+#include <QJsonDocument>
+#include "qhr_global.h"
+#include "job.h"
+#include <functional>
+#include <memory>
+
+namespace QHR {
+
+class RequestExecutorPrivate;
+
+/*!
+ * \brief Plain value describing a single API request for RequestExecutor.
+ *
+ * \headerfile "" <QHR/RequestExecutor>
+ */
+struct Request
+{
+    /*!
+     * \brief HTTP method of the request.
+     */
+    enum Operation : quint8 {
+        Get,
+        Put,
+        Post,
+        Delete
+    };
+
+    /*!
+     * \brief Content expected in a successful reply.
+     */
+    enum Content : quint8 {
+        JsonObject,
+        JsonArray,
+        NoContent
+    };
+
+    Request() = default;
+
+    /*!
+     * \brief Constructs a new %Request with the given \a operation on \a path.
+     *
+     * \a path is relative to AbstractConfiguration::baseUrl(), like \c "/rdns/1.2.3.4". The \a form
+     * will be sent URL encoded for Request::Put and Request::Post operations.
+     */
+    Request(Operation operation, const QString &path, const QUrlQuery &form = QUrlQuery(), Content expectedContent = JsonObject, quint64 tag = 0)
+        : path(path), form(form), tag(tag), operation(operation), expectedContent(expectedContent)
+    {}
+
+    QString path;
+    QUrlQuery query;
+    QUrlQuery form;
+    quint64 tag = 0;    /**< Arbitrary value returned unchanged in Response::tag. */
+    Operation operation = Get;
+    Content expectedContent = JsonObject;
+    bool requiresAuth = true;
+    bool notFoundIsEmpty = false;   /**< Treat HTTP 404 as successful empty result, used by list endpoints. */
+};
+
+/*!
+ * \brief Plain value holding the outcome of a Request.
+ *
+ * \headerfile "" <QHR/RequestExecutor>
+ */
+struct Response
+{
+    QJsonDocument json;
+    QString errorString;    /**< Human readable and translated error string. */
+    QString apiErrorCode;   /**< Error code returned by the API, like \c "INVALID_INPUT". */
+    quint64 tag = 0;        /**< The Request::tag of the request. */
+    int error = 0;          /**< BJob::NoError or one of the error codes of Job. */
+    int httpStatus = 0;
+    quint8 attempts = 0;
+
+    /*!
+     * \brief Returns \c true if the request has been finished without error.
+     */
+    bool isOk() const { return error == 0; }
+};
+
+/*!
+ * \brief Runs plain Request descriptors without creating a job object per request.
+ *
+ * Every Job is a QObject with a private class, a BJobPrivate and often a QTimer, and it is
+ * destroyed via QObject::deleteLater(). For bulk operations with thousands of calls this per
+ * request overhead dominates. %RequestExecutor uses the same configuration, credentials, rate
+ * limits, retry policy and network access manager as Job, but keeps its per request state in a
+ * pool that is recycled. It does not create any QObject per request; at most \link
+ * RequestExecutor::maxInFlight maxInFlight\endlink state objects are ever allocated.
+ *
+ * The executor is not thread-safe, it has to be used from the thread it has been created in
+ * and that thread needs a running event loop. Use Client to submit from other threads.
+ * Requests are not coalesced and not cached, but \c PUT, \c POST and \c DELETE requests
+ * invalidate the ResponseCache like jobs do. Like jobs, requests to hosts that fail with
+ * protocol errors are sent again without HTTP/2 and pipelining. Callbacks of requests that are still pending or
+ * running when the executor is destroyed will not be invoked.
+ *
+ * Use createJob() if a BJob is needed for a request, for example to add it to a JobGroup.
+ *
+ * \headerfile "" <QHR/RequestExecutor>
+ */
+class QHR_LIBRARY RequestExecutor
+{
+public:
+    /*!
+     * \brief Function called with the outcome of a request.
+     */
+    using Callback = std::function<void(const Response &response)>;
+
+    /*!
+     * \brief Constructs a new %RequestExecutor using the given \a configuration.
+     *
+     * If \a configuration is a \c nullptr, QHR::defaultConfiguration() will be used.
+     */
+    explicit RequestExecutor(AbstractConfiguration *configuration = nullptr);
+
+    /*!
+     * \brief Aborts all running requests and destroys the %RequestExecutor.
+     */
+    ~RequestExecutor();
+
+    /*!
+     * \brief Queues the \a request, \a callback will be called when it has been finished.
+     */
+    void submit(const Request &request, const Callback &callback);
+
+    /*!
+     * \brief Queues all \a requests, \a callback will be called for every single request.
+     */
+    void submit(const QVector<Request> &requests, const Callback &callback);
+
+    /*!
+     * \brief Aborts all pending and running requests without invoking their callbacks.
+     */
+    void abortAll();
+
+    /*!
+     * \brief Returns the number of requests waiting to be sent.
+     */
+    int pendingCount() const;
+
+    /*!
+     * \brief Returns the number of requests currently running.
+     */
+    int inFlightCount() const;
+
+    /*!
+     * \brief Returns the number of request state objects allocated by the pool.
+     */
+    int poolSize() const;
+
+    /*!
+     * \brief Returns the maximum number of requests running at the same time.
+     *
+     * The default value is \c 6.
+     */
+    int maxInFlight() const;
+
+    /*!
+     * \brief Sets the maximum number of requests running at the same time.
+     */
+    void setMaxInFlight(int maxInFlight);
+
+    /*!
+     * \brief Returns the retry policy used for the requests.
+     *
+     * Defaults to QHR::defaultRetryPolicy() at construction time.
+     */
+    RetryPolicy retryPolicy() const;
+
+    /*!
+     * \brief Sets the retry \a policy used for the requests.
+     */
+    void setRetryPolicy(const RetryPolicy &policy);
+
+    /*!
+     * \brief Creates a Job that performs the \a request.
+     *
+     * The job uses the configuration of this executor and has to be started by the caller.
+     * Its Job::result() contains the parsed reply.
+     */
+    Job *createJob(const Request &request, QObject *parent = nullptr) const;
+
+protected:
+    const std::unique_ptr<RequestExecutorPrivate> d_ptr;
+
+private:
+    Q_DECLARE_PRIVATE_D(d_ptr, RequestExecutor)
+    Q_DISABLE_COPY(RequestExecutor)
+};
+
+}
+
+#endif // QHR_REQUESTEXECUTOR_H
@@ -0,0 +1,154 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_REQUESTEXECUTOR_P_H
+#define QHR_REQUESTEXECUTOR_P_H
+
+#include "requestexecutor.h"
+#include "job_p.h"
+#include <QObject>
+#include <QTimer>
+#include <QPointer>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <deque>
+#include <vector>
+
+namespace QHR {
+
+class AbstractCredentialProvider;
+
+/*
+ * Per request state, recycled by RequestExecutorPrivate. serial is increased
+ * every time the state is returned to the pool, so that delayed retries can
+ * detect that their request has been aborted in the meantime.
+ */
+struct RequestState
+{
+    Request request;
+    RequestExecutor::Callback callback;
+    QNetworkRequest networkRequest;
+    QByteArray payload;
+    QByteArray rateLimitKey;
+    QString endpoint;
+    QNetworkReply *reply = nullptr;
+#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
+    qint64 deadline = 0;
+#endif
+    quint32 serial = 0;
+    quint8 attempts = 0;
+    quint8 protocolOptions = NoProtocolOptions;
+};
+
+class RequestExecutorPrivate
+{
+public:
+    explicit RequestExecutorPrivate(RequestExecutor *q, AbstractConfiguration *config);
+    ~RequestExecutorPrivate();
+
+    static RequestExecutorPrivate *get(RequestExecutor *executor) { return executor->d_func(); }
+
+    static NetworkOperation networkOperation(Request::Operation operation);
+
+    AbstractConfiguration *activeConfiguration() const;
+
+    RequestState *prepareState(Request &&request, RequestExecutor::Callback &&callback);
+
+    void releaseState(RequestState *state);
+
+    void schedule();
+
+    bool checkCredentials(AbstractConfiguration *config);
+
+    void waitForCredentials();
+
+    QNetworkAccessManager *networkAccessManager();
+
+    void dispatch(RequestState *state);
+
+    void replyFinished(QNetworkReply *reply);
+
+    bool protocolFallback(RequestState *state, QNetworkReply::NetworkError networkError);
+
+    void invalidateCache(const RequestState *state) const;
+
+    void readReply(const QByteArray &data, Request::Content expectedContent, Response &response) const;
+
+    void readError(RequestState *state, QNetworkReply *reply, const QByteArray &data, Response &response);
+
+    bool scheduleRetry(RequestState *state, const Response &response, QNetworkReply::NetworkError networkError);
+
+    void dispatchRetry(RequestState *state, quint32 serial);
+
+    void failPending(int error, const QString &errorText = QString());
+
+#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
+    void checkTimeouts();
+#endif
+
+    struct PendingRequest {
+        Request request;
+        RequestExecutor::Callback callback;
+    };
+
+    std::deque<PendingRequest> pending;
+    std::vector<std::unique_ptr<RequestState>> pool;
+    std::vector<RequestState*> freeStates;
+    std::vector<RequestState*> inFlight;
+    // receiver for all connections, destroying it disconnects them
+    QObject context;
+    QTimer throttleTimer;
+#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 0))
+    QTimer timeoutTimer;
+#endif
+    RetryPolicy retryPolicy;
+    QByteArray authHeader;
+    QByteArray userAgent;
+    QString account;
+    QPointer<AbstractCredentialProvider> credentialProvider;
+    QMetaObject::Connection credentialConnections[2];
+    AbstractConfiguration *configuration = nullptr;
+    QNetworkAccessManager *nam = nullptr;
+    quint16 requestTimeout = 300;
+    int maxInFlight = 6;
+    bool ownsNam = false;
+    bool waitingForCredentials = false;
+
+protected:
+    RequestExecutor *q_ptr = nullptr;
+
+private:
+    Q_DISABLE_COPY(RequestExecutorPrivate)
+    Q_DECLARE_PUBLIC(RequestExecutor)
+};
+
+class RequestJobPrivate : public JobPrivate
+{
+public:
+    RequestJobPrivate(Job *q, const Request &request);
+
+    bool checkInput() override;
+
+    QString buildUrlPath() const override;
+
+    QUrlQuery buildUrlQuery() const override;
+
+    std::pair<QByteArray, QByteArray> buildPayload() const override;
+
+    Request request;
+};
+
+// job created by RequestExecutor::createJob(), does not add any signals or properties
+class RequestJob : public Job
+{
+public:
+    explicit RequestJob(const Request &request, QObject *parent = nullptr);
+
+    void start() override;
+};
+
+}
+
+#endif // QHR_REQUESTEXECUTOR_P_H
@@ -0,0 +1,545 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "responsecache_p.h"
+#include "logging.h"
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QMessageAuthenticationCode>
+#include <QJsonParseError>
+#include <QRegularExpression>
+#include <algorithm>
+
+using namespace QHR;
+
+static constexpr quint32 entryMagic = 0x51485243; // QHRC
+static constexpr quint8 entryVersion = 1;
+
+ResponseCachePrivate::LookupResult ResponseCachePrivate::lookup(const QByteArray &key, const QString &account, const QByteArray &secret, QByteArray *data, QJsonDocument *json)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QString fileName;
+    bool expired = false;
+
+    {
+        QMutexLocker locker(&lock);
+
+        const Entry *e = entries.object(key);
+        if (e && e->staleUntil > now) {
+            *data = e->data;
+            *json = e->json;
+            return e->expires > now ? Fresh : Stale;
+        }
+
+        if (e) {
+            entries.remove(key);
+            expired = true;
+        }
+
+        if (directory.isEmpty() || secret.isEmpty()) {
+            return Miss;
+        }
+
+        fileName = entryFile(key, account, secret);
+    }
+
+    // memory lookups of other threads do not have to wait for the disk
+    QMutexLocker diskLocker(&diskLock);
+
+    if (expired) {
+        removeEntryFile(fileName);
+        return Miss;
+    }
+
+    bool invalid = false;
+    std::unique_ptr<Entry> de(readEntry(fileName, account, secret, &invalid));
+    if (!de || de->staleUntil <= now) {
+        if (de || invalid) {
+            removeEntryFile(fileName);
+        }
+        return Miss;
+    }
+
+    diskLocker.unlock();
+
+    qCDebug(qhrCore) << "Loaded cached response for" << de->path << "from disk";
+    *data = de->data;
+    *json = de->json;
+    const LookupResult result = de->expires > now ? Fresh : Stale;
+    const int cost = qMax(1, de->data.size());
+
+    QMutexLocker locker(&lock);
+    entries.insert(key, de.release(), cost);
+    return result;
+}
+
+void ResponseCachePrivate::insert(const QByteArray &key, const QString &account, const QByteArray &secret, const QString &path, const QByteArray &data, const QJsonDocument &json)
+{
+    auto e = new Entry;
+    e->data = data;
+    e->json = json;
+    e->account = account;
+    e->path = path;
+
+    Entry diskEntry;
+    QString fileName;
+    quint64 generation = 0;
+
+    {
+        QMutexLocker locker(&lock);
+
+        const int _ttl = ttlForPath(path);
+        if (_ttl <= 0) {
+            delete e;
+            return;
+        }
+
+        e->expires = QDateTime::currentMSecsSinceEpoch() + static_cast<qint64>(_ttl) * 1000;
+        e->staleUntil = e->expires + static_cast<qint64>(qMax(0, swrForPath(path))) * 1000;
+
+        if (!directory.isEmpty() && !secret.isEmpty()) {
+            diskEntry = *e;
+            fileName = entryFile(key, account, secret);
+            generation = invalidations;
+        }
+
+        // QCache takes ownership and deletes the entry right away if it is bigger than maxCost
+        entries.insert(key, e, qMax(1, data.size()));
+    }
+
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker diskLocker(&diskLock);
+    // do not store a response that has been invalidated in the meantime
+    if (generation == invalidations.load()) {
+        writeEntry(fileName, secret, &diskEntry);
+    }
+}
+
+void ResponseCachePrivate::invalidate(const QString &account, const QByteArray &secret, const QString &path)
+{
+    {
+        QMutexLocker locker(&lock);
+
+        ++invalidations;
+        const QList<QByteArray> keys = entries.keys();
+        for (const QByteArray &key : keys) {
+            const Entry *e = entries.object(key);
+            if (e && (account.isNull() || e->account == account) && pathsRelated(e->path, path)) {
+                qCDebug(qhrCore) << "Invalidating cached response for" << e->path;
+                entries.remove(key);
+            }
+        }
+    }
+
+    QMutexLocker diskLocker(&diskLock);
+
+    if (directory.isEmpty()) {
+        return;
+    }
+
+    QStringList dirs;
+    if (account.isNull()) {
+        const QStringList subDirs = QDir(directory).entryList(QDir::Dirs|QDir::NoDotAndDotDot);
+        for (const QString &subDir : subDirs) {
+            dirs.push_back(directory + QLatin1Char('/') + subDir);
+        }
+    } else if (!secret.isEmpty()) {
+        dirs.push_back(accountDirectory(account, secret));
+    }
+
+    for (const QString &dir : qAsConst(dirs)) {
+        QDirIterator it(dir, QDir::Files);
+        while (it.hasNext()) {
+            const QString fileName = it.next();
+            QFile f(fileName);
+            if (!f.open(QIODevice::ReadOnly)) {
+                continue;
+            }
+            QDataStream in(&f);
+            in.setVersion(QDataStream::Qt_5_6);
+            quint32 magic = 0;
+            quint8 version = 0;
+            QString entryPath;
+            in >> magic >> version >> entryPath;
+            f.close();
+            if (magic == entryMagic && pathsRelated(entryPath, path)) {
+                qCDebug(qhrCore) << "Removing cached response for" << entryPath << "from disk";
+                if (diskSize >= 0) {
+                    diskSize -= it.fileInfo().size();
+                }
+                QFile::remove(fileName);
+            }
+        }
+    }
+}
+
+bool ResponseCachePrivate::beginRevalidation(const QByteArray &key)
+{
+    QMutexLocker locker(&lock);
+    if (revalidating.contains(key)) {
+        return false;
+    }
+    revalidating.insert(key);
+    return true;
+}
+
+void ResponseCachePrivate::endRevalidation(const QByteArray &key)
+{
+    QMutexLocker locker(&lock);
+    revalidating.remove(key);
+}
+
+int ResponseCachePrivate::ttlForPath(const QString &path) const
+{
+    return matchPath(ttls, path, defaultTtl);
+}
+
+int ResponseCachePrivate::swrForPath(const QString &path) const
+{
+    return matchPath(swrs, path, defaultSwr);
+}
+
+int ResponseCachePrivate::matchPath(const QMap<QString, int> &map, const QString &path, int defaultValue)
+{
+    int value = defaultValue;
+    int matchLength = -1;
+    for (auto i = map.constBegin(); i != map.constEnd(); ++i) {
+        if (i.key().size() > matchLength && (path == i.key() || path.startsWith(i.key() + QLatin1Char('/')))) {
+            value = i.value();
+            matchLength = i.key().size();
+        }
+    }
+    return value;
+}
+
+QString ResponseCachePrivate::accountDirectory(const QString &account, const QByteArray &secret) const
+{
+    const QByteArray name = QMessageAuthenticationCode::hash(account.toUtf8(), secret, QCryptographicHash::Sha256).toHex().left(32);
+    return directory + QLatin1Char('/') + QString::fromLatin1(name);
+}
+
+QString ResponseCachePrivate::entryFile(const QByteArray &key, const QString &account, const QByteArray &secret) const
+{
+    const QByteArray name = QMessageAuthenticationCode::hash(key, secret, QCryptographicHash::Sha256).toHex();
+    return accountDirectory(account, secret) + QLatin1Char('/') + QString::fromLatin1(name);
+}
+
+ResponseCachePrivate::Entry *ResponseCachePrivate::readEntry(const QString &fileName, const QString &account, const QByteArray &secret, bool *invalid) const
+{
+    QFile f(fileName);
+    if (!f.open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic = 0;
+    quint8 version = 0;
+    in >> magic >> version;
+    if (magic != entryMagic || version != entryVersion) {
+        *invalid = true;
+        return nullptr;
+    }
+
+    std::unique_ptr<Entry> e(new Entry);
+    QByteArray mac;
+    in >> e->path >> e->expires >> e->staleUntil >> e->data >> mac;
+
+    if (in.status() != QDataStream::Ok || mac != entryMac(secret, e->path, e->expires, e->staleUntil, e->data)) {
+        qCWarning(qhrCore) << "Ignoring invalid cached response in" << fileName;
+        *invalid = true;
+        return nullptr;
+    }
+
+    QJsonParseError jpe;
+    e->json = QJsonDocument::fromJson(e->data, &jpe);
+    if (jpe.error != QJsonParseError::NoError) {
+        *invalid = true;
+        return nullptr;
+    }
+
+    e->account = account;
+    return e.release();
+}
+
+QByteArray ResponseCachePrivate::entryMac(const QByteArray &secret, const QString &path, qint64 expires, qint64 staleUntil, const QByteArray &data)
+{
+    QMessageAuthenticationCode mac(QCryptographicHash::Sha256, secret);
+    mac.addData(path.toUtf8());
+    mac.addData(QByteArray::number(expires));
+    mac.addData(QByteArray::number(staleUntil));
+    mac.addData(data);
+    return mac.result();
+}
+
+void ResponseCachePrivate::writeEntry(const QString &fileName, const QByteArray &secret, const Entry *e)
+{
+    if (diskSize < 0) {
+        calculateDiskSize();
+    }
+
+    const QFileInfo fi(fileName);
+    const QString dir = fi.absolutePath();
+    if (!QFileInfo::exists(dir)) {
+        if (!QDir().mkpath(dir)) {
+            qCWarning(qhrCore) << "Failed to create response cache directory" << dir;
+            return;
+        }
+        QFile::setPermissions(dir, QFileDevice::ReadOwner|QFileDevice::WriteOwner|QFileDevice::ExeOwner);
+    }
+
+    const qint64 oldSize = fi.exists() ? fi.size() : 0;
+
+    QSaveFile f(fileName);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qCWarning(qhrCore) << "Failed to open" << fileName << "to store cached response:" << f.errorString();
+        return;
+    }
+    f.setPermissions(QFileDevice::ReadOwner|QFileDevice::WriteOwner);
+
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_5_6);
+    out << entryMagic << entryVersion << e->path << e->expires << e->staleUntil << e->data << entryMac(secret, e->path, e->expires, e->staleUntil, e->data);
+
+    if (!f.commit()) {
+        qCWarning(qhrCore) << "Failed to store cached response in" << fileName << ":" << f.errorString();
+        return;
+    }
+
+    diskSize += QFileInfo(fileName).size() - oldSize;
+
+    if (diskSize > maxDiskSize) {
+        pruneDisk();
+    }
+}
+
+void ResponseCachePrivate::removeEntryFile(const QString &fileName)
+{
+    const QFileInfo fi(fileName);
+    const qint64 size = fi.exists() ? fi.size() : -1;
+    if (size >= 0 && QFile::remove(fileName) && diskSize >= 0) {
+        diskSize -= size;
+    }
+}
+
+void ResponseCachePrivate::pruneDisk()
+{
+    QFileInfoList files;
+    QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        files.push_back(it.fileInfo());
+    }
+
+    std::sort(files.begin(), files.end(), [](const QFileInfo &a, const QFileInfo &b){
+        return a.lastModified() < b.lastModified();
+    });
+
+    // remove some more to not prune again with the next insert
+    const qint64 target = maxDiskSize - maxDiskSize / 10;
+    for (const QFileInfo &fi : qAsConst(files)) {
+        if (diskSize <= target) {
+            break;
+        }
+        if (QFile::remove(fi.absoluteFilePath())) {
+            diskSize -= fi.size();
+        }
+    }
+
+    qCDebug(qhrCore) << "Pruned response cache on disk to" << diskSize << "bytes";
+}
+
+void ResponseCachePrivate::calculateDiskSize()
+{
+    diskSize = 0;
+    if (directory.isEmpty()) {
+        return;
+    }
+    QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        diskSize += it.fileInfo().size();
+    }
+}
+
+bool ResponseCachePrivate::pathsRelated(const QString &a, const QString &b)
+{
+    if (a == b) {
+        return true;
+    }
+
+    if (a.size() < b.size()) {
+        return b.startsWith(a) && b.at(a.size()) == QLatin1Char('/');
+    } else {
+        return a.startsWith(b) && a.at(b.size()) == QLatin1Char('/');
+    }
+}
+
+ResponseCache::ResponseCache()
+    : d_ptr(new ResponseCachePrivate)
+{
+    Q_D(ResponseCache);
+    d->entries.setMaxCost(10 * 1024 * 1024);
+}
+
+ResponseCache::~ResponseCache() = default;
+
+int ResponseCache::defaultTtl() const
+{
+    Q_D(const ResponseCache);
+    QMutexLocker locker(&d->lock);
+    return d->defaultTtl;
+}
+
+void ResponseCache::setDefaultTtl(int seconds)
+{
+    Q_D(ResponseCache);
+    QMutexLocker locker(&d->lock);
+    d->defaultTtl = seconds;
+}
+
+int ResponseCache::ttl(const QString &path) const
+{
+    Q_D(const ResponseCache);
+    QMutexLocker locker(&d->lock);
+    return d->ttlForPath(path);
+}
+
+void ResponseCache::setTtl(const QString &path, int seconds)
+{
+    Q_D(ResponseCache);
+    QMutexLocker locker(&d->lock);
+    d->ttls.insert(path, seconds);
+}
+
+int ResponseCache::defaultStaleWhileRevalidate() const
+{
+    Q_D(const ResponseCache);
+    QMutexLocker locker(&d->lock);
+    return d->defaultSwr;
+}
+
+void ResponseCache::setDefaultStaleWhileRevalidate(int seconds)
+{
+    Q_D(ResponseCache);
+    QMutexLocker locker(&d->lock);
+    d->defaultSwr = seconds;
+}
+
+int ResponseCache::staleWhileRevalidate(const QString &path) const
+{
+    Q_D(const ResponseCache);
+    QMutexLocker locker(&d->lock);
+    return d->swrForPath(path);
+}
+
+void ResponseCache::setStaleWhileRevalidate(const QString &path, int seconds)
+{
+    Q_D(ResponseCache);
+    QMutexLocker locker(&d->lock);
+    d->swrs.insert(path, seconds);
+}
+
+QString ResponseCache::directory() const
+{
+    Q_D(const ResponseCache);
+    QMutexLocker locker(&d->lock);
+    return d->directory;
+}
+
+void ResponseCache::setDirectory(const QString &directory)
+{
+    Q_D(ResponseCache);
+    QMutexLocker locker(&d->lock);
+    QMutexLocker diskLocker(&d->diskLock);
+    d->directory = directory;
+    d->diskSize = -1;
+    diskLocker.unlock();
+    locker.unlock();
+    if (!directory.isEmpty() && !QDir().mkpath(directory)) {
+        qCWarning(qhrCore) << "Failed to create response cache directory" << directory;
+    }
+}
+
+qint64 ResponseCache::maxDiskSize() const
+{
+    Q_D(const ResponseCache);
+    QMutexLocker locker(&d->lock);
+    return d->maxDiskSize;
+}
+
+void ResponseCache::setMaxDiskSize(qint64 bytes)
+{
+    Q_D(ResponseCache);
+    QMutexLocker locker(&d->lock);
+    QMutexLocker diskLocker(&d->diskLock);
+    d->maxDiskSize = bytes;
+    locker.unlock();
+    if (!d->directory.isEmpty()) {
+        d->calculateDiskSize();
+        if (d->diskSize > d->maxDiskSize) {
+            d->pruneDisk();
+        }
+    }
+}
+
+int ResponseCache::maxSize() const
+{
+    Q_D(const ResponseCache);
+    QMutexLocker locker(&d->lock);
+    return d->entries.maxCost();
+}
+
+void ResponseCache::setMaxSize(int bytes)
+{
+    Q_D(ResponseCache);
+    QMutexLocker locker(&d->lock);
+    d->entries.setMaxCost(bytes);
+}
+
+int ResponseCache::size() const
+{
+    Q_D(const ResponseCache);
+    QMutexLocker locker(&d->lock);
+    return d->entries.totalCost();
+}
+
+void ResponseCache::invalidate(const QString &path)
+{
+    Q_D(ResponseCache);
+    d->invalidate(QString(), QByteArray(), path);
+}
+
+void ResponseCache::clear()
+{
+    Q_D(ResponseCache);
+    {
+        QMutexLocker locker(&d->lock);
+        d->entries.clear();
+    }
+
+    QMutexLocker diskLocker(&d->diskLock);
+    if (!d->directory.isEmpty()) {
+        // only remove the account directories created by us
+        static const QRegularExpression accountDirName(QStringLiteral("^[0-9a-f]{32}$"));
+        const QStringList subDirs = QDir(d->directory).entryList(QDir::Dirs|QDir::NoDotAndDotDot);
+        for (const QString &subDir : subDirs) {
+            if (accountDirName.match(subDir).hasMatch()) {
+                QDir(d->directory + QLatin1Char('/') + subDir).removeRecursively();
+            }
+        }
+        d->diskSize = 0;
+    }
+}
@@ -0,0 +1,206 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_RESPONSECACHE_H
+#define QHR_RESPONSECACHE_H
+
+#include <QString>
+#include "qhr_global.h"
+#include <memory>
+
+namespace QHR {
+
+class ResponseCachePrivate;
+
+/*!
+ * \brief In-memory cache for the responses of read-only API requests.
+ *
+ * If a response cache has been set via QHR::setResponseCache(), jobs performing
+ * \c GET requests will first look up the cache before sending a request. Cached
+ * responses are identified by the account used for the request and the complete
+ * request URL. A cache hit will finish the job without any network I/O.
+ *
+ * Jobs and RequestExecutor performing mutating requests (\c PUT, \c POST and \c DELETE) will invalidate
+ * all cached responses of the same account whose path is the same, a parent or a
+ * child of the changed resource path. So changing \c /server/123 will invalidate
+ * \c /server/123 as well as \c /server.
+ *
+ * The time to live of the cached responses can be set globally via setDefaultTtl()
+ * or per endpoint via setTtl(). The overall size of the cached response data is
+ * limited by maxSize().
+ *
+ * Expired responses can still be used for the time set via setStaleWhileRevalidate().
+ * Jobs will then finish immediately with the stale response while the response
+ * is fetched again in the background to update the cache.
+ *
+ * If a directory has been set via setDirectory(), responses will also be stored on disk,
+ * so that they can be used by later processes. Every account gets its own subdirectory
+ * and the entries are authenticated with a key derived from the account credentials.
+ * Entries can only be found and read with the same credentials that have been used to
+ * store them. The entries are not encrypted, but only readable by the owner. The overall
+ * size of the stored entries is limited by maxDiskSize().
+ *
+ * All member functions are thread-safe.
+ *
+ * \headerfile "" <QHR/ResponseCache>
+ */
+class QHR_LIBRARY ResponseCache
+{
+public:
+    /*!
+     * \brief Constructs a new empty %ResponseCache object.
+     */
+    ResponseCache();
+
+    /*!
+     * \brief Destroys the %ResponseCache object and all cached entries.
+     */
+    ~ResponseCache();
+
+    /*!
+     * \brief Returns the default time to live in seconds.
+     *
+     * This will be used for all paths that do not have a time to live set
+     * via setTtl(). The default value is \c 60 seconds.
+     *
+     * \sa setDefaultTtl()
+     */
+    int defaultTtl() const;
+
+    /*!
+     * \brief Sets the default time to live in \a seconds.
+     *
+     * Set \c 0 to only cache responses for paths that have an explicit
+     * time to live set via setTtl().
+     *
+     * \sa defaultTtl()
+     */
+    void setDefaultTtl(int seconds);
+
+    /*!
+     * \brief Returns the time to live in seconds used for the API \a path.
+     *
+     * This will return the time to live of the longest path prefix set via setTtl()
+     * that matches \a path, or defaultTtl() if there is none.
+     */
+    int ttl(const QString &path) const;
+
+    /*!
+     * \brief Sets the time to live in \a seconds for the API \a path and all paths below it.
+     *
+     * Set for example \c /server to 300 seconds to cache responses for \c /server as well as
+     * \c /server/123 for five minutes. Set \c 0 to disable caching for \a path.
+     */
+    void setTtl(const QString &path, int seconds);
+
+    /*!
+     * \brief Returns the default stale-while-revalidate time in seconds.
+     *
+     * The default value is \c 0, what disables the usage of stale responses.
+     *
+     * \sa setDefaultStaleWhileRevalidate()
+     */
+    int defaultStaleWhileRevalidate() const;
+
+    /*!
+     * \brief Sets the default stale-while-revalidate time in \a seconds.
+     * \sa defaultStaleWhileRevalidate()
+     */
+    void setDefaultStaleWhileRevalidate(int seconds);
+
+    /*!
+     * \brief Returns the stale-while-revalidate time in seconds used for the API \a path.
+     *
+     * The time is matched the same way as ttl().
+     */
+    int staleWhileRevalidate(const QString &path) const;
+
+    /*!
+     * \brief Sets the stale-while-revalidate time in \a seconds for the API \a path and all paths below it.
+     *
+     * For this time after the response has been expired, it will still be used to finish jobs,
+     * while a new response is requested in the background.
+     */
+    void setStaleWhileRevalidate(const QString &path, int seconds);
+
+    /*!
+     * \brief Returns the directory used to store responses on disk.
+     *
+     * Returns an empty string if responses are only cached in memory, what is the default.
+     *
+     * \sa setDirectory()
+     */
+    QString directory() const;
+
+    /*!
+     * \brief Sets the \a directory used to store responses on disk.
+     *
+     * The directory will be created if it does not exist. Set an empty string to
+     * only cache responses in memory.
+     *
+     * \sa directory()
+     */
+    void setDirectory(const QString &directory);
+
+    /*!
+     * \brief Returns the maximum size of all responses stored on disk in bytes.
+     *
+     * The default value is 50 MiB.
+     *
+     * \sa setMaxDiskSize()
+     */
+    qint64 maxDiskSize() const;
+
+    /*!
+     * \brief Sets the maximum size of all responses stored on disk in \a bytes.
+     *
+     * If the size is exceeded, the least recently stored entries will be removed.
+     *
+     * \sa maxDiskSize()
+     */
+    void setMaxDiskSize(qint64 bytes);
+
+    /*!
+     * \brief Returns the maximum size of all cached response data in bytes.
+     *
+     * The default value is 10 MiB.
+     *
+     * \sa setMaxSize()
+     */
+    int maxSize() const;
+
+    /*!
+     * \brief Sets the maximum size of all cached response data in \a bytes.
+     *
+     * If the size is exceeded, the least recently used entries will be removed.
+     *
+     * \sa maxSize()
+     */
+    void setMaxSize(int bytes);
+
+    /*!
+     * \brief Returns the size of all currently cached response data in bytes.
+     */
+    int size() const;
+
+    /*!
+     * \brief Removes all cached responses of all accounts for \a path, its parents and its children.
+     */
+    void invalidate(const QString &path);
+
+    /*!
+     * \brief Removes all cached responses from memory and disk.
+     */
+    void clear();
+
+private:
+    const std::unique_ptr<ResponseCachePrivate> d_ptr;
+    Q_DECLARE_PRIVATE_D(d_ptr, ResponseCache)
+    Q_DISABLE_COPY(ResponseCache)
+};
+
+}
+
+#endif // QHR_RESPONSECACHE_H
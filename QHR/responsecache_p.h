@@ -0,0 +1,92 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_RESPONSECACHE_P_H
+#define QHR_RESPONSECACHE_P_H
+
+#include "responsecache.h"
+#include <QCache>
+#include <QMap>
+#include <QSet>
+#include <QMutex>
+#include <QJsonDocument>
+#include <atomic>
+
+namespace QHR {
+
+class ResponseCachePrivate
+{
+public:
+    struct Entry {
+        QByteArray data;
+        QJsonDocument json;
+        QString account;
+        QString path;
+        qint64 expires = 0;
+        qint64 staleUntil = 0;
+    };
+
+    enum LookupResult : quint8 {
+        Miss,
+        Fresh,
+        Stale
+    };
+
+    static ResponseCachePrivate *get(ResponseCache *cache) { return cache->d_func(); }
+
+    LookupResult lookup(const QByteArray &key, const QString &account, const QByteArray &secret, QByteArray *data, QJsonDocument *json);
+
+    void insert(const QByteArray &key, const QString &account, const QByteArray &secret, const QString &path, const QByteArray &data, const QJsonDocument &json);
+
+    void invalidate(const QString &account, const QByteArray &secret, const QString &path);
+
+    bool beginRevalidation(const QByteArray &key);
+
+    void endRevalidation(const QByteArray &key);
+
+    int ttlForPath(const QString &path) const;
+
+    int swrForPath(const QString &path) const;
+
+    static int matchPath(const QMap<QString, int> &map, const QString &path, int defaultValue);
+
+    static bool pathsRelated(const QString &a, const QString &b);
+
+    QString accountDirectory(const QString &account, const QByteArray &secret) const;
+
+    QString entryFile(const QByteArray &key, const QString &account, const QByteArray &secret) const;
+
+    Entry *readEntry(const QString &fileName, const QString &account, const QByteArray &secret, bool *invalid) const;
+
+    static QByteArray entryMac(const QByteArray &secret, const QString &path, qint64 expires, qint64 staleUntil, const QByteArray &data);
+
+    void writeEntry(const QString &fileName, const QByteArray &secret, const Entry *e);
+
+    void removeEntryFile(const QString &fileName);
+
+    void pruneDisk();
+
+    void calculateDiskSize();
+
+    // lock guards the memory cache and the settings, diskLock guards the files
+    // and diskSize; directory and maxDiskSize are only changed holding both
+    mutable QMutex lock;
+    QMutex diskLock;
+    QCache<QByteArray, Entry> entries;
+    QMap<QString, int> ttls;
+    QMap<QString, int> swrs;
+    QSet<QByteArray> revalidating;
+    QString directory;
+    qint64 maxDiskSize = 50 * 1024 * 1024;
+    qint64 diskSize = -1;
+    // increased under lock by invalidate(), read by insert() before writing to disk
+    std::atomic<quint64> invalidations{0};
+    int defaultTtl = 60;
+    int defaultSwr = 0;
+};
+
+}
+
+#endif // QHR_RESPONSECACHE_P_H
@@ -0,0 +1,139 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "retrypolicy.h"
+#include <QSharedData>
+#include <cmath>
+#include <random>
+
+namespace QHR {
+
+class RetryPolicyData : public QSharedData
+{
+public:
+    double multiplier = 2.0;
+    double jitter = 0.5;
+    int maxAttempts = 1;
+    int initialDelay = 500;
+    int maxDelay = 30000;
+    RetryPolicy::ErrorClasses retryOn = RetryPolicy::NetworkErrors|RetryPolicy::ServerErrors|RetryPolicy::Timeouts;
+    bool retryNonIdempotent = false;
+};
+
+}
+
+using namespace QHR;
+
+RetryPolicy::RetryPolicy()
+    : d(new RetryPolicyData)
+{
+
+}
+
+RetryPolicy::RetryPolicy(int maxAttempts)
+    : d(new RetryPolicyData)
+{
+    setMaxAttempts(maxAttempts);
+}
+
+RetryPolicy::RetryPolicy(const RetryPolicy &other) = default;
+
+RetryPolicy::RetryPolicy(RetryPolicy &&other) noexcept = default;
+
+RetryPolicy &RetryPolicy::operator=(const RetryPolicy &other) = default;
+
+RetryPolicy &RetryPolicy::operator=(RetryPolicy &&other) noexcept = default;
+
+RetryPolicy::~RetryPolicy() = default;
+
+void RetryPolicy::swap(RetryPolicy &other) noexcept
+{
+    d.swap(other.d);
+}
+
+int RetryPolicy::maxAttempts() const
+{
+    return d->maxAttempts;
+}
+
+void RetryPolicy::setMaxAttempts(int attempts)
+{
+    // attempts are counted in quint8 by jobs and the request executor
+    d->maxAttempts = qBound(1, attempts, 255);
+}
+
+int RetryPolicy::initialDelay() const
+{
+    return d->initialDelay;
+}
+
+void RetryPolicy::setInitialDelay(int msecs)
+{
+    d->initialDelay = msecs;
+}
+
+int RetryPolicy::maxDelay() const
+{
+    return d->maxDelay;
+}
+
+void RetryPolicy::setMaxDelay(int msecs)
+{
+    d->maxDelay = msecs;
+}
+
+double RetryPolicy::multiplier() const
+{
+    return d->multiplier;
+}
+
+void RetryPolicy::setMultiplier(double factor)
+{
+    d->multiplier = factor;
+}
+
+double RetryPolicy::jitter() const
+{
+    return d->jitter;
+}
+
+void RetryPolicy::setJitter(double fraction)
+{
+    d->jitter = qBound(0.0, fraction, 1.0);
+}
+
+RetryPolicy::ErrorClasses RetryPolicy::retryOn() const
+{
+    return d->retryOn;
+}
+
+void RetryPolicy::setRetryOn(ErrorClasses classes)
+{
+    d->retryOn = classes;
+}
+
+bool RetryPolicy::retryNonIdempotent() const
+{
+    return d->retryNonIdempotent;
+}
+
+void RetryPolicy::setRetryNonIdempotent(bool retry)
+{
+    d->retryNonIdempotent = retry;
+}
+
+int RetryPolicy::delay(int attempt) const
+{
+    const double base = qMin(static_cast<double>(d->maxDelay), static_cast<double>(d->initialDelay) * std::pow(d->multiplier, qMax(0, attempt - 1)));
+
+    if (d->jitter <= 0.0) {
+        return static_cast<int>(base);
+    }
+
+    thread_local std::mt19937 generator{std::random_device{}()};
+    std::uniform_real_distribution<double> distribution(0.0, d->jitter);
+
+    return static_cast<int>(base * (1.0 - distribution(generator)));
+}
@@ -0,0 +1,193 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_RETRYPOLICY_H
+#define QHR_RETRYPOLICY_H
+
+#include <QSharedDataPointer>
+#include "qhr_global.h"
+
+namespace QHR {
+
+class RetryPolicyData;
+
+/*!
+ * \brief Describes if and how failed API requests will be retried.
+ *
+ * Requests that failed because of an error class set in retryOn() will be sent again
+ * by the same job until maxAttempts() has been reached. The delay between the attempts
+ * grows exponentially starting at initialDelay() up to maxDelay(). A random part of the
+ * delay, controlled by jitter(), spreads the retries of many jobs over time.
+ *
+ * By default only idempotent requests (\c GET, \c HEAD, \c PUT and \c DELETE) will be
+ * retried. Use setRetryNonIdempotent() to also retry \c POST requests.
+ *
+ * A default constructed %RetryPolicy has maxAttempts() set to \c 1, so it will not retry
+ * any request. Use QHR::setDefaultRetryPolicy() to set a policy for all jobs or
+ * Job::setRetryPolicy() to set it for a single job.
+ *
+ * \headerfile "" <QHR/RetryPolicy>
+ */
+class QHR_LIBRARY RetryPolicy
+{
+public:
+    /*!
+     * \brief Classes of errors that can be retried.
+     */
+    enum ErrorClass : int {
+        NoErrors        = 0x00, /**< Do not retry any error. */
+        NetworkErrors   = 0x01, /**< Connection and other transport related errors. */
+        ServerErrors    = 0x02, /**< HTTP status codes 5xx, including API maintenance and internal errors. */
+        Timeouts        = 0x04, /**< The request timed out. */
+        RateLimited     = 0x08  /**< The request limit of the API has been exceeded. */
+    };
+    Q_DECLARE_FLAGS(ErrorClasses, ErrorClass)
+
+    /*!
+     * \brief Constructs a new %RetryPolicy that does not retry any request.
+     */
+    RetryPolicy();
+
+    /*!
+     * \brief Constructs a new %RetryPolicy that will try a request up to \a maxAttempts times.
+     *
+     * \a maxAttempts will be bound to the range of setMaxAttempts(). All other values
+     * will have their defaults.
+     */
+    explicit RetryPolicy(int maxAttempts);
+
+    /*!
+     * \brief Constructs a copy of \a other.
+     */
+    RetryPolicy(const RetryPolicy &other);
+
+    /*!
+     * \brief Move-constructs a %RetryPolicy instance, making it point at the same object that \a other was pointing to.
+     */
+    RetryPolicy(RetryPolicy &&other) noexcept;
+
+    /*!
+     * \brief Assigns \a other to this policy and returns a reference to this policy.
+     */
+    RetryPolicy &operator=(const RetryPolicy &other);
+
+    /*!
+     * \brief Move-assigns \a other to this %RetryPolicy instance.
+     */
+    RetryPolicy &operator=(RetryPolicy &&other) noexcept;
+
+    /*!
+     * \brief Destroys the %RetryPolicy object.
+     */
+    ~RetryPolicy();
+
+    /*!
+     * \brief Swaps this policy with \a other.
+     */
+    void swap(RetryPolicy &other) noexcept;
+
+    /*!
+     * \brief Returns the maximum number of attempts, including the first one.
+     *
+     * Default value: \c 1
+     */
+    int maxAttempts() const;
+
+    /*!
+     * \brief Sets the maximum number of \a attempts, including the first one.
+     *
+     * Valid values are between \c 1 and \c 255, values outside will be bound to this range.
+     */
+    void setMaxAttempts(int attempts);
+
+    /*!
+     * \brief Returns the delay in milliseconds before the first retry.
+     *
+     * Default value: \c 500
+     */
+    int initialDelay() const;
+
+    /*!
+     * \brief Sets the delay in \a msecs before the first retry.
+     */
+    void setInitialDelay(int msecs);
+
+    /*!
+     * \brief Returns the maximum delay in milliseconds between two attempts.
+     *
+     * Default value: \c 30000
+     */
+    int maxDelay() const;
+
+    /*!
+     * \brief Sets the maximum delay in \a msecs between two attempts.
+     */
+    void setMaxDelay(int msecs);
+
+    /*!
+     * \brief Returns the factor the delay grows by after every attempt.
+     *
+     * Default value: \c 2.0
+     */
+    double multiplier() const;
+
+    /*!
+     * \brief Sets the \a factor the delay grows by after every attempt.
+     */
+    void setMultiplier(double factor);
+
+    /*!
+     * \brief Returns the part of the delay that will be randomized.
+     *
+     * A value of \c 0.0 disables the jitter, a value of \c 1.0 randomizes the
+     * complete delay. Default value: \c 0.5
+     */
+    double jitter() const;
+
+    /*!
+     * \brief Sets the \a fraction of the delay that will be randomized.
+     */
+    void setJitter(double fraction);
+
+    /*!
+     * \brief Returns the error classes that will be retried.
+     *
+     * Default value: <CODE>NetworkErrors|ServerErrors|Timeouts</CODE>
+     */
+    ErrorClasses retryOn() const;
+
+    /*!
+     * \brief Sets the error \a classes that will be retried.
+     */
+    void setRetryOn(ErrorClasses classes);
+
+    /*!
+     * \brief Returns \c true if also non-idempotent requests like \c POST will be retried.
+     *
+     * Default value: \c false
+     */
+    bool retryNonIdempotent() const;
+
+    /*!
+     * \brief Set \a retry to \c true to also retry non-idempotent requests like \c POST.
+     */
+    void setRetryNonIdempotent(bool retry);
+
+    /*!
+     * \brief Returns the delay in milliseconds before the retry following the failed \a attempt.
+     *
+     * \a attempt starts at \c 1 for the first request. The returned delay includes the jitter.
+     */
+    int delay(int attempt) const;
+
+private:
+    QSharedDataPointer<RetryPolicyData> d;
+};
+
+}
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(QHR::RetryPolicy::ErrorClasses)
+
+#endif // QHR_RETRYPOLICY_H
@@ -0,0 +1,158 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "server.h"
+#include <QSharedData>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonValue>
+
+namespace QHR {
+
+class ServerData : public QSharedData
+{
+public:
+    QString serverIp;
+    QString serverIpv6Net;
+    QString serverName;
+    QString product;
+    QString dc;
+    QString traffic;
+    QString status;
+    QStringList ips;
+    QVector<Subnet> subnets;
+    QDate paidUntil;
+    int serverNumber = 0;
+    bool cancelled = false;
+};
+
+}
+
+using namespace QHR;
+
+Server::Server() = default;
+
+Server::Server(const Server &other) = default;
+
+Server::Server(Server &&other) noexcept = default;
+
+Server &Server::operator=(const Server &other) = default;
+
+Server &Server::operator=(Server &&other) noexcept = default;
+
+Server::~Server() = default;
+
+void Server::swap(Server &other) noexcept
+{
+    d.swap(other.d);
+}
+
+bool Server::isNull() const
+{
+    return !d;
+}
+
+QString Server::serverIp() const
+{
+    return d ? d->serverIp : QString();
+}
+
+QString Server::serverIpv6Net() const
+{
+    return d ? d->serverIpv6Net : QString();
+}
+
+int Server::serverNumber() const
+{
+    return d ? d->serverNumber : 0;
+}
+
+QString Server::serverName() const
+{
+    return d ? d->serverName : QString();
+}
+
+QString Server::product() const
+{
+    return d ? d->product : QString();
+}
+
+QString Server::dc() const
+{
+    return d ? d->dc : QString();
+}
+
+QString Server::traffic() const
+{
+    return d ? d->traffic : QString();
+}
+
+QString Server::status() const
+{
+    return d ? d->status : QString();
+}
+
+bool Server::isCancelled() const
+{
+    return d ? d->cancelled : false;
+}
+
+QDate Server::paidUntil() const
+{
+    return d ? d->paidUntil : QDate();
+}
+
+QStringList Server::ips() const
+{
+    return d ? d->ips : QStringList();
+}
+
+QVector<Subnet> Server::subnets() const
+{
+    return d ? d->subnets : QVector<Subnet>();
+}
+
+Server Server::fromJson(const QJsonObject &json)
+{
+    const QJsonValue wrapped = json.value(QStringLiteral("server"));
+    const QJsonObject o = wrapped.isObject() ? wrapped.toObject() : json;
+
+    Server server;
+    if (o.isEmpty()) {
+        return server;
+    }
+
+    server.d = new ServerData;
+    server.d->serverIp = o.value(QStringLiteral("server_ip")).toString();
+    server.d->serverIpv6Net = o.value(QStringLiteral("server_ipv6_net")).toString();
+    server.d->serverNumber = o.value(QStringLiteral("server_number")).toInt();
+    server.d->serverName = o.value(QStringLiteral("server_name")).toString();
+    server.d->product = o.value(QStringLiteral("product")).toString();
+    server.d->dc = o.value(QStringLiteral("dc")).toString();
+    server.d->traffic = o.value(QStringLiteral("traffic")).toString();
+    server.d->status = o.value(QStringLiteral("status")).toString();
+    server.d->cancelled = o.value(QStringLiteral("cancelled")).toBool();
+    server.d->paidUntil = QDate::fromString(o.value(QStringLiteral("paid_until")).toString(), Qt::ISODate);
+
+    const QJsonArray ips = o.value(QStringLiteral("ip")).toArray();
+    server.d->ips.reserve(ips.size());
+    for (const QJsonValue &ip : ips) {
+        server.d->ips.append(ip.toString());
+    }
+
+    server.d->subnets = Subnet::listFromJson(o.value(QStringLiteral("subnet")).toArray());
+
+    return server;
+}
+
+QVector<Server> Server::listFromJson(const QJsonArray &json)
+{
+    QVector<Server> list;
+    list.reserve(json.size());
+    for (const QJsonValue &v : json) {
+        list.push_back(Server::fromJson(v.toObject()));
+    }
+    return list;
+}
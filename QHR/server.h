@@ -0,0 +1,167 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_SERVER_H
+#define QHR_SERVER_H
+
+#include <QSharedDataPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QDate>
+#include <QMetaType>
+#include "qhr_global.h"
+#include "subnet.h"
+
+class QJsonObject;
+class QJsonArray;
+
+namespace QHR {
+
+class ServerData;
+
+/*!
+ * \brief Contains information about a dedicated server.
+ *
+ * Objects of this class are returned by the API for the \c /server routes.
+ *
+ * This class is implicitly shared. All values are read once from the JSON data
+ * and stored in plain members, so accessing them is cheap.
+ *
+ * \headerfile "" <QHR/Server>
+ */
+class QHR_LIBRARY Server
+{
+public:
+    /*!
+     * \brief Constructs a new null %Server object.
+     */
+    Server();
+
+    /*!
+     * \brief Constructs a copy of \a other.
+     */
+    Server(const Server &other);
+
+    /*!
+     * \brief Move-constructs a %Server instance, making it point at the same object that \a other was pointing to.
+     */
+    Server(Server &&other) noexcept;
+
+    /*!
+     * \brief Assigns \a other to this server and returns a reference to this server.
+     */
+    Server &operator=(const Server &other);
+
+    /*!
+     * \brief Move-assigns \a other to this %Server instance.
+     */
+    Server &operator=(Server &&other) noexcept;
+
+    /*!
+     * \brief Destroys the %Server object.
+     */
+    ~Server();
+
+    /*!
+     * \brief Swaps this server with \a other.
+     */
+    void swap(Server &other) noexcept;
+
+    /*!
+     * \brief Returns \c true if this server does not contain any data.
+     */
+    bool isNull() const;
+
+    /*!
+     * \brief Returns the main IPv4 address of the server.
+     */
+    QString serverIp() const;
+
+    /*!
+     * \brief Returns the IPv6 network of the server.
+     */
+    QString serverIpv6Net() const;
+
+    /*!
+     * \brief Returns the server number.
+     */
+    int serverNumber() const;
+
+    /*!
+     * \brief Returns the server name.
+     */
+    QString serverName() const;
+
+    /*!
+     * \brief Returns the product name.
+     */
+    QString product() const;
+
+    /*!
+     * \brief Returns the data center.
+     */
+    QString dc() const;
+
+    /*!
+     * \brief Returns the free traffic quota, like "5 TB" or "unlimited".
+     */
+    QString traffic() const;
+
+    /*!
+     * \brief Returns the server status, like "ready" or "in process".
+     */
+    QString status() const;
+
+    /*!
+     * \brief Returns \c true if the server has been cancelled.
+     */
+    bool isCancelled() const;
+
+    /*!
+     * \brief Returns the date until the server has been paid.
+     */
+    QDate paidUntil() const;
+
+    /*!
+     * \brief Returns the list of single IP addresses of the server.
+     */
+    QStringList ips() const;
+
+    /*!
+     * \brief Returns the list of subnets of the server.
+     *
+     * The returned subnets only contain the Subnet::ip() and the Subnet::mask().
+     */
+    QVector<Subnet> subnets() const;
+
+    /*!
+     * \brief Creates a new %Server object from \a json.
+     *
+     * \a json can either be the server object itself or an object containing
+     * the server object in the \c server key, as returned by the API.
+     */
+    static Server fromJson(const QJsonObject &json);
+
+    /*!
+     * \brief Creates a list of %Server objects from the \a json array.
+     */
+    static QVector<Server> listFromJson(const QJsonArray &json);
+
+private:
+    QSharedDataPointer<ServerData> d;
+};
+
+/*!
+ * \brief List of Server objects.
+ */
+using ServerList = QVector<Server>;
+
+}
+
+Q_DECLARE_SHARED(QHR::Server)
+Q_DECLARE_METATYPE(QHR::Server)
+
+#endif // QHR_SERVER_H
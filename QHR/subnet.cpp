@@ -0,0 +1,147 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "subnet.h"
+#include <QSharedData>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonValue>
+
+namespace QHR {
+
+class SubnetData : public QSharedData
+{
+public:
+    QString ip;
+    QString gateway;
+    QString serverIp;
+    int mask = 0;
+    int serverNumber = 0;
+    int trafficHourly = 0;
+    int trafficDaily = 0;
+    int trafficMonthly = 0;
+    bool failover = false;
+    bool locked = false;
+    bool trafficWarnings = false;
+};
+
+}
+
+using namespace QHR;
+
+Subnet::Subnet() = default;
+
+Subnet::Subnet(const Subnet &other) = default;
+
+Subnet::Subnet(Subnet &&other) noexcept = default;
+
+Subnet &Subnet::operator=(const Subnet &other) = default;
+
+Subnet &Subnet::operator=(Subnet &&other) noexcept = default;
+
+Subnet::~Subnet() = default;
+
+void Subnet::swap(Subnet &other) noexcept
+{
+    d.swap(other.d);
+}
+
+bool Subnet::isNull() const
+{
+    return !d;
+}
+
+QString Subnet::ip() const
+{
+    return d ? d->ip : QString();
+}
+
+int Subnet::mask() const
+{
+    return d ? d->mask : 0;
+}
+
+QString Subnet::gateway() const
+{
+    return d ? d->gateway : QString();
+}
+
+QString Subnet::serverIp() const
+{
+    return d ? d->serverIp : QString();
+}
+
+int Subnet::serverNumber() const
+{
+    return d ? d->serverNumber : 0;
+}
+
+bool Subnet::isFailover() const
+{
+    return d ? d->failover : false;
+}
+
+bool Subnet::isLocked() const
+{
+    return d ? d->locked : false;
+}
+
+bool Subnet::trafficWarnings() const
+{
+    return d ? d->trafficWarnings : false;
+}
+
+int Subnet::trafficHourly() const
+{
+    return d ? d->trafficHourly : 0;
+}
+
+int Subnet::trafficDaily() const
+{
+    return d ? d->trafficDaily : 0;
+}
+
+int Subnet::trafficMonthly() const
+{
+    return d ? d->trafficMonthly : 0;
+}
+
+Subnet Subnet::fromJson(const QJsonObject &json)
+{
+    const QJsonValue wrapped = json.value(QStringLiteral("subnet"));
+    const QJsonObject o = wrapped.isObject() ? wrapped.toObject() : json;
+
+    Subnet subnet;
+    if (o.isEmpty()) {
+        return subnet;
+    }
+
+    subnet.d = new SubnetData;
+    subnet.d->ip = o.value(QStringLiteral("ip")).toString();
+    // the mask is a string in the server object and a number in the subnet object
+    const QJsonValue mask = o.value(QStringLiteral("mask"));
+    subnet.d->mask = mask.isString() ? mask.toString().toInt() : mask.toInt();
+    subnet.d->gateway = o.value(QStringLiteral("gateway")).toString();
+    subnet.d->serverIp = o.value(QStringLiteral("server_ip")).toString();
+    subnet.d->serverNumber = o.value(QStringLiteral("server_number")).toInt();
+    subnet.d->failover = o.value(QStringLiteral("failover")).toBool();
+    subnet.d->locked = o.value(QStringLiteral("locked")).toBool();
+    subnet.d->trafficWarnings = o.value(QStringLiteral("traffic_warnings")).toBool();
+    subnet.d->trafficHourly = o.value(QStringLiteral("traffic_hourly")).toInt();
+    subnet.d->trafficDaily = o.value(QStringLiteral("traffic_daily")).toInt();
+    subnet.d->trafficMonthly = o.value(QStringLiteral("traffic_monthly")).toInt();
+
+    return subnet;
+}
+
+QVector<Subnet> Subnet::listFromJson(const QJsonArray &json)
+{
+    QVector<Subnet> list;
+    list.reserve(json.size());
+    for (const QJsonValue &v : json) {
+        list.push_back(Subnet::fromJson(v.toObject()));
+    }
+    return list;
+}
@@ -0,0 +1,154 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_SUBNET_H
+#define QHR_SUBNET_H
+
+#include <QSharedDataPointer>
+#include <QString>
+#include <QVector>
+#include <QMetaType>
+#include "qhr_global.h"
+
+class QJsonObject;
+class QJsonArray;
+
+namespace QHR {
+
+class SubnetData;
+
+/*!
+ * \brief Contains information about a subnet.
+ *
+ * Objects of this class are returned by the API for the \c /subnet routes and
+ * as part of a Server. Subnets that are part of a Server only contain the
+ * ip() and the mask().
+ *
+ * This class is implicitly shared. All values are read once from the JSON data
+ * and stored in plain members, so accessing them is cheap.
+ *
+ * \headerfile "" <QHR/Subnet>
+ */
+class QHR_LIBRARY Subnet
+{
+public:
+    /*!
+     * \brief Constructs a new null %Subnet object.
+     */
+    Subnet();
+
+    /*!
+     * \brief Constructs a copy of \a other.
+     */
+    Subnet(const Subnet &other);
+
+    /*!
+     * \brief Move-constructs a %Subnet instance, making it point at the same object that \a other was pointing to.
+     */
+    Subnet(Subnet &&other) noexcept;
+
+    /*!
+     * \brief Assigns \a other to this subnet and returns a reference to this subnet.
+     */
+    Subnet &operator=(const Subnet &other);
+
+    /*!
+     * \brief Move-assigns \a other to this %Subnet instance.
+     */
+    Subnet &operator=(Subnet &&other) noexcept;
+
+    /*!
+     * \brief Destroys the %Subnet object.
+     */
+    ~Subnet();
+
+    /*!
+     * \brief Swaps this subnet with \a other.
+     */
+    void swap(Subnet &other) noexcept;
+
+    /*!
+     * \brief Returns \c true if this subnet does not contain any data.
+     */
+    bool isNull() const;
+
+    /*!
+     * \brief Returns the network address of the subnet.
+     */
+    QString ip() const;
+
+    /*!
+     * \brief Returns the prefix length of the subnet.
+     */
+    int mask() const;
+
+    /*!
+     * \brief Returns the gateway address of the subnet.
+     */
+    QString gateway() const;
+
+    /*!
+     * \brief Returns the main IP address of the server the subnet is routed to.
+     */
+    QString serverIp() const;
+
+    /*!
+     * \brief Returns the number of the server the subnet is routed to.
+     */
+    int serverNumber() const;
+
+    /*!
+     * \brief Returns \c true if the subnet is a failover subnet.
+     */
+    bool isFailover() const;
+
+    /*!
+     * \brief Returns \c true if the subnet has been locked.
+     */
+    bool isLocked() const;
+
+    /*!
+     * \brief Returns \c true if traffic warnings are enabled.
+     */
+    bool trafficWarnings() const;
+
+    /*!
+     * \brief Returns the hourly traffic limit in MB.
+     */
+    int trafficHourly() const;
+
+    /*!
+     * \brief Returns the daily traffic limit in MB.
+     */
+    int trafficDaily() const;
+
+    /*!
+     * \brief Returns the monthly traffic limit in GB.
+     */
+    int trafficMonthly() const;
+
+    /*!
+     * \brief Creates a new %Subnet object from \a json.
+     *
+     * \a json can either be the subnet object itself or an object containing
+     * the subnet object in the \c subnet key, as returned by the API.
+     */
+    static Subnet fromJson(const QJsonObject &json);
+
+    /*!
+     * \brief Creates a list of %Subnet objects from the \a json array.
+     */
+    static QVector<Subnet> listFromJson(const QJsonArray &json);
+
+private:
+    QSharedDataPointer<SubnetData> d;
+};
+
+}
+
+Q_DECLARE_SHARED(QHR::Subnet)
+Q_DECLARE_METATYPE(QHR::Subnet)
+
+#endif // QHR_SUBNET_H
@@ -0,0 +1,873 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "trafficdata.h"
+#include "traffickernels_p.h"
+#include "logging.h"
+#include <QSharedData>
+#include <QHostAddress>
+#include <QPair>
+#include <cstring>
+#include <numeric>
+#include <utility>
+
+namespace QHR {
+
+class TrafficDataData : public QSharedData
+{
+public:
+    std::pair<int,int> range(int ipIndex) const
+    {
+        if (ipIndex < 0) {
+            return std::make_pair(0, timestamps.size());
+        }
+        if (Q_UNLIKELY(ipIndex >= ips.size())) {
+            qCWarning(qhrCore) << "Invalid traffic IP index" << ipIndex;
+            return std::make_pair(0, 0);
+        }
+        return std::make_pair(offsets.at(ipIndex), offsets.at(ipIndex + 1));
+    }
+
+    QStringList ips;
+    // ips.size() + 1 entries, the rows of ip n are [offsets[n], offsets[n + 1])
+    QVector<int> offsets;
+    QVector<qint64> timestamps;
+    QVector<double> columns[3];
+    QDateTime from;
+    QDateTime to;
+    TrafficData::Type type = TrafficData::Invalid;
+};
+
+}
+
+using namespace QHR;
+
+namespace {
+
+/*
+ * Scans the reply of /traffic directly into the columns of TrafficDataData.
+ *
+ * Only the structure used by the API is interpreted, values of unknown keys
+ * are skipped. Strings are referenced as slices of the input data and only
+ * the IP addresses are converted into QStrings. Period keys of single values
+ * are resolved into timestamps after the whole object has been read, because
+ * the type and the begin of the time range might come after the data.
+ */
+class TrafficReader
+{
+public:
+    TrafficReader(const QByteArray &data, TrafficDataData *d)
+        : m_begin(data.constData()), m_pos(data.constData()), m_end(data.constData() + data.size()), d(d)
+    {
+        const int expectedRows = data.size() / 48;
+        d->timestamps.reserve(expectedRows);
+        for (QVector<double> &column : d->columns) {
+            column.reserve(expectedRows);
+        }
+        m_periods.reserve(expectedRows);
+    }
+
+    bool read();
+
+    QString errorString;
+
+private:
+    struct Slice {
+        const char *data = nullptr;
+        int size = 0;
+        bool escaped = false;
+
+        bool equals(const char *str, int len) const { return !escaped && size == len && std::memcmp(data, str, static_cast<size_t>(len)) == 0; }
+    };
+
+    bool fail(const char *message);
+    void skipWhitespace();
+    bool consume(char c);
+    bool readString(Slice &slice);
+    bool readNumber(double &value);
+    bool skipValue();
+    bool readTraffic(int depth);
+    bool readData();
+    bool readIp();
+    bool readValues(double *values);
+    void appendRow(const double *values, const Slice &period);
+    bool resolveTimestamps();
+    qint64 periodStart(const Slice &period, qint64 fallback) const;
+    void sortRows();
+
+    static QString decode(const Slice &slice);
+    static QDateTime parseDateTime(const QString &str);
+    static bool toInt(const Slice &slice, int &value);
+
+    const char *m_begin;
+    const char *m_pos;
+    const char *m_end;
+    TrafficDataData *d;
+    QVector<Slice> m_periods;
+    Slice m_type;
+    Slice m_from;
+    Slice m_to;
+};
+
+bool TrafficReader::fail(const char *message)
+{
+    if (errorString.isEmpty()) {
+        errorString = QStringLiteral("%1 at offset %2").arg(QLatin1String(message)).arg(m_pos - m_begin);
+    }
+    return false;
+}
+
+void TrafficReader::skipWhitespace()
+{
+    while (m_pos < m_end && (*m_pos == ' ' || *m_pos == '\n' || *m_pos == '\r' || *m_pos == '\t')) {
+        ++m_pos;
+    }
+}
+
+bool TrafficReader::consume(char c)
+{
+    skipWhitespace();
+    if (Q_LIKELY(m_pos < m_end && *m_pos == c)) {
+        ++m_pos;
+        return true;
+    }
+    return false;
+}
+
+bool TrafficReader::readString(Slice &slice)
+{
+    if (!consume('"')) {
+        return fail("String expected");
+    }
+
+    slice.data = m_pos;
+    slice.escaped = false;
+    while (m_pos < m_end) {
+        const char c = *m_pos;
+        if (c == '"') {
+            slice.size = static_cast<int>(m_pos - slice.data);
+            ++m_pos;
+            return true;
+        }
+        if (c == '\\') {
+            // a trailing backslash must not move behind the end of the data
+            if (Q_UNLIKELY(m_pos + 1 >= m_end)) {
+                break;
+            }
+            slice.escaped = true;
+            ++m_pos;
+        }
+        ++m_pos;
+    }
+
+    return fail("Unterminated string");
+}
+
+bool TrafficReader::readNumber(double &value)
+{
+    skipWhitespace();
+
+    if (m_end - m_pos >= 4 && std::memcmp(m_pos, "null", 4) == 0) {
+        m_pos += 4;
+        value = 0.0;
+        return true;
+    }
+
+    // exact for up to 15 significant digits and powers of ten up to 22, what covers
+    // all values returned by the API; everything else is handed over to Qt
+    static const double powersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char *start = m_pos;
+    const bool negative = (m_pos < m_end && *m_pos == '-');
+    if (negative) {
+        ++m_pos;
+    }
+
+    quint64 mantissa = 0;
+    int significant = 0;
+    int digits = 0;
+    int exponent = 0;
+
+    while (m_pos < m_end && *m_pos >= '0' && *m_pos <= '9') {
+        if (significant < 19) {
+            mantissa = mantissa * 10 + static_cast<quint64>(*m_pos - '0');
+            if (mantissa) {
+                ++significant;
+            }
+        } else {
+            ++exponent;
+            ++significant;
+        }
+        ++digits;
+        ++m_pos;
+    }
+
+    if (m_pos < m_end && *m_pos == '.') {
+        ++m_pos;
+        while (m_pos < m_end && *m_pos >= '0' && *m_pos <= '9') {
+            if (significant < 19) {
+                mantissa = mantissa * 10 + static_cast<quint64>(*m_pos - '0');
+                if (mantissa) {
+                    ++significant;
+                }
+                --exponent;
+            } else {
+                ++significant;
+            }
+            ++digits;
+            ++m_pos;
+        }
+    }
+
+    if (Q_UNLIKELY(digits == 0)) {
+        m_pos = start;
+        return fail("Number expected");
+    }
+
+    if (m_pos < m_end && (*m_pos == 'e' || *m_pos == 'E')) {
+        ++m_pos;
+        bool negativeExponent = false;
+        if (m_pos < m_end && (*m_pos == '+' || *m_pos == '-')) {
+            negativeExponent = (*m_pos == '-');
+            ++m_pos;
+        }
+        int e = 0;
+        const char *expStart = m_pos;
+        while (m_pos < m_end && *m_pos >= '0' && *m_pos <= '9') {
+            if (e < 100000) {
+                e = e * 10 + (*m_pos - '0');
+            }
+            ++m_pos;
+        }
+        if (Q_UNLIKELY(expStart == m_pos)) {
+            return fail("Invalid number exponent");
+        }
+        exponent += negativeExponent ? -e : e;
+    }
+
+    if (Q_LIKELY(significant <= 15 && exponent >= -22 && exponent <= 22)) {
+        const double m = static_cast<double>(mantissa);
+        value = exponent < 0 ? m / powersOfTen[-exponent] : m * powersOfTen[exponent];
+        if (negative) {
+            value = -value;
+        }
+        return true;
+    }
+
+    bool ok = false;
+    value = QByteArray(start, static_cast<int>(m_pos - start)).toDouble(&ok);
+    return ok ? true : fail("Invalid number");
+}
+
+bool TrafficReader::skipValue()
+{
+    skipWhitespace();
+    if (Q_UNLIKELY(m_pos >= m_end)) {
+        return fail("Value expected");
+    }
+
+    if (*m_pos == '"') {
+        Slice slice;
+        return readString(slice);
+    }
+
+    if (*m_pos == '{' || *m_pos == '[') {
+        int depth = 0;
+        bool inString = false;
+        while (m_pos < m_end) {
+            const char c = *m_pos++;
+            if (inString) {
+                if (c == '\\') {
+                    if (Q_UNLIKELY(m_pos >= m_end)) {
+                        break;
+                    }
+                    ++m_pos;
+                } else if (c == '"') {
+                    inString = false;
+                }
+            } else if (c == '"') {
+                inString = true;
+            } else if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    return true;
+                }
+            }
+        }
+        return fail("Unterminated object or array");
+    }
+
+    // numbers and literals
+    const char *start = m_pos;
+    while (m_pos < m_end && *m_pos != ',' && *m_pos != '}' && *m_pos != ']' && *m_pos != ' ' && *m_pos != '\n' && *m_pos != '\r' && *m_pos != '\t') {
+        ++m_pos;
+    }
+    return m_pos != start ? true : fail("Value expected");
+}
+
+bool TrafficReader::read()
+{
+    if (!readTraffic(0)) {
+        return false;
+    }
+
+    skipWhitespace();
+    if (Q_UNLIKELY(m_pos != m_end)) {
+        return fail("Unexpected data after the end of the object");
+    }
+
+    if (Q_UNLIKELY(d->offsets.isEmpty())) {
+        return fail("Missing traffic data");
+    }
+
+    return resolveTimestamps();
+}
+
+bool TrafficReader::readTraffic(int depth)
+{
+    if (!consume('{')) {
+        return fail("Object expected");
+    }
+
+    if (consume('}')) {
+        return true;
+    }
+
+    do {
+        Slice key;
+        if (!readString(key) || !consume(':')) {
+            return fail("Invalid object member");
+        }
+
+        bool ok;
+        if (depth == 0 && key.equals("traffic", 7)) {
+            ok = readTraffic(depth + 1);
+        } else if (key.equals("data", 4)) {
+            ok = readData();
+        } else if (key.equals("type", 4)) {
+            ok = readString(m_type);
+        } else if (key.equals("from", 4)) {
+            ok = readString(m_from);
+        } else if (key.equals("to", 2)) {
+            ok = readString(m_to);
+        } else {
+            ok = skipValue();
+        }
+        if (!ok) {
+            return false;
+        }
+    } while (consume(','));
+
+    return consume('}') ? true : fail("Expected end of object");
+}
+
+bool TrafficReader::readData()
+{
+    d->offsets.clear();
+    d->offsets.push_back(0);
+
+    skipWhitespace();
+    // PHP encodes empty maps as empty arrays
+    if (m_pos < m_end && *m_pos == '[') {
+        return skipValue();
+    }
+
+    if (!consume('{')) {
+        return fail("Object expected");
+    }
+
+    if (consume('}')) {
+        return true;
+    }
+
+    do {
+        Slice ip;
+        if (!readString(ip) || !consume(':')) {
+            return fail("Invalid object member");
+        }
+        d->ips.push_back(decode(ip));
+        if (!readIp()) {
+            return false;
+        }
+        d->offsets.push_back(d->timestamps.size());
+    } while (consume(','));
+
+    return consume('}') ? true : fail("Expected end of object");
+}
+
+bool TrafficReader::readIp()
+{
+    if (!consume('{')) {
+        return fail("Object expected");
+    }
+
+    if (consume('}')) {
+        return true;
+    }
+
+    double totals[3] = {0.0, 0.0, -1.0};
+    bool hasTotals = false;
+
+    do {
+        Slice key;
+        if (!readString(key) || !consume(':')) {
+            return fail("Invalid object member");
+        }
+
+        skipWhitespace();
+        if (m_pos < m_end && *m_pos == '{') {
+            double values[3] = {0.0, 0.0, -1.0};
+            if (!readValues(values)) {
+                return false;
+            }
+            appendRow(values, key);
+            continue;
+        }
+
+        int column = -1;
+        if (key.equals("in", 2)) {
+            column = TrafficData::In;
+        } else if (key.equals("out", 3)) {
+            column = TrafficData::Out;
+        } else if (key.equals("sum", 3)) {
+            column = TrafficData::Sum;
+        }
+
+        if (column < 0) {
+            if (!skipValue()) {
+                return false;
+            }
+        } else {
+            if (!readNumber(totals[column])) {
+                return false;
+            }
+            hasTotals = true;
+        }
+    } while (consume(','));
+
+    if (hasTotals) {
+        appendRow(totals, Slice());
+    }
+
+    return consume('}') ? true : fail("Expected end of object");
+}
+
+bool TrafficReader::readValues(double *values)
+{
+    if (!consume('{')) {
+        return fail("Object expected");
+    }
+
+    if (consume('}')) {
+        return true;
+    }
+
+    do {
+        Slice key;
+        if (!readString(key) || !consume(':')) {
+            return fail("Invalid object member");
+        }
+
+        bool ok;
+        if (key.equals("in", 2)) {
+            ok = readNumber(values[TrafficData::In]);
+        } else if (key.equals("out", 3)) {
+            ok = readNumber(values[TrafficData::Out]);
+        } else if (key.equals("sum", 3)) {
+            ok = readNumber(values[TrafficData::Sum]);
+        } else {
+            ok = skipValue();
+        }
+        if (!ok) {
+            return false;
+        }
+    } while (consume(','));
+
+    return consume('}') ? true : fail("Expected end of object");
+}
+
+void TrafficReader::appendRow(const double *values, const Slice &period)
+{
+    d->timestamps.push_back(0);
+    d->columns[TrafficData::In].push_back(values[TrafficData::In]);
+    d->columns[TrafficData::Out].push_back(values[TrafficData::Out]);
+    // a missing sum is initialized with -1
+    d->columns[TrafficData::Sum].push_back(values[TrafficData::Sum] < 0.0 ? values[TrafficData::In] + values[TrafficData::Out] : values[TrafficData::Sum]);
+    m_periods.push_back(period);
+}
+
+QString TrafficReader::decode(const Slice &slice)
+{
+    if (!slice.escaped) {
+        return QString::fromUtf8(slice.data, slice.size);
+    }
+
+    QByteArray unescaped;
+    unescaped.reserve(slice.size);
+    const char *p = slice.data;
+    const char *end = slice.data + slice.size;
+    QString result;
+    while (p < end) {
+        if (*p != '\\' || p + 1 >= end) {
+            unescaped.append(*p++);
+            continue;
+        }
+        ++p;
+        switch (*p) {
+        case 'b': unescaped.append('\b'); break;
+        case 'f': unescaped.append('\f'); break;
+        case 'n': unescaped.append('\n'); break;
+        case 'r': unescaped.append('\r'); break;
+        case 't': unescaped.append('\t'); break;
+        case 'u':
+            if (end - p > 4) {
+                bool ok = false;
+                const ushort code = QByteArray(p + 1, 4).toUShort(&ok, 16);
+                if (ok) {
+                    result += QString::fromUtf8(unescaped);
+                    result += QChar(code);
+                    unescaped.clear();
+                    p += 4;
+                }
+            }
+            break;
+        default:
+            unescaped.append(*p);
+            break;
+        }
+        ++p;
+    }
+    result += QString::fromUtf8(unescaped);
+    return result;
+}
+
+QDateTime TrafficReader::parseDateTime(const QString &str)
+{
+    QDateTime dt;
+    switch (str.size()) {
+    case 7:
+        dt = QDateTime(QDate::fromString(str, QStringLiteral("yyyy-MM")), QTime(0, 0), Qt::UTC);
+        break;
+    case 10:
+        dt = QDateTime(QDate::fromString(str, QStringLiteral("yyyy-MM-dd")), QTime(0, 0), Qt::UTC);
+        break;
+    case 13:
+        dt = QDateTime::fromString(str, QStringLiteral("yyyy-MM-dd'T'HH"));
+        dt.setTimeSpec(Qt::UTC);
+        break;
+    default:
+        dt = QDateTime::fromString(str, Qt::ISODate);
+        dt.setTimeSpec(Qt::UTC);
+        break;
+    }
+    return dt;
+}
+
+bool TrafficReader::toInt(const Slice &slice, int &value)
+{
+    if (slice.size == 0 || slice.size > 4 || slice.escaped) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < slice.size; ++i) {
+        const char c = slice.data[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return true;
+}
+
+qint64 TrafficReader::periodStart(const Slice &period, qint64 fallback) const
+{
+    if (period.size == 0) {
+        return fallback;
+    }
+
+    int number = 0;
+    if (!toInt(period, number)) {
+        const QDateTime dt = parseDateTime(decode(period));
+        return dt.isValid() ? dt.toMSecsSinceEpoch() : fallback;
+    }
+
+    // short keys are relative to the begin of the time range, ranges might wrap
+    // into the next day, month or year
+    const QDate fromDate = d->from.date();
+    QDateTime dt;
+    switch (d->type) {
+    case TrafficData::Day:
+        dt = QDateTime(fromDate, QTime(qBound(0, number, 23), 0), Qt::UTC);
+        if (dt < d->from) {
+            dt = dt.addDays(1);
+        }
+        break;
+    case TrafficData::Month:
+    {
+        QDate date(fromDate.year(), fromDate.month(), number);
+        if (!date.isValid() || date < fromDate) {
+            const QDate next = fromDate.addMonths(1);
+            date = QDate(next.year(), next.month(), number);
+        }
+        dt = QDateTime(date, QTime(0, 0), Qt::UTC);
+        break;
+    }
+    case TrafficData::Year:
+    {
+        QDate date(fromDate.year(), number, 1);
+        if (date.isValid() && date < QDate(fromDate.year(), fromDate.month(), 1)) {
+            date = date.addYears(1);
+        }
+        dt = QDateTime(date, QTime(0, 0), Qt::UTC);
+        break;
+    }
+    default:
+        break;
+    }
+
+    return dt.isValid() ? dt.toMSecsSinceEpoch() : fallback;
+}
+
+bool TrafficReader::resolveTimestamps()
+{
+    if (m_type.equals("day", 3)) {
+        d->type = TrafficData::Day;
+    } else if (m_type.equals("month", 5)) {
+        d->type = TrafficData::Month;
+    } else if (m_type.equals("year", 4)) {
+        d->type = TrafficData::Year;
+    } else {
+        qCWarning(qhrCore) << "Unknown traffic type" << decode(m_type);
+    }
+
+    d->from = parseDateTime(decode(m_from));
+    d->to = parseDateTime(decode(m_to));
+
+    const qint64 fallback = d->from.isValid() ? d->from.toMSecsSinceEpoch() : 0;
+    qint64 *timestamps = d->timestamps.data();
+    for (int row = 0; row < m_periods.size(); ++row) {
+        timestamps[row] = periodStart(m_periods.at(row), fallback);
+    }
+
+    sortRows();
+
+    return true;
+}
+
+void TrafficReader::sortRows()
+{
+    QVector<int> order;
+    for (int ip = 0; ip < d->ips.size(); ++ip) {
+        const int begin = d->offsets.at(ip);
+        const int end = d->offsets.at(ip + 1);
+        const qint64 *ts = d->timestamps.constData();
+        if (std::is_sorted(ts + begin, ts + end)) {
+            continue;
+        }
+
+        order.resize(end - begin);
+        std::iota(order.begin(), order.end(), begin);
+        std::stable_sort(order.begin(), order.end(), [ts](int a, int b){
+            return ts[a] < ts[b];
+        });
+
+        const QVector<qint64> timestamps = d->timestamps.mid(begin, end - begin);
+        for (int i = 0; i < order.size(); ++i) {
+            d->timestamps[begin + i] = timestamps.at(order.at(i) - begin);
+        }
+        for (QVector<double> &column : d->columns) {
+            const QVector<double> values = column.mid(begin, end - begin);
+            for (int i = 0; i < order.size(); ++i) {
+                column[begin + i] = values.at(order.at(i) - begin);
+            }
+        }
+    }
+}
+
+}
+
+TrafficData::TrafficData() = default;
+
+TrafficData::TrafficData(const TrafficData &other) = default;
+
+TrafficData::TrafficData(TrafficData &&other) noexcept = default;
+
+TrafficData &TrafficData::operator=(const TrafficData &other) = default;
+
+TrafficData &TrafficData::operator=(TrafficData &&other) noexcept = default;
+
+TrafficData::~TrafficData() = default;
+
+void TrafficData::swap(TrafficData &other) noexcept
+{
+    d.swap(other.d);
+}
+
+bool TrafficData::isNull() const
+{
+    return !d;
+}
+
+TrafficData::Type TrafficData::type() const
+{
+    return d ? d->type : Invalid;
+}
+
+QDateTime TrafficData::from() const
+{
+    return d ? d->from : QDateTime();
+}
+
+QDateTime TrafficData::to() const
+{
+    return d ? d->to : QDateTime();
+}
+
+QStringList TrafficData::ips() const
+{
+    return d ? d->ips : QStringList();
+}
+
+int TrafficData::ipCount() const
+{
+    return d ? d->ips.size() : 0;
+}
+
+int TrafficData::indexOf(const QString &ip) const
+{
+    return d ? d->ips.indexOf(ip) : -1;
+}
+
+int TrafficData::rowCount() const
+{
+    return d ? d->timestamps.size() : 0;
+}
+
+int TrafficData::rowBegin(int ipIndex) const
+{
+    return d ? d->range(ipIndex).first : 0;
+}
+
+int TrafficData::rowEnd(int ipIndex) const
+{
+    return d ? d->range(ipIndex).second : 0;
+}
+
+QVector<qint64> TrafficData::timestamps() const
+{
+    return d ? d->timestamps : QVector<qint64>();
+}
+
+QVector<double> TrafficData::values(Column column) const
+{
+    Q_ASSERT(column <= Sum);
+    return d ? d->columns[column] : QVector<double>();
+}
+
+double TrafficData::sum(Column column, int ipIndex) const
+{
+    Q_ASSERT(column <= Sum);
+    if (!d) {
+        return 0.0;
+    }
+    const auto range = d->range(ipIndex);
+    return TrafficKernels::sum(d->columns[column].constData() + range.first, range.second - range.first);
+}
+
+double TrafficData::peak(Column column, int ipIndex) const
+{
+    Q_ASSERT(column <= Sum);
+    if (!d) {
+        return 0.0;
+    }
+    const auto range = d->range(ipIndex);
+    return TrafficKernels::peak(d->columns[column].constData() + range.first, range.second - range.first);
+}
+
+double TrafficData::percentile(Column column, double percent, int ipIndex) const
+{
+    Q_ASSERT(column <= Sum);
+    if (!d) {
+        return 0.0;
+    }
+    const auto range = d->range(ipIndex);
+    QVector<double> values = d->columns[column].mid(range.first, range.second - range.first);
+    return TrafficKernels::percentile(values.data(), values.size(), percent);
+}
+
+QVector<double> TrafficData::sums(Column column) const
+{
+    Q_ASSERT(column <= Sum);
+    QVector<double> result;
+    if (d && !d->ips.empty()) {
+        result.resize(d->ips.size());
+        TrafficKernels::segmentSums(d->columns[column].constData(), d->offsets.constData(), d->ips.size(), result.data());
+    }
+    return result;
+}
+
+QHash<QString, double> TrafficData::subnetSums(Column column, int ipv4Prefix, int ipv6Prefix) const
+{
+    QHash<QString, double> result;
+    if (!d) {
+        return result;
+    }
+
+    const QVector<double> ipSums = sums(column);
+    for (int i = 0; i < d->ips.size(); ++i) {
+        const QString &ip = d->ips.at(i);
+        QPair<QHostAddress,int> subnet;
+        if (ip.contains(QLatin1Char('/'))) {
+            subnet = QHostAddress::parseSubnet(ip);
+        } else {
+            subnet.first = QHostAddress(ip);
+            subnet.second = subnet.first.protocol() == QAbstractSocket::IPv6Protocol ? 128 : 32;
+        }
+
+        QHostAddress network;
+        int prefix;
+        if (subnet.first.protocol() == QAbstractSocket::IPv4Protocol) {
+            prefix = qBound(0, std::min(ipv4Prefix, subnet.second), 32);
+            const quint32 mask = prefix == 0 ? 0 : ~quint32(0) << (32 - prefix);
+            network = QHostAddress(subnet.first.toIPv4Address() & mask);
+        } else if (subnet.first.protocol() == QAbstractSocket::IPv6Protocol) {
+            prefix = qBound(0, std::min(ipv6Prefix, subnet.second), 128);
+            Q_IPV6ADDR addr = subnet.first.toIPv6Address();
+            for (int b = 0; b < 16; ++b) {
+                const int bits = qBound(0, prefix - b * 8, 8);
+                addr[b] &= static_cast<quint8>(bits == 0 ? 0 : 0xFF << (8 - bits));
+            }
+            network = QHostAddress(addr);
+        } else {
+            qCWarning(qhrCore) << "Skipping invalid traffic IP" << ip << "in subnet rollup.";
+            continue;
+        }
+
+        result[network.toString() + QLatin1Char('/') + QString::number(prefix)] += ipSums.at(i);
+    }
+
+    return result;
+}
+
+TrafficData TrafficData::fromJson(const QByteArray &data, QString *errorString)
+{
+    TrafficData traffic;
+    traffic.d = new TrafficDataData;
+
+    TrafficReader reader(data, traffic.d.data());
+    if (Q_UNLIKELY(!reader.read())) {
+        qCWarning(qhrCore) << "Failed to read traffic data:" << reader.errorString;
+        if (errorString) {
+            *errorString = reader.errorString;
+        }
+        return TrafficData();
+    }
+
+    return traffic;
+}
@@ -0,0 +1,216 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_TRAFFICDATA_H
+#define QHR_TRAFFICDATA_H
+
+#include <QSharedDataPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QDateTime>
+#include <QMetaType>
+#include "qhr_global.h"
+
+namespace QHR {
+
+class TrafficDataData;
+
+/*!
+ * \brief Contains traffic statistics returned by the \c /traffic route.
+ *
+ * The values are stored column wise: there is one column for the timestamps and
+ * one column of \c double values in gigabytes for every of the incoming, outgoing
+ * and summed up traffic. The rows of a single IP address or subnet are stored
+ * contiguously and sorted by timestamp, the range of rows belonging to an IP can
+ * be queried via rowBegin() and rowEnd(). If the statistics have been requested
+ * without single values, every IP has exactly one row.
+ *
+ * The aggregation functions work directly on the columns and do not touch any
+ * JSON data. Sums and peaks are computed with SIMD instructions where available.
+ *
+ * This class is implicitly shared.
+ *
+ * \headerfile "" <QHR/TrafficData>
+ */
+class QHR_LIBRARY TrafficData
+{
+public:
+    /*!
+     * \brief Type of the requested statistics, determines the resolution of single values.
+     */
+    enum Type : quint8 {
+        Invalid = 0,    /**< Invalid type. */
+        Day,            /**< Statistics for a day with hourly single values. */
+        Month,          /**< Statistics for a month with daily single values. */
+        Year            /**< Statistics for a year with monthly single values. */
+    };
+
+    /*!
+     * \brief Selects one of the value columns.
+     */
+    enum Column : quint8 {
+        In = 0,         /**< Incoming traffic in GB. */
+        Out,            /**< Outgoing traffic in GB. */
+        Sum             /**< Sum of incoming and outgoing traffic in GB. */
+    };
+
+    /*!
+     * \brief Constructs a null %TrafficData object.
+     */
+    TrafficData();
+
+    /*!
+     * \brief Constructs a copy of \a other.
+     */
+    TrafficData(const TrafficData &other);
+
+    /*!
+     * \brief Move-constructs a %TrafficData instance, making it point at the same object that \a other was pointing to.
+     */
+    TrafficData(TrafficData &&other) noexcept;
+
+    /*!
+     * \brief Assigns \a other to this object.
+     */
+    TrafficData &operator=(const TrafficData &other);
+
+    /*!
+     * \brief Move-assigns \a other to this object.
+     */
+    TrafficData &operator=(TrafficData &&other) noexcept;
+
+    /*!
+     * \brief Destroys the %TrafficData object.
+     */
+    ~TrafficData();
+
+    /*!
+     * \brief Swaps this object with \a other.
+     */
+    void swap(TrafficData &other) noexcept;
+
+    /*!
+     * \brief Returns \c true if this object does not contain any data.
+     */
+    bool isNull() const;
+
+    /*!
+     * \brief Returns the type of the statistics.
+     */
+    Type type() const;
+
+    /*!
+     * \brief Returns the begin of the requested time range in UTC.
+     */
+    QDateTime from() const;
+
+    /*!
+     * \brief Returns the end of the requested time range in UTC.
+     */
+    QDateTime to() const;
+
+    /*!
+     * \brief Returns the IP addresses and subnets contained in the statistics.
+     */
+    QStringList ips() const;
+
+    /*!
+     * \brief Returns the number of IP addresses and subnets.
+     */
+    int ipCount() const;
+
+    /*!
+     * \brief Returns the index of \a ip or \c -1 if it is not part of the statistics.
+     */
+    int indexOf(const QString &ip) const;
+
+    /*!
+     * \brief Returns the total number of rows of all IPs.
+     */
+    int rowCount() const;
+
+    /*!
+     * \brief Returns the first row of the IP at \a ipIndex.
+     */
+    int rowBegin(int ipIndex) const;
+
+    /*!
+     * \brief Returns the row after the last row of the IP at \a ipIndex.
+     */
+    int rowEnd(int ipIndex) const;
+
+    /*!
+     * \brief Returns the timestamps of all rows in milliseconds since the epoch.
+     *
+     * The timestamp marks the begin of the period the values belong to.
+     */
+    QVector<qint64> timestamps() const;
+
+    /*!
+     * \brief Returns all values of \a column.
+     */
+    QVector<double> values(Column column) const;
+
+    /*!
+     * \brief Returns the sum of \a column over all rows of the IP at \a ipIndex.
+     *
+     * If \a ipIndex is \c -1, the sum over all IPs will be returned.
+     */
+    double sum(Column column, int ipIndex = -1) const;
+
+    /*!
+     * \brief Returns the highest value of \a column in the rows of the IP at \a ipIndex.
+     *
+     * If \a ipIndex is \c -1, the peak over all IPs will be returned. Returns \c 0 if there
+     * are no rows.
+     */
+    double peak(Column column, int ipIndex = -1) const;
+
+    /*!
+     * \brief Returns the \a percent percentile of \a column in the rows of the IP at \a ipIndex.
+     *
+     * \a percent has to be between \c 0 and \c 100. Values between the closest ranks are
+     * linearly interpolated. If \a ipIndex is \c -1, all rows will be used. Returns \c 0 if
+     * there are no rows.
+     */
+    double percentile(Column column, double percent, int ipIndex = -1) const;
+
+    /*!
+     * \brief Returns the sum of \a column for every IP, in the same order as ips().
+     */
+    QVector<double> sums(Column column) const;
+
+    /*!
+     * \brief Returns the sum of \a column rolled up per subnet.
+     *
+     * Every IP is masked with \a ipv4Prefix or \a ipv6Prefix and the sums of all IPs in the
+     * same network are added up. The keys of the returned hash are the networks in CIDR
+     * notation, like \c 192.0.2.0/24. Entries that are subnets with a longer prefix are
+     * rolled up into their enclosing network, entries that can not be parsed are skipped.
+     */
+    QHash<QString, double> subnetSums(Column column, int ipv4Prefix = 24, int ipv6Prefix = 64) const;
+
+    /*!
+     * \brief Creates a new %TrafficData object from the raw JSON \a data returned by the API.
+     *
+     * The data is scanned directly into the columns without creating a QJsonDocument.
+     * \a data can either be the traffic object itself or an object containing it in the
+     * \c traffic key, as returned by the API. If the data can not be parsed, a null object
+     * will be returned and \a errorString will be set, if it is not a \c nullptr.
+     */
+    static TrafficData fromJson(const QByteArray &data, QString *errorString = nullptr);
+
+private:
+    QSharedDataPointer<TrafficDataData> d;
+};
+
+}
+
+Q_DECLARE_SHARED(QHR::TrafficData)
+Q_DECLARE_METATYPE(QHR::TrafficData)
+
+#endif // QHR_TRAFFICDATA_H
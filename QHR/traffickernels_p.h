@@ -0,0 +1,130 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_TRAFFICKERNELS_P_H
+#define QHR_TRAFFICKERNELS_P_H
+
+#include <QtGlobal>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QHR_TRAFFIC_SSE2
+#endif
+
+namespace QHR {
+
+/*
+ * Aggregation kernels working on the columns of TrafficData.
+ *
+ * SSE2 is part of every x86_64 baseline, so the explicit path is used there
+ * without any runtime dispatching. The scalar fallback uses four independent
+ * accumulators, what breaks the dependency chain and lets the compiler
+ * vectorize it on other architectures without relaxing the floating point model.
+ */
+namespace TrafficKernels {
+
+inline double sum(const double *values, int count)
+{
+    int i = 0;
+#ifdef QHR_TRAFFIC_SSE2
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    for (; i + 4 <= count; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_loadu_pd(values + i));
+        acc1 = _mm_add_pd(acc1, _mm_loadu_pd(values + i + 2));
+    }
+    acc0 = _mm_add_pd(acc0, acc1);
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc0);
+    double result = lanes[0] + lanes[1];
+#else
+    double acc[4] = {0.0, 0.0, 0.0, 0.0};
+    for (; i + 4 <= count; i += 4) {
+        acc[0] += values[i];
+        acc[1] += values[i + 1];
+        acc[2] += values[i + 2];
+        acc[3] += values[i + 3];
+    }
+    double result = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+    for (; i < count; ++i) {
+        result += values[i];
+    }
+    return result;
+}
+
+inline double peak(const double *values, int count)
+{
+    if (count <= 0) {
+        return 0.0;
+    }
+
+    int i = 0;
+    double result = -std::numeric_limits<double>::infinity();
+#ifdef QHR_TRAFFIC_SSE2
+    __m128d max0 = _mm_set1_pd(result);
+    __m128d max1 = max0;
+    for (; i + 4 <= count; i += 4) {
+        max0 = _mm_max_pd(max0, _mm_loadu_pd(values + i));
+        max1 = _mm_max_pd(max1, _mm_loadu_pd(values + i + 2));
+    }
+    max0 = _mm_max_pd(max0, max1);
+    double lanes[2];
+    _mm_storeu_pd(lanes, max0);
+    result = std::max(lanes[0], lanes[1]);
+#else
+    double max[4] = {result, result, result, result};
+    for (; i + 4 <= count; i += 4) {
+        max[0] = std::max(max[0], values[i]);
+        max[1] = std::max(max[1], values[i + 1]);
+        max[2] = std::max(max[2], values[i + 2]);
+        max[3] = std::max(max[3], values[i + 3]);
+    }
+    result = std::max(std::max(max[0], max[1]), std::max(max[2], max[3]));
+#endif
+    for (; i < count; ++i) {
+        result = std::max(result, values[i]);
+    }
+    return result;
+}
+
+// offsets has segments + 1 entries, segment n covers [offsets[n], offsets[n + 1])
+inline void segmentSums(const double *values, const int *offsets, int segments, double *out)
+{
+    for (int s = 0; s < segments; ++s) {
+        out[s] = sum(values + offsets[s], offsets[s + 1] - offsets[s]);
+    }
+}
+
+// partially reorders values
+inline double percentile(double *values, int count, double percent)
+{
+    if (count <= 0) {
+        return 0.0;
+    }
+
+    const double rank = qBound(0.0, percent, 100.0) / 100.0 * (count - 1);
+    const int lower = static_cast<int>(std::floor(rank));
+    const double fraction = rank - lower;
+
+    std::nth_element(values, values + lower, values + count);
+    const double lowerValue = values[lower];
+    if (fraction == 0.0 || lower + 1 >= count) {
+        return lowerValue;
+    }
+
+    // after nth_element, the next rank is the smallest value of the upper partition
+    const double upperValue = *std::min_element(values + lower + 1, values + count);
+    return lowerValue + fraction * (upperValue - lowerValue);
+}
+
+}
+
+}
+
+#endif // QHR_TRAFFICKERNELS_P_H
@@ -0,0 +1,304 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "addressindex.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QJsonArray>
+#include <QJsonObject>
+
+/*
+ * Checks the address parser and the longest-prefix match of AddressIndex.
+ */
+
+class TestAddressIndex : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void parse_data();
+    void parse();
+    void rejectMalformed_data();
+    void rejectMalformed();
+    void emptyIndex();
+    void longestPrefixMatch_data();
+    void longestPrefixMatch();
+    void ipOverridesSubnet();
+    void separateTries();
+    void skipInvalidEntries();
+    void rebuildGeneration();
+
+private:
+    static QJsonObject ip(const QString &address, int serverNumber);
+    static QJsonObject subnet(const QString &address, int mask, int serverNumber, bool failover = false);
+    static void buildIndex(QHR::AddressIndex *index);
+};
+
+QJsonObject TestAddressIndex::ip(const QString &address, int serverNumber)
+{
+    return QJsonObject{{QStringLiteral("ip"), QJsonObject{
+        {QStringLiteral("ip"), address},
+        {QStringLiteral("server_number"), serverNumber}
+    }}};
+}
+
+QJsonObject TestAddressIndex::subnet(const QString &address, int mask, int serverNumber, bool failover)
+{
+    return QJsonObject{{QStringLiteral("subnet"), QJsonObject{
+        {QStringLiteral("ip"), address},
+        {QStringLiteral("mask"), mask},
+        {QStringLiteral("server_number"), serverNumber},
+        {QStringLiteral("failover"), failover}
+    }}};
+}
+
+void TestAddressIndex::buildIndex(QHR::AddressIndex *index)
+{
+    const QJsonArray ips{
+        ip(QStringLiteral("10.1.2.3"), 3),
+        ip(QStringLiteral("2a01:4f8:a::2"), 7)
+    };
+    const QJsonArray subnets{
+        subnet(QStringLiteral("10.0.0.0"), 8, 1),
+        subnet(QStringLiteral("10.1.0.0"), 16, 2),
+        subnet(QStringLiteral("10.1.2.0"), 29, 4, true),
+        subnet(QStringLiteral("2a01:4f8::"), 29, 5),
+        subnet(QStringLiteral("2a01:4f8:a::"), 64, 6, true)
+    };
+    index->rebuild(ips, subnets);
+}
+
+void TestAddressIndex::parse_data()
+{
+    QTest::addColumn<QString>("address");
+    QTest::addColumn<bool>("ipv6");
+    QTest::addColumn<quint64>("hi");
+    QTest::addColumn<quint64>("lo");
+
+    QTest::newRow("ipv4-zero") << QStringLiteral("0.0.0.0") << false << Q_UINT64_C(0) << Q_UINT64_C(0);
+    QTest::newRow("ipv4") << QStringLiteral("192.0.2.1") << false << Q_UINT64_C(0xc000020100000000) << Q_UINT64_C(0);
+    QTest::newRow("ipv4-broadcast") << QStringLiteral("255.255.255.255") << false << Q_UINT64_C(0xffffffff00000000) << Q_UINT64_C(0);
+    QTest::newRow("ipv6-unspecified") << QStringLiteral("::") << true << Q_UINT64_C(0) << Q_UINT64_C(0);
+    QTest::newRow("ipv6-loopback") << QStringLiteral("::1") << true << Q_UINT64_C(0) << Q_UINT64_C(1);
+    QTest::newRow("ipv6-trailing-compression") << QStringLiteral("2001:db8::") << true << Q_UINT64_C(0x20010db800000000) << Q_UINT64_C(0);
+    QTest::newRow("ipv6-middle-compression") << QStringLiteral("2001:db8::8:800:200c:417a") << true << Q_UINT64_C(0x20010db800000000) << Q_UINT64_C(0x00080800200c417a);
+    QTest::newRow("ipv6-full-uppercase") << QStringLiteral("2001:DB8:0:0:0:0:0:1") << true << Q_UINT64_C(0x20010db800000000) << Q_UINT64_C(1);
+    QTest::newRow("ipv6-no-compression") << QStringLiteral("1:2:3:4:5:6:7:8") << true << Q_UINT64_C(0x0001000200030004) << Q_UINT64_C(0x0005000600070008);
+    QTest::newRow("ipv6-leading-zeros") << QStringLiteral("0001:0db8::0001") << true << Q_UINT64_C(0x00010db800000000) << Q_UINT64_C(1);
+    QTest::newRow("embedded-ipv4") << QStringLiteral("64:ff9b::192.0.2.1") << true << Q_UINT64_C(0x0064ff9b00000000) << Q_UINT64_C(0x00000000c0000201);
+    QTest::newRow("ipv4-compatible") << QStringLiteral("::192.0.2.1") << true << Q_UINT64_C(0) << Q_UINT64_C(0x00000000c0000201);
+    QTest::newRow("ipv4-mapped") << QStringLiteral("::ffff:192.0.2.1") << false << Q_UINT64_C(0xc000020100000000) << Q_UINT64_C(0);
+    QTest::newRow("ipv4-mapped-hex") << QStringLiteral("::ffff:c000:201") << false << Q_UINT64_C(0xc000020100000000) << Q_UINT64_C(0);
+    QTest::newRow("ipv4-mapped-full") << QStringLiteral("0:0:0:0:0:ffff:192.0.2.1") << false << Q_UINT64_C(0xc000020100000000) << Q_UINT64_C(0);
+}
+
+void TestAddressIndex::parse()
+{
+    QFETCH(QString, address);
+    QFETCH(bool, ipv6);
+    QFETCH(quint64, hi);
+    QFETCH(quint64, lo);
+
+    QHR::AddressIndex::Address parsed;
+    QVERIFY(QHR::AddressIndex::parse(address, &parsed));
+    QCOMPARE(parsed.ipv6, ipv6);
+    QCOMPARE(parsed.hi, hi);
+    QCOMPARE(parsed.lo, lo);
+
+    // the Latin-1 overload has to give the same result
+    const QByteArray latin1 = address.toLatin1();
+    QHR::AddressIndex::Address parsedLatin1;
+    QVERIFY(QHR::AddressIndex::parse(QLatin1String(latin1), &parsedLatin1));
+    QCOMPARE(parsedLatin1.ipv6, ipv6);
+    QCOMPARE(parsedLatin1.hi, hi);
+    QCOMPARE(parsedLatin1.lo, lo);
+}
+
+void TestAddressIndex::rejectMalformed_data()
+{
+    QTest::addColumn<QString>("address");
+
+    QTest::newRow("empty") << QString();
+    QTest::newRow("text") << QStringLiteral("not an address");
+    QTest::newRow("ipv4-three-parts") << QStringLiteral("192.0.2");
+    QTest::newRow("ipv4-five-parts") << QStringLiteral("192.0.2.1.5");
+    QTest::newRow("ipv4-empty-part") << QStringLiteral("192..2.1");
+    QTest::newRow("ipv4-out-of-range") << QStringLiteral("256.0.2.1");
+    QTest::newRow("ipv4-four-digits") << QStringLiteral("0192.0.2.1");
+    QTest::newRow("ipv4-trailing-dot") << QStringLiteral("192.0.2.1.");
+    QTest::newRow("ipv4-trailing-space") << QStringLiteral("192.0.2.1 ");
+    QTest::newRow("ipv4-cidr") << QStringLiteral("192.0.2.0/24");
+    QTest::newRow("ipv6-triple-colon") << QStringLiteral(":::");
+    QTest::newRow("ipv6-two-compressions") << QStringLiteral("1::2::3");
+    QTest::newRow("ipv6-nine-groups") << QStringLiteral("1:2:3:4:5:6:7:8:9");
+    QTest::newRow("ipv6-seven-groups") << QStringLiteral("1:2:3:4:5:6:7");
+    QTest::newRow("ipv6-compression-of-nothing") << QStringLiteral("1:2:3:4:5:6:7::8");
+    QTest::newRow("ipv6-five-digits") << QStringLiteral("12345::");
+    QTest::newRow("ipv6-invalid-digit") << QStringLiteral("::g");
+    QTest::newRow("ipv6-leading-colon") << QStringLiteral(":1::");
+    QTest::newRow("ipv6-trailing-colon") << QStringLiteral("1::2:");
+    QTest::newRow("ipv6-scoped") << QStringLiteral("fe80::1%eth0");
+    QTest::newRow("embedded-ipv4-not-last") << QStringLiteral("::1.2.3.4:1");
+    QTest::newRow("embedded-ipv4-too-late") << QStringLiteral("1:2:3:4:5:6:7:1.2.3.4");
+    QTest::newRow("embedded-ipv4-invalid") << QStringLiteral("::ffff:1.2.3");
+    QTest::newRow("ipv4-before-compression") << QStringLiteral("1.2.3.4::");
+}
+
+void TestAddressIndex::rejectMalformed()
+{
+    QFETCH(QString, address);
+
+    QHR::AddressIndex::Address parsed;
+    QVERIFY(!QHR::AddressIndex::parse(address, &parsed));
+
+    QHR::AddressIndex index;
+    buildIndex(&index);
+    QVERIFY(!index.lookup(address).isValid());
+}
+
+void TestAddressIndex::emptyIndex()
+{
+    QHR::AddressIndex index;
+    QCOMPARE(index.size(), 0);
+    QCOMPARE(index.generation(), Q_UINT64_C(0));
+    QVERIFY(!index.lookup(QStringLiteral("10.1.2.3")).isValid());
+    QCOMPARE(index.lookup(QStringLiteral("10.1.2.3")).prefixLength, -1);
+
+    const QHR::AddressIndex::Snapshot snapshot;
+    QCOMPARE(snapshot.size(), 0);
+    QCOMPARE(snapshot.generation(), Q_UINT64_C(0));
+    QVERIFY(!snapshot.lookup(QStringLiteral("::1")).isValid());
+
+    // an empty rebuild is still a new generation
+    index.rebuild(QJsonArray(), QJsonArray());
+    QCOMPARE(index.size(), 0);
+    QCOMPARE(index.generation(), Q_UINT64_C(1));
+}
+
+void TestAddressIndex::longestPrefixMatch_data()
+{
+    QTest::addColumn<QString>("address");
+    QTest::addColumn<int>("serverNumber");
+    QTest::addColumn<int>("prefixLength");
+    QTest::addColumn<bool>("failover");
+
+    QTest::newRow("ipv4-single") << QStringLiteral("10.1.2.3") << 3 << 32 << false;
+    QTest::newRow("ipv4-29") << QStringLiteral("10.1.2.7") << 4 << 29 << true;
+    QTest::newRow("ipv4-16") << QStringLiteral("10.1.2.8") << 2 << 16 << false;
+    QTest::newRow("ipv4-8") << QStringLiteral("10.200.0.1") << 1 << 8 << false;
+    QTest::newRow("ipv4-outside") << QStringLiteral("11.0.0.1") << 0 << -1 << false;
+    QTest::newRow("ipv4-mapped-single") << QStringLiteral("::ffff:10.1.2.3") << 3 << 32 << false;
+    QTest::newRow("ipv4-mapped-8") << QStringLiteral("::ffff:a02:ff01") << 1 << 8 << false;
+    QTest::newRow("ipv6-single") << QStringLiteral("2a01:4f8:a::2") << 7 << 128 << false;
+    QTest::newRow("ipv6-64") << QStringLiteral("2a01:4f8:a:0:1:2:3:4") << 6 << 64 << true;
+    QTest::newRow("ipv6-29") << QStringLiteral("2a01:4f8:b::1") << 5 << 29 << false;
+    QTest::newRow("ipv6-29-upper-end") << QStringLiteral("2a01:4ff:ffff:ffff:ffff:ffff:ffff:ffff") << 5 << 29 << false;
+    QTest::newRow("ipv6-outside") << QStringLiteral("2a01:500::1") << 0 << -1 << false;
+    QTest::newRow("ipv6-unspecified") << QStringLiteral("::") << 0 << -1 << false;
+}
+
+void TestAddressIndex::longestPrefixMatch()
+{
+    QFETCH(QString, address);
+    QFETCH(int, serverNumber);
+    QFETCH(int, prefixLength);
+    QFETCH(bool, failover);
+
+    QHR::AddressIndex index;
+    buildIndex(&index);
+
+    const QHR::AddressMatch match = index.lookup(address);
+    QCOMPARE(match.isValid(), prefixLength >= 0);
+    QCOMPARE(match.serverNumber, serverNumber);
+    QCOMPARE(match.prefixLength, prefixLength);
+    QCOMPARE(match.failover, failover);
+
+    // all overloads and snapshots have to return the same match
+    const QByteArray latin1 = address.toLatin1();
+    QCOMPARE(index.lookup(QLatin1String(latin1)).serverNumber, serverNumber);
+    QHR::AddressIndex::Address parsed;
+    QVERIFY(QHR::AddressIndex::parse(address, &parsed));
+    QCOMPARE(index.lookup(parsed).prefixLength, prefixLength);
+    QCOMPARE(index.snapshot().lookup(address).serverNumber, serverNumber);
+}
+
+void TestAddressIndex::ipOverridesSubnet()
+{
+    QHR::AddressIndex index;
+    index.rebuild(QJsonArray{ip(QStringLiteral("10.1.2.3"), 3)},
+                  QJsonArray{subnet(QStringLiteral("10.1.2.3"), 32, 4), subnet(QStringLiteral("10.1.2.0"), 24, 5)});
+    QCOMPARE(index.size(), 3);
+
+    // single addresses replace subnets with the same prefix
+    const QHR::AddressMatch match = index.lookup(QStringLiteral("10.1.2.3"));
+    QCOMPARE(match.serverNumber, 3);
+    QCOMPARE(match.prefixLength, 32);
+    QCOMPARE(match.ip.ip(), QStringLiteral("10.1.2.3"));
+    QVERIFY(match.subnet.isNull());
+
+    const QHR::AddressMatch subnetMatch = index.lookup(QStringLiteral("10.1.2.4"));
+    QCOMPARE(subnetMatch.serverNumber, 5);
+    QCOMPARE(subnetMatch.subnet.mask(), 24);
+    QVERIFY(subnetMatch.ip.isNull());
+}
+
+void TestAddressIndex::separateTries()
+{
+    QHR::AddressIndex index;
+    index.rebuild(QJsonArray(), QJsonArray{subnet(QStringLiteral("0.0.0.0"), 0, 1), subnet(QStringLiteral("::"), 0, 2)});
+
+    // a default route of one family does not match the other one
+    QCOMPARE(index.lookup(QStringLiteral("192.0.2.1")).serverNumber, 1);
+    QCOMPARE(index.lookup(QStringLiteral("192.0.2.1")).prefixLength, 0);
+    QCOMPARE(index.lookup(QStringLiteral("::ffff:192.0.2.1")).serverNumber, 1);
+    QCOMPARE(index.lookup(QStringLiteral("::192.0.2.1")).serverNumber, 2);
+    QCOMPARE(index.lookup(QStringLiteral("2001:db8::1")).serverNumber, 2);
+
+    index.rebuild(QJsonArray(), QJsonArray{subnet(QStringLiteral("0.0.0.0"), 0, 1)});
+    QVERIFY(!index.lookup(QStringLiteral("::192.0.2.1")).isValid());
+    QVERIFY(!index.lookup(QStringLiteral("::")).isValid());
+}
+
+void TestAddressIndex::skipInvalidEntries()
+{
+    QHR::AddressIndex index;
+    index.rebuild(QJsonArray{ip(QStringLiteral("10.1.2.3"), 3), ip(QStringLiteral("10.1.2"), 8), ip(QString(), 9)},
+                  QJsonArray{subnet(QStringLiteral("10.0.0.0"), 8, 1), subnet(QStringLiteral("2a01::4f8::"), 64, 2)});
+    QCOMPARE(index.size(), 2);
+    QCOMPARE(index.lookup(QStringLiteral("10.1.2.3")).serverNumber, 3);
+    QCOMPARE(index.lookup(QStringLiteral("10.9.9.9")).serverNumber, 1);
+    QVERIFY(!index.lookup(QStringLiteral("2a01::1")).isValid());
+}
+
+void TestAddressIndex::rebuildGeneration()
+{
+    QHR::AddressIndex index;
+    buildIndex(&index);
+    QCOMPARE(index.size(), 7);
+    QCOMPARE(index.generation(), Q_UINT64_C(1));
+
+    const QHR::AddressIndex::Snapshot before = index.snapshot();
+    QCOMPARE(before.generation(), Q_UINT64_C(1));
+
+    index.rebuild(QJsonArray{ip(QStringLiteral("10.1.2.3"), 30)}, QJsonArray());
+    QCOMPARE(index.size(), 1);
+    QCOMPARE(index.generation(), Q_UINT64_C(2));
+    QCOMPARE(index.lookup(QStringLiteral("10.1.2.3")).serverNumber, 30);
+    QVERIFY(!index.lookup(QStringLiteral("10.1.2.4")).isValid());
+
+    // snapshots keep the state they have been taken from
+    QCOMPARE(before.size(), 7);
+    QCOMPARE(before.generation(), Q_UINT64_C(1));
+    QCOMPARE(before.lookup(QStringLiteral("10.1.2.3")).serverNumber, 3);
+    QCOMPARE(before.lookup(QStringLiteral("10.1.2.4")).serverNumber, 4);
+
+    const QHR::AddressIndex::Snapshot after = index.snapshot();
+    QCOMPARE(after.generation(), Q_UINT64_C(2));
+    QCOMPARE(after.size(), 1);
+}
+
+QTEST_MAIN(TestAddressIndex)
+
+#include "testaddressindex.moc"
@@ -0,0 +1,668 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "job.h"
+#include "job_p.h"
+#include "getserversjob.h"
+#include "server.h"
+#include "abstractconfiguration.h"
+#include "requestexecutor.h"
+#include "requestexecutor_p.h"
+#include "endpoints.h"
+#include "inventorysync.h"
+#include "trafficdata.h"
+#include "rdnsreconciler.h"
+#include "addressindex.h"
+#include "productcatalog.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/*
+ * Counting allocator hook
+ *
+ * Every allocation done while counting is enabled will be counted, regardless if it has
+ * been done by this executable, by libqhr or by Qt. With glibc we hook into malloc, that
+ * also covers operator new and the QArrayData based containers of Qt. On other platforms
+ * we can only count allocations done via operator new.
+ */
+
+static std::atomic<bool> allocCountingEnabled{false};
+static std::atomic<quint64> allocCount{0};
+
+static inline void countAllocation()
+{
+    if (allocCountingEnabled.load(std::memory_order_relaxed)) {
+        allocCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    countAllocation();
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (size > 0) {
+        countAllocation();
+    }
+    return __libc_realloc(ptr, size);
+}
+}
+#else
+void *operator new(std::size_t size)
+{
+    countAllocation();
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+#endif
+
+class AllocationCounter
+{
+public:
+    AllocationCounter()
+    {
+        allocCount.store(0, std::memory_order_relaxed);
+        allocCountingEnabled.store(true, std::memory_order_relaxed);
+    }
+
+    ~AllocationCounter()
+    {
+        allocCountingEnabled.store(false, std::memory_order_relaxed);
+    }
+
+    quint64 count() const
+    {
+        return allocCount.load(std::memory_order_relaxed);
+    }
+};
+
+/*
+ * Test helpers
+ */
+
+class BenchConfig : public QHR::AbstractConfiguration
+{
+    Q_OBJECT
+public:
+    explicit BenchConfig(QObject *parent = nullptr) : QHR::AbstractConfiguration(parent) {}
+
+    QString username() const override { return QStringLiteral("#ws+benchmark"); }
+    QString password() const override { return QStringLiteral("s3cr3t-p4ssw0rd"); }
+};
+
+class BenchJobPrivate : public QHR::JobPrivate
+{
+public:
+    explicit BenchJobPrivate(QHR::Job *q) : QHR::JobPrivate(q)
+    {
+        namOperation = QHR::NetworkOperation::Get;
+        expectedContentType = QHR::ExpectedContentType::JsonArray;
+    }
+
+    QString buildUrlPath() const override { return QStringLiteral("/server"); }
+};
+
+class BenchJob : public QHR::Job
+{
+    Q_OBJECT
+public:
+    explicit BenchJob(QObject *parent = nullptr) : QHR::Job(*new BenchJobPrivate(this), parent) {}
+
+    void start() override {}
+
+    QHR::JobPrivate *priv() const { return bd_ptr.get(); }
+
+    void setErrorCode(int code) { setError(code); }
+};
+
+static QByteArray serverPayload(int count)
+{
+    QJsonArray array;
+    for (int i = 0; i < count; ++i) {
+        const QString ip = QStringLiteral("123.123.%1.%2").arg(i / 250).arg(i % 250 + 1);
+        QJsonObject server{
+            {QStringLiteral("server_ip"), ip},
+            {QStringLiteral("server_ipv6_net"), QStringLiteral("2a01:f48:111:%1::").arg(i, 0, 16)},
+            {QStringLiteral("server_number"), 100000 + i},
+            {QStringLiteral("server_name"), QStringLiteral("server%1").arg(i)},
+            {QStringLiteral("product"), QStringLiteral("DS 3000")},
+            {QStringLiteral("dc"), QStringLiteral("NBG1-DC%1").arg(i % 8 + 1)},
+            {QStringLiteral("traffic"), QStringLiteral("5 TB")},
+            {QStringLiteral("status"), QStringLiteral("ready")},
+            {QStringLiteral("cancelled"), false},
+            {QStringLiteral("paid_until"), QStringLiteral("2020-12-31")},
+            {QStringLiteral("ip"), QJsonArray{ip}},
+            {QStringLiteral("subnet"), QJsonArray{QJsonObject{{QStringLiteral("ip"), QStringLiteral("2a01:4f8:111:4221::")}, {QStringLiteral("mask"), QStringLiteral("64")}}}}
+        };
+        array.append(QJsonObject{{QStringLiteral("server"), server}});
+    }
+    return QJsonDocument(array).toJson(QJsonDocument::Compact);
+}
+
+static QByteArray trafficPayload(int ips, int days)
+{
+    QJsonObject data;
+    for (int i = 0; i < ips; ++i) {
+        QJsonObject values;
+        for (int day = 1; day <= days; ++day) {
+            const double in = (i % 17 + day) * 0.125;
+            const double out = (i % 5 + day) * 0.5;
+            values.insert(QStringLiteral("%1").arg(day, 2, 10, QLatin1Char('0')), QJsonObject{
+                {QStringLiteral("in"), in},
+                {QStringLiteral("out"), out},
+                {QStringLiteral("sum"), in + out}
+            });
+        }
+        data.insert(QStringLiteral("123.123.%1.%2").arg(i / 250).arg(i % 250 + 1), values);
+    }
+    const QJsonObject traffic{
+        {QStringLiteral("type"), QStringLiteral("month")},
+        {QStringLiteral("from"), QStringLiteral("2020-01-01")},
+        {QStringLiteral("to"), QStringLiteral("2020-01-31")},
+        {QStringLiteral("data"), data}
+    };
+    return QJsonDocument(QJsonObject{{QStringLiteral("traffic"), traffic}}).toJson(QJsonDocument::Compact);
+}
+
+static QByteArray ipPayload(int count)
+{
+    QJsonArray array;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject ip{
+            {QStringLiteral("ip"), QStringLiteral("123.%1.%2.%3").arg(i / 62500).arg((i / 250) % 250).arg(i % 250 + 1)},
+            {QStringLiteral("server_ip"), QStringLiteral("123.123.123.123")},
+            {QStringLiteral("server_number"), 100000 + i / 4},
+            {QStringLiteral("locked"), false},
+            {QStringLiteral("separate_mac"), QJsonValue()},
+            {QStringLiteral("traffic_warnings"), false},
+            {QStringLiteral("traffic_hourly"), 50},
+            {QStringLiteral("traffic_daily"), 50},
+            {QStringLiteral("traffic_monthly"), 5}
+        };
+        array.append(QJsonObject{{QStringLiteral("ip"), ip}});
+    }
+    return QJsonDocument(array).toJson(QJsonDocument::Compact);
+}
+
+static QByteArray rdnsPayload(int count)
+{
+    QJsonArray array;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject rdns{
+            {QStringLiteral("ip"), QStringLiteral("123.%1.%2.%3").arg(i / 62500).arg((i / 250) % 250).arg(i % 250 + 1)},
+            {QStringLiteral("ptr"), QStringLiteral("host%1.example.com").arg(i)}
+        };
+        array.append(QJsonObject{{QStringLiteral("rdns"), rdns}});
+    }
+    return QJsonDocument(array).toJson(QJsonDocument::Compact);
+}
+
+static QByteArray marketPayload(int count)
+{
+    const QString cpus[] = {QStringLiteral("Intel Core i7-6700"), QStringLiteral("Intel Xeon E3-1275V6"), QStringLiteral("AMD Ryzen 7 3700X")};
+    const QString datacenters[] = {QStringLiteral("FSN1-DC8"), QStringLiteral("FSN1-DC14"), QStringLiteral("NBG1-DC3"), QStringLiteral("HEL1-DC2")};
+    QJsonArray array;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject product{
+            {QStringLiteral("id"), 1000000 + i},
+            {QStringLiteral("name"), QStringLiteral("SB%1").arg(30 + i % 120)},
+            {QStringLiteral("cpu"), cpus[i % 3]},
+            {QStringLiteral("cpu_benchmark"), 8000 + (i * 37) % 12000},
+            {QStringLiteral("memory_size"), 16 << (i % 4)},
+            {QStringLiteral("hdd_size"), 512 * (1 + i % 8)},
+            {QStringLiteral("hdd_count"), 1 + i % 4},
+            {QStringLiteral("datacenter"), datacenters[(i / 4) % 4]},
+            {QStringLiteral("price"), QString::number(30.0 + (i * 7) % 150, 'f', 2)},
+            {QStringLiteral("price_setup"), QStringLiteral("0.00")}
+        };
+        array.append(QJsonObject{{QStringLiteral("product"), product}});
+    }
+    return QJsonDocument(array).toJson(QJsonDocument::Compact);
+}
+
+/*
+ * Benchmarks
+ *
+ * Timings are recorded via QBENCHMARK and can be written in machine readable form
+ * with the QtTest output options (ctest writes benchjobpipeline.xml to the build directory).
+ * Because timings depend too much on the machine, only the allocation counts are compared
+ * against the baseline stored in baseline.json. The counts include the allocations done by
+ * Qt, so a baseline is only valid for the Qt version and platform it has been recorded on.
+ * Run the benchmark with the environment variable QHR_BENCH_WRITE_BASELINE set to record
+ * the baseline. As long as there is no baseline.json, the counts are only reported.
+ */
+
+class BenchJobPipeline : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void jobLifecycle();
+    void buildRequest();
+    void jobRequest();
+    void executorRequest();
+    void endpointRequest();
+    void checkOutput_data();
+    void checkOutput();
+    void parseServers();
+    void inventorySync();
+    void parseTraffic();
+    void aggregateTraffic();
+    void rdnsDiff();
+    void addressLookup();
+    void catalogQuery();
+    void errorString();
+
+private:
+    template<typename Func>
+    void measureAllocations(const QString &name, Func op);
+
+    BenchConfig m_config;
+    QJsonObject m_baseline;
+    QJsonObject m_results;
+    bool m_writeBaseline = false;
+    bool m_compareBaseline = false;
+};
+
+static constexpr int allocRuns = 20;
+static constexpr double allocTolerance = 0.1;
+
+template<typename Func>
+void BenchJobPipeline::measureAllocations(const QString &name, Func op)
+{
+    // warm up thread local and global state like the rate limiter
+    op();
+
+    quint64 count = 0;
+    {
+        AllocationCounter counter;
+        for (int i = 0; i < allocRuns; ++i) {
+            op();
+        }
+        count = counter.count();
+    }
+
+    const double perOp = static_cast<double>(count) / allocRuns;
+    m_results.insert(name, perOp);
+    qDebug("%s: %.1f allocations per operation", qUtf8Printable(name), perOp);
+
+    if (!m_compareBaseline) {
+        return;
+    }
+
+    const QJsonValue base = m_baseline.value(name);
+    QVERIFY2(base.isDouble(), qPrintable(QStringLiteral("No allocation baseline for %1, run with QHR_BENCH_WRITE_BASELINE to record it").arg(name)));
+    const double limit = base.toDouble() * (1.0 + allocTolerance) + 1.0;
+    QVERIFY2(perOp <= limit, qPrintable(QStringLiteral("%1 needs %2 allocations per operation, baseline is %3").arg(name).arg(perOp).arg(base.toDouble())));
+}
+
+void BenchJobPipeline::initTestCase()
+{
+    m_writeBaseline = qEnvironmentVariableIsSet("QHR_BENCH_WRITE_BASELINE");
+    if (m_writeBaseline) {
+        qWarning("Recording a new allocation baseline, results will not be compared.");
+        return;
+    }
+
+    QFile f(QStringLiteral(QHR_BENCH_BASELINE));
+    if (!f.exists()) {
+        qWarning("No allocation baseline recorded, results will not be compared.");
+        return;
+    }
+
+    QVERIFY2(f.open(QIODevice::ReadOnly), qPrintable(f.errorString()));
+    m_baseline = QJsonDocument::fromJson(f.readAll()).object();
+    QVERIFY2(!m_baseline.isEmpty(), "The allocation baseline is empty.");
+    m_compareBaseline = true;
+}
+
+void BenchJobPipeline::cleanupTestCase()
+{
+    const QByteArray json = QJsonDocument(m_results).toJson();
+
+    QFile result(QStringLiteral("benchjobpipeline-allocations.json"));
+    if (result.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+        result.write(json);
+    }
+
+    if (m_writeBaseline) {
+        QFile baseline(QStringLiteral(QHR_BENCH_BASELINE));
+        QVERIFY2(baseline.open(QIODevice::WriteOnly|QIODevice::Truncate), qPrintable(baseline.errorString()));
+        baseline.write(json);
+    }
+}
+
+void BenchJobPipeline::jobLifecycle()
+{
+    QBENCHMARK {
+        delete new QHR::GetServersJob;
+    }
+
+    measureAllocations(QStringLiteral("jobLifecycle"), [](){
+        delete new QHR::GetServersJob;
+    });
+}
+
+void BenchJobPipeline::buildRequest()
+{
+    BenchJob job;
+    job.setConfiguration(&m_config);
+    QHR::JobPrivate *d = job.priv();
+    d->configuration = &m_config;
+    d->requestUrl = QUrl(QStringLiteral("https://robot-ws.your-server.de/server"));
+
+    QBENCHMARK {
+        d->buildNetworkRequest();
+    }
+
+    measureAllocations(QStringLiteral("buildRequest"), [d](){
+        d->buildNetworkRequest();
+    });
+}
+
+void BenchJobPipeline::jobRequest()
+{
+    // client side cost of a single call through a job, compare with executorRequest
+    auto op = [this](){
+        BenchJob job;
+        job.setConfiguration(&m_config);
+        QHR::JobPrivate *d = job.priv();
+        d->configuration = &m_config;
+        d->requestUrl = QUrl(QStringLiteral("https://robot-ws.your-server.de/server"));
+        d->buildNetworkRequest();
+    };
+
+    QBENCHMARK {
+        op();
+    }
+
+    measureAllocations(QStringLiteral("jobRequest"), op);
+}
+
+void BenchJobPipeline::executorRequest()
+{
+    QHR::RequestExecutor executor(&m_config);
+    QHR::RequestExecutorPrivate *d = QHR::RequestExecutorPrivate::get(&executor);
+    const QHR::Request request(QHR::Request::Get, QStringLiteral("/server"), QUrlQuery(), QHR::Request::JsonArray);
+
+    auto op = [d, &request](){
+        d->releaseState(d->prepareState(QHR::Request(request), [](const QHR::Response &){}));
+    };
+
+    QBENCHMARK {
+        op();
+    }
+
+    QCOMPARE(executor.poolSize(), 1);
+
+    measureAllocations(QStringLiteral("executorRequest"), op);
+}
+
+void BenchJobPipeline::endpointRequest()
+{
+    // the behavior is tested by tests/endpoints
+    const QString ip = QStringLiteral("123.123.123.123");
+
+    auto op = [&ip](){
+        QHR::makeRequest<QHR::Endpoints::RdnsUpdate>(ip);
+    };
+
+    QBENCHMARK {
+        op();
+    }
+
+    measureAllocations(QStringLiteral("endpointRequest"), op);
+}
+
+void BenchJobPipeline::checkOutput_data()
+{
+    QTest::addColumn<QByteArray>("payload");
+
+    QTest::newRow("server-1000") << serverPayload(1000);
+    QTest::newRow("ip-5000") << ipPayload(5000);
+    QTest::newRow("rdns-5000") << rdnsPayload(5000);
+}
+
+void BenchJobPipeline::checkOutput()
+{
+    QFETCH(QByteArray, payload);
+
+    BenchJob job;
+    QHR::JobPrivate *d = job.priv();
+
+    QVERIFY(d->checkOutput(payload));
+
+    QBENCHMARK {
+        d->checkOutput(payload);
+    }
+
+    measureAllocations(QStringLiteral("checkOutput/") + QString::fromLatin1(QTest::currentDataTag()), [d, &payload](){
+        d->checkOutput(payload);
+    });
+}
+
+void BenchJobPipeline::parseServers()
+{
+    const QJsonArray array = QJsonDocument::fromJson(serverPayload(1000)).array();
+
+    QCOMPARE(QHR::Server::listFromJson(array).size(), 1000);
+
+    QBENCHMARK {
+        QHR::Server::listFromJson(array);
+    }
+
+    measureAllocations(QStringLiteral("parseServers"), [&array](){
+        QHR::Server::listFromJson(array);
+    });
+}
+
+void BenchJobPipeline::inventorySync()
+{
+    const QJsonArray array = QJsonDocument::fromJson(serverPayload(1000)).array();
+
+    QHR::InventorySync sync;
+    sync.update(array);
+
+    // measures an unchanged snapshot, the deltas are checked by tests/inventorysync
+    QBENCHMARK {
+        sync.update(array);
+    }
+
+    measureAllocations(QStringLiteral("inventorySync"), [&sync, &array](){
+        sync.update(array);
+    });
+}
+
+void BenchJobPipeline::parseTraffic()
+{
+    const QByteArray payload = trafficPayload(500, 31);
+
+    const QHR::TrafficData traffic = QHR::TrafficData::fromJson(payload);
+    QCOMPARE(traffic.type(), QHR::TrafficData::Month);
+    QCOMPARE(traffic.ipCount(), 500);
+    QCOMPARE(traffic.rowCount(), 500 * 31);
+    QCOMPARE(traffic.timestamps().at(30), QDateTime(QDate(2020, 1, 31), QTime(0, 0), Qt::UTC).toMSecsSinceEpoch());
+
+    QBENCHMARK {
+        QHR::TrafficData::fromJson(payload);
+    }
+
+    measureAllocations(QStringLiteral("parseTraffic"), [&payload](){
+        QHR::TrafficData::fromJson(payload);
+    });
+}
+
+void BenchJobPipeline::aggregateTraffic()
+{
+    const QHR::TrafficData traffic = QHR::TrafficData::fromJson(trafficPayload(500, 31));
+
+    // first IP: in = (day) * 0.125 for day 1..31
+    QCOMPARE(traffic.sum(QHR::TrafficData::In, 0), 496 * 0.125);
+    QCOMPARE(traffic.peak(QHR::TrafficData::Out, 0), 31 * 0.5);
+    QCOMPARE(traffic.percentile(QHR::TrafficData::In, 50, 0), 16 * 0.125);
+    QCOMPARE(traffic.sums(QHR::TrafficData::Sum).size(), 500);
+    QCOMPARE(traffic.subnetSums(QHR::TrafficData::Sum).size(), 2);
+
+    auto op = [&traffic](){
+        traffic.sum(QHR::TrafficData::Sum);
+        traffic.peak(QHR::TrafficData::Sum);
+        traffic.sums(QHR::TrafficData::Sum);
+    };
+
+    QBENCHMARK {
+        op();
+    }
+
+    measureAllocations(QStringLiteral("aggregateTraffic"), op);
+}
+
+void BenchJobPipeline::rdnsDiff()
+{
+    QHash<QString, QString> current;
+    const QJsonArray listing = QJsonDocument::fromJson(rdnsPayload(5000)).array();
+    for (const QJsonValue &v : listing) {
+        const QJsonObject rdns = v.toObject().value(QStringLiteral("rdns")).toObject();
+        current.insert(rdns.value(QStringLiteral("ip")).toString(), rdns.value(QStringLiteral("ptr")).toString());
+    }
+
+    // mostly the same state in different notation, the results are checked by tests/rdnsreconciler
+    QHash<QString, QString> desired;
+    for (auto it = current.cbegin(); it != current.cend(); ++it) {
+        desired.insert(it.key(), it.value().toUpper() + QLatin1Char('.'));
+    }
+    desired[QStringLiteral("123.0.0.1")] = QStringLiteral("changed.example.com");
+    desired[QStringLiteral("123.0.0.2")] = QString();
+    desired[QStringLiteral("10.0.0.1")] = QStringLiteral("new.example.com");
+
+    QBENCHMARK {
+        QHR::RdnsReconciler::diff(current, desired);
+    }
+
+    measureAllocations(QStringLiteral("rdnsDiff"), [&current, &desired](){
+        QHR::RdnsReconciler::diff(current, desired);
+    });
+}
+
+void BenchJobPipeline::addressLookup()
+{
+    const QJsonArray ips = QJsonDocument::fromJson(ipPayload(5000)).array();
+    QJsonArray subnets;
+    for (int i = 0; i < 1000; ++i) {
+        subnets.append(QJsonObject{{QStringLiteral("subnet"), QJsonObject{
+            {QStringLiteral("ip"), QStringLiteral("2a01:4f8:%1::").arg(i, 0, 16)},
+            {QStringLiteral("mask"), 64},
+            {QStringLiteral("server_number"), 200000 + i},
+            {QStringLiteral("failover"), i % 10 == 0}
+        }}});
+    }
+    subnets.append(QJsonObject{{QStringLiteral("subnet"), QJsonObject{
+        {QStringLiteral("ip"), QStringLiteral("123.0.0.0")},
+        {QStringLiteral("mask"), 8},
+        {QStringLiteral("server_number"), 1}
+    }}});
+
+    QHR::AddressIndex index;
+    // the lookups are checked by tests/addressindex
+    index.rebuild(ips, subnets);
+
+    const QHR::AddressIndex::Snapshot snapshot = index.snapshot();
+    const QString addresses[] = {
+        QStringLiteral("123.0.12.7"),
+        QStringLiteral("123.0.3.250"),
+        QStringLiteral("2a01:4f8:3e7::1"),
+        QStringLiteral("10.0.0.1")
+    };
+
+    auto op = [&snapshot, &addresses](){
+        for (const QString &address : addresses) {
+            snapshot.lookup(address);
+        }
+    };
+
+    QBENCHMARK {
+        op();
+    }
+
+    measureAllocations(QStringLiteral("addressLookup"), op);
+}
+
+void BenchJobPipeline::catalogQuery()
+{
+    const QJsonArray products = QJsonDocument::fromJson(marketPayload(5000)).array();
+    // the catalog and its queries are checked by tests/productcatalog
+    const QHR::ProductCatalog catalog = QHR::ProductCatalog::fromJson(products, QHR::ProductCatalog::ServerMarket);
+
+    QHR::ProductQuery query;
+    query.range(QHR::ProductCatalog::MemorySize, 64)
+         .range(QHR::ProductCatalog::Price, 0, 100)
+         .equals(QHR::ProductCatalog::Location, QStringLiteral("FSN1"))
+         .setLimit(10);
+
+    QBENCHMARK {
+        catalog.query(query);
+    }
+
+    measureAllocations(QStringLiteral("catalogQuery"), [&catalog, &query](){
+        catalog.query(query);
+    });
+}
+
+void BenchJobPipeline::errorString()
+{
+    BenchJob job;
+    const int first = QHR::MissingConfig;
+    const int last = QHR::ApiError;
+
+    auto op = [&job, first, last](){
+        for (int code = first; code <= last; ++code) {
+            job.setErrorCode(code);
+            job.errorString();
+        }
+    };
+
+    QBENCHMARK {
+        op();
+    }
+
+    measureAllocations(QStringLiteral("errorString"), op);
+}
+
+QTEST_GUILESS_MAIN(BenchJobPipeline)
+
+#include "benchjobpipeline.moc"
@@ -0,0 +1,367 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "client_p.h"
+#include "abstractconfiguration.h"
+#include "endpoints.h"
+#include "getserversjob.h"
+#include "retrypolicy.h"
+#include "job_p.h"
+#include "mockrobotserver.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QElapsedTimer>
+#include <QNetworkAccessManager>
+#include <QUrl>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Checks the lock-free request queue of Client and submitting jobs from other threads,
+ * failed jobs reported as JobError and the shutdown of the network thread while jobs
+ * are running against the local MockRobotServer.
+ */
+
+class TestConfig : public QHR::AbstractConfiguration
+{
+    Q_OBJECT
+public:
+    explicit TestConfig(const QUrl &baseUrl, QObject *parent = nullptr) : QHR::AbstractConfiguration(parent), m_baseUrl(baseUrl) {}
+
+    QString username() const override { return QStringLiteral("#ws+mock"); }
+    QString password() const override { return QStringLiteral("mock"); }
+    QUrl baseUrl() const override { return m_baseUrl; }
+
+private:
+    QUrl m_baseUrl;
+};
+
+class TestClient : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+
+    void queueOrder();
+    void queueConcurrentProducers();
+
+    void submit();
+    void submitTyped();
+    void callFromWorkerThreads();
+    void jobFailed();
+    void factoryWithoutJob();
+    void shutdownKillsRunningJobs();
+    void shutdownFailsPendingRequests();
+
+    void pooledManagerOfAdoptedThread();
+    void pooledManagerOfNetworkThread();
+
+private:
+    static QHR::Client::JobFactory serverGet(int serverNumber);
+    static int errorCode(const QFuture<QJsonDocument> &future);
+
+    QHR::MockRobotServer m_server;
+    TestConfig *m_config = nullptr;
+};
+
+void TestClient::initTestCase()
+{
+    QHR::setDefaultRetryPolicy(QHR::RetryPolicy());
+    QVERIFY(m_server.start());
+    m_config = new TestConfig(m_server.baseUrl(), this);
+}
+
+void TestClient::init()
+{
+    m_server.setServerCount(10);
+    m_server.setLatency(0);
+    m_server.setFailingEndpoints(QStringList());
+}
+
+QHR::Client::JobFactory TestClient::serverGet(int serverNumber)
+{
+    return [serverNumber]() -> QHR::Job* {
+        return QHR::makeJob<QHR::Endpoints::ServerGet>(nullptr, serverNumber);
+    };
+}
+
+int TestClient::errorCode(const QFuture<QJsonDocument> &future)
+{
+    try {
+        future.result();
+    } catch (const QHR::JobError &e) {
+        return e.code();
+    }
+    return QHR::BJob::NoError;
+}
+
+void TestClient::queueOrder()
+{
+    QHR::ClientRequestQueue queue;
+    QVERIFY(!queue.pop());
+
+    QHR::ClientRequest requests[3];
+    for (QHR::ClientRequest &request : requests) {
+        queue.push(&request);
+    }
+
+    for (QHR::ClientRequest &request : requests) {
+        QCOMPARE(queue.pop(), &request);
+    }
+    QVERIFY(!queue.pop());
+
+    // the queue is usable again after it has been drained
+    queue.push(&requests[1]);
+    QCOMPARE(queue.pop(), &requests[1]);
+    QVERIFY(!queue.pop());
+}
+
+void TestClient::queueConcurrentProducers()
+{
+    const int producers = 4;
+    const int perProducer = 20000;
+
+    std::vector<std::unique_ptr<QHR::ClientRequest[]>> requests;
+    std::unordered_map<const QHR::ClientRequest*, std::pair<int,int>> origin;
+    for (int p = 0; p < producers; ++p) {
+        requests.emplace_back(new QHR::ClientRequest[perProducer]);
+        for (int i = 0; i < perProducer; ++i) {
+            origin.emplace(&requests[p][i], std::make_pair(p, i));
+        }
+    }
+
+    QHR::ClientRequestQueue queue;
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, &requests, p](){
+            for (int i = 0; i < perProducer; ++i) {
+                queue.push(&requests[p][i]);
+            }
+        });
+    }
+
+    // pop concurrently with the producers, the requests of every producer have to arrive in order
+    std::vector<int> next(producers, 0);
+    int received = 0;
+    bool ordered = true;
+    bool known = true;
+    while (received < producers * perProducer && known) {
+        QHR::ClientRequest *request = queue.pop();
+        if (!request) {
+            std::this_thread::yield();
+            continue;
+        }
+        const auto it = origin.find(request);
+        if (it == origin.end()) {
+            known = false;
+            continue;
+        }
+        ordered = ordered && next[it->second.first] == it->second.second;
+        ++next[it->second.first];
+        ++received;
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    QVERIFY(known);
+    QVERIFY(ordered);
+    QVERIFY(!queue.pop());
+    for (int p = 0; p < producers; ++p) {
+        QCOMPARE(next[p], perProducer);
+    }
+}
+
+void TestClient::submit()
+{
+    QHR::Client client;
+    client.setConfiguration(m_config);
+    QCOMPARE(client.configuration(), m_config);
+
+    QFuture<QJsonDocument> future = client.submit(serverGet(100003));
+    QTRY_VERIFY_WITH_TIMEOUT(future.isFinished(), 5000);
+    QCOMPARE(errorCode(future), static_cast<int>(QHR::BJob::NoError));
+    QVERIFY(future.result().isObject());
+}
+
+void TestClient::submitTyped()
+{
+    QHR::Client client;
+    client.setConfiguration(m_config);
+
+    QFuture<QHR::ServerList> future = client.submit([](){ return new QHR::GetServersJob; }, &QHR::GetServersJob::servers);
+    QTRY_VERIFY_WITH_TIMEOUT(future.isFinished(), 5000);
+    QCOMPARE(future.result().size(), 10);
+}
+
+void TestClient::callFromWorkerThreads()
+{
+    QHR::Client client;
+    client.setConfiguration(m_config);
+
+    // the mock server runs in this thread, so wait for the blocking calls with a running event loop
+    std::atomic<int> finished{0};
+    std::atomic<int> failed{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&client, &finished, &failed, t](){
+            for (int i = 0; i < 5; ++i) {
+                QHR::JobError error;
+                const QJsonDocument result = client.call(serverGet(100000 + t), &error);
+                if (result.isNull() || error.code() != QHR::BJob::NoError) {
+                    ++failed;
+                }
+                ++finished;
+            }
+        });
+    }
+
+    QTRY_COMPARE_WITH_TIMEOUT(finished.load(), 20, 10000);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    QCOMPARE(failed.load(), 0);
+}
+
+void TestClient::jobFailed()
+{
+    QHR::Client client;
+    client.setConfiguration(m_config);
+
+    QFuture<QJsonDocument> future = client.submit(serverGet(999999));
+    QTRY_VERIFY_WITH_TIMEOUT(future.isFinished(), 5000);
+    QVERIFY_EXCEPTION_THROWN(future.result(), QHR::JobError);
+
+    try {
+        future.result();
+    } catch (const QHR::JobError &e) {
+        QCOMPARE(e.code(), static_cast<int>(QHR::NotFound));
+        QCOMPARE(e.apiErrorCode(), QStringLiteral("SERVER_NOT_FOUND"));
+        QVERIFY(!e.errorString().isEmpty());
+        QCOMPARE(QByteArray(e.what()), e.errorString().toUtf8());
+    }
+
+    // typed futures report errors the same way, call() returns a default constructed value
+    m_server.setFailingEndpoints({QStringLiteral("GET /server")});
+    QFuture<QHR::ServerList> typed = client.submit([](){ return new QHR::GetServersJob; }, &QHR::GetServersJob::servers);
+    QTRY_VERIFY_WITH_TIMEOUT(typed.isFinished(), 5000);
+    QVERIFY_EXCEPTION_THROWN(typed.result(), QHR::JobError);
+
+    std::atomic<bool> finished{false};
+    QHR::ServerList servers;
+    QHR::JobError error;
+    std::thread thread([&](){
+        servers = client.call([](){ return new QHR::GetServersJob; }, &QHR::GetServersJob::servers, &error);
+        finished = true;
+    });
+    QTRY_VERIFY_WITH_TIMEOUT(finished.load(), 5000);
+    thread.join();
+    QVERIFY(servers.empty());
+    QCOMPARE(error.code(), static_cast<int>(QHR::InternalServerError));
+    QCOMPARE(error.apiErrorCode(), QStringLiteral("INTERNAL_ERROR"));
+}
+
+void TestClient::factoryWithoutJob()
+{
+    QHR::Client client;
+    client.setConfiguration(m_config);
+
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression(QStringLiteral("returned no job")));
+    QFuture<QJsonDocument> future = client.submit([]() -> QHR::Job* { return nullptr; });
+    QTRY_VERIFY_WITH_TIMEOUT(future.isFinished(), 5000);
+    QCOMPARE(errorCode(future), static_cast<int>(QHR::BJob::UserDefinedError));
+
+    // the client keeps working
+    QFuture<QJsonDocument> next = client.submit(serverGet(100000));
+    QTRY_VERIFY_WITH_TIMEOUT(next.isFinished(), 5000);
+    QCOMPARE(errorCode(next), static_cast<int>(QHR::BJob::NoError));
+}
+
+void TestClient::shutdownKillsRunningJobs()
+{
+    m_server.setLatency(3000);
+
+    std::unique_ptr<QHR::Client> client(new QHR::Client);
+    client->setConfiguration(m_config);
+
+    const quint64 requestsBefore = m_server.requestCount();
+    QFuture<QJsonDocument> future = client->submit(serverGet(100000));
+    QTRY_COMPARE_WITH_TIMEOUT(m_server.requestCount(), requestsBefore + 1, 5000);
+    QVERIFY(!future.isFinished());
+
+    // the running job is killed instead of waited for
+    QElapsedTimer timer;
+    timer.start();
+    client.reset();
+    QVERIFY(timer.elapsed() < 3000);
+
+    QVERIFY(future.isFinished());
+    QCOMPARE(errorCode(future), static_cast<int>(QHR::BJob::KilledJobError));
+}
+
+void TestClient::shutdownFailsPendingRequests()
+{
+    m_server.setLatency(1000);
+
+    std::unique_ptr<QHR::Client> client(new QHR::Client);
+    client->setConfiguration(m_config);
+
+    QVector<QFuture<QJsonDocument>> futures;
+    for (int i = 0; i < 50; ++i) {
+        futures << client->submit(serverGet(100000 + i % 10));
+    }
+    client.reset();
+
+    // queued and running requests are failed, no future is left unfinished
+    for (const QFuture<QJsonDocument> &future : futures) {
+        QVERIFY(future.isFinished());
+        QCOMPARE(errorCode(future), static_cast<int>(QHR::BJob::KilledJobError));
+    }
+}
+
+void TestClient::pooledManagerOfAdoptedThread()
+{
+    // native threads never run an event loop, the manager has to be deleted on thread exit anyway
+    std::atomic<bool> destroyed{false};
+    bool sameManager = false;
+    std::thread thread([&destroyed, &sameManager](){
+        QNetworkAccessManager *nam = QHR::JobPrivate::pooledNetworkAccessManager();
+        QObject::connect(nam, &QObject::destroyed, [&destroyed](){ destroyed = true; });
+        sameManager = QHR::JobPrivate::pooledNetworkAccessManager() == nam;
+    });
+    thread.join();
+
+    QVERIFY(sameManager);
+    QVERIFY(destroyed.load());
+}
+
+void TestClient::pooledManagerOfNetworkThread()
+{
+    std::atomic<bool> destroyed{false};
+
+    std::unique_ptr<QHR::Client> client(new QHR::Client);
+    client->setConfiguration(m_config);
+
+    QFuture<QJsonDocument> future = client->submit([&destroyed]() -> QHR::Job* {
+        QNetworkAccessManager *nam = QHR::JobPrivate::pooledNetworkAccessManager();
+        QObject::connect(nam, &QObject::destroyed, [&destroyed](){ destroyed = true; });
+        return QHR::makeJob<QHR::Endpoints::ServerGet>(nullptr, 100000);
+    });
+    QTRY_VERIFY_WITH_TIMEOUT(future.isFinished(), 5000);
+    QVERIFY(!destroyed.load());
+
+    client.reset();
+    QVERIFY(destroyed.load());
+}
+
+QTEST_MAIN(TestClient)
+
+#include "testclient.moc"
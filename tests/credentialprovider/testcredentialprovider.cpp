@@ -0,0 +1,317 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "abstractcredentialprovider.h"
+#include "abstractconfiguration.h"
+#include "endpoints.h"
+#include "retrypolicy.h"
+#include "job.h"
+#include "mockrobotserver.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QTimer>
+#include <QUrl>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/*
+ * Checks fetching and caching of AbstractCredentialProvider and jobs waiting for the
+ * credentials while sending requests to the local MockRobotServer.
+ */
+
+class TestCredentialProvider : public QHR::AbstractCredentialProvider
+{
+    Q_OBJECT
+public:
+    enum Mode : quint8 {
+        Immediate,
+        Delayed,
+        Failing
+    };
+
+    explicit TestCredentialProvider(Mode mode, QObject *parent = nullptr) : QHR::AbstractCredentialProvider(parent), m_mode(mode) {}
+
+    void setPassword(const QString &password) { m_password = password; }
+    int fetches() const { return m_fetches.load(); }
+    int maxConcurrentFetches() const { return m_maxConcurrent.load(); }
+
+protected:
+    void fetchCredentials() override
+    {
+        ++m_fetches;
+        const int running = ++m_running;
+        int max = m_maxConcurrent.load();
+        while (running > max && !m_maxConcurrent.compare_exchange_weak(max, running)) {}
+        --m_running;
+
+        switch (m_mode) {
+        case Immediate:
+            setCredentials(QStringLiteral("#ws+mock"), m_password);
+            break;
+        case Delayed:
+            QTimer::singleShot(50, this, [this](){
+                setCredentials(QStringLiteral("#ws+mock"), m_password);
+            });
+            break;
+        case Failing:
+            setCredentialsError(QStringLiteral("secret store locked"));
+            break;
+        }
+    }
+
+private:
+    QString m_password = QStringLiteral("mock");
+    std::atomic<int> m_fetches{0};
+    std::atomic<int> m_running{0};
+    std::atomic<int> m_maxConcurrent{0};
+    Mode m_mode;
+};
+
+class TestConfig : public QHR::AbstractConfiguration
+{
+    Q_OBJECT
+public:
+    explicit TestConfig(const QUrl &baseUrl, QObject *parent = nullptr) : QHR::AbstractConfiguration(parent), m_baseUrl(baseUrl) {}
+
+    QString username() const override { return QStringLiteral("#ws+mock"); }
+    QString password() const override { return QString(); }
+    QUrl baseUrl() const override { return m_baseUrl; }
+    QHR::AbstractCredentialProvider *credentialProvider() const override { return m_provider; }
+
+    void setCredentialProvider(QHR::AbstractCredentialProvider *provider) { m_provider = provider; }
+
+private:
+    QUrl m_baseUrl;
+    QHR::AbstractCredentialProvider *m_provider = nullptr;
+};
+
+class TestAbstractCredentialProvider : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+
+    void fetchOnce();
+    void shareRunningFetch();
+    void fetchFailed();
+    void invalidate();
+    void concurrentRequests();
+
+    void jobsWaitForCredentials();
+    void jobCredentialsFailed();
+    void jobUnauthorizedInvalidates();
+
+private:
+    QHR::Job *startJob(int serverNumber);
+
+    QHR::MockRobotServer m_server;
+    TestConfig *m_config = nullptr;
+};
+
+void TestAbstractCredentialProvider::initTestCase()
+{
+    QHR::setDefaultRetryPolicy(QHR::RetryPolicy());
+    QVERIFY(m_server.start());
+    m_config = new TestConfig(m_server.baseUrl(), this);
+}
+
+void TestAbstractCredentialProvider::init()
+{
+    m_server.setServerCount(10);
+    m_server.setPassword(QStringLiteral("mock"));
+    m_config->setCredentialProvider(nullptr);
+}
+
+QHR::Job *TestAbstractCredentialProvider::startJob(int serverNumber)
+{
+    QHR::Job *job = QHR::makeJob<QHR::Endpoints::ServerGet>(this, serverNumber);
+    job->setConfiguration(m_config);
+    job->setAutoDelete(false);
+    job->start();
+    return job;
+}
+
+void TestAbstractCredentialProvider::fetchOnce()
+{
+    TestCredentialProvider provider(TestCredentialProvider::Immediate);
+    QVERIFY(!provider.isReady());
+    QVERIFY(provider.username().isNull());
+    QVERIFY(provider.authorizationHeader().isEmpty());
+
+    QSignalSpy ready(&provider, &QHR::AbstractCredentialProvider::credentialsReady);
+    provider.requestCredentials();
+    QCOMPARE(ready.size(), 1);
+    QCOMPARE(provider.fetches(), 1);
+    QVERIFY(provider.isReady());
+    QCOMPARE(provider.username(), QStringLiteral("#ws+mock"));
+    QCOMPARE(provider.authorizationHeader(), QByteArrayLiteral("Basic ") + QByteArrayLiteral("#ws+mock:mock").toBase64());
+
+    // cached credentials are reported immediately
+    provider.requestCredentials();
+    QCOMPARE(ready.size(), 2);
+    QCOMPARE(provider.fetches(), 1);
+}
+
+void TestAbstractCredentialProvider::shareRunningFetch()
+{
+    TestCredentialProvider provider(TestCredentialProvider::Delayed);
+    QSignalSpy ready(&provider, &QHR::AbstractCredentialProvider::credentialsReady);
+
+    provider.requestCredentials();
+    provider.requestCredentials();
+    provider.requestCredentials();
+    QCOMPARE(provider.fetches(), 1);
+    QVERIFY(ready.isEmpty());
+
+    QVERIFY(ready.wait(5000));
+    QCOMPARE(ready.size(), 1);
+    QVERIFY(provider.isReady());
+    QCOMPARE(provider.fetches(), 1);
+}
+
+void TestAbstractCredentialProvider::fetchFailed()
+{
+    TestCredentialProvider provider(TestCredentialProvider::Failing);
+    QSignalSpy ready(&provider, &QHR::AbstractCredentialProvider::credentialsReady);
+    QSignalSpy failed(&provider, &QHR::AbstractCredentialProvider::credentialsFailed);
+
+    provider.requestCredentials();
+    QCOMPARE(failed.size(), 1);
+    QCOMPARE(failed.first().first().toString(), QStringLiteral("secret store locked"));
+    QVERIFY(ready.isEmpty());
+    QVERIFY(!provider.isReady());
+
+    // a failed fetch does not block the next one
+    provider.requestCredentials();
+    QCOMPARE(failed.size(), 2);
+    QCOMPARE(provider.fetches(), 2);
+}
+
+void TestAbstractCredentialProvider::invalidate()
+{
+    TestCredentialProvider provider(TestCredentialProvider::Immediate);
+    provider.requestCredentials();
+    QVERIFY(provider.isReady());
+
+    provider.invalidate();
+    QVERIFY(!provider.isReady());
+    QVERIFY(provider.username().isNull());
+    QVERIFY(provider.authorizationHeader().isEmpty());
+
+    provider.setPassword(QStringLiteral("changed"));
+    provider.requestCredentials();
+    QCOMPARE(provider.fetches(), 2);
+    QCOMPARE(provider.authorizationHeader(), QByteArrayLiteral("Basic ") + QByteArrayLiteral("#ws+mock:changed").toBase64());
+
+    // changed credentials invalidate the cache too
+    Q_EMIT provider.credentialsChanged();
+    QVERIFY(!provider.isReady());
+    provider.requestCredentials();
+    QCOMPARE(provider.fetches(), 3);
+}
+
+void TestAbstractCredentialProvider::concurrentRequests()
+{
+    // requests racing with invalidations must never run two fetches at the same time
+    TestCredentialProvider provider(TestCredentialProvider::Immediate);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&provider, t](){
+            for (int i = 0; i < 500; ++i) {
+                if ((i + t) % 3 == 0) {
+                    provider.invalidate();
+                } else {
+                    provider.requestCredentials();
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    QVERIFY(provider.fetches() > 0);
+    QCOMPARE(provider.maxConcurrentFetches(), 1);
+}
+
+void TestAbstractCredentialProvider::jobsWaitForCredentials()
+{
+    TestCredentialProvider provider(TestCredentialProvider::Delayed);
+    m_config->setCredentialProvider(&provider);
+
+    QVector<QHR::Job*> jobs;
+    std::vector<std::unique_ptr<QSignalSpy>> spies;
+    for (int i = 0; i < 3; ++i) {
+        QHR::Job *job = QHR::makeJob<QHR::Endpoints::ServerGet>(this, 100000 + i);
+        job->setConfiguration(m_config);
+        job->setAutoDelete(false);
+        spies.emplace_back(new QSignalSpy(job, &QHR::BJob::result));
+        job->start();
+        jobs << job;
+    }
+
+    for (const auto &spy : spies) {
+        QVERIFY(!spy->empty() || spy->wait(5000));
+    }
+
+    // all jobs shared a single fetch
+    QCOMPARE(provider.fetches(), 1);
+    for (QHR::Job *job : jobs) {
+        QVERIFY2(job->error() == QHR::BJob::NoError, qUtf8Printable(job->errorString()));
+        delete job;
+    }
+
+    // jobs started with cached credentials do not wait
+    QScopedPointer<QHR::Job> job(startJob(100004));
+    QSignalSpy result(job.data(), &QHR::BJob::result);
+    QVERIFY(result.wait(5000));
+    QCOMPARE(job->error(), static_cast<int>(QHR::BJob::NoError));
+    QCOMPARE(provider.fetches(), 1);
+}
+
+void TestAbstractCredentialProvider::jobCredentialsFailed()
+{
+    TestCredentialProvider provider(TestCredentialProvider::Failing);
+    m_config->setCredentialProvider(&provider);
+
+    const quint64 requestsBefore = m_server.requestCount();
+    QScopedPointer<QHR::Job> job(startJob(100000));
+    QSignalSpy result(job.data(), &QHR::BJob::result);
+    QVERIFY(result.wait(5000));
+
+    QCOMPARE(job->error(), static_cast<int>(QHR::CredentialsUnavailable));
+    QCOMPARE(job->errorText(), QStringLiteral("secret store locked"));
+    QCOMPARE(m_server.requestCount(), requestsBefore);
+}
+
+void TestAbstractCredentialProvider::jobUnauthorizedInvalidates()
+{
+    TestCredentialProvider provider(TestCredentialProvider::Immediate);
+    provider.setPassword(QStringLiteral("wrong"));
+    m_config->setCredentialProvider(&provider);
+
+    QScopedPointer<QHR::Job> job(startJob(100000));
+    QSignalSpy result(job.data(), &QHR::BJob::result);
+    QVERIFY(result.wait(5000));
+    QCOMPARE(job->error(), static_cast<int>(QHR::Unauthorized));
+
+    // the rejected credentials are removed, the next job fetches them again
+    QTRY_VERIFY(!provider.isReady());
+    provider.setPassword(QStringLiteral("mock"));
+    QScopedPointer<QHR::Job> retry(startJob(100000));
+    QSignalSpy retryResult(retry.data(), &QHR::BJob::result);
+    QVERIFY(retryResult.wait(5000));
+    QCOMPARE(retry->error(), static_cast<int>(QHR::BJob::NoError));
+    QCOMPARE(provider.fetches(), 2);
+}
+
+QTEST_MAIN(TestAbstractCredentialProvider)
+
+#include "testcredentialprovider.moc"
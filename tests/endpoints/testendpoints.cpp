@@ -0,0 +1,104 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "endpoints.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QUrl>
+
+/*
+ * Checks the requests created from the compile-time endpoint table, especially
+ * that path arguments can not change the target of a request.
+ */
+
+class TestEndpoints : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void requestProperties();
+    void formatPath_data();
+    void formatPath();
+    void rejectInvalidArguments_data();
+    void rejectInvalidArguments();
+    void encodedPathStaysInResource();
+};
+
+void TestEndpoints::requestProperties()
+{
+    const QHR::Request list = QHR::makeRequest<QHR::Endpoints::RdnsList>();
+    QCOMPARE(list.path, QStringLiteral("/rdns"));
+    QCOMPARE(list.operation, QHR::Request::Get);
+    QCOMPARE(list.expectedContent, QHR::Request::JsonArray);
+    QVERIFY(list.notFoundIsEmpty);
+    QVERIFY(list.requiresAuth);
+
+    const QHR::Request del = QHR::makeRequest<QHR::Endpoints::RdnsDelete>(QStringLiteral("123.123.123.123"));
+    QCOMPARE(del.path, QStringLiteral("/rdns/123.123.123.123"));
+    QCOMPARE(del.operation, QHR::Request::Delete);
+    QCOMPARE(del.expectedContent, QHR::Request::NoContent);
+    QVERIFY(!del.notFoundIsEmpty);
+
+    const QHR::Request reset = QHR::makeRequest<QHR::Endpoints::ResetExecute>(321);
+    QCOMPARE(reset.path, QStringLiteral("/reset/321"));
+    QCOMPARE(reset.operation, QHR::Request::Post);
+}
+
+void TestEndpoints::formatPath_data()
+{
+    QTest::addColumn<QString>("argument");
+    QTest::addColumn<QString>("path");
+
+    QTest::newRow("ipv4") << QStringLiteral("123.123.123.123") << QStringLiteral("/rdns/123.123.123.123");
+    QTest::newRow("ipv6") << QStringLiteral("2a01:4f8:111:4221::2") << QStringLiteral("/rdns/2a01:4f8:111:4221::2");
+    QTest::newRow("slash") << QStringLiteral("1.2.3.4/../../reset/1") << QStringLiteral("/rdns/1.2.3.4%2F..%2F..%2Freset%2F1");
+    QTest::newRow("query") << QStringLiteral("1.2.3.4?type=hw") << QStringLiteral("/rdns/1.2.3.4%3Ftype%3Dhw");
+    QTest::newRow("fragment") << QStringLiteral("1.2.3.4#x") << QStringLiteral("/rdns/1.2.3.4%23x");
+    QTest::newRow("space") << QStringLiteral("a b") << QStringLiteral("/rdns/a%20b");
+    QTest::newRow("percent") << QStringLiteral("a%2Fb") << QStringLiteral("/rdns/a%252Fb");
+    QTest::newRow("non-ascii") << QString::fromUtf8("\xc3\xa4") << QStringLiteral("/rdns/%C3%A4");
+}
+
+void TestEndpoints::formatPath()
+{
+    QFETCH(QString, argument);
+    QFETCH(QString, path);
+
+    QCOMPARE(QHR::makeRequest<QHR::Endpoints::RdnsGet>(argument).path, path);
+}
+
+void TestEndpoints::rejectInvalidArguments_data()
+{
+    QTest::addColumn<QString>("argument");
+
+    QTest::newRow("empty") << QString();
+    QTest::newRow("dot") << QStringLiteral(".");
+    QTest::newRow("dot-dot") << QStringLiteral("..");
+}
+
+void TestEndpoints::rejectInvalidArguments()
+{
+    QFETCH(QString, argument);
+
+    QVERIFY(QHR::makeRequest<QHR::Endpoints::RdnsDelete>(argument).path.isNull());
+    QVERIFY(QHR::makeRequest<QHR::Endpoints::StorageBoxSnapshotComment>(1234, argument).path.isNull());
+    QCOMPARE(QHR::makeRequest<QHR::Endpoints::StorageBoxSnapshotComment>(1234, QStringLiteral("snap")).path, QStringLiteral("/storagebox/1234/snapshot/snap/comment"));
+}
+
+void TestEndpoints::encodedPathStaysInResource()
+{
+    QUrl url(QStringLiteral("https://robot-ws.your-server.de"));
+    url.setPath(QHR::makeRequest<QHR::Endpoints::RdnsDelete>(QStringLiteral("1.2.3.4/../../reset/1?type=hw#x")).path);
+
+    QVERIFY(url.isValid());
+    QVERIFY(!url.hasQuery());
+    QVERIFY(!url.hasFragment());
+    QCOMPARE(url.adjusted(QUrl::NormalizePathSegments).path(QUrl::FullyEncoded), url.path(QUrl::FullyEncoded));
+    QVERIFY(url.path(QUrl::FullyEncoded).startsWith(QLatin1String("/rdns/1.2.3.4%2F")));
+}
+
+QTEST_MAIN(TestEndpoints)
+
+#include "testendpoints.moc"
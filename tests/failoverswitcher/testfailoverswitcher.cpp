@@ -0,0 +1,410 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "failoverswitcher.h"
+#include "failovercontroller.h"
+#include "abstractconfiguration.h"
+#include "abstractcredentialprovider.h"
+#include "job.h"
+#include "mockrobotserver.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QTimer>
+#include <QUrl>
+
+/*
+ * Switches failover IPs of the local MockRobotServer via FailoverSwitcher and
+ * FailoverController, including retries, credential handling and stopping the
+ * controller while a switch is running.
+ */
+
+class TestCredentialProvider : public QHR::AbstractCredentialProvider
+{
+    Q_OBJECT
+public:
+    enum Mode : quint8 {
+        Immediate,
+        Delayed,
+        Failing,
+        Never
+    };
+
+    explicit TestCredentialProvider(Mode mode, QObject *parent = nullptr) : QHR::AbstractCredentialProvider(parent), m_mode(mode) {}
+
+    void setPassword(const QString &password) { m_password = password; }
+    int fetches() const { return m_fetches; }
+
+protected:
+    void fetchCredentials() override
+    {
+        ++m_fetches;
+        switch (m_mode) {
+        case Immediate:
+            setCredentials(QStringLiteral("#ws+mock"), m_password);
+            break;
+        case Delayed:
+            QTimer::singleShot(50, this, [this](){
+                setCredentials(QStringLiteral("#ws+mock"), m_password);
+            });
+            break;
+        case Failing:
+            setCredentialsError(QStringLiteral("secret store locked"));
+            break;
+        case Never:
+            break;
+        }
+    }
+
+private:
+    QString m_password = QStringLiteral("mock");
+    int m_fetches = 0;
+    Mode m_mode;
+};
+
+class TestConfig : public QHR::AbstractConfiguration
+{
+    Q_OBJECT
+public:
+    explicit TestConfig(const QUrl &baseUrl, QObject *parent = nullptr) : QHR::AbstractConfiguration(parent), m_baseUrl(baseUrl) {}
+
+    QString username() const override { return QStringLiteral("#ws+mock"); }
+    QString password() const override { return m_password; }
+    void setPassword(const QString &password) override { m_password = password; }
+    QUrl baseUrl() const override { return m_baseUrl; }
+    QHR::AbstractCredentialProvider *credentialProvider() const override { return m_provider; }
+
+    void setCredentialProvider(QHR::AbstractCredentialProvider *provider) { m_provider = provider; }
+
+private:
+    QUrl m_baseUrl;
+    QString m_password = QStringLiteral("mock");
+    QHR::AbstractCredentialProvider *m_provider = nullptr;
+};
+
+class TestFailoverSwitcher : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+
+    void switchFailover();
+    void alreadyRouted();
+    void lockedRetryVerifiesRouting();
+    void lockedFirstAttemptFails();
+    void rejectInvalidIp();
+    void unauthorizedRetry();
+    void unauthorizedFails();
+    void waitForCredentials();
+    void credentialsTimeout();
+    void credentialsFailed();
+    void unauthorizedRefetchesCredentials();
+
+    void controllerSwitches();
+    void controllerResumesAfterFailedSwitch();
+    void controllerStopWhileSwitching();
+
+private:
+    QHR::FailoverSwitchResult switchTo(QHR::FailoverSwitcher *switcher, const QString &failoverIp, const QString &activeServerIp);
+
+    QHR::MockRobotServer m_server;
+    TestConfig *m_config = nullptr;
+};
+
+void TestFailoverSwitcher::initTestCase()
+{
+    qRegisterMetaType<QHR::FailoverSwitchResult>();
+    qRegisterMetaType<QHR::FailoverController::State>();
+    QVERIFY(m_server.start());
+    m_config = new TestConfig(m_server.baseUrl(), this);
+}
+
+void TestFailoverSwitcher::init()
+{
+    m_server.setServerCount(10);
+    m_server.setFailoverSwitchDuration(0);
+    m_server.setPassword(QStringLiteral("mock"));
+    m_config->setPassword(QStringLiteral("mock"));
+    m_config->setCredentialProvider(nullptr);
+}
+
+QHR::FailoverSwitchResult TestFailoverSwitcher::switchTo(QHR::FailoverSwitcher *switcher, const QString &failoverIp, const QString &activeServerIp)
+{
+    QSignalSpy spy(switcher, &QHR::FailoverSwitcher::switchFinished);
+    switcher->switchTo(failoverIp, activeServerIp);
+    if (spy.empty() && !spy.wait(5000)) {
+        return QHR::FailoverSwitchResult();
+    }
+    return spy.first().first().value<QHR::FailoverSwitchResult>();
+}
+
+void TestFailoverSwitcher::switchFailover()
+{
+    QHR::FailoverSwitcher switcher;
+    switcher.setConfiguration(m_config);
+
+    const QHR::FailoverSwitchResult result = switchTo(&switcher, QStringLiteral("10.0.0.1"), QStringLiteral("10.0.0.2"));
+    QVERIFY2(result.isOk(), qUtf8Printable(result.errorString));
+    QCOMPARE(result.failoverIp, QStringLiteral("10.0.0.1"));
+    QCOMPARE(result.attempts, 1);
+    QCOMPARE(result.httpStatus, 200);
+    QCOMPARE(result.failover.value(QStringLiteral("active_server_ip")).toString(), QStringLiteral("10.0.0.2"));
+    QVERIFY(!switcher.isSwitching(QStringLiteral("10.0.0.1")));
+}
+
+void TestFailoverSwitcher::alreadyRouted()
+{
+    QHR::FailoverSwitcher switcher;
+    switcher.setConfiguration(m_config);
+
+    // the fixture routes every failover IP to its own server
+    const QHR::FailoverSwitchResult result = switchTo(&switcher, QStringLiteral("10.0.0.3"), QStringLiteral("10.0.0.3"));
+    QVERIFY2(result.isOk(), qUtf8Printable(result.errorString));
+    QCOMPARE(result.apiErrorCode, QStringLiteral("FAILOVER_ALREADY_ROUTED"));
+    QCOMPARE(result.attempts, 1);
+}
+
+void TestFailoverSwitcher::lockedRetryVerifiesRouting()
+{
+    // the first attempt is applied but times out, the retry hits the lock of the first attempt
+    m_server.setFailoverSwitchDuration(500);
+
+    QHR::FailoverSwitcher switcher;
+    switcher.setConfiguration(m_config);
+    switcher.setTimeout(200);
+    switcher.setMaxAttempts(3);
+
+    const QHR::FailoverSwitchResult result = switchTo(&switcher, QStringLiteral("10.0.0.4"), QStringLiteral("10.0.0.5"));
+    QVERIFY2(result.isOk(), qUtf8Printable(result.errorString));
+    QCOMPARE(result.attempts, 2);
+    QCOMPARE(result.apiErrorCode, QStringLiteral("FAILOVER_LOCKED"));
+    QCOMPARE(result.failover.value(QStringLiteral("active_server_ip")).toString(), QStringLiteral("10.0.0.5"));
+    QVERIFY(result.latency >= 200);
+}
+
+void TestFailoverSwitcher::lockedFirstAttemptFails()
+{
+    m_server.setFailoverSwitchDuration(500);
+
+    QHR::FailoverSwitcher first;
+    first.setConfiguration(m_config);
+    QSignalSpy firstSpy(&first, &QHR::FailoverSwitcher::switchFinished);
+
+    const quint64 requests = m_server.requestCount();
+    first.switchTo(QStringLiteral("10.0.0.6"), QStringLiteral("10.0.0.7"));
+    QTRY_VERIFY(m_server.requestCount() > requests);
+
+    // a lock on the first attempt belongs to another switch and is not verified
+    QHR::FailoverSwitcher second;
+    second.setConfiguration(m_config);
+    const QHR::FailoverSwitchResult result = switchTo(&second, QStringLiteral("10.0.0.6"), QStringLiteral("10.0.0.8"));
+    QVERIFY(!result.isOk());
+    QCOMPARE(result.attempts, 1);
+    QCOMPARE(result.httpStatus, 409);
+    QCOMPARE(result.apiErrorCode, QStringLiteral("FAILOVER_LOCKED"));
+
+    QVERIFY(!firstSpy.empty() || firstSpy.wait(5000));
+    QVERIFY(firstSpy.first().first().value<QHR::FailoverSwitchResult>().isOk());
+}
+
+void TestFailoverSwitcher::rejectInvalidIp()
+{
+    QHR::FailoverSwitcher switcher;
+    switcher.setConfiguration(m_config);
+
+    const quint64 requests = m_server.requestCount();
+    const QHR::FailoverSwitchResult result = switchTo(&switcher, QStringLiteral(".."), QStringLiteral("10.0.0.2"));
+    QCOMPARE(result.error, static_cast<int>(QHR::InvalidInput));
+    QCOMPARE(result.attempts, 0);
+    QCOMPARE(m_server.requestCount(), requests);
+}
+
+void TestFailoverSwitcher::unauthorizedRetry()
+{
+    QHR::FailoverSwitcher switcher;
+    switcher.setConfiguration(m_config);
+
+    QHR::FailoverSwitchResult result = switchTo(&switcher, QStringLiteral("10.0.0.1"), QStringLiteral("10.0.0.3"));
+    QVERIFY2(result.isOk(), qUtf8Printable(result.errorString));
+
+    // the cached header is outdated after the password has been changed
+    m_server.setPassword(QStringLiteral("changed"));
+    m_config->setPassword(QStringLiteral("changed"));
+
+    result = switchTo(&switcher, QStringLiteral("10.0.0.1"), QStringLiteral("10.0.0.4"));
+    QVERIFY2(result.isOk(), qUtf8Printable(result.errorString));
+    QCOMPARE(result.attempts, 2);
+    QCOMPARE(result.failover.value(QStringLiteral("active_server_ip")).toString(), QStringLiteral("10.0.0.4"));
+}
+
+void TestFailoverSwitcher::unauthorizedFails()
+{
+    QHR::FailoverSwitcher switcher;
+    switcher.setConfiguration(m_config);
+    switcher.setMaxAttempts(5);
+
+    m_server.setPassword(QStringLiteral("changed"));
+
+    // the credentials are fetched again only once
+    const QHR::FailoverSwitchResult result = switchTo(&switcher, QStringLiteral("10.0.0.1"), QStringLiteral("10.0.0.2"));
+    QCOMPARE(result.error, static_cast<int>(QHR::Unauthorized));
+    QCOMPARE(result.httpStatus, 401);
+    QCOMPARE(result.attempts, 2);
+}
+
+void TestFailoverSwitcher::waitForCredentials()
+{
+    TestCredentialProvider provider(TestCredentialProvider::Delayed);
+    m_config->setCredentialProvider(&provider);
+
+    QHR::FailoverSwitcher switcher;
+    switcher.setConfiguration(m_config);
+    QSignalSpy spy(&switcher, &QHR::FailoverSwitcher::switchFinished);
+
+    // both switches share the same fetch
+    switcher.switchTo(QStringLiteral("10.0.0.1"), QStringLiteral("10.0.0.2"));
+    switcher.switchTo(QStringLiteral("10.0.0.3"), QStringLiteral("10.0.0.4"));
+    QVERIFY(switcher.isSwitching(QStringLiteral("10.0.0.1")));
+    QVERIFY(switcher.isSwitching(QStringLiteral("10.0.0.3")));
+    QTRY_COMPARE_WITH_TIMEOUT(spy.size(), 2, 5000);
+
+    for (const QList<QVariant> &args : spy) {
+        const auto result = args.first().value<QHR::FailoverSwitchResult>();
+        QVERIFY2(result.isOk(), qUtf8Printable(result.errorString));
+        QCOMPARE(result.attempts, 1);
+    }
+    QCOMPARE(provider.fetches(), 1);
+}
+
+void TestFailoverSwitcher::credentialsTimeout()
+{
+    TestCredentialProvider provider(TestCredentialProvider::Never);
+    m_config->setCredentialProvider(&provider);
+
+    QHR::FailoverSwitcher switcher;
+    switcher.setConfiguration(m_config);
+    switcher.setTimeout(200);
+
+    const quint64 requests = m_server.requestCount();
+    const QHR::FailoverSwitchResult result = switchTo(&switcher, QStringLiteral("10.0.0.1"), QStringLiteral("10.0.0.2"));
+    QCOMPARE(result.error, static_cast<int>(QHR::RequestTimedOut));
+    QCOMPARE(result.attempts, 0);
+    QVERIFY(result.latency >= 200);
+    QCOMPARE(m_server.requestCount(), requests);
+}
+
+void TestFailoverSwitcher::credentialsFailed()
+{
+    TestCredentialProvider provider(TestCredentialProvider::Failing);
+    m_config->setCredentialProvider(&provider);
+
+    QHR::FailoverSwitcher switcher;
+    switcher.setConfiguration(m_config);
+
+    const QHR::FailoverSwitchResult result = switchTo(&switcher, QStringLiteral("10.0.0.1"), QStringLiteral("10.0.0.2"));
+    QCOMPARE(result.error, static_cast<int>(QHR::CredentialsUnavailable));
+    QVERIFY(result.errorString.contains(QStringLiteral("secret store locked")));
+    QCOMPARE(result.attempts, 0);
+}
+
+void TestFailoverSwitcher::unauthorizedRefetchesCredentials()
+{
+    TestCredentialProvider provider(TestCredentialProvider::Immediate);
+    m_config->setCredentialProvider(&provider);
+
+    QHR::FailoverSwitcher switcher;
+    switcher.setConfiguration(m_config);
+
+    QHR::FailoverSwitchResult result = switchTo(&switcher, QStringLiteral("10.0.0.1"), QStringLiteral("10.0.0.2"));
+    QVERIFY2(result.isOk(), qUtf8Printable(result.errorString));
+    QCOMPARE(provider.fetches(), 1);
+
+    m_server.setPassword(QStringLiteral("changed"));
+    provider.setPassword(QStringLiteral("changed"));
+
+    result = switchTo(&switcher, QStringLiteral("10.0.0.1"), QStringLiteral("10.0.0.3"));
+    QVERIFY2(result.isOk(), qUtf8Printable(result.errorString));
+    QCOMPARE(result.attempts, 2);
+    QCOMPARE(provider.fetches(), 2);
+}
+
+void TestFailoverSwitcher::controllerSwitches()
+{
+    QHR::FailoverController controller;
+    controller.switcher()->setConfiguration(m_config);
+    controller.setFailover(QStringLiteral("10.0.0.9"), QStringLiteral("10.0.0.8"));
+    controller.setProbe([](const std::function<void(bool)> &report){ report(false); });
+    controller.setProbeInterval(20);
+    controller.setFailureThreshold(2);
+
+    QSignalSpy triggered(&controller, &QHR::FailoverController::switchTriggered);
+    QSignalSpy finished(&controller, &QHR::FailoverController::switchFinished);
+    controller.start();
+    QCOMPARE(controller.state(), QHR::FailoverController::Monitoring);
+
+    QVERIFY(finished.wait(5000));
+    QCOMPARE(triggered.size(), 1);
+    QCOMPARE(triggered.first().first().toInt(), 2);
+    QVERIFY(finished.first().first().value<QHR::FailoverSwitchResult>().isOk());
+    QCOMPARE(controller.state(), QHR::FailoverController::Switched);
+}
+
+void TestFailoverSwitcher::controllerResumesAfterFailedSwitch()
+{
+    QHR::FailoverController controller;
+    controller.switcher()->setConfiguration(m_config);
+    // the backup server is not part of the fixture data
+    controller.setFailover(QStringLiteral("10.0.0.9"), QStringLiteral("10.0.1.0"));
+    controller.setProbe([](const std::function<void(bool)> &report){ report(false); });
+    controller.setProbeInterval(20);
+    controller.setFailureThreshold(1);
+
+    QSignalSpy finished(&controller, &QHR::FailoverController::switchFinished);
+    controller.start();
+
+    QVERIFY(finished.wait(5000));
+    QVERIFY(!finished.first().first().value<QHR::FailoverSwitchResult>().isOk());
+    QCOMPARE(controller.state(), QHR::FailoverController::Monitoring);
+
+    // the next failed probe triggers the switch again
+    QVERIFY(finished.wait(5000));
+    controller.stop();
+    QCOMPARE(controller.state(), QHR::FailoverController::Stopped);
+}
+
+void TestFailoverSwitcher::controllerStopWhileSwitching()
+{
+    QHR::FailoverController controller;
+    controller.switcher()->setConfiguration(m_config);
+    controller.setFailover(QStringLiteral("10.0.0.9"), QStringLiteral("10.0.1.0"));
+    controller.setProbe([](const std::function<void(bool)> &report){ report(false); });
+    controller.setProbeInterval(20);
+    controller.setFailureThreshold(1);
+
+    connect(&controller, &QHR::FailoverController::switchTriggered, &controller, [&controller](){
+        QCOMPARE(controller.state(), QHR::FailoverController::Switching);
+        controller.stop();
+    });
+
+    QSignalSpy probed(&controller, &QHR::FailoverController::probed);
+    QSignalSpy finished(&controller, &QHR::FailoverController::switchFinished);
+    controller.start();
+
+    // stopping does not abort the running switch
+    QVERIFY(finished.wait(5000));
+    QVERIFY(!finished.first().first().value<QHR::FailoverSwitchResult>().isOk());
+    QCOMPARE(controller.state(), QHR::FailoverController::Stopped);
+
+    // a failed switch does not resume monitoring after the controller has been stopped
+    const int probes = probed.size();
+    QTest::qWait(200);
+    QCOMPARE(probed.size(), probes);
+    QCOMPARE(finished.size(), 1);
+}
+
+QTEST_MAIN(TestFailoverSwitcher)
+
+#include "testfailoverswitcher.moc"
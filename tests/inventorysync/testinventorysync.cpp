@@ -0,0 +1,289 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "inventorysync.h"
+#include "abstractconfiguration.h"
+#include "retrypolicy.h"
+#include "job.h"
+#include "mockrobotserver.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QStringList>
+#include <QUrl>
+
+/*
+ * Applies snapshots to InventorySync and checks the reported deltas, and syncs
+ * the inventory of the local MockRobotServer.
+ */
+
+class TestConfig : public QHR::AbstractConfiguration
+{
+    Q_OBJECT
+public:
+    explicit TestConfig(const QUrl &baseUrl, QObject *parent = nullptr) : QHR::AbstractConfiguration(parent), m_baseUrl(baseUrl) {}
+
+    QString username() const override { return QStringLiteral("#ws+mock"); }
+    QString password() const override { return QStringLiteral("mock"); }
+    QUrl baseUrl() const override { return m_baseUrl; }
+
+private:
+    QUrl m_baseUrl;
+};
+
+class TestInventorySync : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void initialSnapshot();
+    void unchangedSnapshot();
+    void mergeEvents();
+    void signalsAfterApply();
+    void removeAll();
+    void skipInvalidRecords();
+    void syncFromServer();
+    void syncFailed();
+
+private:
+    static QJsonObject server(int number, const QString &status = QStringLiteral("ready"));
+    static QJsonArray snapshot(const QVector<int> &numbers);
+
+    QHR::MockRobotServer m_server;
+    TestConfig *m_config = nullptr;
+    QHR::InventorySync *m_sync = nullptr;
+    // one entry per change signal, like "added:100001"
+    QStringList m_events;
+};
+
+void TestInventorySync::initTestCase()
+{
+    QHR::setDefaultRetryPolicy(QHR::RetryPolicy());
+    QVERIFY(m_server.start());
+    m_config = new TestConfig(m_server.baseUrl(), this);
+}
+
+void TestInventorySync::init()
+{
+    m_server.setServerCount(10);
+    m_server.setMaintenance(false);
+    m_events.clear();
+
+    m_sync = new QHR::InventorySync(this);
+    m_sync->setConfiguration(m_config);
+    connect(m_sync, &QHR::InventorySync::serverAdded, this, [this](const QHR::Server &s){
+        m_events << QStringLiteral("added:%1").arg(s.serverNumber());
+    });
+    connect(m_sync, &QHR::InventorySync::serverRemoved, this, [this](const QHR::Server &s){
+        m_events << QStringLiteral("removed:%1").arg(s.serverNumber());
+    });
+    connect(m_sync, &QHR::InventorySync::serverChanged, this, [this](const QHR::Server &s, const QHR::Server &previous){
+        QCOMPARE(s.serverNumber(), previous.serverNumber());
+        m_events << QStringLiteral("changed:%1:%2:%3").arg(s.serverNumber()).arg(previous.status(), s.status());
+    });
+}
+
+void TestInventorySync::cleanup()
+{
+    delete m_sync;
+    m_sync = nullptr;
+}
+
+QJsonObject TestInventorySync::server(int number, const QString &status)
+{
+    return QJsonObject{{QStringLiteral("server"), QJsonObject{
+        {QStringLiteral("server_ip"), QStringLiteral("123.123.0.%1").arg(number % 250 + 1)},
+        {QStringLiteral("server_number"), number},
+        {QStringLiteral("server_name"), QStringLiteral("server%1").arg(number)},
+        {QStringLiteral("product"), QStringLiteral("DS 3000")},
+        {QStringLiteral("status"), status},
+        {QStringLiteral("cancelled"), false}
+    }}};
+}
+
+QJsonArray TestInventorySync::snapshot(const QVector<int> &numbers)
+{
+    QJsonArray array;
+    for (int number : numbers) {
+        array.append(server(number));
+    }
+    return array;
+}
+
+void TestInventorySync::initialSnapshot()
+{
+    QSignalSpy synced(m_sync, &QHR::InventorySync::synced);
+    QSignalSpy countChanged(m_sync, &QHR::InventorySync::serverCountChanged);
+
+    // the order of the API is not relied upon
+    m_sync->update(snapshot({3, 1, 2}));
+
+    QCOMPARE(m_events, QStringList({QStringLiteral("added:1"), QStringLiteral("added:2"), QStringLiteral("added:3")}));
+    QCOMPARE(synced.size(), 1);
+    QCOMPARE(synced.first(), QVariantList({3, 0, 0}));
+    QCOMPARE(countChanged.size(), 1);
+    QCOMPARE(countChanged.first().first().toInt(), 3);
+    QCOMPARE(m_sync->serverCount(), 3);
+    QCOMPARE(m_sync->generation(), Q_UINT64_C(1));
+
+    const QHR::ServerList servers = m_sync->servers();
+    QCOMPARE(servers.size(), 3);
+    QCOMPARE(servers.at(0).serverNumber(), 1);
+    QCOMPARE(servers.at(2).serverNumber(), 3);
+    QCOMPARE(m_sync->server(2).serverName(), QStringLiteral("server2"));
+    QVERIFY(m_sync->server(4).isNull());
+}
+
+void TestInventorySync::unchangedSnapshot()
+{
+    m_sync->update(snapshot({1, 2, 3}));
+    m_events.clear();
+
+    QSignalSpy synced(m_sync, &QHR::InventorySync::synced);
+    QSignalSpy countChanged(m_sync, &QHR::InventorySync::serverCountChanged);
+
+    m_sync->update(snapshot({3, 2, 1}));
+
+    QVERIFY(m_events.isEmpty());
+    QCOMPARE(synced.first(), QVariantList({0, 0, 0}));
+    QVERIFY(countChanged.isEmpty());
+    QCOMPARE(m_sync->serverCount(), 3);
+    QCOMPARE(m_sync->generation(), Q_UINT64_C(2));
+}
+
+void TestInventorySync::mergeEvents()
+{
+    m_sync->update(snapshot({1, 2, 3, 5}));
+    m_events.clear();
+
+    QSignalSpy synced(m_sync, &QHR::InventorySync::synced);
+    QSignalSpy countChanged(m_sync, &QHR::InventorySync::serverCountChanged);
+
+    QJsonArray next;
+    next.append(server(2, QStringLiteral("in process")));
+    next.append(server(3));
+    next.append(server(4));
+    next.append(server(6));
+    m_sync->update(next);
+
+    // removed servers first, then added and changed ones, each in server number order
+    QCOMPARE(m_events, QStringList({
+        QStringLiteral("removed:1"),
+        QStringLiteral("removed:5"),
+        QStringLiteral("added:4"),
+        QStringLiteral("added:6"),
+        QStringLiteral("changed:2:ready:in process")
+    }));
+    QCOMPARE(synced.first(), QVariantList({2, 2, 1}));
+    QVERIFY(countChanged.isEmpty());
+    QCOMPARE(m_sync->serverCount(), 4);
+    QCOMPARE(m_sync->server(2).status(), QStringLiteral("in process"));
+    QVERIFY(m_sync->server(1).isNull());
+    QVERIFY(m_sync->server(5).isNull());
+    QCOMPARE(m_sync->server(6).serverNumber(), 6);
+}
+
+void TestInventorySync::signalsAfterApply()
+{
+    m_sync->update(snapshot({1, 2}));
+
+    int countInSlot = -1;
+    bool removedStillFound = true;
+    connect(m_sync, &QHR::InventorySync::serverRemoved, this, [this, &countInSlot, &removedStillFound](const QHR::Server &s){
+        countInSlot = m_sync->serverCount();
+        removedStillFound = !m_sync->server(s.serverNumber()).isNull();
+    });
+
+    m_sync->update(snapshot({2}));
+
+    QCOMPARE(countInSlot, 1);
+    QVERIFY(!removedStillFound);
+}
+
+void TestInventorySync::removeAll()
+{
+    m_sync->update(snapshot({1, 2}));
+    m_events.clear();
+
+    QSignalSpy synced(m_sync, &QHR::InventorySync::synced);
+    QSignalSpy countChanged(m_sync, &QHR::InventorySync::serverCountChanged);
+
+    m_sync->update(QJsonArray());
+
+    QCOMPARE(m_events, QStringList({QStringLiteral("removed:1"), QStringLiteral("removed:2")}));
+    QCOMPARE(synced.first(), QVariantList({0, 2, 0}));
+    QCOMPARE(countChanged.size(), 1);
+    QCOMPARE(countChanged.first().first().toInt(), 0);
+    QVERIFY(m_sync->servers().isEmpty());
+}
+
+void TestInventorySync::skipInvalidRecords()
+{
+    QJsonArray array;
+    array.append(server(2));
+    // not wrapped into a server object
+    array.append(server(1).value(QStringLiteral("server")));
+    array.append(QJsonObject{{QStringLiteral("server"), QJsonObject{{QStringLiteral("server_name"), QStringLiteral("no number")}}}});
+    array.append(QJsonObject{{QStringLiteral("server"), QJsonObject{{QStringLiteral("server_number"), -5}}}});
+    array.append(QStringLiteral("not an object"));
+    // the first record of a duplicate server number wins
+    array.append(server(2, QStringLiteral("duplicate")));
+
+    QSignalSpy synced(m_sync, &QHR::InventorySync::synced);
+    m_sync->update(array);
+
+    QCOMPARE(synced.first(), QVariantList({2, 0, 0}));
+    QCOMPARE(m_sync->serverCount(), 2);
+    QCOMPARE(m_sync->server(1).serverName(), QStringLiteral("server1"));
+    QCOMPARE(m_sync->server(2).status(), QStringLiteral("ready"));
+}
+
+void TestInventorySync::syncFromServer()
+{
+    QSignalSpy synced(m_sync, &QHR::InventorySync::synced);
+
+    m_sync->sync();
+    QVERIFY(m_sync->isSyncing());
+    // a running sync is not started twice
+    m_sync->sync();
+
+    QVERIFY(synced.wait(5000));
+    QVERIFY(!m_sync->isSyncing());
+    QCOMPARE(synced.first(), QVariantList({10, 0, 0}));
+    QCOMPARE(m_sync->serverCount(), 10);
+    QCOMPARE(m_sync->servers().first().serverNumber(), 100000);
+
+    m_server.setServerCount(8);
+    m_sync->sync();
+    QVERIFY(synced.wait(5000));
+    QCOMPARE(synced.at(1), QVariantList({0, 2, 0}));
+    QCOMPARE(m_sync->generation(), Q_UINT64_C(2));
+}
+
+void TestInventorySync::syncFailed()
+{
+    m_sync->update(snapshot({1}));
+    m_server.setMaintenance(true);
+
+    QSignalSpy failed(m_sync, &QHR::InventorySync::syncFailed);
+    QSignalSpy synced(m_sync, &QHR::InventorySync::synced);
+    m_sync->sync();
+
+    QVERIFY(failed.wait(5000));
+    QCOMPARE(failed.first().first().toInt(), static_cast<int>(QHR::ServerMaintenance));
+    QVERIFY(synced.isEmpty());
+    // the previous snapshot is kept
+    QCOMPARE(m_sync->serverCount(), 1);
+    QCOMPARE(m_sync->generation(), Q_UINT64_C(1));
+}
+
+QTEST_MAIN(TestInventorySync)
+
+#include "testinventorysync.moc"
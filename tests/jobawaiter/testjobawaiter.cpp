@@ -0,0 +1,191 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "job.h"
+#include "job_p.h"
+#include "getserversjob.h"
+#include "abstractconfiguration.h"
+#include "jobawaiter.h"
+#include "mockrobotserver.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QUrl>
+
+/*
+ * Awaits jobs running against the local MockRobotServer in coroutines. This test is
+ * built with C++20, so it is the part of the build that compiles QHR/JobAwaiter.
+ */
+
+class TestConfig : public QHR::AbstractConfiguration
+{
+    Q_OBJECT
+public:
+    explicit TestConfig(const QUrl &baseUrl, QObject *parent = nullptr) : QHR::AbstractConfiguration(parent), m_baseUrl(baseUrl) {}
+
+    QString username() const override { return QStringLiteral("#ws+mock"); }
+    QString password() const override { return QStringLiteral("mock"); }
+    QUrl baseUrl() const override { return m_baseUrl; }
+
+private:
+    QUrl m_baseUrl;
+};
+
+class TestJobPrivate : public QHR::JobPrivate
+{
+public:
+    TestJobPrivate(QHR::Job *q, const QString &path) : QHR::JobPrivate(q), path(path)
+    {
+        namOperation = QHR::NetworkOperation::Get;
+        expectedContentType = QHR::ExpectedContentType::JsonArray;
+    }
+
+    QString buildUrlPath() const override { return path; }
+
+    QString path;
+};
+
+class TestJob : public QHR::Job
+{
+    Q_OBJECT
+public:
+    TestJob(const QString &path, QHR::AbstractConfiguration *config, QObject *parent = nullptr) : QHR::Job(*new TestJobPrivate(this, path), parent)
+    {
+        setConfiguration(config);
+    }
+
+    void start() override { QTimer::singleShot(0, this, &TestJob::sendRequest); }
+};
+
+class TestJobAwaiter : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void awaitResult();
+    void awaitGetter();
+    void awaitError();
+    void awaitDestroyedJob();
+
+private:
+#if defined(QHR_HAS_COROUTINES)
+    QHR::Task awaitDocument(TestJob *job);
+    QHR::Task awaitServers(QHR::GetServersJob *job);
+#endif
+
+    QHR::MockRobotServer m_server;
+    TestConfig *m_config = nullptr;
+    QJsonDocument m_document;
+    QHR::ServerList m_servers;
+    QHR::JobError m_error;
+    bool m_done = false;
+};
+
+void TestJobAwaiter::initTestCase()
+{
+#if !defined(QHR_HAS_COROUTINES)
+    QSKIP("The compiler does not support coroutines.");
+#endif
+    QVERIFY(m_server.start());
+    m_config = new TestConfig(m_server.baseUrl(), this);
+}
+
+void TestJobAwaiter::init()
+{
+    m_document = QJsonDocument();
+    m_servers = QHR::ServerList();
+    m_error = QHR::JobError();
+    m_done = false;
+}
+
+void TestJobAwaiter::cleanup()
+{
+    m_server.setLatency(0);
+    m_server.setMaintenance(false);
+}
+
+#if defined(QHR_HAS_COROUTINES)
+QHR::Task TestJobAwaiter::awaitDocument(TestJob *job)
+{
+    const auto result = co_await QHR::awaitJob(job);
+    m_document = result.value;
+    m_error = result.error;
+    m_done = true;
+}
+
+QHR::Task TestJobAwaiter::awaitServers(QHR::GetServersJob *job)
+{
+    const auto result = co_await QHR::awaitJob(job, &QHR::GetServersJob::servers);
+    m_servers = result.value;
+    m_error = result.error;
+    m_done = true;
+}
+#endif
+
+void TestJobAwaiter::awaitResult()
+{
+#if defined(QHR_HAS_COROUTINES)
+    awaitDocument(new TestJob(QStringLiteral("/server"), m_config));
+    QVERIFY(!m_done);
+
+    QTRY_VERIFY(m_done);
+    QCOMPARE(m_error.code(), static_cast<int>(QHR::BJob::NoError));
+    QCOMPARE(m_document.array().size(), m_server.serverCount());
+#endif
+}
+
+void TestJobAwaiter::awaitGetter()
+{
+#if defined(QHR_HAS_COROUTINES)
+    auto job = new QHR::GetServersJob;
+    job->setConfiguration(m_config);
+    awaitServers(job);
+
+    QTRY_VERIFY(m_done);
+    QCOMPARE(m_error.code(), static_cast<int>(QHR::BJob::NoError));
+    QCOMPARE(m_servers.size(), m_server.serverCount());
+#endif
+}
+
+void TestJobAwaiter::awaitError()
+{
+#if defined(QHR_HAS_COROUTINES)
+    m_server.setMaintenance(true);
+    auto job = new TestJob(QStringLiteral("/server"), m_config);
+    job->setRetryPolicy(QHR::RetryPolicy(1));
+    awaitDocument(job);
+
+    QTRY_VERIFY(m_done);
+    QCOMPARE(m_error.code(), static_cast<int>(QHR::ServerMaintenance));
+    QCOMPARE(m_error.apiErrorCode(), QStringLiteral("MAINTENANCE"));
+    QVERIFY(m_document.isNull());
+#endif
+}
+
+void TestJobAwaiter::awaitDestroyedJob()
+{
+#if defined(QHR_HAS_COROUTINES)
+    m_server.setLatency(200);
+    const quint64 requests = m_server.requestCount();
+    auto job = new TestJob(QStringLiteral("/ip"), m_config);
+    awaitDocument(job);
+
+    QTRY_COMPARE(m_server.requestCount() - requests, static_cast<quint64>(1));
+    QVERIFY(!m_done);
+
+    delete job;
+
+    QVERIFY(m_done);
+    QCOMPARE(m_error.code(), static_cast<int>(QHR::BJob::KilledJobError));
+    QVERIFY(!m_error.errorString().isEmpty());
+#endif
+}
+
+QTEST_MAIN(TestJobAwaiter)
+
+#include "testjobawaiter.moc"
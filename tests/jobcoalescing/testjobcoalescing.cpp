@@ -0,0 +1,239 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "job.h"
+#include "job_p.h"
+#include "abstractconfiguration.h"
+#include "abstractnamfactory.h"
+#include "retrypolicy.h"
+#include "mockrobotserver.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QNetworkAccessManager>
+#include <QPointer>
+#include <QUrl>
+
+/*
+ * Drives coalesced GET requests against the local MockRobotServer. Jobs that request
+ * the same resource while a request is in flight have to share it, and the waiting
+ * jobs have to finish even if the leading job is deleted or killed early.
+ */
+
+class TestConfig : public QHR::AbstractConfiguration
+{
+    Q_OBJECT
+public:
+    explicit TestConfig(const QUrl &baseUrl, QObject *parent = nullptr) : QHR::AbstractConfiguration(parent), m_baseUrl(baseUrl) {}
+
+    QString username() const override { return QStringLiteral("#ws+mock"); }
+    QString password() const override { return QStringLiteral("mock"); }
+    QUrl baseUrl() const override { return m_baseUrl; }
+
+private:
+    QUrl m_baseUrl;
+};
+
+class TestJobPrivate : public QHR::JobPrivate
+{
+public:
+    TestJobPrivate(QHR::Job *q, const QString &path) : QHR::JobPrivate(q), path(path)
+    {
+        namOperation = QHR::NetworkOperation::Get;
+        expectedContentType = QHR::ExpectedContentType::JsonArray;
+    }
+
+    QString buildUrlPath() const override { return path; }
+
+    QString path;
+};
+
+class TestJob : public QHR::Job
+{
+    Q_OBJECT
+public:
+    TestJob(const QString &path, QHR::AbstractConfiguration *config, QObject *parent = nullptr) : QHR::Job(*new TestJobPrivate(this, path), parent)
+    {
+        setAutoDelete(false);
+        setConfiguration(config);
+    }
+
+    void start() override { QTimer::singleShot(0, this, &TestJob::sendRequest); }
+
+    using QHR::Job::sendRequest;
+};
+
+class ChildNamFactory : public QHR::AbstractNamFactory
+{
+public:
+    QNetworkAccessManager *create(QObject *parent) override { return new QNetworkAccessManager(parent); }
+};
+
+class TestJobCoalescing : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+
+    void coalesceIdenticalRequests();
+    void handOverReplyOnDelete();
+    void resendWithFactoryNam();
+    void resendAfterKillDuringRetry();
+    void followerDeletesSibling();
+
+private:
+    QHR::MockRobotServer m_server;
+    TestConfig *m_config = nullptr;
+};
+
+void TestJobCoalescing::initTestCase()
+{
+    QVERIFY(m_server.start());
+    m_config = new TestConfig(m_server.baseUrl(), this);
+}
+
+void TestJobCoalescing::cleanup()
+{
+    QHR::setNetworkAccessManagerFactory(nullptr);
+    m_server.setLatency(0);
+    m_server.setMaintenance(false);
+}
+
+void TestJobCoalescing::coalesceIdenticalRequests()
+{
+    m_server.setLatency(100);
+    const quint64 requests = m_server.requestCount();
+
+    TestJob leader(QStringLiteral("/server"), m_config);
+    TestJob follower1(QStringLiteral("/server"), m_config);
+    TestJob follower2(QStringLiteral("/server"), m_config);
+    QSignalSpy leaderSpy(&leader, &QHR::Job::succeeded);
+    QSignalSpy follower1Spy(&follower1, &QHR::Job::succeeded);
+    QSignalSpy follower2Spy(&follower2, &QHR::Job::succeeded);
+
+    leader.sendRequest();
+    follower1.sendRequest();
+    follower2.sendRequest();
+
+    QTRY_COMPARE(follower2Spy.count(), 1);
+    QCOMPARE(leaderSpy.count(), 1);
+    QCOMPARE(follower1Spy.count(), 1);
+    QCOMPARE(m_server.requestCount() - requests, static_cast<quint64>(1));
+    QCOMPARE(follower1.result(), leader.result());
+    QCOMPARE(follower2.result().array().size(), m_server.serverCount());
+}
+
+void TestJobCoalescing::handOverReplyOnDelete()
+{
+    m_server.setLatency(200);
+    const quint64 requests = m_server.requestCount();
+
+    auto leader = new TestJob(QStringLiteral("/ip"), m_config);
+    TestJob follower1(QStringLiteral("/ip"), m_config);
+    TestJob follower2(QStringLiteral("/ip"), m_config);
+    QSignalSpy follower1Spy(&follower1, &QHR::BJob::result);
+    QSignalSpy follower2Spy(&follower2, &QHR::BJob::result);
+
+    leader->sendRequest();
+    follower1.sendRequest();
+    follower2.sendRequest();
+
+    QTRY_COMPARE(m_server.requestCount() - requests, static_cast<quint64>(1));
+    delete leader;
+
+    QTRY_COMPARE(follower2Spy.count(), 1);
+    QCOMPARE(follower1Spy.count(), 1);
+    QCOMPARE(follower1.error(), static_cast<int>(QHR::BJob::NoError));
+    QCOMPARE(follower2.error(), static_cast<int>(QHR::BJob::NoError));
+    QCOMPARE(m_server.requestCount() - requests, static_cast<quint64>(1));
+}
+
+void TestJobCoalescing::resendWithFactoryNam()
+{
+    ChildNamFactory factory;
+    QHR::setNetworkAccessManagerFactory(&factory);
+    m_server.setLatency(200);
+    const quint64 requests = m_server.requestCount();
+
+    auto leader = new TestJob(QStringLiteral("/subnet"), m_config);
+    TestJob follower1(QStringLiteral("/subnet"), m_config);
+    TestJob follower2(QStringLiteral("/subnet"), m_config);
+    QSignalSpy follower1Spy(&follower1, &QHR::BJob::result);
+    QSignalSpy follower2Spy(&follower2, &QHR::BJob::result);
+
+    leader->sendRequest();
+    follower1.sendRequest();
+    follower2.sendRequest();
+
+    QTRY_COMPARE(m_server.requestCount() - requests, static_cast<quint64>(1));
+
+    // the reply dies together with the manager owned by the leader
+    delete leader;
+
+    QTRY_COMPARE(follower2Spy.count(), 1);
+    QCOMPARE(follower1Spy.count(), 1);
+    QCOMPARE(follower1.error(), static_cast<int>(QHR::BJob::NoError));
+    QCOMPARE(follower2.error(), static_cast<int>(QHR::BJob::NoError));
+    QCOMPARE(m_server.requestCount() - requests, static_cast<quint64>(2));
+}
+
+void TestJobCoalescing::resendAfterKillDuringRetry()
+{
+    m_server.setMaintenance(true);
+    const quint64 requests = m_server.requestCount();
+
+    QHR::RetryPolicy policy(3);
+    policy.setInitialDelay(5000);
+    policy.setJitter(0.0);
+
+    TestJob leader(QStringLiteral("/failover"), m_config);
+    leader.setRetryPolicy(policy);
+    TestJob follower(QStringLiteral("/failover"), m_config);
+    QSignalSpy leaderSpy(&leader, &QHR::BJob::result);
+    QSignalSpy followerSpy(&follower, &QHR::BJob::result);
+    QSignalSpy infoSpy(&leader, &QHR::BJob::infoMessage);
+
+    leader.sendRequest();
+    follower.sendRequest();
+
+    // wait until the leader has no reply and waits for the retry
+    QTRY_VERIFY(!infoSpy.empty() && infoSpy.last().at(1).toString() == qtTrId("libqhr-info-msg-req-retry"));
+    m_server.setMaintenance(false);
+    QVERIFY(leader.kill());
+
+    QTRY_COMPARE(followerSpy.count(), 1);
+    QCOMPARE(follower.error(), static_cast<int>(QHR::BJob::NoError));
+    QCOMPARE(m_server.requestCount() - requests, static_cast<quint64>(2));
+    QCOMPARE(leaderSpy.count(), 0);
+}
+
+void TestJobCoalescing::followerDeletesSibling()
+{
+    m_server.setLatency(100);
+
+    TestJob leader(QStringLiteral("/reset"), m_config);
+    TestJob follower1(QStringLiteral("/reset"), m_config);
+    QPointer<TestJob> follower2 = new TestJob(QStringLiteral("/reset"), m_config);
+    TestJob follower3(QStringLiteral("/reset"), m_config);
+    QSignalSpy follower3Spy(&follower3, &QHR::Job::succeeded);
+
+    connect(&follower1, &QHR::Job::succeeded, this, [follower2](){
+        delete follower2.data();
+    });
+
+    leader.sendRequest();
+    follower1.sendRequest();
+    follower2->sendRequest();
+    follower3.sendRequest();
+
+    QTRY_COMPARE(follower3Spy.count(), 1);
+    QVERIFY(follower2.isNull());
+    QCOMPARE(follower3.result(), leader.result());
+}
+
+QTEST_MAIN(TestJobCoalescing)
+
+#include "testjobcoalescing.moc"
@@ -0,0 +1,382 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "jobgroup.h"
+#include "job.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <algorithm>
+
+/*
+ * Runs groups of local jobs that finish after a timer with JobGroup and checks the
+ * concurrency limit, the failure modes and the aggregated result.
+ */
+
+struct JobTracker
+{
+    int started = 0;
+    int running = 0;
+    int maxRunning = 0;
+};
+
+class TestJob : public QHR::BJob
+{
+    Q_OBJECT
+public:
+    // a negative delay finishes the job synchronously inside start()
+    TestJob(JobTracker *tracker, int delay, int error = NoError) : QHR::BJob(), m_tracker(tracker), m_delay(delay), m_error(error)
+    {
+        setCapabilities(Killable);
+        m_timer.setSingleShot(true);
+        connect(&m_timer, &QTimer::timeout, this, &TestJob::done);
+    }
+
+    void start() override
+    {
+        m_started = true;
+        ++m_tracker->started;
+        ++m_tracker->running;
+        m_tracker->maxRunning = std::max(m_tracker->maxRunning, m_tracker->running);
+        if (m_delay < 0) {
+            done();
+        } else {
+            m_timer.start(m_delay);
+        }
+    }
+
+    bool isStarted() const { return m_started; }
+    bool isKilled() const { return m_killed; }
+
+protected:
+    bool doKill() override
+    {
+        m_timer.stop();
+        m_killed = true;
+        --m_tracker->running;
+        return true;
+    }
+
+private:
+    void done()
+    {
+        --m_tracker->running;
+        if (m_error != NoError) {
+            setError(m_error);
+            setErrorText(QStringLiteral("job failed after %1 ms").arg(m_delay));
+        }
+        emitResult();
+    }
+
+    QTimer m_timer;
+    JobTracker *m_tracker;
+    int m_delay;
+    int m_error;
+    bool m_started = false;
+    bool m_killed = false;
+};
+
+class TestJobGroup : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void emptyGroup();
+    void collectAll();
+    void concurrencyLimit_data();
+    void concurrencyLimit();
+    void raiseLimitWhileRunning();
+    void synchronousJobs();
+    void failFast();
+    void failFastWithoutRunningJobs();
+    void addWhileRunning();
+    void killGroup();
+    void exec();
+
+private:
+    static TestJob *addJob(QHR::JobGroup *group, JobTracker *tracker, int delay, int error = QHR::BJob::NoError);
+};
+
+TestJob *TestJobGroup::addJob(QHR::JobGroup *group, JobTracker *tracker, int delay, int error)
+{
+    auto job = new TestJob(tracker, delay, error);
+    group->addJob(job);
+    return job;
+}
+
+void TestJobGroup::emptyGroup()
+{
+    QHR::JobGroup group;
+    group.setAutoDelete(false);
+    QSignalSpy result(&group, &QHR::BJob::result);
+    group.start();
+
+    QVERIFY(result.wait(1000));
+    QCOMPARE(group.error(), static_cast<int>(QHR::BJob::NoError));
+    QCOMPARE(group.finishedCount(), 0);
+}
+
+void TestJobGroup::collectAll()
+{
+    JobTracker tracker;
+    QHR::JobGroup group;
+    group.setAutoDelete(false);
+    QCOMPARE(group.failureMode(), QHR::JobGroup::CollectAll);
+
+    addJob(&group, &tracker, 10);
+    TestJob *failedLate = addJob(&group, &tracker, 60, QHR::NotFound);
+    addJob(&group, &tracker, 20);
+    TestJob *failedEarly = addJob(&group, &tracker, 30, QHR::InvalidInput);
+    addJob(&group, &tracker, 40);
+
+    // the group owns the jobs
+    QCOMPARE(failedLate->parent(), static_cast<QObject*>(&group));
+    QVERIFY(!failedLate->isAutoDelete());
+    QCOMPARE(group.totalAmount(QHR::BJob::Items), Q_UINT64_C(5));
+
+    QList<QHR::BJob*> finished;
+    connect(&group, &QHR::JobGroup::jobFinished, this, [&finished](QHR::BJob *job){
+        finished << job;
+    });
+    QSignalSpy result(&group, &QHR::BJob::result);
+    group.start();
+
+    QVERIFY(result.wait(5000));
+    QTest::qWait(50);
+    QCOMPARE(result.size(), 1);
+    QCOMPARE(tracker.started, 5);
+    QCOMPARE(finished.size(), 5);
+    QCOMPARE(group.finishedCount(), 5);
+    QCOMPARE(group.processedAmount(QHR::BJob::Items), Q_UINT64_C(5));
+
+    // failed jobs in the order they have been finished
+    QCOMPARE(group.error(), static_cast<int>(QHR::SubJobsFailed));
+    QCOMPARE(group.failedJobs(), QList<QHR::BJob*>({failedEarly, failedLate}));
+    QCOMPARE(group.errorText(), failedEarly->errorString());
+    QVERIFY(!group.errorString().isEmpty());
+    QCOMPARE(group.jobs().size(), 5);
+    QCOMPARE(group.jobs().at(1), static_cast<QHR::BJob*>(failedLate));
+}
+
+void TestJobGroup::concurrencyLimit_data()
+{
+    QTest::addColumn<int>("maxInFlight");
+    QTest::addColumn<int>("expected");
+
+    QTest::newRow("sequential") << 1 << 1;
+    QTest::newRow("two") << 2 << 2;
+    QTest::newRow("default") << 6 << 6;
+    QTest::newRow("more-than-jobs") << 20 << 8;
+    QTest::newRow("unlimited") << 0 << 8;
+}
+
+void TestJobGroup::concurrencyLimit()
+{
+    QFETCH(int, maxInFlight);
+    QFETCH(int, expected);
+
+    JobTracker tracker;
+    QHR::JobGroup group;
+    group.setAutoDelete(false);
+    group.setMaxInFlight(maxInFlight);
+    for (int i = 0; i < 8; ++i) {
+        addJob(&group, &tracker, 10 + i % 3 * 10);
+    }
+
+    QSignalSpy result(&group, &QHR::BJob::result);
+    group.start();
+
+    QVERIFY(result.wait(5000));
+    QCOMPARE(group.error(), static_cast<int>(QHR::BJob::NoError));
+    QCOMPARE(tracker.started, 8);
+    QCOMPARE(tracker.running, 0);
+    QCOMPARE(tracker.maxRunning, expected);
+}
+
+void TestJobGroup::raiseLimitWhileRunning()
+{
+    JobTracker tracker;
+    QHR::JobGroup group;
+    group.setAutoDelete(false);
+    group.setMaxInFlight(1);
+    for (int i = 0; i < 4; ++i) {
+        addJob(&group, &tracker, 100);
+    }
+
+    QSignalSpy maxInFlightChanged(&group, &QHR::JobGroup::maxInFlightChanged);
+    QSignalSpy result(&group, &QHR::BJob::result);
+    group.start();
+    QTRY_COMPARE(tracker.started, 1);
+
+    // the new limit is applied immediately
+    group.setMaxInFlight(3);
+    QCOMPARE(maxInFlightChanged.size(), 1);
+    QCOMPARE(tracker.started, 3);
+    QCOMPARE(tracker.running, 3);
+
+    QVERIFY(result.wait(5000));
+    QCOMPARE(tracker.started, 4);
+    QCOMPARE(tracker.maxRunning, 3);
+}
+
+void TestJobGroup::synchronousJobs()
+{
+    JobTracker tracker;
+    QHR::JobGroup group;
+    group.setAutoDelete(false);
+    group.setMaxInFlight(2);
+    for (int i = 0; i < 50; ++i) {
+        addJob(&group, &tracker, -1, i == 10 ? static_cast<int>(QHR::NotFound) : static_cast<int>(QHR::BJob::NoError));
+    }
+
+    QSignalSpy result(&group, &QHR::BJob::result);
+    group.start();
+
+    QVERIFY(result.wait(1000));
+    QCOMPARE(result.size(), 1);
+    QCOMPARE(tracker.started, 50);
+    QCOMPARE(tracker.maxRunning, 1);
+    QCOMPARE(group.finishedCount(), 50);
+    QCOMPARE(group.failedJobs().size(), 1);
+    QCOMPARE(group.error(), static_cast<int>(QHR::SubJobsFailed));
+}
+
+void TestJobGroup::failFast()
+{
+    JobTracker tracker;
+    QHR::JobGroup group;
+    group.setAutoDelete(false);
+    group.setFailureMode(QHR::JobGroup::FailFast);
+    group.setMaxInFlight(2);
+
+    TestJob *failing = addJob(&group, &tracker, 20, QHR::NotFound);
+    TestJob *running = addJob(&group, &tracker, 1000);
+    TestJob *pending = addJob(&group, &tracker, 10);
+    addJob(&group, &tracker, 10);
+
+    QSignalSpy result(&group, &QHR::BJob::result);
+    QElapsedTimer timer;
+    timer.start();
+    group.start();
+
+    QVERIFY(result.wait(5000));
+    // the group does not wait for the long running job
+    QVERIFY(timer.elapsed() < 900);
+    QCOMPARE(group.error(), static_cast<int>(QHR::SubJobsFailed));
+    QCOMPARE(group.failedJobs(), QList<QHR::BJob*>({failing}));
+    QCOMPARE(group.errorText(), failing->errorString());
+    QVERIFY(running->isKilled());
+    QVERIFY(!pending->isStarted());
+    QCOMPARE(tracker.started, 2);
+    QCOMPARE(tracker.running, 0);
+    QCOMPARE(group.finishedCount(), 1);
+
+    // no further results after the jobs have been killed
+    QTest::qWait(100);
+    QCOMPARE(result.size(), 1);
+}
+
+void TestJobGroup::failFastWithoutRunningJobs()
+{
+    JobTracker tracker;
+    QHR::JobGroup group;
+    group.setAutoDelete(false);
+    group.setFailureMode(QHR::JobGroup::FailFast);
+    group.setMaxInFlight(1);
+
+    addJob(&group, &tracker, 10);
+    TestJob *failing = addJob(&group, &tracker, 10, QHR::NotFound);
+    TestJob *pending = addJob(&group, &tracker, 10);
+
+    QSignalSpy result(&group, &QHR::BJob::result);
+    group.start();
+
+    QVERIFY(result.wait(5000));
+    QCOMPARE(group.failedJobs(), QList<QHR::BJob*>({failing}));
+    QVERIFY(!pending->isStarted());
+    QCOMPARE(group.finishedCount(), 2);
+}
+
+void TestJobGroup::addWhileRunning()
+{
+    JobTracker tracker;
+    QHR::JobGroup group;
+    group.setAutoDelete(false);
+    addJob(&group, &tracker, 50);
+
+    QSignalSpy result(&group, &QHR::BJob::result);
+    group.start();
+    QTRY_COMPARE(tracker.started, 1);
+
+    // jobs added to a running group are started immediately
+    TestJob *added = addJob(&group, &tracker, 10);
+    QVERIFY(added->isStarted());
+    QCOMPARE(group.totalAmount(QHR::BJob::Items), Q_UINT64_C(2));
+
+    QVERIFY(result.wait(5000));
+    QCOMPARE(group.finishedCount(), 2);
+    QCOMPARE(group.error(), static_cast<int>(QHR::BJob::NoError));
+
+    // but not to a finished one
+    TestJob late(&tracker, 10);
+    group.addJob(&late);
+    QCOMPARE(group.jobs().size(), 2);
+    QVERIFY(late.parent() == nullptr);
+}
+
+void TestJobGroup::killGroup()
+{
+    JobTracker tracker;
+    QHR::JobGroup group;
+    group.setAutoDelete(false);
+    group.setMaxInFlight(2);
+    TestJob *first = addJob(&group, &tracker, 1000);
+    TestJob *second = addJob(&group, &tracker, 1000);
+    TestJob *pending = addJob(&group, &tracker, 1000);
+
+    QSignalSpy result(&group, &QHR::BJob::result);
+    group.start();
+    QTRY_COMPARE(tracker.running, 2);
+
+    QVERIFY(group.kill(QHR::BJob::EmitResult));
+    QCOMPARE(result.size(), 1);
+    QCOMPARE(group.error(), static_cast<int>(QHR::BJob::KilledJobError));
+    QVERIFY(first->isKilled());
+    QVERIFY(second->isKilled());
+    QVERIFY(!pending->isStarted());
+    QCOMPARE(tracker.running, 0);
+
+    QTest::qWait(100);
+    QCOMPARE(result.size(), 1);
+    QVERIFY(!pending->isStarted());
+}
+
+void TestJobGroup::exec()
+{
+    JobTracker tracker;
+    {
+        QHR::JobGroup group;
+        group.setAutoDelete(false);
+        group.setMaxInFlight(2);
+        for (int i = 0; i < 4; ++i) {
+            addJob(&group, &tracker, 10);
+        }
+        QVERIFY(group.exec());
+        QCOMPARE(group.finishedCount(), 4);
+    }
+
+    QHR::JobGroup group;
+    group.setAutoDelete(false);
+    addJob(&group, &tracker, 10);
+    addJob(&group, &tracker, 20, QHR::NotFound);
+    QVERIFY(!group.exec());
+    QCOMPARE(group.error(), static_cast<int>(QHR::SubJobsFailed));
+    QCOMPARE(group.finishedCount(), 2);
+}
+
+QTEST_MAIN(TestJobGroup)
+
+#include "testjobgroup.moc"
@@ -0,0 +1,137 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "job.h"
+#include "job_p.h"
+#include "abstractconfiguration.h"
+#include "mockrobotserver.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QPointer>
+#include <QUrl>
+
+/*
+ * Streams the server list of the local MockRobotServer. A slot connected to
+ * itemReceived() may delete or kill the job, no further item must be emitted then.
+ */
+
+class TestConfig : public QHR::AbstractConfiguration
+{
+    Q_OBJECT
+public:
+    explicit TestConfig(const QUrl &baseUrl, QObject *parent = nullptr) : QHR::AbstractConfiguration(parent), m_baseUrl(baseUrl) {}
+
+    QString username() const override { return QStringLiteral("#ws+mock"); }
+    QString password() const override { return QStringLiteral("mock"); }
+    QUrl baseUrl() const override { return m_baseUrl; }
+
+private:
+    QUrl m_baseUrl;
+};
+
+class TestJobPrivate : public QHR::JobPrivate
+{
+public:
+    TestJobPrivate(QHR::Job *q, const QString &path) : QHR::JobPrivate(q), path(path)
+    {
+        namOperation = QHR::NetworkOperation::Get;
+        expectedContentType = QHR::ExpectedContentType::JsonArray;
+    }
+
+    QString buildUrlPath() const override { return path; }
+
+    QString path;
+};
+
+class TestJob : public QHR::Job
+{
+    Q_OBJECT
+public:
+    TestJob(const QString &path, QHR::AbstractConfiguration *config, QObject *parent = nullptr) : QHR::Job(*new TestJobPrivate(this, path), parent)
+    {
+        setAutoDelete(false);
+        setConfiguration(config);
+        setStreamingEnabled(true);
+    }
+
+    void start() override { QTimer::singleShot(0, this, &TestJob::sendRequest); }
+
+    using QHR::Job::sendRequest;
+};
+
+class TestJobStreaming : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+
+    void streamItems();
+    void deleteInItemSlot();
+    void killInItemSlot();
+
+private:
+    QHR::MockRobotServer m_server;
+    TestConfig *m_config = nullptr;
+};
+
+void TestJobStreaming::initTestCase()
+{
+    QVERIFY(m_server.start());
+    QVERIFY(m_server.serverCount() > 1);
+    m_config = new TestConfig(m_server.baseUrl(), this);
+}
+
+void TestJobStreaming::streamItems()
+{
+    TestJob job(QStringLiteral("/server"), m_config);
+    QSignalSpy itemSpy(&job, &QHR::Job::itemReceived);
+    QSignalSpy succeededSpy(&job, &QHR::Job::succeeded);
+
+    job.sendRequest();
+
+    QTRY_COMPARE(succeededSpy.count(), 1);
+    QCOMPARE(itemSpy.count(), m_server.serverCount());
+}
+
+void TestJobStreaming::deleteInItemSlot()
+{
+    QPointer<TestJob> job = new TestJob(QStringLiteral("/server"), m_config);
+    int items = 0;
+    connect(job.data(), &QHR::Job::itemReceived, this, [&items, &job](){
+        ++items;
+        delete job.data();
+    });
+
+    job->sendRequest();
+
+    QTRY_VERIFY(job.isNull());
+    QTest::qWait(100);
+    QCOMPARE(items, 1);
+}
+
+void TestJobStreaming::killInItemSlot()
+{
+    TestJob job(QStringLiteral("/server"), m_config);
+    QSignalSpy succeededSpy(&job, &QHR::Job::succeeded);
+    QSignalSpy failedSpy(&job, &QHR::Job::failed);
+    int items = 0;
+    connect(&job, &QHR::Job::itemReceived, this, [&items, &job](){
+        ++items;
+        job.kill();
+    });
+
+    job.sendRequest();
+
+    QTRY_COMPARE(items, 1);
+    QTest::qWait(100);
+    QCOMPARE(items, 1);
+    QVERIFY(succeededSpy.isEmpty());
+    QVERIFY(failedSpy.isEmpty());
+}
+
+QTEST_MAIN(TestJobStreaming)
+
+#include "testjobstreaming.moc"
@@ -0,0 +1,214 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "job.h"
+#include "job_p.h"
+#include "abstractconfiguration.h"
+#include "mockrobotserver.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QUrl>
+#include <QUrlQuery>
+#include <algorithm>
+#include <cstdio>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+/*
+ * Drives a large number of concurrent jobs through the full client stack against
+ * the local MockRobotServer and reports throughput, latency percentiles and the
+ * peak resident set size of the process.
+ */
+
+class LoadConfig : public QHR::AbstractConfiguration
+{
+    Q_OBJECT
+public:
+    LoadConfig(const QUrl &baseUrl, const QString &username, const QString &password, QObject *parent = nullptr)
+        : QHR::AbstractConfiguration(parent), m_baseUrl(baseUrl), m_username(username), m_password(password)
+    {}
+
+    bool http2 = false;
+    bool pipelining = false;
+
+    QString username() const override { return m_username; }
+    QString password() const override { return m_password; }
+    QUrl baseUrl() const override { return m_baseUrl; }
+    bool isHttp2Allowed() const override { return http2; }
+    bool isPipeliningAllowed() const override { return pipelining; }
+
+private:
+    QUrl m_baseUrl;
+    QString m_username;
+    QString m_password;
+};
+
+class LoadJobPrivate : public QHR::JobPrivate
+{
+public:
+    LoadJobPrivate(QHR::Job *q, const QString &path, const QUrlQuery &query) : QHR::JobPrivate(q), path(path), query(query)
+    {
+        namOperation = QHR::NetworkOperation::Get;
+        expectedContentType = QHR::ExpectedContentType::JsonObject;
+    }
+
+    QString buildUrlPath() const override { return path; }
+
+    QUrlQuery buildUrlQuery() const override { return query; }
+
+    QString path;
+    QUrlQuery query;
+};
+
+class LoadJob : public QHR::Job
+{
+    Q_OBJECT
+public:
+    LoadJob(const QString &path, const QUrlQuery &query, QObject *parent = nullptr) : QHR::Job(*new LoadJobPrivate(this, path, query), parent) {}
+
+    void start() override { QTimer::singleShot(0, this, &LoadJob::sendRequest); }
+};
+
+static qint64 peakRssKiB()
+{
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(Q_OS_DARWIN)
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return -1;
+}
+
+static double percentile(const QVector<qint64> &sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    const int idx = std::min(sorted.size() - 1, static_cast<int>(p * sorted.size()));
+    return sorted.at(idx) / 1000.0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName(QStringLiteral("qhrloadtest"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Load test for libqhr against a local mock Robot server."));
+    parser.addHelpOption();
+    parser.addOptions({
+        {QStringLiteral("jobs"), QStringLiteral("Number of jobs to run."), QStringLiteral("count"), QStringLiteral("20000")},
+        {QStringLiteral("servers"), QStringLiteral("Number of servers in the fixture data."), QStringLiteral("count"), QStringLiteral("1000")},
+        {QStringLiteral("latency"), QStringLiteral("Server latency in milliseconds."), QStringLiteral("msecs"), QStringLiteral("0")},
+        {QStringLiteral("jitter"), QStringLiteral("Maximum random additional server latency in milliseconds."), QStringLiteral("msecs"), QStringLiteral("0")},
+        {QStringLiteral("error-rate"), QStringLiteral("Fraction of requests answered with INTERNAL_ERROR."), QStringLiteral("rate"), QStringLiteral("0")},
+        {QStringLiteral("rate-limit"), QStringLiteral("Requests per interval allowed by the server, 0 to disable."), QStringLiteral("count"), QStringLiteral("0")},
+        {QStringLiteral("rate-interval"), QStringLiteral("Rate limit interval in seconds."), QStringLiteral("secs"), QStringLiteral("1")},
+        {QStringLiteral("tls"), QStringLiteral("Use TLS with a self-signed certificate.")},
+        {QStringLiteral("http2"), QStringLiteral("Allow HTTP/2, the mock server will refuse it.")},
+        {QStringLiteral("pipelining"), QStringLiteral("Allow HTTP/1.1 pipelining.")},
+        {QStringLiteral("min-success"), QStringLiteral("Exit with failure if less than this fraction of jobs succeeds."), QStringLiteral("rate"), QStringLiteral("0")}
+    });
+    parser.process(app);
+
+    const int jobCount = parser.value(QStringLiteral("jobs")).toInt();
+    const int serverCount = std::max(1, parser.value(QStringLiteral("servers")).toInt());
+    const bool tls = parser.isSet(QStringLiteral("tls"));
+
+    QThread serverThread;
+    auto server = new QHR::MockRobotServer;
+    server->setServerCount(serverCount);
+    server->setLatency(parser.value(QStringLiteral("latency")).toInt(), parser.value(QStringLiteral("jitter")).toInt());
+    server->setErrorRate(parser.value(QStringLiteral("error-rate")).toDouble());
+    server->setRateLimit(parser.value(QStringLiteral("rate-limit")).toInt(), parser.value(QStringLiteral("rate-interval")).toInt());
+    server->moveToThread(&serverThread);
+    QObject::connect(&serverThread, &QThread::finished, server, &QObject::deleteLater);
+    serverThread.start();
+
+    bool listening = false;
+    QMetaObject::invokeMethod(server, "start", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, listening), Q_ARG(bool, tls));
+    if (!listening) {
+        std::fprintf(stderr, "Failed to start the mock server.\n");
+        serverThread.quit();
+        serverThread.wait();
+        return 1;
+    }
+
+    if (tls) {
+        QHR::MockRobotServer::trustCertificate();
+    }
+
+    LoadConfig config(server->baseUrl(), server->username(), server->password());
+    config.http2 = parser.isSet(QStringLiteral("http2"));
+    config.pipelining = parser.isSet(QStringLiteral("pipelining"));
+    QHR::setDefaultConfiguration(&config);
+
+    QVector<qint64> latencies;
+    latencies.reserve(jobCount);
+    int finished = 0;
+    int succeeded = 0;
+
+    QElapsedTimer total;
+    total.start();
+
+    for (int i = 0; i < jobCount; ++i) {
+        // distinct paths, otherwise identical requests would be coalesced
+        QUrlQuery query;
+        if (i >= serverCount) {
+            query.addQueryItem(QStringLiteral("n"), QString::number(i));
+        }
+        auto job = new LoadJob(QStringLiteral("/server/%1").arg(100000 + i % serverCount), query);
+        const qint64 started = total.nsecsElapsed();
+        QObject::connect(job, &QHR::BJob::result, &app, [&, started](QHR::BJob *j){
+            latencies.append((total.nsecsElapsed() - started) / 1000);
+            if (j->error() == 0) {
+                ++succeeded;
+            }
+            if (++finished == jobCount) {
+                app.quit();
+            }
+        });
+        job->start();
+    }
+
+    if (jobCount > 0) {
+        app.exec();
+    }
+
+    const double seconds = total.nsecsElapsed() / 1e9;
+    const auto requests = static_cast<unsigned long long>(server->requestCount());
+    const auto rateLimited = static_cast<unsigned long long>(server->rateLimitedCount());
+    const auto errors = static_cast<unsigned long long>(server->errorCount());
+
+    serverThread.quit();
+    serverThread.wait();
+
+    std::sort(latencies.begin(), latencies.end());
+
+    std::printf("jobs:        %d (%d succeeded, %d failed)\n", jobCount, succeeded, jobCount - succeeded);
+    std::printf("requests:    %llu (%llu rate limited, %llu errors)\n", requests, rateLimited, errors);
+    std::printf("duration:    %.3f s\n", seconds);
+    std::printf("throughput:  %.1f jobs/s\n", seconds > 0 ? jobCount / seconds : 0.0);
+    std::printf("latency p50: %.2f ms\n", percentile(latencies, 0.50));
+    std::printf("latency p99: %.2f ms\n", percentile(latencies, 0.99));
+    std::printf("peak RSS:    %lld KiB\n", static_cast<long long>(peakRssKiB()));
+
+    const double minSuccess = parser.value(QStringLiteral("min-success")).toDouble();
+    return (jobCount > 0 && static_cast<double>(succeeded) / jobCount < minSuccess) ? 1 : 0;
+}
+
+#include "loadtest.moc"
@@ -0,0 +1,533 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "mockrobotserver.h"
+#include <QTcpSocket>
+#include <QSslSocket>
+#include <QSslConfiguration>
+#include <QFile>
+#include <QTimer>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QUrlQuery>
+#include <QHostAddress>
+#include <QPointer>
+
+using namespace QHR;
+
+MockRobotServer::MockRobotServer(QObject *parent)
+    : QTcpServer(parent), m_random(std::random_device{}())
+{
+    setServerCount(10);
+}
+
+MockRobotServer::~MockRobotServer() = default;
+
+bool MockRobotServer::start(bool tls)
+{
+    m_tls = tls;
+
+    if (m_tls) {
+        QFile certFile(QStringLiteral(QHR_MOCK_CERT));
+        QFile keyFile(QStringLiteral(QHR_MOCK_KEY));
+        if (!certFile.open(QIODevice::ReadOnly) || !keyFile.open(QIODevice::ReadOnly)) {
+            qWarning("Can not open the certificate or key of the mock server.");
+            return false;
+        }
+        m_certificate = QSslCertificate(&certFile, QSsl::Pem);
+        m_key = QSslKey(&keyFile, QSsl::Rsa, QSsl::Pem);
+        if (m_certificate.isNull() || m_key.isNull()) {
+            qWarning("Invalid certificate or key for the mock server.");
+            return false;
+        }
+    }
+
+    setMaxPendingConnections(1024);
+
+    return listen(QHostAddress::LocalHost, 0);
+}
+
+QUrl MockRobotServer::baseUrl() const
+{
+    QUrl url;
+    url.setScheme(m_tls ? QStringLiteral("https") : QStringLiteral("http"));
+    url.setHost(QStringLiteral("127.0.0.1"));
+    url.setPort(serverPort());
+    return url;
+}
+
+void MockRobotServer::trustCertificate()
+{
+    QFile certFile(QStringLiteral(QHR_MOCK_CERT));
+    if (!certFile.open(QIODevice::ReadOnly)) {
+        qWarning("Can not open the certificate of the mock server.");
+        return;
+    }
+    QSslConfiguration config = QSslConfiguration::defaultConfiguration();
+    auto cas = config.caCertificates();
+    cas.append(QSslCertificate(&certFile, QSsl::Pem));
+    config.setCaCertificates(cas);
+    QSslConfiguration::setDefaultConfiguration(config);
+}
+
+void MockRobotServer::setServerCount(int count)
+{
+    m_serverCount = count;
+    m_rdns.clear();
+    m_failoverRouting.clear();
+    m_failoverLocks.clear();
+    for (int i = 0; i < count; ++i) {
+        m_rdns.insert(ipForIndex(i), QStringLiteral("static.%1.clients.your-server.de").arg(i));
+    }
+}
+
+void MockRobotServer::incomingConnection(qintptr socketDescriptor)
+{
+    QTcpSocket *socket = nullptr;
+
+    if (m_tls) {
+        auto sslSocket = new QSslSocket(this);
+        if (!sslSocket->setSocketDescriptor(socketDescriptor)) {
+            delete sslSocket;
+            return;
+        }
+        sslSocket->setLocalCertificate(m_certificate);
+        sslSocket->setPrivateKey(m_key);
+        sslSocket->setProtocol(QSsl::TlsV1_2OrLater);
+        sslSocket->startServerEncryption();
+        socket = sslSocket;
+    } else {
+        socket = new QTcpSocket(this);
+        if (!socket->setSocketDescriptor(socketDescriptor)) {
+            delete socket;
+            return;
+        }
+    }
+
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket](){
+        m_buffers[socket].append(socket->readAll());
+        readRequests(socket);
+    });
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket](){
+        m_buffers.remove(socket);
+        m_busy.remove(socket);
+        socket->deleteLater();
+    });
+}
+
+void MockRobotServer::readRequests(QTcpSocket *socket)
+{
+    // one request per connection at a time, so that delayed responses keep their order
+    if (m_busy.value(socket)) {
+        return;
+    }
+
+    QByteArray &buffer = m_buffers[socket];
+    const int headerEnd = buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        return;
+    }
+
+    const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if (requestLine.size() < 3) {
+        sendResponse(socket, error(400, QStringLiteral("INVALID_INPUT"), QStringLiteral("Malformed request line")), true);
+        return;
+    }
+
+    QMap<QByteArray, QByteArray> headers;
+    for (int i = 1; i < lines.size(); ++i) {
+        const QByteArray &line = lines.at(i);
+        const int colon = line.indexOf(':');
+        if (colon > 0) {
+            headers.insert(line.left(colon).trimmed().toLower(), line.mid(colon + 1).trimmed());
+        }
+    }
+
+    const int contentLength = headers.value(QByteArrayLiteral("content-length")).toInt();
+    if (buffer.size() < headerEnd + 4 + contentLength) {
+        return;
+    }
+
+    const QByteArray body = buffer.mid(headerEnd + 4, contentLength);
+    buffer.remove(0, headerEnd + 4 + contentLength);
+
+    const QByteArray method = requestLine.at(0);
+    const QString path = QUrl::fromEncoded(requestLine.at(1)).path();
+    const bool close = headers.value(QByteArrayLiteral("connection")).toLower() == "close";
+
+    m_requestCount.fetch_add(1, std::memory_order_relaxed);
+    const Response response = handleRequest(method, path, headers, body);
+
+    int delay = m_latency + response.delay;
+    if (m_latencyJitter > 0) {
+        delay += std::uniform_int_distribution<int>(0, m_latencyJitter)(m_random);
+    }
+
+    if (delay > 0) {
+        m_busy.insert(socket, true);
+        QPointer<QTcpSocket> s(socket);
+        QTimer::singleShot(delay, this, [this, s, response, close](){
+            if (s) {
+                m_busy.insert(s, false);
+                sendResponse(s, response, close);
+                readRequests(s);
+            }
+        });
+    } else {
+        sendResponse(socket, response, close);
+        readRequests(socket);
+    }
+}
+
+void MockRobotServer::sendResponse(QTcpSocket *socket, const Response &response, bool close)
+{
+    static const QHash<int, QByteArray> reasons({
+        {200, QByteArrayLiteral("OK")},
+        {201, QByteArrayLiteral("Created")},
+        {400, QByteArrayLiteral("Bad Request")},
+        {401, QByteArrayLiteral("Unauthorized")},
+        {403, QByteArrayLiteral("Forbidden")},
+        {404, QByteArrayLiteral("Not Found")},
+        {409, QByteArrayLiteral("Conflict")},
+        {500, QByteArrayLiteral("Internal Server Error")},
+        {503, QByteArrayLiteral("Service Unavailable")}
+    });
+
+    QByteArray out;
+    out.reserve(response.body.size() + 160);
+    out += "HTTP/1.1 " + QByteArray::number(response.status) + ' ' + reasons.value(response.status) + "\r\n";
+    out += "Content-Type: application/json; charset=utf-8\r\n";
+    out += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+    out += close ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+    out += response.body;
+
+    socket->write(out);
+
+    if (close) {
+        socket->disconnectFromHost();
+    }
+}
+
+MockRobotServer::Response MockRobotServer::handleRequest(const QByteArray &method, const QString &path, const QMap<QByteArray, QByteArray> &headers, const QByteArray &body)
+{
+    const QByteArray expectedAuth = "Basic " + QString(m_username + QLatin1Char(':') + m_password).toUtf8().toBase64();
+    if (headers.value(QByteArrayLiteral("authorization")) != expectedAuth) {
+        m_errorCount.fetch_add(1, std::memory_order_relaxed);
+        return error(401, QStringLiteral("UNAUTHORIZED"), QStringLiteral("Unauthorized"));
+    }
+
+    if (m_maintenance) {
+        m_errorCount.fetch_add(1, std::memory_order_relaxed);
+        return error(503, QStringLiteral("MAINTENANCE"), QStringLiteral("Server in maintenance mode"));
+    }
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 14, 0))
+    const QStringList parts = path.split(QLatin1Char('/'), Qt::SkipEmptyParts);
+#else
+    const QStringList parts = path.split(QLatin1Char('/'), QString::SkipEmptyParts);
+#endif
+
+    if (m_rateLimitMax > 0) {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        RateWindow &window = m_rateWindows[m_username + QLatin1Char(' ') + endpoint(method, parts)];
+        if (now - window.start >= static_cast<qint64>(m_rateLimitInterval) * 1000) {
+            window.start = now;
+            window.count = 0;
+        }
+        if (window.count >= m_rateLimitMax) {
+            m_rateLimitedCount.fetch_add(1, std::memory_order_relaxed);
+            QJsonObject e{
+                {QStringLiteral("status"), 403},
+                {QStringLiteral("code"), QStringLiteral("RATE_LIMIT_EXCEEDED")},
+                {QStringLiteral("message"), QStringLiteral("Rate limit exceeded")},
+                {QStringLiteral("max_request"), m_rateLimitMax},
+                {QStringLiteral("interval"), m_rateLimitInterval}
+            };
+            return {403, QJsonDocument(QJsonObject{{QStringLiteral("error"), e}}).toJson(QJsonDocument::Compact)};
+        }
+        ++window.count;
+    }
+
+    if (!m_failingEndpoints.empty() && m_failingEndpoints.contains(endpoint(method, parts))) {
+        m_errorCount.fetch_add(1, std::memory_order_relaxed);
+        return error(500, QStringLiteral("INTERNAL_ERROR"), QStringLiteral("Internal error"));
+    }
+
+    if (m_errorRate > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(m_random) < m_errorRate) {
+        m_errorCount.fetch_add(1, std::memory_order_relaxed);
+        return error(500, QStringLiteral("INTERNAL_ERROR"), QStringLiteral("Internal error"));
+    }
+
+    return route(method, parts, body);
+}
+
+MockRobotServer::Response MockRobotServer::route(const QByteArray &method, const QStringList &parts, const QByteArray &body)
+{
+    if (parts.empty()) {
+        return error(404, QStringLiteral("NOT_FOUND"), QStringLiteral("Not found"));
+    }
+
+    const QString &resource = parts.first();
+    const QString param = parts.size() > 1 ? parts.at(1) : QString();
+    const QUrlQuery form(QString::fromUtf8(body));
+
+    auto list = [this](const QString &key, QJsonObject (MockRobotServer::*object)(int) const) -> Response {
+        QJsonArray array;
+        for (int i = 0; i < m_serverCount; ++i) {
+            array.append(QJsonObject{{key, (this->*object)(i)}});
+        }
+        return {200, QJsonDocument(array).toJson(QJsonDocument::Compact)};
+    };
+
+    auto single = [](const QString &key, const QJsonObject &object) -> Response {
+        return {200, QJsonDocument(QJsonObject{{key, object}}).toJson(QJsonDocument::Compact)};
+    };
+
+    if (resource == QLatin1String("server")) {
+        if (param.isEmpty() && method == "GET") {
+            return list(QStringLiteral("server"), &MockRobotServer::serverObject);
+        }
+        const int idx = indexForServerNumber(param);
+        if (idx < 0) {
+            return error(404, QStringLiteral("SERVER_NOT_FOUND"), QStringLiteral("Server not found"));
+        }
+        return single(QStringLiteral("server"), serverObject(idx));
+    }
+
+    if (resource == QLatin1String("ip")) {
+        if (param.isEmpty()) {
+            return list(QStringLiteral("ip"), &MockRobotServer::ipObject);
+        }
+        const int idx = indexForIp(param);
+        if (idx < 0) {
+            return error(404, QStringLiteral("IP_NOT_FOUND"), QStringLiteral("IP not found"));
+        }
+        return single(QStringLiteral("ip"), ipObject(idx));
+    }
+
+    if (resource == QLatin1String("subnet")) {
+        if (param.isEmpty()) {
+            return list(QStringLiteral("subnet"), &MockRobotServer::subnetObject);
+        }
+        return error(404, QStringLiteral("SUBNET_NOT_FOUND"), QStringLiteral("Subnet not found"));
+    }
+
+    if (resource == QLatin1String("rdns")) {
+        if (param.isEmpty()) {
+            QJsonArray array;
+            for (auto it = m_rdns.constBegin(); it != m_rdns.constEnd(); ++it) {
+                array.append(QJsonObject{{QStringLiteral("rdns"), QJsonObject{{QStringLiteral("ip"), it.key()}, {QStringLiteral("ptr"), it.value()}}}});
+            }
+            return {200, QJsonDocument(array).toJson(QJsonDocument::Compact)};
+        }
+        if (method == "GET") {
+            if (!m_rdns.contains(param)) {
+                return error(404, QStringLiteral("RDNS_NOT_FOUND"), QStringLiteral("RDNS entry not found"));
+            }
+            return single(QStringLiteral("rdns"), QJsonObject{{QStringLiteral("ip"), param}, {QStringLiteral("ptr"), m_rdns.value(param)}});
+        }
+        if (method == "DELETE") {
+            if (m_rdns.remove(param) == 0) {
+                return error(404, QStringLiteral("RDNS_NOT_FOUND"), QStringLiteral("RDNS entry not found"));
+            }
+            return {200, QByteArray()};
+        }
+        const QString ptr = form.queryItemValue(QStringLiteral("ptr"), QUrl::FullyDecoded);
+        if (ptr.isEmpty()) {
+            return error(400, QStringLiteral("INVALID_INPUT"), QStringLiteral("Invalid input parameters"));
+        }
+        if (method == "PUT" && m_rdns.contains(param)) {
+            return error(409, QStringLiteral("RDNS_ALREADY_EXISTS"), QStringLiteral("RDNS entry already exists"));
+        }
+        const bool created = !m_rdns.contains(param);
+        m_rdns.insert(param, ptr);
+        Response r = single(QStringLiteral("rdns"), QJsonObject{{QStringLiteral("ip"), param}, {QStringLiteral("ptr"), ptr}});
+        r.status = created ? 201 : 200;
+        return r;
+    }
+
+    if (resource == QLatin1String("reset")) {
+        if (param.isEmpty()) {
+            return list(QStringLiteral("reset"), &MockRobotServer::resetObject);
+        }
+        const int idx = indexForServerNumber(param);
+        if (idx < 0) {
+            return error(404, QStringLiteral("SERVER_NOT_FOUND"), QStringLiteral("Server not found"));
+        }
+        if (method == "POST") {
+            const QString type = form.queryItemValue(QStringLiteral("type"));
+            if (type != QLatin1String("sw") && type != QLatin1String("hw") && type != QLatin1String("man")) {
+                return error(400, QStringLiteral("INVALID_INPUT"), QStringLiteral("Invalid input parameters"));
+            }
+            return single(QStringLiteral("reset"), QJsonObject{{QStringLiteral("server_ip"), ipForIndex(idx)}, {QStringLiteral("type"), type}});
+        }
+        return single(QStringLiteral("reset"), resetObject(idx));
+    }
+
+    if (resource == QLatin1String("wol")) {
+        const int idx = indexForServerNumber(param);
+        if (idx < 0) {
+            return error(404, QStringLiteral("SERVER_NOT_FOUND"), QStringLiteral("Server not found"));
+        }
+        return single(QStringLiteral("wol"), QJsonObject{{QStringLiteral("server_ip"), ipForIndex(idx)}, {QStringLiteral("server_number"), 100000 + idx}});
+    }
+
+    if (resource == QLatin1String("failover")) {
+        if (param.isEmpty()) {
+            return list(QStringLiteral("failover"), &MockRobotServer::failoverObject);
+        }
+        const int idx = indexForIp(param);
+        if (idx < 0) {
+            return error(404, QStringLiteral("NOT_FOUND"), QStringLiteral("Failover IP not found"));
+        }
+        if (method == "POST") {
+            const int target = indexForIp(form.queryItemValue(QStringLiteral("active_server_ip")));
+            if (target < 0) {
+                return error(400, QStringLiteral("INVALID_INPUT"), QStringLiteral("Invalid input parameters"));
+            }
+            const qint64 now = QDateTime::currentMSecsSinceEpoch();
+            if (m_failoverLocks.value(param) > now) {
+                return error(409, QStringLiteral("FAILOVER_LOCKED"), QStringLiteral("Switching the failover IP is blocked due to another active request"));
+            }
+            if (m_failoverRouting.value(param, idx) == target) {
+                return error(409, QStringLiteral("FAILOVER_ALREADY_ROUTED"), QStringLiteral("Failover already routed"));
+            }
+            m_failoverRouting.insert(param, target);
+            if (m_failoverSwitchDuration > 0) {
+                m_failoverLocks.insert(param, now + m_failoverSwitchDuration);
+                Response r = single(QStringLiteral("failover"), failoverObject(idx));
+                r.delay = m_failoverSwitchDuration;
+                return r;
+            }
+        } else if (method == "DELETE") {
+            m_failoverRouting.insert(param, -1);
+        }
+        return single(QStringLiteral("failover"), failoverObject(idx));
+    }
+
+    return error(404, QStringLiteral("NOT_FOUND"), QStringLiteral("Not found"));
+}
+
+MockRobotServer::Response MockRobotServer::error(int status, const QString &code, const QString &message)
+{
+    const QJsonObject e{
+        {QStringLiteral("status"), status},
+        {QStringLiteral("code"), code},
+        {QStringLiteral("message"), message}
+    };
+    return {status, QJsonDocument(QJsonObject{{QStringLiteral("error"), e}}).toJson(QJsonDocument::Compact)};
+}
+
+QString MockRobotServer::endpoint(const QByteArray &method, const QStringList &parts)
+{
+    QString ep = QString::fromLatin1(method) + QLatin1Char(' ');
+    if (!parts.empty()) {
+        ep += QLatin1Char('/') + parts.first();
+    }
+    if (parts.size() > 1) {
+        ep += QLatin1String("/{}");
+    }
+    return ep;
+}
+
+QString MockRobotServer::ipForIndex(int index) const
+{
+    return QStringLiteral("10.%1.%2.%3").arg((index >> 16) & 0xff).arg((index >> 8) & 0xff).arg(index & 0xff);
+}
+
+int MockRobotServer::indexForServerNumber(const QString &number) const
+{
+    bool ok = false;
+    const int idx = number.toInt(&ok) - 100000;
+    return (ok && idx >= 0 && idx < m_serverCount) ? idx : -1;
+}
+
+int MockRobotServer::indexForIp(const QString &ip) const
+{
+    const QStringList octets = ip.split(QLatin1Char('.'));
+    if (octets.size() != 4 || octets.first() != QLatin1String("10")) {
+        return -1;
+    }
+    const int idx = (octets.at(1).toInt() << 16) | (octets.at(2).toInt() << 8) | octets.at(3).toInt();
+    return idx < m_serverCount ? idx : -1;
+}
+
+QJsonObject MockRobotServer::serverObject(int index) const
+{
+    const QString ip = ipForIndex(index);
+    return QJsonObject{
+        {QStringLiteral("server_ip"), ip},
+        {QStringLiteral("server_ipv6_net"), QStringLiteral("2a01:4f8:%1::").arg(index, 0, 16)},
+        {QStringLiteral("server_number"), 100000 + index},
+        {QStringLiteral("server_name"), QStringLiteral("server%1").arg(index)},
+        {QStringLiteral("product"), QStringLiteral("EX41")},
+        {QStringLiteral("dc"), QStringLiteral("FSN1-DC%1").arg(index % 16 + 1)},
+        {QStringLiteral("traffic"), QStringLiteral("unlimited")},
+        {QStringLiteral("status"), QStringLiteral("ready")},
+        {QStringLiteral("cancelled"), false},
+        {QStringLiteral("paid_until"), QStringLiteral("2030-12-31")},
+        {QStringLiteral("ip"), QJsonArray{ip}},
+        {QStringLiteral("subnet"), QJsonArray{QJsonObject{{QStringLiteral("ip"), QStringLiteral("2a01:4f8:%1::").arg(index, 0, 16)}, {QStringLiteral("mask"), QStringLiteral("64")}}}}
+    };
+}
+
+QJsonObject MockRobotServer::ipObject(int index) const
+{
+    return QJsonObject{
+        {QStringLiteral("ip"), ipForIndex(index)},
+        {QStringLiteral("server_ip"), ipForIndex(index)},
+        {QStringLiteral("server_number"), 100000 + index},
+        {QStringLiteral("locked"), false},
+        {QStringLiteral("separate_mac"), QJsonValue()},
+        {QStringLiteral("traffic_warnings"), false},
+        {QStringLiteral("traffic_hourly"), 200},
+        {QStringLiteral("traffic_daily"), 2000},
+        {QStringLiteral("traffic_monthly"), 20}
+    };
+}
+
+QJsonObject MockRobotServer::subnetObject(int index) const
+{
+    return QJsonObject{
+        {QStringLiteral("ip"), QStringLiteral("2a01:4f8:%1::").arg(index, 0, 16)},
+        {QStringLiteral("mask"), 64},
+        {QStringLiteral("gateway"), QStringLiteral("fe80::1")},
+        {QStringLiteral("server_ip"), ipForIndex(index)},
+        {QStringLiteral("server_number"), 100000 + index},
+        {QStringLiteral("failover"), false},
+        {QStringLiteral("locked"), false},
+        {QStringLiteral("traffic_warnings"), false},
+        {QStringLiteral("traffic_hourly"), 200},
+        {QStringLiteral("traffic_daily"), 2000},
+        {QStringLiteral("traffic_monthly"), 20}
+    };
+}
+
+QJsonObject MockRobotServer::resetObject(int index) const
+{
+    return QJsonObject{
+        {QStringLiteral("server_ip"), ipForIndex(index)},
+        {QStringLiteral("server_number"), 100000 + index},
+        {QStringLiteral("type"), (index % 2) ? QJsonArray{QStringLiteral("sw"), QStringLiteral("hw"), QStringLiteral("man")} : QJsonArray{QStringLiteral("hw"), QStringLiteral("man")}}
+    };
+}
+
+QJsonObject MockRobotServer::failoverObject(int index) const
+{
+    const QString ip = ipForIndex(index);
+    const int active = m_failoverRouting.value(ip, index);
+    return QJsonObject{
+        {QStringLiteral("ip"), ip},
+        {QStringLiteral("netmask"), QStringLiteral("255.255.255.255")},
+        {QStringLiteral("server_ip"), ipForIndex(index)},
+        {QStringLiteral("server_number"), 100000 + index},
+        {QStringLiteral("active_server_ip"), active < 0 ? QJsonValue() : QJsonValue(ipForIndex(active))}
+    };
+}
+
+#include "moc_mockrobotserver.cpp"
@@ -0,0 +1,188 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#ifndef QHR_MOCKROBOTSERVER_H
+#define QHR_MOCKROBOTSERVER_H
+
+#include <QTcpServer>
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QHash>
+#include <QMap>
+#include <QUrl>
+#include <QJsonObject>
+#include <QStringList>
+#include <QString>
+#include <QByteArray>
+#include <atomic>
+#include <random>
+
+class QTcpSocket;
+
+namespace QHR {
+
+/*!
+ * \brief Local HTTP(S) server emulating the Robot webservice for tests.
+ *
+ * The server answers on 127.0.0.1 with generated fixture data for \c /server, \c /ip,
+ * \c /subnet, \c /rdns, \c /reset, \c /wol and \c /failover. It can emulate latency,
+ * random internal server errors, maintenance mode and request limits that are answered
+ * with \c RATE_LIMIT_EXCEEDED error objects like the real API does. Failover switches to the
+ * current routing are answered with \c FAILOVER_ALREADY_ROUTED.
+ *
+ * If TLS is enabled, a self-signed certificate for \c localhost and \c 127.0.0.1 will
+ * be used. Call trustCertificate() in the client process to accept it.
+ *
+ * All settings have to be applied before the server is started. The server can be
+ * moved to its own thread before calling start().
+ */
+class MockRobotServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    struct Response {
+        int status = 200;
+        QByteArray body;
+        // additional delay in milliseconds
+        int delay = 0;
+    };
+
+    explicit MockRobotServer(QObject *parent = nullptr);
+    ~MockRobotServer() override;
+
+    /*!
+     * \brief Starts listening on a random port of 127.0.0.1.
+     */
+    Q_INVOKABLE bool start(bool tls = false);
+
+    /*!
+     * \brief Returns the URL that has to be used as AbstractConfiguration::baseUrl().
+     */
+    QUrl baseUrl() const;
+
+    /*!
+     * \brief Adds the self-signed certificate of the server to the default CA certificates.
+     */
+    static void trustCertificate();
+
+    QString username() const { return m_username; }
+    void setUsername(const QString &username) { m_username = username; }
+
+    QString password() const { return m_password; }
+    void setPassword(const QString &password) { m_password = password; }
+
+    /*!
+     * \brief Sets the \a count of servers and IPs in the fixture data.
+     */
+    void setServerCount(int count);
+    int serverCount() const { return m_serverCount; }
+
+    /*!
+     * \brief Delays every response by \a msecs plus a random value up to \a jitter.
+     */
+    void setLatency(int msecs, int jitter = 0) { m_latency = msecs; m_latencyJitter = jitter; }
+
+    /*!
+     * \brief Answers the given \a rate of requests with \c INTERNAL_ERROR.
+     */
+    void setErrorRate(double rate) { m_errorRate = rate; }
+
+    /*!
+     * \brief Answers all requests with \c MAINTENANCE if \a enabled is \c true.
+     */
+    void setMaintenance(bool enabled) { m_maintenance = enabled; }
+
+    /*!
+     * \brief Allows \a maxRequests per \a interval seconds per user and endpoint.
+     *
+     * Set \a maxRequests to \c 0 to disable the limit, what is the default.
+     */
+    void setRateLimit(int maxRequests, int interval) { m_rateLimitMax = maxRequests; m_rateLimitInterval = interval; }
+
+    /*!
+     * \brief Lets every failover switch take \a msecs.
+     *
+     * The routing is changed immediately, but the response is delayed by \a msecs and
+     * other switches of the same failover IP are answered with \c FAILOVER_LOCKED until then.
+     */
+    void setFailoverSwitchDuration(int msecs) { m_failoverSwitchDuration = msecs; }
+
+    /*!
+     * \brief Answers all requests to the \a endpoints with \c INTERNAL_ERROR.
+     *
+     * Endpoints are given with method and path, parameters are replaced by \c {},
+     * like \c "GET /reset" or \c "POST /reset/{}".
+     */
+    void setFailingEndpoints(const QStringList &endpoints) { m_failingEndpoints = endpoints; }
+
+    quint64 requestCount() const { return m_requestCount.load(); }
+    quint64 rateLimitedCount() const { return m_rateLimitedCount.load(); }
+    quint64 errorCount() const { return m_errorCount.load(); }
+
+    /*!
+     * \brief Returns the current reverse DNS entries of the fixture data.
+     */
+    QMap<QString, QString> rdnsEntries() const { return m_rdns; }
+
+    /*!
+     * \brief Sets the reverse DNS \a entries of the fixture data.
+     */
+    void setRdnsEntries(const QMap<QString, QString> &entries) { m_rdns = entries; }
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    struct RateWindow {
+        qint64 start = 0;
+        int count = 0;
+    };
+
+    void readRequests(QTcpSocket *socket);
+    void sendResponse(QTcpSocket *socket, const Response &response, bool close);
+    Response handleRequest(const QByteArray &method, const QString &path, const QMap<QByteArray, QByteArray> &headers, const QByteArray &body);
+    Response route(const QByteArray &method, const QStringList &parts, const QByteArray &body);
+
+    static Response error(int status, const QString &code, const QString &message);
+    static QString endpoint(const QByteArray &method, const QStringList &parts);
+
+    QString ipForIndex(int index) const;
+    int indexForServerNumber(const QString &number) const;
+    int indexForIp(const QString &ip) const;
+    QJsonObject serverObject(int index) const;
+    QJsonObject ipObject(int index) const;
+    QJsonObject subnetObject(int index) const;
+    QJsonObject resetObject(int index) const;
+    QJsonObject failoverObject(int index) const;
+
+    QHash<QTcpSocket*, QByteArray> m_buffers;
+    QHash<QTcpSocket*, bool> m_busy;
+    QHash<QString, RateWindow> m_rateWindows;
+    QMap<QString, QString> m_rdns;
+    QStringList m_failingEndpoints;
+    QHash<QString, int> m_failoverRouting;
+    QHash<QString, qint64> m_failoverLocks;
+    QSslCertificate m_certificate;
+    QSslKey m_key;
+    QString m_username = QStringLiteral("#ws+mock");
+    QString m_password = QStringLiteral("mock");
+    std::mt19937 m_random;
+    std::atomic<quint64> m_requestCount{0};
+    std::atomic<quint64> m_rateLimitedCount{0};
+    std::atomic<quint64> m_errorCount{0};
+    double m_errorRate = 0.0;
+    int m_serverCount = 0;
+    int m_latency = 0;
+    int m_latencyJitter = 0;
+    int m_rateLimitMax = 0;
+    int m_rateLimitInterval = 0;
+    int m_failoverSwitchDuration = 0;
+    bool m_tls = false;
+    bool m_maintenance = false;
+};
+
+}
+
+#endif // QHR_MOCKROBOTSERVER_H
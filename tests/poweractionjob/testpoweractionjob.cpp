@@ -0,0 +1,341 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "poweractionjob.h"
+#include "abstractconfiguration.h"
+#include "retrypolicy.h"
+#include "job.h"
+#include "mockrobotserver.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QStringList>
+#include <QUrl>
+
+/*
+ * Resets and wakes servers of the local MockRobotServer with PowerActionJob. The mock
+ * server lists the reset types sw, hw and man for servers with an odd index and only
+ * hw and man for the others.
+ */
+
+class TestConfig : public QHR::AbstractConfiguration
+{
+    Q_OBJECT
+public:
+    explicit TestConfig(const QUrl &baseUrl, QObject *parent = nullptr) : QHR::AbstractConfiguration(parent), m_baseUrl(baseUrl) {}
+
+    QString username() const override { return QStringLiteral("#ws+mock"); }
+    QString password() const override { return QStringLiteral("mock"); }
+    QUrl baseUrl() const override { return m_baseUrl; }
+
+private:
+    QUrl m_baseUrl;
+};
+
+class TestPowerActionJob : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+
+    void addServers();
+    void resetServers();
+    void skipResetTypes();
+    void sendUncheckedResets();
+    void listingFailed();
+    void wakeOnLan();
+    void noServers();
+    void killWhileRunning();
+    void killWhileListing();
+
+private:
+    QHR::PowerActionJob *createJob(QHR::PowerActionJob::Action action = QHR::PowerActionJob::Reset);
+
+    QHR::MockRobotServer m_server;
+    TestConfig *m_config = nullptr;
+};
+
+void TestPowerActionJob::initTestCase()
+{
+    qRegisterMetaType<QHR::PowerActionResult>();
+    QHR::setDefaultRetryPolicy(QHR::RetryPolicy());
+    QVERIFY(m_server.start());
+    m_config = new TestConfig(m_server.baseUrl(), this);
+}
+
+void TestPowerActionJob::init()
+{
+    m_server.setServerCount(10);
+    m_server.setLatency(0);
+    m_server.setFailingEndpoints(QStringList());
+}
+
+QHR::PowerActionJob *TestPowerActionJob::createJob(QHR::PowerActionJob::Action action)
+{
+    auto job = new QHR::PowerActionJob(action, this);
+    job->setConfiguration(m_config);
+    job->setAutoDelete(false);
+    return job;
+}
+
+void TestPowerActionJob::addServers()
+{
+    QScopedPointer<QHR::PowerActionJob> job(createJob());
+    job->addServer(100001);
+    job->addServer(100003, QStringLiteral("hw"));
+    // invalid and duplicate server numbers are ignored
+    job->addServer(0);
+    job->addServer(-5);
+    job->addServer(100001, QStringLiteral("man"));
+    job->addServers({100000, 100003, 100002});
+    QCOMPARE(job->servers(), QVector<int>({100001, 100003, 100000, 100002}));
+
+    job->setMaxInFlight(0);
+    QCOMPARE(job->maxInFlight(), 1);
+}
+
+void TestPowerActionJob::resetServers()
+{
+    QScopedPointer<QHR::PowerActionJob> job(createJob());
+    job->addServer(100001);
+    job->addServer(100000, QStringLiteral("hw"));
+    job->addServer(100003, QStringLiteral("man"));
+    job->setMaxInFlight(2);
+
+    QVector<qulonglong> processed;
+    connect(job.data(), static_cast<void (QHR::BJob::*)(QHR::BJob*, QHR::BJob::Unit, qulonglong)>(&QHR::BJob::processedAmount), this, [&processed](QHR::BJob *, QHR::BJob::Unit unit, qulonglong amount){
+        if (unit == QHR::BJob::Items) {
+            processed << amount;
+        }
+    });
+    QSignalSpy serverFinished(job.data(), &QHR::PowerActionJob::serverFinished);
+    QSignalSpy result(job.data(), &QHR::BJob::result);
+
+    job->start();
+    // servers can not be added after start
+    job->addServer(100005);
+    QCOMPARE(job->totalAmount(QHR::BJob::Items), Q_UINT64_C(3));
+
+    QVERIFY(result.wait(5000));
+    QCOMPARE(job->error(), static_cast<int>(QHR::BJob::NoError));
+    QCOMPARE(job->servers().size(), 3);
+    QCOMPARE(serverFinished.size(), 3);
+    QCOMPARE(job->succeededCount(), 3);
+    QCOMPARE(job->failedCount(), 0);
+    QCOMPARE(job->skippedCount(), 0);
+    QCOMPARE(processed, QVector<qulonglong>({1, 2, 3}));
+    QCOMPARE(job->processedAmount(QHR::BJob::Items), Q_UINT64_C(3));
+    QCOMPARE(job->percent(), 100ul);
+
+    const QVector<QHR::PowerActionResult> results = job->results();
+    QCOMPARE(results.size(), 3);
+    for (const QHR::PowerActionResult &r : results) {
+        QVERIFY2(r.isOk(), qUtf8Printable(r.errorString));
+        QVERIFY(!r.skipped);
+        QCOMPARE(r.httpStatus, 200);
+        QCOMPARE(r.reply.value(QStringLiteral("type")).toString(), r.resetType);
+        if (r.serverNumber == 100001) {
+            QCOMPARE(r.resetType, QStringLiteral("sw"));
+            QCOMPARE(r.reply.value(QStringLiteral("server_ip")).toString(), QStringLiteral("10.0.0.1"));
+        }
+    }
+}
+
+void TestPowerActionJob::skipResetTypes()
+{
+    QScopedPointer<QHR::PowerActionJob> job(createJob());
+    // sw is not available for servers with an even index
+    job->addServer(100000);
+    job->addServer(100002, QStringLiteral("man"));
+    job->addServer(100009);
+    // not part of the listing
+    job->addServer(123456, QStringLiteral("hw"));
+
+    QSignalSpy serverFinished(job.data(), &QHR::PowerActionJob::serverFinished);
+    QSignalSpy result(job.data(), &QHR::BJob::result);
+    job->start();
+
+    QVERIFY(result.wait(5000));
+    QCOMPARE(job->error(), static_cast<int>(QHR::SubJobsFailed));
+    QCOMPARE(job->succeededCount(), 2);
+    QCOMPARE(job->failedCount(), 0);
+    QCOMPARE(job->skippedCount(), 2);
+    QCOMPARE(serverFinished.size(), 4);
+    QCOMPARE(job->processedAmount(QHR::BJob::Items), Q_UINT64_C(4));
+    QCOMPARE(job->percent(), 100ul);
+
+    // skipped servers are reported before any reset has been sent
+    const QVector<QHR::PowerActionResult> results = job->results();
+    QCOMPARE(results.at(0).serverNumber, 100000);
+    QVERIFY(results.at(0).skipped);
+    QCOMPARE(results.at(0).error, static_cast<int>(QHR::InvalidInput));
+    QCOMPARE(results.at(0).resetType, QStringLiteral("sw"));
+    QCOMPARE(results.at(0).httpStatus, 0);
+    QVERIFY(!results.at(0).errorString.isEmpty());
+    QCOMPARE(results.at(1).serverNumber, 123456);
+    QVERIFY(results.at(1).skipped);
+    QVERIFY(results.at(2).isOk());
+    QVERIFY(results.at(3).isOk());
+
+    // the error text is the first error
+    QCOMPARE(job->errorText(), results.at(0).errorString);
+    QVERIFY(!job->errorString().isEmpty());
+}
+
+void TestPowerActionJob::sendUncheckedResets()
+{
+    QScopedPointer<QHR::PowerActionJob> job(createJob());
+    job->setCheckResetTypes(false);
+    job->setDefaultResetType(QStringLiteral("hw"));
+    job->addServer(100000);
+    job->addServer(123456);
+
+    QSignalSpy result(job.data(), &QHR::BJob::result);
+    const quint64 requestsBefore = m_server.requestCount();
+    job->start();
+
+    QVERIFY(result.wait(5000));
+    // no listing request, the unknown server is rejected by the API
+    QCOMPARE(m_server.requestCount() - requestsBefore, Q_UINT64_C(2));
+    QCOMPARE(job->error(), static_cast<int>(QHR::SubJobsFailed));
+    QCOMPARE(job->succeededCount(), 1);
+    QCOMPARE(job->failedCount(), 1);
+    QCOMPARE(job->skippedCount(), 0);
+
+    const QHR::PowerActionResult failed = job->results().at(job->results().at(0).isOk() ? 1 : 0);
+    QCOMPARE(failed.serverNumber, 123456);
+    QVERIFY(!failed.skipped);
+    QCOMPARE(failed.httpStatus, 404);
+    QCOMPARE(failed.apiErrorCode, QStringLiteral("SERVER_NOT_FOUND"));
+    QCOMPARE(failed.resetType, QStringLiteral("hw"));
+    QVERIFY(failed.reply.isEmpty());
+}
+
+void TestPowerActionJob::listingFailed()
+{
+    m_server.setFailingEndpoints({QStringLiteral("GET /reset")});
+
+    QScopedPointer<QHR::PowerActionJob> job(createJob());
+    // would be skipped if the listing was available
+    job->addServer(100000);
+    job->addServer(100001);
+
+    QStringList warnings;
+    connect(job.data(), &QHR::BJob::warning, this, [&warnings](QHR::BJob *, const QString &plain){
+        warnings << plain;
+    });
+    QSignalSpy result(job.data(), &QHR::BJob::result);
+    job->start();
+
+    QVERIFY(result.wait(5000));
+    QCOMPARE(warnings.size(), 1);
+    QVERIFY(!warnings.first().isEmpty());
+    // the resets have been sent without checking the types
+    QCOMPARE(job->error(), static_cast<int>(QHR::BJob::NoError));
+    QCOMPARE(job->succeededCount(), 2);
+    QCOMPARE(job->skippedCount(), 0);
+}
+
+void TestPowerActionJob::wakeOnLan()
+{
+    // Wake-on-LAN does not need the reset listing
+    m_server.setFailingEndpoints({QStringLiteral("GET /reset")});
+
+    QScopedPointer<QHR::PowerActionJob> job(createJob(QHR::PowerActionJob::WakeOnLan));
+    job->addServers({100000, 100001, 123456});
+
+    int warnings = 0;
+    connect(job.data(), &QHR::BJob::warning, this, [&warnings](){
+        ++warnings;
+    });
+    QSignalSpy result(job.data(), &QHR::BJob::result);
+    job->start();
+
+    QVERIFY(result.wait(5000));
+    QCOMPARE(warnings, 0);
+    QCOMPARE(job->error(), static_cast<int>(QHR::SubJobsFailed));
+    QCOMPARE(job->succeededCount(), 2);
+    QCOMPARE(job->failedCount(), 1);
+    QCOMPARE(job->skippedCount(), 0);
+    QCOMPARE(job->percent(), 100ul);
+
+    for (const QHR::PowerActionResult &r : job->results()) {
+        QVERIFY(r.resetType.isEmpty());
+        if (r.serverNumber == 123456) {
+            QCOMPARE(r.httpStatus, 404);
+            QCOMPARE(job->errorText(), r.errorString);
+        } else {
+            QVERIFY(r.isOk());
+            QCOMPARE(r.reply.value(QStringLiteral("server_number")).toInt(), r.serverNumber);
+        }
+    }
+}
+
+void TestPowerActionJob::noServers()
+{
+    QScopedPointer<QHR::PowerActionJob> job(createJob());
+    QSignalSpy result(job.data(), &QHR::BJob::result);
+    const quint64 requestsBefore = m_server.requestCount();
+    job->start();
+
+    QVERIFY(result.wait(5000));
+    QCOMPARE(job->error(), static_cast<int>(QHR::BJob::NoError));
+    QCOMPARE(m_server.requestCount(), requestsBefore);
+    QVERIFY(job->results().isEmpty());
+}
+
+void TestPowerActionJob::killWhileRunning()
+{
+    m_server.setLatency(100);
+
+    QScopedPointer<QHR::PowerActionJob> job(createJob());
+    job->setCheckResetTypes(false);
+    job->setMaxInFlight(1);
+    job->setDefaultResetType(QStringLiteral("hw"));
+    job->addServers({100000, 100001, 100002, 100003, 100004});
+
+    QSignalSpy serverFinished(job.data(), &QHR::PowerActionJob::serverFinished);
+    QSignalSpy result(job.data(), &QHR::BJob::result);
+    job->start();
+
+    QVERIFY(serverFinished.wait(5000));
+    QVERIFY(job->kill(QHR::BJob::EmitResult));
+    QCOMPARE(result.size(), 1);
+    QCOMPARE(job->error(), static_cast<int>(QHR::BJob::KilledJobError));
+
+    // aborted and pending servers are not reported anymore
+    QTest::qWait(400);
+    QCOMPARE(serverFinished.size(), 1);
+    QCOMPARE(job->results().size(), 1);
+    QCOMPARE(result.size(), 1);
+    QCOMPARE(job->processedAmount(QHR::BJob::Items), Q_UINT64_C(1));
+}
+
+void TestPowerActionJob::killWhileListing()
+{
+    m_server.setLatency(200);
+
+    QScopedPointer<QHR::PowerActionJob> job(createJob());
+    job->addServers({100001, 100003});
+
+    QSignalSpy serverFinished(job.data(), &QHR::PowerActionJob::serverFinished);
+    QSignalSpy finished(job.data(), &QHR::BJob::finished);
+    const quint64 requestsBefore = m_server.requestCount();
+    job->start();
+
+    QTest::qWait(50);
+    QVERIFY(job->kill());
+    QCOMPARE(finished.size(), 1);
+
+    // the listing reply does not start the resets
+    QTest::qWait(500);
+    QVERIFY(serverFinished.isEmpty());
+    QVERIFY(m_server.requestCount() - requestsBefore <= Q_UINT64_C(1));
+}
+
+QTEST_MAIN(TestPowerActionJob)
+
+#include "testpoweractionjob.moc"
@@ -0,0 +1,403 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "productcatalog.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QStringList>
+
+/*
+ * Builds ProductCatalog objects from server market and server product lists and checks
+ * the queries, the refresh from a previous catalog and the diff between catalogs.
+ */
+
+class TestProductCatalog : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void nullCatalog();
+    void emptyCatalog();
+    void marketOffers();
+    void serverProducts();
+    void query();
+    void duplicateIds();
+    void refreshUnchanged();
+    void refreshReusesRows();
+    void refreshServerProducts();
+    void refreshDuplicateOfReused();
+    void refreshOtherSource();
+    void diff();
+
+private:
+    static QJsonObject market(int id, double price, const QString &datacenter = QStringLiteral("FSN1-DC8"), int memorySize = 64);
+    static QJsonObject server(const QString &id, const QStringList &locations, double price);
+    static QStringList idsOf(const QHR::ProductCatalog &catalog, const QVector<int> &rows);
+};
+
+QJsonObject TestProductCatalog::market(int id, double price, const QString &datacenter, int memorySize)
+{
+    return QJsonObject{{QStringLiteral("product"), QJsonObject{
+        {QStringLiteral("id"), id},
+        {QStringLiteral("name"), QStringLiteral("SB%1").arg(id)},
+        {QStringLiteral("cpu"), QStringLiteral("AMD Ryzen 7 3700X")},
+        {QStringLiteral("cpu_benchmark"), 24000},
+        {QStringLiteral("memory_size"), memorySize},
+        {QStringLiteral("hdd_size"), 1024},
+        {QStringLiteral("hdd_count"), 2},
+        {QStringLiteral("datacenter"), datacenter},
+        // the API returns prices as strings
+        {QStringLiteral("price"), QString::number(price, 'f', 4)},
+        {QStringLiteral("price_setup"), QStringLiteral("0.0000")}
+    }}};
+}
+
+QJsonObject TestProductCatalog::server(const QString &id, const QStringList &locations, double price)
+{
+    QJsonArray prices;
+    for (int i = 0; i < locations.size(); ++i) {
+        prices.append(QJsonObject{
+            {QStringLiteral("location"), locations.at(i)},
+            {QStringLiteral("price"), QJsonObject{{QStringLiteral("net"), QString::number(price + i, 'f', 4)}}},
+            {QStringLiteral("price_setup"), QJsonObject{{QStringLiteral("net"), QStringLiteral("39.0000")}}}
+        });
+    }
+    return QJsonObject{{QStringLiteral("product"), QJsonObject{
+        {QStringLiteral("id"), id},
+        {QStringLiteral("name"), QStringLiteral("Dedicated Server %1").arg(id)},
+        {QStringLiteral("prices"), prices}
+    }}};
+}
+
+QStringList TestProductCatalog::idsOf(const QHR::ProductCatalog &catalog, const QVector<int> &rows)
+{
+    QStringList list;
+    for (int row : rows) {
+        list << catalog.offer(row).id;
+    }
+    return list;
+}
+
+void TestProductCatalog::nullCatalog()
+{
+    const QHR::ProductCatalog catalog;
+    QVERIFY(catalog.isNull());
+    QCOMPARE(catalog.size(), 0);
+    QCOMPARE(catalog.indexOf(QStringLiteral("1")), -1);
+    QVERIFY(!catalog.offer(0).isValid());
+    QVERIFY(catalog.values(QHR::ProductCatalog::Location).isEmpty());
+    QVERIFY(catalog.query(QHR::ProductQuery()).isEmpty());
+    QCOMPARE(catalog.count(QHR::ProductQuery()), 0);
+    QVERIFY(QHR::ProductCatalog::diff(catalog, QHR::ProductCatalog()).isEmpty());
+}
+
+void TestProductCatalog::emptyCatalog()
+{
+    const QHR::ProductCatalog catalog = QHR::ProductCatalog::fromJson(QJsonArray(), QHR::ProductCatalog::ServerMarket);
+    QVERIFY(!catalog.isNull());
+    QCOMPARE(catalog.source(), QHR::ProductCatalog::ServerMarket);
+    QCOMPARE(catalog.size(), 0);
+    QVERIFY(catalog.values(QHR::ProductCatalog::Cpu).isEmpty());
+
+    QHR::ProductQuery query;
+    QVERIFY(catalog.query(query).isEmpty());
+    QCOMPARE(catalog.count(query), 0);
+    query.range(QHR::ProductCatalog::Price, 0, 100).equals(QHR::ProductCatalog::Location, QStringLiteral("FSN1"));
+    QVERIFY(catalog.query(query).isEmpty());
+    QCOMPARE(catalog.count(query), 0);
+
+    // refreshing an empty catalog with an empty list
+    const QHR::ProductCatalog refreshed = QHR::ProductCatalog::fromJson(QJsonArray(), QHR::ProductCatalog::ServerMarket, catalog);
+    QCOMPARE(refreshed.size(), 0);
+    QVERIFY(QHR::ProductCatalog::diff(catalog, refreshed).isEmpty());
+
+    // emptying a filled catalog
+    const QHR::ProductCatalog filled = QHR::ProductCatalog::fromJson(QJsonArray{market(1, 30), market(2, 40)}, QHR::ProductCatalog::ServerMarket);
+    const QHR::ProductCatalog emptied = QHR::ProductCatalog::fromJson(QJsonArray(), QHR::ProductCatalog::ServerMarket, filled);
+    QCOMPARE(emptied.size(), 0);
+    const QHR::ProductCatalog::Changes changes = QHR::ProductCatalog::diff(filled, emptied);
+    QVERIFY(changes.added.isEmpty());
+    QVERIFY(changes.changed.isEmpty());
+    QCOMPARE(changes.removed, QStringList({QStringLiteral("1"), QStringLiteral("2")}));
+}
+
+void TestProductCatalog::marketOffers()
+{
+    QJsonArray products{market(1001, 39.5, QStringLiteral("NBG1-DC3"), 128)};
+    // not wrapped into a product object
+    products.append(market(1002, 30).value(QStringLiteral("product")));
+
+    const QHR::ProductCatalog catalog = QHR::ProductCatalog::fromJson(products, QHR::ProductCatalog::ServerMarket);
+    QCOMPARE(catalog.size(), 2);
+
+    const QHR::ProductOffer offer = catalog.offer(catalog.indexOf(QStringLiteral("1001")));
+    QVERIFY(offer.isValid());
+    QCOMPARE(offer.id, QStringLiteral("1001"));
+    QCOMPARE(offer.productId, QStringLiteral("1001"));
+    QCOMPARE(offer.name, QStringLiteral("SB1001"));
+    QCOMPARE(offer.cpu, QStringLiteral("AMD Ryzen 7 3700X"));
+    QCOMPARE(offer.datacenter, QStringLiteral("NBG1-DC3"));
+    QCOMPARE(offer.location, QStringLiteral("NBG1"));
+    QCOMPARE(offer.price, 39.5);
+    QCOMPARE(offer.setupPrice, 0.0);
+    QCOMPARE(offer.cpuBenchmark, 24000);
+    QCOMPARE(offer.memorySize, 128);
+    QCOMPARE(offer.hddSize, 1024);
+    QCOMPARE(offer.hddCount, 2);
+    QCOMPARE(offer.product.value(QStringLiteral("id")).toInt(), 1001);
+    QCOMPARE(catalog.value(QHR::ProductCatalog::MemorySize, catalog.indexOf(QStringLiteral("1001"))), 128.0);
+
+    QCOMPARE(catalog.offer(catalog.indexOf(QStringLiteral("1002"))).location, QStringLiteral("FSN1"));
+    QCOMPARE(catalog.values(QHR::ProductCatalog::Location), QStringList({QStringLiteral("FSN1"), QStringLiteral("NBG1")}));
+
+    QVERIFY(!catalog.offer(2).isValid());
+    QVERIFY(!catalog.offer(-1).isValid());
+    QCOMPARE(catalog.value(QHR::ProductCatalog::Price, 2), 0.0);
+}
+
+void TestProductCatalog::serverProducts()
+{
+    QJsonObject legacy{
+        {QStringLiteral("id"), QStringLiteral("AX41")},
+        {QStringLiteral("name"), QStringLiteral("Dedicated Server AX41")},
+        {QStringLiteral("location"), QJsonArray{QStringLiteral("FSN1"), QStringLiteral("HEL1")}},
+        {QStringLiteral("price"), QJsonObject{{QStringLiteral("net"), QStringLiteral("37.0000")}}},
+        {QStringLiteral("price_setup"), QJsonObject{{QStringLiteral("net"), QStringLiteral("0.0000")}}}
+    };
+
+    const QJsonArray products{server(QStringLiteral("EX44"), {QStringLiteral("FSN1"), QStringLiteral("NBG1")}, 44), legacy};
+    const QHR::ProductCatalog catalog = QHR::ProductCatalog::fromJson(products, QHR::ProductCatalog::ServerProducts);
+    QCOMPARE(catalog.source(), QHR::ProductCatalog::ServerProducts);
+    QCOMPARE(catalog.size(), 4);
+
+    // one offer per product and location
+    const QHR::ProductOffer offer = catalog.offer(catalog.indexOf(QStringLiteral("EX44/NBG1")));
+    QCOMPARE(offer.productId, QStringLiteral("EX44"));
+    QCOMPARE(offer.location, QStringLiteral("NBG1"));
+    QCOMPARE(offer.datacenter, QStringLiteral("NBG1"));
+    QCOMPARE(offer.price, 45.0);
+    QCOMPARE(offer.setupPrice, 39.0);
+    QVERIFY(offer.cpu.isEmpty());
+    QCOMPARE(offer.memorySize, 0);
+
+    QCOMPARE(catalog.offer(catalog.indexOf(QStringLiteral("AX41/HEL1"))).price, 37.0);
+    QVERIFY(catalog.indexOf(QStringLiteral("AX41/FSN1")) >= 0);
+    QCOMPARE(catalog.indexOf(QStringLiteral("EX44")), -1);
+}
+
+void TestProductCatalog::query()
+{
+    QJsonArray products;
+    products.append(market(1, 50, QStringLiteral("FSN1-DC8"), 64));
+    products.append(market(2, 30, QStringLiteral("FSN1-DC14"), 32));
+    products.append(market(3, 40, QStringLiteral("NBG1-DC3"), 128));
+    products.append(market(4, 40, QStringLiteral("FSN1-DC8"), 128));
+    products.append(market(5, 100, QStringLiteral("HEL1-DC2"), 256));
+    // more than one bitmap word
+    for (int i = 0; i < 70; ++i) {
+        products.append(market(100 + i, 200 + i, QStringLiteral("HEL1-DC2"), 16));
+    }
+    const QHR::ProductCatalog catalog = QHR::ProductCatalog::fromJson(products, QHR::ProductCatalog::ServerMarket);
+    QCOMPARE(catalog.size(), 75);
+
+    // an empty query matches everything ordered by price, ties ordered by row
+    QHR::ProductQuery all;
+    all.setLimit(4);
+    QCOMPARE(idsOf(catalog, catalog.query(all)), QStringList({QStringLiteral("2"), QStringLiteral("3"), QStringLiteral("4"), QStringLiteral("1")}));
+    QCOMPARE(catalog.count(all), 75);
+
+    // range bounds are inclusive
+    QHR::ProductQuery range;
+    range.range(QHR::ProductCatalog::Price, 40, 100).range(QHR::ProductCatalog::MemorySize, 64);
+    QCOMPARE(idsOf(catalog, catalog.query(range)), QStringList({QStringLiteral("3"), QStringLiteral("4"), QStringLiteral("1"), QStringLiteral("5")}));
+
+    // multiple values of the same category match any of them
+    QHR::ProductQuery locations;
+    locations.equals(QHR::ProductCatalog::Location, QStringLiteral("NBG1"))
+             .equals(QHR::ProductCatalog::Location, QStringLiteral("FSN1"))
+             .range(QHR::ProductCatalog::MemorySize, 64);
+    QCOMPARE(idsOf(catalog, catalog.query(locations)), QStringList({QStringLiteral("3"), QStringLiteral("4"), QStringLiteral("1")}));
+
+    QHR::ProductQuery datacenter;
+    datacenter.equals(QHR::ProductCatalog::Datacenter, QStringLiteral("FSN1-DC8"));
+    QCOMPARE(idsOf(catalog, catalog.query(datacenter)), QStringList({QStringLiteral("4"), QStringLiteral("1")}));
+
+    // the limit does not change the count
+    QHR::ProductQuery hel;
+    hel.equals(QHR::ProductCatalog::Location, QStringLiteral("HEL1")).range(QHR::ProductCatalog::Price, 200).setLimit(3);
+    QCOMPARE(idsOf(catalog, catalog.query(hel)), QStringList({QStringLiteral("100"), QStringLiteral("101"), QStringLiteral("102")}));
+    QCOMPARE(catalog.count(hel), 70);
+
+    QHR::ProductQuery unknown;
+    unknown.equals(QHR::ProductCatalog::Cpu, QStringLiteral("Intel Core i7-6700"));
+    QVERIFY(catalog.query(unknown).isEmpty());
+    QCOMPARE(catalog.count(unknown), 0);
+
+    QHR::ProductQuery empty;
+    empty.range(QHR::ProductCatalog::Price, 101, 199);
+    QVERIFY(catalog.query(empty).isEmpty());
+}
+
+void TestProductCatalog::duplicateIds()
+{
+    QJsonArray products;
+    products.append(market(1, 30));
+    products.append(market(2, 40));
+    // the first offer with an ID wins
+    products.append(market(1, 20, QStringLiteral("NBG1-DC3")));
+    products.append(QJsonObject{{QStringLiteral("product"), QJsonObject{{QStringLiteral("name"), QStringLiteral("no id")}}}});
+
+    const QHR::ProductCatalog catalog = QHR::ProductCatalog::fromJson(products, QHR::ProductCatalog::ServerMarket);
+    QCOMPARE(catalog.size(), 2);
+    QCOMPARE(catalog.offer(catalog.indexOf(QStringLiteral("1"))).price, 30.0);
+    QCOMPARE(catalog.values(QHR::ProductCatalog::Location), QStringList({QStringLiteral("FSN1")}));
+    QCOMPARE(catalog.indexOf(QString()), -1);
+
+    QHR::ProductQuery query;
+    query.range(QHR::ProductCatalog::Price, 0, 25);
+    QVERIFY(catalog.query(query).isEmpty());
+}
+
+void TestProductCatalog::refreshUnchanged()
+{
+    const QJsonArray products{market(1, 30), market(2, 40), market(3, 50)};
+    const QHR::ProductCatalog catalog = QHR::ProductCatalog::fromJson(products, QHR::ProductCatalog::ServerMarket);
+    const QHR::ProductCatalog refreshed = QHR::ProductCatalog::fromJson(products, QHR::ProductCatalog::ServerMarket, catalog);
+    QCOMPARE(refreshed.size(), 3);
+    QVERIFY(QHR::ProductCatalog::diff(catalog, refreshed).isEmpty());
+
+    // the same products in another order are a new catalog without changes
+    const QHR::ProductCatalog reordered = QHR::ProductCatalog::fromJson(QJsonArray{market(3, 50), market(1, 30), market(2, 40)}, QHR::ProductCatalog::ServerMarket, catalog);
+    QCOMPARE(reordered.size(), 3);
+    QCOMPARE(reordered.indexOf(QStringLiteral("3")), 0);
+    QVERIFY(QHR::ProductCatalog::diff(catalog, reordered).isEmpty());
+
+    QHR::ProductQuery query;
+    query.setLimit(1);
+    QCOMPARE(idsOf(reordered, reordered.query(query)), QStringList({QStringLiteral("1")}));
+}
+
+void TestProductCatalog::refreshReusesRows()
+{
+    const QHR::ProductCatalog catalog = QHR::ProductCatalog::fromJson(QJsonArray{market(1, 30), market(2, 40, QStringLiteral("NBG1-DC3")), market(3, 50)}, QHR::ProductCatalog::ServerMarket);
+
+    // 1 is removed, 2 is unchanged, 3 is changed and 4 is new
+    const QJsonArray products{market(2, 40, QStringLiteral("NBG1-DC3")), market(3, 25, QStringLiteral("HEL1-DC2")), market(4, 60)};
+    const QHR::ProductCatalog refreshed = QHR::ProductCatalog::fromJson(products, QHR::ProductCatalog::ServerMarket, catalog);
+    QCOMPARE(refreshed.size(), 3);
+    QCOMPARE(refreshed.indexOf(QStringLiteral("1")), -1);
+
+    // the taken over row has the same data as a freshly extracted one
+    const QHR::ProductOffer reused = refreshed.offer(refreshed.indexOf(QStringLiteral("2")));
+    const QHR::ProductOffer original = catalog.offer(catalog.indexOf(QStringLiteral("2")));
+    QCOMPARE(reused.name, original.name);
+    QCOMPARE(reused.datacenter, QStringLiteral("NBG1-DC3"));
+    QCOMPARE(reused.location, QStringLiteral("NBG1"));
+    QCOMPARE(reused.cpu, original.cpu);
+    QCOMPARE(reused.price, 40.0);
+    QCOMPARE(reused.memorySize, original.memorySize);
+    QCOMPARE(reused.product, original.product);
+
+    const QHR::ProductOffer changed = refreshed.offer(refreshed.indexOf(QStringLiteral("3")));
+    QCOMPARE(changed.price, 25.0);
+    QCOMPARE(changed.location, QStringLiteral("HEL1"));
+
+    // the indexes have been rebuilt
+    QCOMPARE(refreshed.values(QHR::ProductCatalog::Location), QStringList({QStringLiteral("FSN1"), QStringLiteral("HEL1"), QStringLiteral("NBG1")}));
+    QHR::ProductQuery query;
+    query.equals(QHR::ProductCatalog::Location, QStringLiteral("NBG1"));
+    QCOMPARE(idsOf(refreshed, refreshed.query(query)), QStringList({QStringLiteral("2")}));
+    QHR::ProductQuery cheapest;
+    cheapest.setLimit(1);
+    QCOMPARE(idsOf(refreshed, refreshed.query(cheapest)), QStringList({QStringLiteral("3")}));
+
+    const QHR::ProductCatalog::Changes changes = QHR::ProductCatalog::diff(catalog, refreshed);
+    QCOMPARE(changes.added, QVector<int>({refreshed.indexOf(QStringLiteral("4"))}));
+    QCOMPARE(changes.changed, QVector<int>({refreshed.indexOf(QStringLiteral("3"))}));
+    QCOMPARE(changes.removed, QStringList({QStringLiteral("1")}));
+
+    // the previous catalog is not touched
+    QCOMPARE(catalog.size(), 3);
+    QCOMPARE(catalog.offer(catalog.indexOf(QStringLiteral("3"))).price, 50.0);
+}
+
+void TestProductCatalog::refreshServerProducts()
+{
+    const QJsonObject ex44 = server(QStringLiteral("EX44"), {QStringLiteral("FSN1"), QStringLiteral("NBG1"), QStringLiteral("HEL1")}, 44);
+    const QHR::ProductCatalog catalog = QHR::ProductCatalog::fromJson(QJsonArray{server(QStringLiteral("AX41"), {QStringLiteral("FSN1")}, 37), ex44}, QHR::ProductCatalog::ServerProducts);
+    QCOMPARE(catalog.size(), 4);
+
+    // all offers of an unchanged product are taken over
+    const QHR::ProductCatalog refreshed = QHR::ProductCatalog::fromJson(QJsonArray{ex44, server(QStringLiteral("AX41"), {QStringLiteral("FSN1"), QStringLiteral("HEL1")}, 37)}, QHR::ProductCatalog::ServerProducts, catalog);
+    QCOMPARE(refreshed.size(), 5);
+    QCOMPARE(refreshed.indexOf(QStringLiteral("EX44/FSN1")), 0);
+    QCOMPARE(refreshed.indexOf(QStringLiteral("EX44/HEL1")), 2);
+    QCOMPARE(refreshed.offer(2).price, 46.0);
+    QCOMPARE(refreshed.offer(2).location, QStringLiteral("HEL1"));
+
+    const QHR::ProductCatalog::Changes changes = QHR::ProductCatalog::diff(catalog, refreshed);
+    QCOMPARE(changes.added, QVector<int>({refreshed.indexOf(QStringLiteral("AX41/HEL1"))}));
+    // the offer of the changed product has the hash of the changed product
+    QCOMPARE(changes.changed, QVector<int>({refreshed.indexOf(QStringLiteral("AX41/FSN1"))}));
+    QVERIFY(changes.removed.isEmpty());
+}
+
+void TestProductCatalog::refreshDuplicateOfReused()
+{
+    const QHR::ProductCatalog catalog = QHR::ProductCatalog::fromJson(QJsonArray{market(1, 30)}, QHR::ProductCatalog::ServerMarket);
+
+    // the unchanged product is dropped as duplicate of a changed one, that has to win
+    const QHR::ProductCatalog refreshed = QHR::ProductCatalog::fromJson(QJsonArray{market(1, 35), market(1, 30)}, QHR::ProductCatalog::ServerMarket, catalog);
+    QCOMPARE(refreshed.size(), 1);
+    QCOMPARE(refreshed.offer(0).price, 35.0);
+
+    const QHR::ProductCatalog::Changes changes = QHR::ProductCatalog::diff(catalog, refreshed);
+    QCOMPARE(changes.changed, QVector<int>({0}));
+}
+
+void TestProductCatalog::refreshOtherSource()
+{
+    const QHR::ProductCatalog catalog = QHR::ProductCatalog::fromJson(QJsonArray{market(1, 30)}, QHR::ProductCatalog::ServerMarket);
+
+    // a previous catalog of another source is ignored
+    const QJsonArray products{server(QStringLiteral("1"), {QString()}, 30)};
+    const QHR::ProductCatalog refreshed = QHR::ProductCatalog::fromJson(products, QHR::ProductCatalog::ServerProducts, catalog);
+    QCOMPARE(refreshed.source(), QHR::ProductCatalog::ServerProducts);
+    QCOMPARE(refreshed.size(), 1);
+    QCOMPARE(refreshed.offer(0).id, QStringLiteral("1"));
+    QVERIFY(refreshed.offer(0).location.isEmpty());
+    QCOMPARE(refreshed.offer(0).setupPrice, 39.0);
+}
+
+void TestProductCatalog::diff()
+{
+    const QHR::ProductCatalog catalog = QHR::ProductCatalog::fromJson(QJsonArray{market(1, 30), market(2, 40)}, QHR::ProductCatalog::ServerMarket);
+
+    // everything is added to a null catalog
+    QHR::ProductCatalog::Changes changes = QHR::ProductCatalog::diff(QHR::ProductCatalog(), catalog);
+    QCOMPARE(changes.added, QVector<int>({0, 1}));
+    QVERIFY(changes.changed.isEmpty());
+    QVERIFY(changes.removed.isEmpty());
+
+    // and removed from it
+    changes = QHR::ProductCatalog::diff(catalog, QHR::ProductCatalog());
+    QVERIFY(changes.added.isEmpty());
+    QCOMPARE(changes.removed, QStringList({QStringLiteral("1"), QStringLiteral("2")}));
+
+    QVERIFY(QHR::ProductCatalog::diff(catalog, catalog).isEmpty());
+
+    // catalogs built without a previous one are compared by the data of the offers
+    const QHR::ProductCatalog other = QHR::ProductCatalog::fromJson(QJsonArray{market(3, 10), market(2, 45), market(1, 30)}, QHR::ProductCatalog::ServerMarket);
+    changes = QHR::ProductCatalog::diff(catalog, other);
+    QCOMPARE(changes.added, QVector<int>({0}));
+    QCOMPARE(changes.changed, QVector<int>({1}));
+    QVERIFY(changes.removed.isEmpty());
+}
+
+QTEST_MAIN(TestProductCatalog)
+
+#include "testproductcatalog.moc"
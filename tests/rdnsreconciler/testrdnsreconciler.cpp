@@ -0,0 +1,214 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "rdnsreconciler.h"
+#include "abstractconfiguration.h"
+#include "job.h"
+#include "mockrobotserver.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QUrl>
+#include <QVector>
+
+/*
+ * Checks the changes calculated by RdnsReconciler::diff() and runs the
+ * RdnsReconciler against the local MockRobotServer.
+ */
+
+class TestConfig : public QHR::AbstractConfiguration
+{
+    Q_OBJECT
+public:
+    explicit TestConfig(const QUrl &baseUrl, QObject *parent = nullptr) : QHR::AbstractConfiguration(parent), m_baseUrl(baseUrl) {}
+
+    QString username() const override { return QStringLiteral("#ws+mock"); }
+    QString password() const override { return QStringLiteral("mock"); }
+    QUrl baseUrl() const override { return m_baseUrl; }
+
+private:
+    QUrl m_baseUrl;
+};
+
+class TestRdnsReconciler : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+
+    void diffUnchanged();
+    void diffChanges();
+    void diffDeleteUnlisted();
+    void applyChanges();
+    void updateOnConflict();
+
+private:
+    QHR::MockRobotServer m_server;
+    TestConfig *m_config = nullptr;
+};
+
+void TestRdnsReconciler::initTestCase()
+{
+    QVERIFY(m_server.start());
+    m_config = new TestConfig(m_server.baseUrl(), this);
+}
+
+void TestRdnsReconciler::init()
+{
+    m_server.setLatency(0);
+    m_server.setRdnsEntries({
+        {QStringLiteral("10.0.0.1"), QStringLiteral("one.example.com")},
+        {QStringLiteral("10.0.0.2"), QStringLiteral("two.example.com")},
+        {QStringLiteral("10.0.0.3"), QStringLiteral("three.example.com")}
+    });
+}
+
+void TestRdnsReconciler::diffUnchanged()
+{
+    const QHash<QString, QString> current({
+        {QStringLiteral("10.0.0.1"), QStringLiteral("one.example.com")},
+        {QStringLiteral("2001:db8::1"), QStringLiteral("six.example.com")}
+    });
+
+    // the same state in different notation must not produce any writes
+    const QHash<QString, QString> desired({
+        {QStringLiteral(" 10.0.0.1 "), QStringLiteral("ONE.example.com.")},
+        {QStringLiteral("2001:DB8:0:0::0001"), QStringLiteral(" six.example.com ")},
+        // nothing to delete
+        {QStringLiteral("10.0.0.9"), QString()}
+    });
+
+    QVERIFY(QHR::RdnsReconciler::diff(current, desired).isEmpty());
+    QVERIFY(QHR::RdnsReconciler::diff(current, desired, true).isEmpty());
+    QVERIFY(QHR::RdnsReconciler::diff(QHash<QString, QString>(), QHash<QString, QString>(), true).isEmpty());
+}
+
+void TestRdnsReconciler::diffChanges()
+{
+    const QHash<QString, QString> current({
+        {QStringLiteral("10.0.0.1"), QStringLiteral("one.example.com")},
+        {QStringLiteral("10.0.0.2"), QStringLiteral("two.example.com")},
+        {QStringLiteral("10.0.0.3"), QStringLiteral("three.example.com")}
+    });
+
+    const QHash<QString, QString> desired({
+        {QStringLiteral("10.0.0.2"), QString()},
+        {QStringLiteral("10.0.0.1"), QStringLiteral("changed.example.com")},
+        {QStringLiteral("10.0.0.4"), QStringLiteral("new.example.com")}
+    });
+
+    // unlisted entries are kept by default, the changes are sorted by IP
+    const QVector<QHR::RdnsChange> changes = QHR::RdnsReconciler::diff(current, desired);
+    QCOMPARE(changes.size(), 3);
+
+    QCOMPARE(changes.at(0).ip, QStringLiteral("10.0.0.1"));
+    QCOMPARE(changes.at(0).action, QHR::RdnsChange::Update);
+    QCOMPARE(changes.at(0).ptr, QStringLiteral("changed.example.com"));
+    QCOMPARE(changes.at(0).previousPtr, QStringLiteral("one.example.com"));
+
+    QCOMPARE(changes.at(1).ip, QStringLiteral("10.0.0.2"));
+    QCOMPARE(changes.at(1).action, QHR::RdnsChange::Delete);
+    QVERIFY(changes.at(1).ptr.isEmpty());
+    QCOMPARE(changes.at(1).previousPtr, QStringLiteral("two.example.com"));
+
+    QCOMPARE(changes.at(2).ip, QStringLiteral("10.0.0.4"));
+    QCOMPARE(changes.at(2).action, QHR::RdnsChange::Create);
+    QCOMPARE(changes.at(2).ptr, QStringLiteral("new.example.com"));
+    QVERIFY(changes.at(2).previousPtr.isEmpty());
+
+    for (const QHR::RdnsChange &change : changes) {
+        QVERIFY(change.isOk());
+    }
+}
+
+void TestRdnsReconciler::diffDeleteUnlisted()
+{
+    const QHash<QString, QString> current({
+        {QStringLiteral("10.0.0.1"), QStringLiteral("one.example.com")},
+        {QStringLiteral("10.0.0.2"), QStringLiteral("two.example.com")}
+    });
+
+    const QHash<QString, QString> desired({
+        {QStringLiteral("10.0.0.1"), QStringLiteral("one.example.com")}
+    });
+
+    QVERIFY(QHR::RdnsReconciler::diff(current, desired).isEmpty());
+
+    // the listed notation of the IP is used for the request
+    const QVector<QHR::RdnsChange> changes = QHR::RdnsReconciler::diff(current, desired, true);
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.first().ip, QStringLiteral("10.0.0.2"));
+    QCOMPARE(changes.first().action, QHR::RdnsChange::Delete);
+    QCOMPARE(changes.first().previousPtr, QStringLiteral("two.example.com"));
+
+    QCOMPARE(QHR::RdnsReconciler::diff(current, QHash<QString, QString>(), true).size(), 2);
+}
+
+void TestRdnsReconciler::applyChanges()
+{
+    const quint64 requests = m_server.requestCount();
+
+    QHR::RdnsReconciler reconciler;
+    reconciler.setConfiguration(m_config);
+    reconciler.setDesired({
+        {QStringLiteral("10.0.0.1"), QStringLiteral("ONE.example.com.")},
+        {QStringLiteral("10.0.0.2"), QStringLiteral("new.example.com")},
+        {QStringLiteral("10.0.0.3"), QString()},
+        {QStringLiteral("10.0.0.4"), QStringLiteral("four.example.com")}
+    });
+    QSignalSpy finishedSpy(&reconciler, &QHR::RdnsReconciler::finished);
+
+    reconciler.start();
+
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.first().at(0).toInt(), 3);
+    QCOMPARE(finishedSpy.first().at(1).toInt(), 0);
+    QCOMPARE(finishedSpy.first().at(2).toInt(), 1);
+    QCOMPARE(m_server.requestCount() - requests, static_cast<quint64>(4));
+
+    const QMap<QString, QString> entries = m_server.rdnsEntries();
+    QCOMPARE(entries.value(QStringLiteral("10.0.0.2")), QStringLiteral("new.example.com"));
+    QCOMPARE(entries.value(QStringLiteral("10.0.0.4")), QStringLiteral("four.example.com"));
+    QVERIFY(!entries.contains(QStringLiteral("10.0.0.3")));
+}
+
+void TestRdnsReconciler::updateOnConflict()
+{
+    m_server.setLatency(200);
+    const quint64 requests = m_server.requestCount();
+
+    QHR::RdnsReconciler reconciler;
+    reconciler.setConfiguration(m_config);
+    reconciler.setDesired({{QStringLiteral("10.0.0.5"), QStringLiteral("five.example.com")}});
+    QVector<QHR::RdnsChange> changes;
+    connect(&reconciler, &QHR::RdnsReconciler::changeFinished, this, [&changes](const QHR::RdnsChange &change){
+        changes.push_back(change);
+    });
+    QSignalSpy finishedSpy(&reconciler, &QHR::RdnsReconciler::finished);
+
+    reconciler.start();
+
+    // the listing has been answered without the entry, now it is created by someone else
+    QTRY_COMPARE(m_server.requestCount() - requests, static_cast<quint64>(1));
+    QMap<QString, QString> entries = m_server.rdnsEntries();
+    entries.insert(QStringLiteral("10.0.0.5"), QStringLiteral("other.example.com"));
+    m_server.setRdnsEntries(entries);
+
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.first().at(0).toInt(), 1);
+    QCOMPARE(finishedSpy.first().at(1).toInt(), 0);
+    QCOMPARE(changes.size(), 1);
+    QVERIFY(changes.first().isOk());
+    QCOMPARE(changes.first().action, QHR::RdnsChange::Update);
+    QCOMPARE(m_server.requestCount() - requests, static_cast<quint64>(3));
+    QCOMPARE(m_server.rdnsEntries().value(QStringLiteral("10.0.0.5")), QStringLiteral("five.example.com"));
+}
+
+QTEST_MAIN(TestRdnsReconciler)
+
+#include "testrdnsreconciler.moc"
@@ -0,0 +1,193 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "requestexecutor.h"
+#include "endpoints.h"
+#include "responsecache.h"
+#include "abstractconfiguration.h"
+#include "mockrobotserver.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QElapsedTimer>
+#include <QUrl>
+#include <memory>
+
+/*
+ * Runs requests through RequestExecutor against the local MockRobotServer and
+ * checks that mutating requests invalidate responses cached by jobs.
+ */
+
+class TestConfig : public QHR::AbstractConfiguration
+{
+    Q_OBJECT
+public:
+    TestConfig(const QUrl &baseUrl, QHR::ResponseCache *cache, QObject *parent = nullptr) : QHR::AbstractConfiguration(parent), m_baseUrl(baseUrl), m_cache(cache) {}
+
+    QString username() const override { return QStringLiteral("#ws+mock"); }
+    QString password() const override { return QStringLiteral("mock"); }
+    QUrl baseUrl() const override { return m_baseUrl; }
+    QHR::ResponseCache *responseCache() const override { return m_cache; }
+
+private:
+    QUrl m_baseUrl;
+    QHR::ResponseCache *m_cache;
+};
+
+class TestRequestExecutor : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void submitRequests();
+    void invalidateCacheOnChange();
+    void invalidateCacheOnError();
+    void rejectInvalidPath();
+
+private:
+    QHR::Response run(const QHR::Request &request);
+    QJsonDocument fetch(const QHR::Request &request);
+
+    QHR::MockRobotServer m_server;
+    QHR::ResponseCache m_cache;
+    TestConfig *m_config = nullptr;
+    std::unique_ptr<QHR::RequestExecutor> m_executor;
+};
+
+void TestRequestExecutor::initTestCase()
+{
+    QVERIFY(m_server.start());
+    m_config = new TestConfig(m_server.baseUrl(), &m_cache, this);
+}
+
+void TestRequestExecutor::init()
+{
+    m_server.setServerCount(10);
+    m_cache.clear();
+    m_executor.reset(new QHR::RequestExecutor(m_config));
+}
+
+void TestRequestExecutor::cleanup()
+{
+    m_executor.reset();
+}
+
+QHR::Response TestRequestExecutor::run(const QHR::Request &request)
+{
+    QHR::Response response;
+    bool finished = false;
+    m_executor->submit(request, [&response, &finished](const QHR::Response &r){
+        response = r;
+        finished = true;
+    });
+    QElapsedTimer timer;
+    timer.start();
+    while (!finished && timer.elapsed() < 5000) {
+        QTest::qWait(10);
+    }
+    return response;
+}
+
+QJsonDocument TestRequestExecutor::fetch(const QHR::Request &request)
+{
+    QHR::Job *job = m_executor->createJob(request);
+    QSignalSpy spy(job, &QHR::Job::succeeded);
+    job->start();
+    if (spy.empty() && !spy.wait(5000)) {
+        return QJsonDocument();
+    }
+    return spy.first().first().value<QJsonDocument>();
+}
+
+void TestRequestExecutor::submitRequests()
+{
+    m_executor->setMaxInFlight(2);
+
+    QVector<QHR::Request> requests;
+    for (int i = 0; i < 6; ++i) {
+        QHR::Request r = QHR::makeRequest<QHR::Endpoints::ServerGet>(100000 + i);
+        r.tag = static_cast<quint64>(i);
+        requests.push_back(r);
+    }
+
+    QVector<quint64> tags;
+    m_executor->submit(requests, [&tags](const QHR::Response &r){
+        QVERIFY(r.isOk());
+        tags.push_back(r.tag);
+    });
+
+    QTRY_COMPARE(tags.size(), 6);
+    QVERIFY(m_executor->poolSize() <= 2);
+    QCOMPARE(m_executor->inFlightCount(), 0);
+    QCOMPARE(m_executor->pendingCount(), 0);
+
+    const QHR::Response missing = run(QHR::makeRequest<QHR::Endpoints::ServerGet>(999999));
+    QCOMPARE(missing.error, static_cast<int>(QHR::NotFound));
+    QCOMPARE(missing.apiErrorCode, QStringLiteral("SERVER_NOT_FOUND"));
+}
+
+void TestRequestExecutor::invalidateCacheOnChange()
+{
+    const QString ip = QStringLiteral("10.0.0.1");
+    const QHR::Request get = QHR::makeRequest<QHR::Endpoints::RdnsGet>(ip);
+
+    QCOMPARE(fetch(get).object().value(QStringLiteral("rdns")).toObject().value(QStringLiteral("ptr")).toString(), QStringLiteral("static.1.clients.your-server.de"));
+
+    // answered by the cache
+    const quint64 requests = m_server.requestCount();
+    QCOMPARE(fetch(get).object().value(QStringLiteral("rdns")).toObject().value(QStringLiteral("ptr")).toString(), QStringLiteral("static.1.clients.your-server.de"));
+    QCOMPARE(m_server.requestCount(), requests);
+
+    QHR::Request update = QHR::makeRequest<QHR::Endpoints::RdnsUpdate>(ip);
+    update.form.addQueryItem(QStringLiteral("ptr"), QStringLiteral("changed.example.com"));
+    QVERIFY(run(update).isOk());
+
+    QCOMPARE(fetch(get).object().value(QStringLiteral("rdns")).toObject().value(QStringLiteral("ptr")).toString(), QStringLiteral("changed.example.com"));
+}
+
+void TestRequestExecutor::invalidateCacheOnError()
+{
+    const QHR::Request list = QHR::makeRequest<QHR::Endpoints::RdnsList>();
+    QCOMPARE(fetch(list).array().size(), m_server.rdnsEntries().size());
+    const quint64 requests = m_server.requestCount();
+    QCOMPARE(fetch(list).array().size(), m_server.rdnsEntries().size());
+    QCOMPARE(m_server.requestCount(), requests);
+
+    // the entry exists, so creating it fails, but the request might still have changed the resource
+    QHR::Request create = QHR::makeRequest<QHR::Endpoints::RdnsCreate>(QStringLiteral("10.0.0.2"));
+    create.form.addQueryItem(QStringLiteral("ptr"), QStringLiteral("other.example.com"));
+    const QHR::Response response = run(create);
+    QCOMPARE(response.error, static_cast<int>(QHR::Conflict));
+
+    QCOMPARE(fetch(list).array().size(), m_server.rdnsEntries().size());
+    QCOMPARE(m_server.requestCount() - requests, static_cast<quint64>(2));
+}
+
+void TestRequestExecutor::rejectInvalidPath()
+{
+    const quint64 requests = m_server.requestCount();
+    const QHR::Request request = QHR::makeRequest<QHR::Endpoints::RdnsDelete>(QStringLiteral(".."));
+
+    const QHR::Response response = run(request);
+    QCOMPARE(response.error, static_cast<int>(QHR::InvalidInput));
+
+    QHR::Job *job = m_executor->createJob(request);
+    QSignalSpy spy(job, &QHR::Job::failed);
+    job->start();
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(spy.first().first().toInt(), static_cast<int>(QHR::InvalidInput));
+
+    QCOMPARE(m_server.requestCount(), requests);
+}
+
+QTEST_MAIN(TestRequestExecutor)
+
+#include "testrequestexecutor.moc"
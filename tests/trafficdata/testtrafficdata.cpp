@@ -0,0 +1,212 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2020 Matthias Fehring / www.huessenbergnetz.de
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "trafficdata.h"
+
+#include <QtTest>
+#include <QObject>
+#include <QRegularExpression>
+
+/*
+ * Feeds valid, malformed and truncated replies of /traffic into the scanner
+ * of TrafficData::fromJson().
+ */
+
+class TestTrafficData : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void readDay();
+    void readEscapes();
+    void readEmptyData_data();
+    void readEmptyData();
+    void readNumbers_data();
+    void readNumbers();
+    void rejectInvalid_data();
+    void rejectInvalid();
+    void rejectTruncated();
+
+private:
+    static QByteArray dayPayload();
+    static int errorOffset(const QString &errorString);
+};
+
+QByteArray TestTrafficData::dayPayload()
+{
+    return QByteArrayLiteral(R"({"traffic":{"type":"day","from":"2020-01-01T22","to":"2020-01-02T01",)"
+                             R"("note":"quoted \"]}\\ text","meta":["\"]",{"x":"}\\"},[1,2e3]],)"
+                             R"("data":{"10.0.0.1":{"22":{"in":1.5,"out":0.5,"sum":2.0},"00":{"in":-15,"out":2.5e-1},"23":{"in":1,"out":2}},)"
+                             R"("10.0.0.2":{"in":4,"out":6}}}})");
+}
+
+int TestTrafficData::errorOffset(const QString &errorString)
+{
+    const QRegularExpressionMatch match = QRegularExpression(QStringLiteral("at offset (\\d+)$")).match(errorString);
+    return match.hasMatch() ? match.captured(1).toInt() : -1;
+}
+
+void TestTrafficData::readDay()
+{
+    QString errorString;
+    const QHR::TrafficData traffic = QHR::TrafficData::fromJson(dayPayload(), &errorString);
+    QVERIFY2(!traffic.isNull(), qUtf8Printable(errorString));
+    QCOMPARE(traffic.type(), QHR::TrafficData::Day);
+    QCOMPARE(traffic.from(), QDateTime(QDate(2020, 1, 1), QTime(22, 0), Qt::UTC));
+    QCOMPARE(traffic.to(), QDateTime(QDate(2020, 1, 2), QTime(1, 0), Qt::UTC));
+    QCOMPARE(traffic.ips(), QStringList({QStringLiteral("10.0.0.1"), QStringLiteral("10.0.0.2")}));
+    QCOMPARE(traffic.rowCount(), 4);
+    QCOMPARE(traffic.rowBegin(0), 0);
+    QCOMPARE(traffic.rowEnd(0), 3);
+
+    // rows are sorted by time, the hour after midnight belongs to the next day
+    const QVector<qint64> timestamps = traffic.timestamps();
+    QCOMPARE(timestamps.at(0), QDateTime(QDate(2020, 1, 1), QTime(22, 0), Qt::UTC).toMSecsSinceEpoch());
+    QCOMPARE(timestamps.at(1), QDateTime(QDate(2020, 1, 1), QTime(23, 0), Qt::UTC).toMSecsSinceEpoch());
+    QCOMPARE(timestamps.at(2), QDateTime(QDate(2020, 1, 2), QTime(0, 0), Qt::UTC).toMSecsSinceEpoch());
+
+    QCOMPARE(traffic.values(QHR::TrafficData::In), QVector<double>({1.5, 1.0, -15.0, 4.0}));
+    QCOMPARE(traffic.values(QHR::TrafficData::Out), QVector<double>({0.5, 2.0, 0.25, 6.0}));
+    // a missing sum is calculated from in and out
+    QCOMPARE(traffic.values(QHR::TrafficData::Sum), QVector<double>({2.0, 3.0, -14.75, 10.0}));
+
+    // totals without single values are a row at the begin of the time range
+    QCOMPARE(timestamps.at(3), traffic.from().toMSecsSinceEpoch());
+}
+
+void TestTrafficData::readEscapes()
+{
+    const QByteArray payload = QByteArrayLiteral(R"({"type":"month","from":"2020-01-01","to":"2020-01-31","comment":"a\\b\"c\u00e4",)"
+                                                 R"("data":{"10.0.0.1":{"1\u0035":{"in":1,"out":1}},"2001:db8::\"1\"":{"in":2,"out":2}}})");
+    QString errorString;
+    const QHR::TrafficData traffic = QHR::TrafficData::fromJson(payload, &errorString);
+    QVERIFY2(!traffic.isNull(), qUtf8Printable(errorString));
+    QCOMPARE(traffic.type(), QHR::TrafficData::Month);
+    QCOMPARE(traffic.ips(), QStringList({QStringLiteral("10.0.0.1"), QStringLiteral("2001:db8::\"1\"")}));
+    QCOMPARE(traffic.rowCount(), 2);
+    // an escaped period key is not read as day of the month and falls back to the begin of the range
+    QCOMPARE(traffic.timestamps().first(), traffic.from().toMSecsSinceEpoch());
+}
+
+void TestTrafficData::readEmptyData_data()
+{
+    QTest::addColumn<QByteArray>("payload");
+
+    // PHP encodes empty maps as empty arrays
+    QTest::newRow("php-array") << QByteArrayLiteral(R"({"traffic":{"type":"day","from":"2020-01-01T00","to":"2020-01-01T23","data":[]}})");
+    QTest::newRow("php-array-whitespace") << QByteArrayLiteral(" {\"traffic\" : { \"type\" : \"day\" , \"data\" : [ ] } } \n");
+    QTest::newRow("object") << QByteArrayLiteral(R"({"traffic":{"type":"day","from":"2020-01-01T00","to":"2020-01-01T23","data":{}}})");
+    QTest::newRow("ip-without-values") << QByteArrayLiteral(R"({"type":"day","data":{"10.0.0.1":{}}})");
+}
+
+void TestTrafficData::readEmptyData()
+{
+    QFETCH(QByteArray, payload);
+
+    QString errorString;
+    const QHR::TrafficData traffic = QHR::TrafficData::fromJson(payload, &errorString);
+    QVERIFY2(!traffic.isNull(), qUtf8Printable(errorString));
+    QCOMPARE(traffic.type(), QHR::TrafficData::Day);
+    QCOMPARE(traffic.rowCount(), 0);
+    QCOMPARE(traffic.sum(QHR::TrafficData::Sum), 0.0);
+    QCOMPARE(traffic.peak(QHR::TrafficData::Sum), 0.0);
+}
+
+void TestTrafficData::readNumbers_data()
+{
+    QTest::addColumn<QByteArray>("number");
+    QTest::addColumn<double>("expected");
+
+    QTest::newRow("integer") << QByteArrayLiteral("42") << 42.0;
+    QTest::newRow("zero") << QByteArrayLiteral("0") << 0.0;
+    QTest::newRow("fraction") << QByteArrayLiteral("0.125") << 0.125;
+    QTest::newRow("negative") << QByteArrayLiteral("-12.5") << -12.5;
+    QTest::newRow("negative-zero-fraction") << QByteArrayLiteral("-0.5") << -0.5;
+    QTest::newRow("exponent") << QByteArrayLiteral("1e3") << 1000.0;
+    QTest::newRow("exponent-upper-plus") << QByteArrayLiteral("2.5E+2") << 250.0;
+    QTest::newRow("exponent-negative") << QByteArrayLiteral("5e-3") << 0.005;
+    QTest::newRow("negative-exponent-negative") << QByteArrayLiteral("-1.5e-2") << -0.015;
+    QTest::newRow("exponent-large") << QByteArrayLiteral("1e30") << 1e30;
+    QTest::newRow("exponent-small") << QByteArrayLiteral("1.5e-30") << 1.5e-30;
+    QTest::newRow("long-mantissa") << QByteArrayLiteral("12345678901234567890") << 12345678901234567890.0;
+    QTest::newRow("long-fraction") << QByteArrayLiteral("0.12345678901234567890") << 0.12345678901234567890;
+    QTest::newRow("null") << QByteArrayLiteral("null") << 0.0;
+}
+
+void TestTrafficData::readNumbers()
+{
+    QFETCH(QByteArray, number);
+    QFETCH(double, expected);
+
+    const QByteArray payload = QByteArrayLiteral(R"({"type":"month","from":"2020-01-01","data":{"10.0.0.1":{"01":{"in":)") + number + QByteArrayLiteral(R"(,"out":0}}}})");
+    QString errorString;
+    const QHR::TrafficData traffic = QHR::TrafficData::fromJson(payload, &errorString);
+    QVERIFY2(!traffic.isNull(), qUtf8Printable(errorString));
+    QCOMPARE(traffic.rowCount(), 1);
+    QCOMPARE(traffic.values(QHR::TrafficData::In).first(), expected);
+}
+
+void TestTrafficData::rejectInvalid_data()
+{
+    QTest::addColumn<QByteArray>("payload");
+    QTest::addColumn<QString>("error");
+
+    QTest::newRow("empty") << QByteArray() << QStringLiteral("Object expected");
+    QTest::newRow("array") << QByteArrayLiteral("[]") << QStringLiteral("Object expected");
+    QTest::newRow("missing-data") << QByteArrayLiteral(R"({"traffic":{"type":"day"}})") << QStringLiteral("Missing traffic data");
+    QTest::newRow("trailing-data") << QByteArrayLiteral(R"({"traffic":{"data":[]}} x)") << QStringLiteral("Unexpected data after the end of the object");
+    QTest::newRow("unterminated-string") << QByteArrayLiteral(R"({"traffic":{"type":"da)") << QStringLiteral("Unterminated string");
+    QTest::newRow("trailing-backslash-key") << QByteArrayLiteral(R"({"traffic\)") << QStringLiteral("Unterminated string");
+    QTest::newRow("trailing-backslash-string") << QByteArrayLiteral(R"({"traffic":{"type":"day\)") << QStringLiteral("Unterminated string");
+    QTest::newRow("trailing-backslash-skipped-string") << QByteArrayLiteral(R"({"traffic":{"note":"a\)") << QStringLiteral("Unterminated string");
+    QTest::newRow("trailing-backslash-skipped-array") << QByteArrayLiteral(R"({"traffic":{"note":["a\)") << QStringLiteral("Unterminated object or array");
+    QTest::newRow("unterminated-array") << QByteArrayLiteral(R"({"traffic":{"note":[1,{"a":"]"})") << QStringLiteral("Unterminated object or array");
+    QTest::newRow("missing-colon") << QByteArrayLiteral(R"({"traffic" {}})") << QStringLiteral("Invalid object member");
+    QTest::newRow("missing-value") << QByteArrayLiteral(R"({"note":,"data":[]})") << QStringLiteral("Value expected");
+    QTest::newRow("data-number") << QByteArrayLiteral(R"({"data":5})") << QStringLiteral("Object expected");
+    QTest::newRow("data-string") << QByteArrayLiteral(R"({"data":"10.0.0.1"})") << QStringLiteral("Object expected");
+    QTest::newRow("ip-array") << QByteArrayLiteral(R"({"data":{"10.0.0.1":[1]}})") << QStringLiteral("Object expected");
+    QTest::newRow("ip-key-number") << QByteArrayLiteral(R"({"data":{1:{}}})") << QStringLiteral("String expected");
+    QTest::newRow("total-string") << QByteArrayLiteral(R"({"data":{"10.0.0.1":{"in":"1"}}})") << QStringLiteral("Number expected");
+    QTest::newRow("value-bool") << QByteArrayLiteral(R"({"data":{"10.0.0.1":{"01":{"in":true}}}})") << QStringLiteral("Number expected");
+    QTest::newRow("value-minus") << QByteArrayLiteral(R"({"data":{"10.0.0.1":{"01":{"in":-}}}})") << QStringLiteral("Number expected");
+    QTest::newRow("exponent-without-digits") << QByteArrayLiteral(R"({"data":{"10.0.0.1":{"in":1e}}})") << QStringLiteral("Invalid number exponent");
+    QTest::newRow("exponent-sign-only") << QByteArrayLiteral(R"({"data":{"10.0.0.1":{"in":1e-}}})") << QStringLiteral("Invalid number exponent");
+    QTest::newRow("type-number") << QByteArrayLiteral(R"({"type":1,"data":[]})") << QStringLiteral("String expected");
+}
+
+void TestTrafficData::rejectInvalid()
+{
+    QFETCH(QByteArray, payload);
+    QFETCH(QString, error);
+
+    QString errorString;
+    const QHR::TrafficData traffic = QHR::TrafficData::fromJson(payload, &errorString);
+    QVERIFY(traffic.isNull());
+    QVERIFY2(errorString.startsWith(error), qUtf8Printable(errorString));
+
+    const int offset = errorOffset(errorString);
+    QVERIFY2(offset >= 0 && offset <= payload.size(), qUtf8Printable(errorString));
+}
+
+void TestTrafficData::rejectTruncated()
+{
+    const QByteArray payload = dayPayload();
+    QVERIFY(!QHR::TrafficData::fromJson(payload).isNull());
+
+    // every prefix ends inside the outer object, including after every backslash
+    for (int size = 0; size < payload.size(); ++size) {
+        const QByteArray truncated = payload.left(size);
+        QString errorString;
+        const QHR::TrafficData traffic = QHR::TrafficData::fromJson(truncated, &errorString);
+        QVERIFY2(traffic.isNull(), truncated.constData());
+        QVERIFY2(!errorString.isEmpty(), truncated.constData());
+        const int offset = errorOffset(errorString);
+        QVERIFY2(offset >= 0 && offset <= size, qUtf8Printable(errorString));
+    }
+}
+
+QTEST_MAIN(TestTrafficData)
+
+#include "testtrafficdata.moc"